@@ -0,0 +1,280 @@
+#ifndef BENCHMARK_SUITE_H
+#define BENCHMARK_SUITE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>        // for std::sqrt, std::pow
+#include <cstdint>      // for uint64_t
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+* Building blocks of the parametric benchmark suite in hashmap_perf.cpp: command line options,
+* key and access-pattern generators, repeated timing with summary statistics, and a reporter
+* that prints a table for humans or writes CSV / JSON for scripts.
+*
+* Usage:
+*      ./hashmap_perf                                   // every case, as a table
+*      ./hashmap_perf --size=1000000 --runs=10          // bigger maps, more repetitions
+*      ./hashmap_perf --filter=find --format=json --output=find.json
+*/
+
+/*
+* Command line options. Unknown options print the usage and exit.
+*
+*      --size=N        number of keys in each map (default 100000)
+*      --runs=N        timed repetitions per case and container (default 5)
+*      --filter=TEXT   only run cases whose name contains TEXT
+*      --format=F      text (default), csv or json
+*      --output=PATH   write csv / json to PATH instead of standard output
+*/
+struct BenchmarkOptions {
+    size_t size = 100000;
+    size_t runs = 5;
+    std::string filter;
+    std::string format = "text";
+    std::string output;
+
+    static BenchmarkOptions parse(int argc, char** argv) {
+        BenchmarkOptions options;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&arg](const std::string& name) -> const char* {
+                return arg.rfind(name + "=", 0) == 0 ? arg.c_str() + name.size() + 1 : nullptr;
+            };
+            if (const char* size = value("--size")) {
+                options.size = std::max<size_t>(1, std::stoull(size));
+            } else if (const char* runs = value("--runs")) {
+                options.runs = std::max<size_t>(1, std::stoull(runs));
+            } else if (const char* filter = value("--filter")) {
+                options.filter = filter;
+            } else if (const char* format = value("--format")) {
+                options.format = format;
+            } else if (const char* output = value("--output")) {
+                options.output = output;
+            } else {
+                std::cerr << "usage: " << argv[0] << " [--size=N] [--runs=N] [--filter=TEXT]"
+                          << " [--format=text|csv|json] [--output=PATH]" << '\n';
+                std::exit(arg == "--help" ? 0 : 1);
+            }
+        }
+        if (options.format != "text" && options.format != "csv" && options.format != "json") {
+            std::cerr << "unknown format " << options.format << '\n';
+            std::exit(1);
+        }
+        return options;
+    }
+
+    bool selected(const std::string& name) const {
+        return name.find(filter) != std::string::npos;
+    }
+};
+
+/*
+* Summary of repeated measurements, in nanoseconds per operation.
+*/
+struct BenchmarkStatistics {
+    double min = 0;
+    double median = 0;
+    double mean = 0;
+    double stddev = 0;
+
+    static BenchmarkStatistics of(std::vector<double> samples) {
+        BenchmarkStatistics stats;
+        if (samples.empty()) return stats;
+        std::sort(samples.begin(), samples.end());
+        size_t n = samples.size();
+        stats.min = samples.front();
+        stats.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+        for (double sample : samples) stats.mean += sample;
+        stats.mean /= n;
+        for (double sample : samples) stats.stddev += (sample - stats.mean) * (sample - stats.mean);
+        stats.stddev = n > 1 ? std::sqrt(stats.stddev / (n - 1)) : 0;
+        return stats;
+    }
+};
+
+/*
+* One row of the report: one container on one case. vs_std is the ratio of the median to the
+* median of std::unordered_map on the same case (below 1 = faster than std::unordered_map).
+*/
+struct BenchmarkResult {
+    std::string name;           // the case, e.g. "find/string32/zipf/hit50/cold"
+    std::string container;
+    size_t size = 0;
+    size_t operations = 0;      // per run
+    size_t runs = 0;
+    BenchmarkStatistics ns_per_op;
+    double vs_std = 0;
+};
+
+/*
+* Collects results. In text mode, each case is printed as soon as all of its containers
+* have run; csv and json are written in one go by finish().
+*/
+class BenchmarkReporter {
+public:
+    explicit BenchmarkReporter(const BenchmarkOptions& options) : _options(options) {}
+
+    void add_case(std::vector<BenchmarkResult> results) {
+        double std_median = 0;
+        for (const auto& result : results) {
+            if (result.container == "std::unordered_map") std_median = result.ns_per_op.median;
+        }
+        for (auto& result : results) {
+            result.vs_std = std_median > 0 ? result.ns_per_op.median / std_median : 0;
+        }
+        if (_options.format == "text") print_case(results);
+        _results.insert(_results.end(), results.begin(), results.end());
+    }
+
+    void finish() const {
+        if (_options.format == "text") return;
+        std::ofstream file;
+        if (!_options.output.empty()) file.open(_options.output);
+        std::ostream& out = _options.output.empty() ? std::cout : file;
+        if (_options.format == "csv") {
+            write_csv(out);
+        } else {
+            write_json(out);
+        }
+    }
+
+private:
+    static std::string fixed(double value, int digits) {
+        std::ostringstream stream;
+        stream << std::fixed << std::setprecision(digits) << value;
+        return stream.str();
+    }
+
+    void print_case(const std::vector<BenchmarkResult>& results) const {
+        if (results.empty()) return;
+        std::cout << results.front().name << " (" << results.front().operations << " ops x "
+                  << results.front().runs << " runs, ns/op)" << '\n';
+        for (const auto& result : results) {
+            std::cout << "    " << std::left << std::setw(20) << result.container << std::right
+                      << " median " << std::setw(10) << fixed(result.ns_per_op.median, 1)
+                      << "  min " << std::setw(10) << fixed(result.ns_per_op.min, 1)
+                      << "  stddev " << std::setw(8) << fixed(result.ns_per_op.stddev, 1)
+                      << "  vs std " << fixed(result.vs_std, 2) << '\n';
+        }
+    }
+
+    void write_csv(std::ostream& out) const {
+        out << "case,container,size,operations,runs,min_ns,median_ns,mean_ns,stddev_ns,vs_std\n";
+        for (const auto& result : _results) {
+            out << result.name << ',' << result.container << ',' << result.size << ',' << result.operations << ','
+                << result.runs << ',' << fixed(result.ns_per_op.min, 3) << ',' << fixed(result.ns_per_op.median, 3)
+                << ',' << fixed(result.ns_per_op.mean, 3) << ',' << fixed(result.ns_per_op.stddev, 3) << ','
+                << fixed(result.vs_std, 4) << '\n';
+        }
+    }
+
+    void write_json(std::ostream& out) const {
+        out << "[\n";
+        for (size_t i = 0; i < _results.size(); i++) {
+            const auto& result = _results[i];
+            out << "  {\"case\": \"" << result.name << "\", \"container\": \"" << result.container
+                << "\", \"size\": " << result.size << ", \"operations\": " << result.operations
+                << ", \"runs\": " << result.runs << ", \"min_ns\": " << fixed(result.ns_per_op.min, 3)
+                << ", \"median_ns\": " << fixed(result.ns_per_op.median, 3)
+                << ", \"mean_ns\": " << fixed(result.ns_per_op.mean, 3)
+                << ", \"stddev_ns\": " << fixed(result.ns_per_op.stddev, 3)
+                << ", \"vs_std\": " << fixed(result.vs_std, 4) << "}" << (i + 1 < _results.size() ? "," : "") << '\n';
+        }
+        out << "]\n";
+    }
+
+    const BenchmarkOptions& _options;
+    std::vector<BenchmarkResult> _results;
+};
+
+/*
+* Draws ranks in [0, n) with P(rank = k) proportional to 1 / (k + 1)^exponent, by binary
+* search over the precomputed cumulative distribution. exponent 0.99 is the classic
+* "a few keys get most of the traffic" skew of caches and key-value stores.
+*/
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t n, double exponent) : _cdf(n) {
+        double total = 0;
+        for (size_t k = 0; k < n; k++) {
+            total += 1.0 / std::pow(double(k + 1), exponent);
+            _cdf[k] = total;
+        }
+        for (double& value : _cdf) value /= total;
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng& rng) {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        return std::min<size_t>(std::lower_bound(_cdf.begin(), _cdf.end(), u) - _cdf.begin(), _cdf.size() - 1);
+    }
+
+private:
+    std::vector<double> _cdf;
+};
+
+/*
+* Key generators. Every key type provides make_key(i, length): a different key for every i,
+* drawn from a fixed seed so that every container sees exactly the same keys.
+*/
+inline uint64_t benchmark_mix(uint64_t x) {
+    // splitmix64 finalizer: distinct inputs give distinct, random-looking outputs
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+inline void make_key(uint64_t i, size_t, uint64_t& key) {
+    key = benchmark_mix(i);
+}
+
+inline void make_key(uint64_t i, size_t length, std::string& key) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    key.resize(length);
+    uint64_t state = benchmark_mix(i);
+    for (size_t c = 0; c < length; c++) {
+        if (c % 8 == 0 && c != 0) state = benchmark_mix(state);
+        key[c] = alphabet[(state >> (c % 8 * 8)) % 62];
+    }
+    // the index is spelled out at the end, so that the keys are distinct whatever the length
+    std::string suffix = std::to_string(i);
+    if (suffix.size() <= length) key.replace(length - suffix.size(), suffix.size(), suffix);
+}
+
+/*
+* Evicts the caches by writing a buffer larger than any last-level cache, for "cold" cases.
+* Returns a checksum of the buffer, so that the writes cannot be optimized away.
+*/
+inline size_t evict_caches() {
+    static std::vector<char> buffer(64 << 20);
+    size_t checksum = 0;
+    for (size_t i = 0; i < buffer.size(); i += 64) checksum += ++buffer[i];
+    return checksum;
+}
+
+/*
+* Calls setup(), then times body() (which returns the number of operations it did), runs times.
+* Returns the time per operation of every run.
+*/
+template <typename Setup, typename Body>
+std::vector<double> time_runs(size_t runs, Setup setup, Body body, size_t& operations) {
+    std::vector<double> samples;
+    for (size_t run = 0; run < runs; run++) {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        operations = body();
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        samples.push_back(double(elapsed.count()) / std::max<size_t>(operations, 1));
+    }
+    return samples;
+}
+
+#endif
@@ -0,0 +1,328 @@
+
+#include "concurrent_hashmap.h"
+#include <stdexcept>    // for std::out_of_range
+
+template<typename K, typename M, typename H, typename E>
+ConcurrentHashMap<K, M, H, E>::Table::Table(size_t bucket_count) :
+    mask(bucket_count - 1),
+    buckets(std::make_unique<std::atomic<Node*>[]>(bucket_count)),
+    next(nullptr),
+    migrated(std::make_unique<std::atomic<bool>[]>(kStripes)),
+    migrated_count(0),
+    help_cursor(0) {}
+
+template<typename K, typename M, typename H, typename E>
+ConcurrentHashMap<K, M, H, E>::Table::~Table() {
+    for (size_t i = 0; i <= mask; i++) {
+        Node* node = buckets[i].load(std::memory_order_relaxed);
+        while (node != nullptr) {
+            Node* next_node = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next_node;
+        }
+    }
+}
+
+template<typename K, typename M, typename H, typename E>
+ConcurrentHashMap<K, M, H, E>::ConcurrentHashMap(size_t bucket_count, const H& hash, const E& equal) :
+    _hash_function(hash),
+    _key_equal(equal),
+    _max_load_factor(1.0),
+    _table(new Table(round_up_buckets(bucket_count))),
+    _stripes(std::make_unique<Stripe[]>(kStripes)),
+    _retired_table_count(0) {}
+
+template<typename K, typename M, typename H, typename E>
+ConcurrentHashMap<K, M, H, E>::~ConcurrentHashMap() {
+    // every node belongs to exactly one table: migrated stripes were copied, not moved
+    Table* table = _table.load(std::memory_order_acquire);
+    while (table != nullptr) {
+        Table* next_table = table->next.load(std::memory_order_acquire);
+        delete table;
+        table = next_table;
+    }
+    for (size_t i = 0; i < kStripes; i++) {
+        EpochManager::free_all(_stripes[i].retired);
+    }
+    EpochManager::free_all(_retired_tables);
+}
+
+template<typename K, typename M, typename H, typename E>
+size_t ConcurrentHashMap<K, M, H, E>::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < kStripes; i++) {
+        total += _stripes[i].size.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+template<typename K, typename M, typename H, typename E>
+bool ConcurrentHashMap<K, M, H, E>::empty() const {
+    return size() == 0;
+}
+
+template<typename K, typename M, typename H, typename E>
+size_t ConcurrentHashMap<K, M, H, E>::bucket_count() const {
+    EpochManager::Guard guard(_epochs);
+    return _table.load(std::memory_order_acquire)->mask + 1;
+}
+
+template<typename K, typename M, typename H, typename E>
+float ConcurrentHashMap<K, M, H, E>::max_load_factor() const {
+    return _max_load_factor.load(std::memory_order_relaxed);
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::max_load_factor(float ml) {
+    if (!(ml > 0)) throw std::out_of_range("ConcurrentHashMap<K, M, H, E>::max_load_factor: Invalid Input Parameters");
+    _max_load_factor.store(ml, std::memory_order_relaxed);
+}
+
+template<typename K, typename M, typename H, typename E>
+bool ConcurrentHashMap<K, M, H, E>::contains(const K& key) const {
+    size_t hash = _hash_function(key);
+    EpochManager::Guard guard(_epochs);
+    Table* table = table_for_reader(stripe_of(hash));
+    return find_in_table(table, key, hash).second != nullptr;
+}
+
+template<typename K, typename M, typename H, typename E>
+std::optional<M> ConcurrentHashMap<K, M, H, E>::find(const K& key) const {
+    size_t hash = _hash_function(key);
+    EpochManager::Guard guard(_epochs);
+    Table* table = table_for_reader(stripe_of(hash));
+    Node* node = find_in_table(table, key, hash).second;
+    if (node == nullptr) return std::nullopt;
+    return node->value.second;
+}
+
+template<typename K, typename M, typename H, typename E>
+bool ConcurrentHashMap<K, M, H, E>::insert(const value_type& kv_pair) {
+    size_t hash = _hash_function(kv_pair.first);
+    size_t stripe = stripe_of(hash);
+    EpochManager::Guard guard(_epochs);
+    bool inserted = false;
+    {
+        std::lock_guard<std::mutex> lock(_stripes[stripe].lock);
+        Table* table = table_for_writer(stripe);
+        if (find_in_table(table, kv_pair.first, hash).second == nullptr) {
+            link_node(table, stripe, new Node(hash, nullptr, kv_pair));
+            inserted = true;
+        }
+    }
+    help_migrate();
+    return inserted;
+}
+
+template<typename K, typename M, typename H, typename E>
+bool ConcurrentHashMap<K, M, H, E>::insert_or_assign(const K& key, const M& mapped) {
+    size_t hash = _hash_function(key);
+    size_t stripe = stripe_of(hash);
+    EpochManager::Guard guard(_epochs);
+    bool inserted = false;
+    {
+        std::lock_guard<std::mutex> lock(_stripes[stripe].lock);
+        Table* table = table_for_writer(stripe);
+        auto [link, node] = find_in_table(table, key, hash);
+        if (node != nullptr) {
+            replace_node(stripe, link, node, new Node(hash, nullptr, key, mapped));
+        } else {
+            link_node(table, stripe, new Node(hash, nullptr, key, mapped));
+            inserted = true;
+        }
+    }
+    help_migrate();
+    return inserted;
+}
+
+template<typename K, typename M, typename H, typename E>
+template<typename F>
+bool ConcurrentHashMap<K, M, H, E>::update(const K& key, F&& fn) {
+    size_t hash = _hash_function(key);
+    size_t stripe = stripe_of(hash);
+    EpochManager::Guard guard(_epochs);
+    bool inserted = false;
+    {
+        std::lock_guard<std::mutex> lock(_stripes[stripe].lock);
+        Table* table = table_for_writer(stripe);
+        auto [link, node] = find_in_table(table, key, hash);
+        // nodes are immutable, so modify a copy and swap it in
+        M mapped = (node != nullptr) ? node->value.second : M();
+        std::forward<F>(fn)(mapped);
+        if (node != nullptr) {
+            replace_node(stripe, link, node, new Node(hash, nullptr, key, std::move(mapped)));
+        } else {
+            link_node(table, stripe, new Node(hash, nullptr, key, std::move(mapped)));
+            inserted = true;
+        }
+    }
+    help_migrate();
+    return inserted;
+}
+
+template<typename K, typename M, typename H, typename E>
+bool ConcurrentHashMap<K, M, H, E>::erase(const K& key) {
+    size_t hash = _hash_function(key);
+    size_t stripe = stripe_of(hash);
+    EpochManager::Guard guard(_epochs);
+    bool erased = false;
+    {
+        std::lock_guard<std::mutex> lock(_stripes[stripe].lock);
+        Table* table = table_for_writer(stripe);
+        auto [link, node] = find_in_table(table, key, hash);
+        if (node != nullptr) {
+            link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+            _stripes[stripe].size.fetch_sub(1, std::memory_order_relaxed);
+            retire(stripe, node, delete_node);
+            erased = true;
+        }
+    }
+    help_migrate();
+    return erased;
+}
+
+template<typename K, typename M, typename H, typename E>
+size_t ConcurrentHashMap<K, M, H, E>::round_up_buckets(size_t bucket_count) {
+    size_t buckets = kStripes;
+    while (buckets < bucket_count) buckets <<= 1;
+    return buckets;
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::delete_node(void* node) {
+    delete static_cast<Node*>(node);
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::delete_table(void* table) {
+    delete static_cast<Table*>(table);
+}
+
+template<typename K, typename M, typename H, typename E>
+typename ConcurrentHashMap<K, M, H, E>::Table* ConcurrentHashMap<K, M, H, E>::table_for_reader(size_t stripe) const {
+    Table* table = _table.load(std::memory_order_acquire);
+    Table* next_table = table->next.load(std::memory_order_acquire);
+    while (next_table != nullptr && table->migrated[stripe].load(std::memory_order_acquire)) {
+        table = next_table;
+        next_table = table->next.load(std::memory_order_acquire);
+    }
+    return table;
+}
+
+template<typename K, typename M, typename H, typename E>
+typename ConcurrentHashMap<K, M, H, E>::Table* ConcurrentHashMap<K, M, H, E>::table_for_writer(size_t stripe) {
+    Table* table = _table.load(std::memory_order_acquire);
+    Table* next_table = table->next.load(std::memory_order_acquire);
+    while (next_table != nullptr) {
+        if (!table->migrated[stripe].load(std::memory_order_relaxed)) migrate_stripe(table, stripe);
+        table = next_table;
+        next_table = table->next.load(std::memory_order_acquire);
+    }
+    return table;
+}
+
+template<typename K, typename M, typename H, typename E>
+std::pair<std::atomic<typename ConcurrentHashMap<K, M, H, E>::Node*>*, typename ConcurrentHashMap<K, M, H, E>::Node*>
+ConcurrentHashMap<K, M, H, E>::find_in_table(Table* table, const K& key, size_t hash) const {
+    std::atomic<Node*>* head = &table->buckets[hash & table->mask];
+    std::atomic<Node*>* link = head;
+    Node* node = link->load(std::memory_order_acquire);
+    while (node != nullptr) {
+        if (node->hash == hash && _key_equal(node->value.first, key)) return {link, node};
+        link = &node->next;
+        node = link->load(std::memory_order_acquire);
+    }
+    return {head, nullptr};
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::migrate_stripe(Table* table, size_t stripe) {
+    // the chains of the old table stay intact for readers that are still walking them, so the
+    // nodes are copied; the originals are freed together with the old table
+    Table* target = table->next.load(std::memory_order_acquire);
+    for (size_t index = stripe; index <= table->mask; index += kStripes) {
+        Node* node = table->buckets[index].load(std::memory_order_relaxed);
+        while (node != nullptr) {
+            std::atomic<Node*>& head = target->buckets[node->hash & target->mask];
+            Node* copy = new Node(node->hash, head.load(std::memory_order_relaxed), node->value);
+            head.store(copy, std::memory_order_release);
+            node = node->next.load(std::memory_order_relaxed);
+        }
+    }
+    table->migrated[stripe].store(true, std::memory_order_release);
+
+    if (table->migrated_count.fetch_add(1, std::memory_order_acq_rel) + 1 == kStripes) {
+        // the last stripe is done: publish the new table, and free the old one once no guard can see it
+        _table.store(target, std::memory_order_release);
+        retire_table(table);
+    }
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::link_node(Table* table, size_t stripe, Node* node) {
+    std::atomic<Node*>& head = table->buckets[node->hash & table->mask];
+    node->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    head.store(node, std::memory_order_release);
+    _stripes[stripe].size.fetch_add(1, std::memory_order_relaxed);
+    maybe_grow(table, stripe);
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::replace_node(size_t stripe, std::atomic<Node*>* link, Node* old_node, Node* new_node) {
+    new_node->next.store(old_node->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    link->store(new_node, std::memory_order_release);
+    retire(stripe, old_node, delete_node);
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::retire(size_t stripe, void* object, void (*deleter)(void*)) {
+    auto& retired = _stripes[stripe].retired;
+    _epochs.retire(retired, object, deleter);
+    if (retired.size() % kCollectThreshold == 0) _epochs.collect(retired);
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::maybe_grow(Table* table, size_t stripe) {
+    size_t buckets_per_stripe = (table->mask + 1) / kStripes;
+    if (_stripes[stripe].size.load(std::memory_order_relaxed) <= buckets_per_stripe * max_load_factor()) return;
+    // only the current table may start a resize, and only one resize runs at a time
+    if (_table.load(std::memory_order_acquire) != table) return;
+    if (table->next.load(std::memory_order_acquire) != nullptr) return;
+
+    Table* bigger = new Table(2 * (table->mask + 1));
+    Table* expected = nullptr;
+    if (!table->next.compare_exchange_strong(expected, bigger, std::memory_order_acq_rel)) {
+        delete bigger;
+        return;
+    }
+    migrate_stripe(table, stripe);
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::retire_table(Table* table) {
+    std::lock_guard<std::mutex> lock(_retired_tables_lock);
+    _epochs.retire(_retired_tables, table, delete_table);
+    _retired_table_count.store(_retired_tables.size(), std::memory_order_release);
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::collect_tables() {
+    if (_retired_table_count.load(std::memory_order_acquire) == 0) return;
+    // one collector at a time is enough, the others move on
+    std::unique_lock<std::mutex> lock(_retired_tables_lock, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+    _epochs.collect(_retired_tables);
+    _retired_table_count.store(_retired_tables.size(), std::memory_order_release);
+}
+
+template<typename K, typename M, typename H, typename E>
+void ConcurrentHashMap<K, M, H, E>::help_migrate() {
+    collect_tables();
+    Table* table = _table.load(std::memory_order_acquire);
+    if (table->next.load(std::memory_order_acquire) == nullptr) return;
+    size_t stripe = table->help_cursor.fetch_add(1, std::memory_order_relaxed);
+    if (stripe >= kStripes) return;
+
+    std::lock_guard<std::mutex> lock(_stripes[stripe].lock);
+    if (!table->migrated[stripe].load(std::memory_order_relaxed)) migrate_stripe(table, stripe);
+}
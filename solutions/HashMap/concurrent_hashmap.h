@@ -0,0 +1,240 @@
+#ifndef CONCURRENT_HASHMAP_H
+#define CONCURRENT_HASHMAP_H
+
+#include <atomic>
+#include <mutex>
+#include <memory>       // for std::unique_ptr
+#include <optional>
+#include <functional>   // for std::equal_to
+#include <utility>      // for std::pair
+
+#include "epoch_manager.h"
+#include "hash_functions.h"
+
+/*
+* Template class for a ConcurrentHashMap
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to DefaultHash<K> (see hash_functions.h)
+* E = key equality function type; if not provided, defaults to std::equal_to<K>
+*
+* A thread-safe hash map built on the same separate-chaining design as HashMap (power-of-two
+* bucket array, singly linked chains, cached hash in every node). All member functions may be
+* called concurrently from any number of threads.
+*
+*      - Writers (insert, insert_or_assign, update, erase) lock one of kStripes mutexes, chosen by
+*        the low bits of the hash. The number of buckets is always a multiple of kStripes, so a
+*        stripe owns the same keys before and after a resize, and writers on different stripes
+*        never wait for each other.
+*      - Readers (find, contains) take no lock at all. Nodes are immutable once published: an
+*        update builds a new node and swaps it into the chain. Unlinked nodes are reclaimed with
+*        epoch-based reclamation (see epoch_manager.h), so a reader can never touch freed memory.
+*      - Resizing does not stop the world. The writer that finds its stripe over the maximum load
+*        factor allocates a table twice as large, and from then on the old table is migrated one
+*        stripe at a time: every writer first migrates its own stripe (under the lock it holds
+*        anyway) and then helps with one more stripe. Readers look a key up in the new table if
+*        its stripe has been migrated, and in the old one otherwise. The old table is freed by a
+*        later writer, once no reader can be walking it anymore.
+*
+* Because elements can be replaced or freed at any time by other threads, the interface
+* returns copies of mapped values instead of references or iterators, and there is no iteration.
+*
+* Usage:
+*      ConcurrentHashMap<std::string, int> map;
+*      map.insert({"Avery", 3});                              // from any thread
+*      if (auto value = map.find("Avery")) std::cout << *value;
+*      map.update("Avery", [](int& value) { ++value; });
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - E is function type that with function prototype bool equal(const K& lhs, const K& rhs).
+*      - K and M must be copyable, and M default constructible for update.
+*/
+template<typename K, typename M, typename H = DefaultHash<K>, typename E = std::equal_to<K>>
+class ConcurrentHashMap {
+public:
+    using value_type = std::pair<const K, M>;
+
+    static constexpr size_t kStripes = 128;
+
+    /*
+    * Creates an empty map with at least bucket_count buckets (rounded up to a power of two,
+    * and to at least kStripes).
+    *
+    * Complexity: O(B), B = number of buckets
+    */
+    explicit ConcurrentHashMap(size_t bucket_count = kStripes, const H& hash = H(), const E& equal = E());
+
+    /*
+    * Destructor. Must not run concurrently with any other member function.
+    *
+    * Complexity: O(N + B)
+    */
+    ~ConcurrentHashMap();
+
+    ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+    ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+    /*
+    * Returns the number of elements. While other threads are writing, this is a snapshot
+    * that may already be out of date when it is returned.
+    *
+    * Complexity: O(kStripes)
+    */
+    size_t size() const;
+    bool empty() const;
+
+    /*
+    * Returns the number of buckets of the current table. During a resize, this is the size
+    * of the table that is being migrated.
+    */
+    size_t bucket_count() const;
+
+    /*
+    * Lock-free lookups. find returns a copy of the mapped value, or std::nullopt.
+    *
+    * Complexity: O(1) average case, never blocks
+    */
+    bool contains(const K& key) const;
+    std::optional<M> find(const K& key) const;
+
+    /*
+    * Inserts val if its key is not in the map yet. Returns true if val was inserted.
+    *
+    * Complexity: O(1) amortized average case, plus the migration of up to two stripes during a resize
+    */
+    bool insert(const value_type& val);
+
+    /*
+    * Inserts {key, mapped}, or replaces the mapped value of key. Returns true if key was inserted.
+    */
+    bool insert_or_assign(const K& key, const M& mapped);
+
+    /*
+    * Atomically applies fn to the mapped value of key (a value-initialized M if key is missing),
+    * with no other writer on key in between. Returns true if key was inserted.
+    *
+    * Usage:
+    *      map.update(word, [](int& count) { ++count; });         // a thread-safe counter
+    */
+    template <typename F>
+    bool update(const K& key, F&& fn);
+
+    /*
+    * Erases the element with the given key. Returns true if it was found.
+    */
+    bool erase(const K& key);
+
+    /*
+    * Returns or sets the maximum load factor (default 1.0), the average chain length at which a
+    * stripe starts a resize. Setting it does not resize the map immediately.
+    *
+    * Exceptions: std::out_of_range if ml is not positive.
+    */
+    float max_load_factor() const;
+    void max_load_factor(float ml);
+
+private:
+    /*
+    * An immutable element. Only next changes after the node has been published.
+    */
+    struct Node {
+        value_type value;
+        size_t hash;
+        std::atomic<Node*> next;
+
+        template <typename... Args>
+        Node(size_t hash, Node* next, Args&&... args) :
+            value(std::forward<Args>(args)...), hash(hash), next(next) {}
+    };
+
+    /*
+    * A bucket array. While a table is being replaced, next points to its successor,
+    * and migrated[s] tells whether stripe s has already been copied there.
+    */
+    struct Table {
+        explicit Table(size_t bucket_count);
+        ~Table();
+
+        size_t mask;
+        std::unique_ptr<std::atomic<Node*>[]> buckets;
+        std::atomic<Table*> next;
+        std::unique_ptr<std::atomic<bool>[]> migrated;
+        std::atomic<size_t> migrated_count;
+        std::atomic<size_t> help_cursor;
+    };
+
+    /*
+    * Per-stripe writer state, on its own cache line to avoid false sharing between stripes.
+    */
+    struct alignas(64) Stripe {
+        std::mutex lock;
+        std::atomic<size_t> size{0};
+        EpochManager::retired_list retired;
+    };
+
+    static constexpr size_t kCollectThreshold = 64;
+
+    static size_t stripe_of(size_t hash) { return hash & (kStripes - 1); }
+    static size_t round_up_buckets(size_t bucket_count);
+    static void delete_node(void* node);
+    static void delete_table(void* table);
+
+    /*
+    * Returns the table a reader has to search for stripe s: the newest one that the stripe
+    * has been migrated to.
+    */
+    Table* table_for_reader(size_t stripe) const;
+
+    /*
+    * Returns the table a writer holding the lock of stripe s works on, migrating the stripe
+    * out of every table that is being replaced first.
+    */
+    Table* table_for_writer(size_t stripe);
+
+    /*
+    * Finds the node of key in table, and the atomic pointer that points to it (the bucket, or the
+    * next pointer of its predecessor). Returns {link to the bucket head, nullptr} on a miss.
+    */
+    std::pair<std::atomic<Node*>*, Node*> find_in_table(Table* table, const K& key, size_t hash) const;
+
+    /*
+    * The following functions must be called with the lock of stripe held.
+    */
+    void migrate_stripe(Table* table, size_t stripe);
+    void link_node(Table* table, size_t stripe, Node* node);
+    void replace_node(size_t stripe, std::atomic<Node*>* link, Node* old_node, Node* new_node);
+    void retire(size_t stripe, void* object, void (*deleter)(void*));
+    void maybe_grow(Table* table, size_t stripe);
+
+    /*
+    * Replaced tables go to a list of their own, not to a stripe's: a stripe list is only collected
+    * every kCollectThreshold retirements, which an insert-only workload may never reach, and an old
+    * table still holds the original of every node. retire_table may be called with a stripe lock held;
+    * collect_tables frees the tables no guard can see anymore, and is retried by every writer
+    * (from help_migrate) as long as the list is not empty.
+    */
+    void retire_table(Table* table);
+    void collect_tables();
+
+    /*
+    * Frees replaced tables if possible, then migrates one more stripe of the table being
+    * replaced, if any. Called without any lock held.
+    */
+    void help_migrate();
+
+    /* Private member variables */
+    H _hash_function;
+    E _key_equal;
+    std::atomic<float> _max_load_factor;
+    std::atomic<Table*> _table;
+    mutable EpochManager _epochs;
+    std::unique_ptr<Stripe[]> _stripes;
+    std::mutex _retired_tables_lock;
+    EpochManager::retired_list _retired_tables;     // guarded by _retired_tables_lock
+    std::atomic<size_t> _retired_table_count;       // its size, readable without the lock
+};
+
+#include "concurrent_hashmap.cpp"
+#endif
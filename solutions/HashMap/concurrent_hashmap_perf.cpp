@@ -0,0 +1,109 @@
+#include <random>
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <vector>
+
+#include "hashmap.h"
+#include "concurrent_hashmap.h"
+#include "gtest/gtest.h"
+#include "test_settings.h"
+
+using clock_type = std::chrono::high_resolution_clock;
+using ns = std::chrono::nanoseconds;
+
+#if RUN_TEST_PERF
+// results of the timed loops are written here, so that the optimizer cannot remove the loops
+std::atomic<size_t> benchmark_sink;
+
+/*
+* The baseline: a HashMap behind a single mutex, which is what we used before ConcurrentHashMap.
+*/
+class LockedHashMap {
+public:
+    bool contains(int key) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _map.contains(key);
+    }
+    void insert(const std::pair<const int, int>& kv_pair) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _map.insert(kv_pair);
+    }
+    void erase(int key) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _map.erase(key);
+    }
+
+private:
+    std::mutex _mutex;
+    HashMap<int, int> _map;
+};
+
+/*
+* Runs ops_per_thread operations on each of threads threads against a map prefilled with
+* half of the key range. read_percent of the operations are lookups, the rest are split evenly
+* between inserts and erases, so the size of the map stays about the same.
+* Returns the throughput in million operations per second.
+*/
+template <typename Map>
+double run_mix(size_t threads, int read_percent, size_t ops_per_thread, int key_range) {
+    Map map;
+    for (int i = 0; i < key_range; i += 2) {
+        map.insert({i, i});
+    }
+
+    std::vector<std::thread> workers;
+    auto start = clock_type::now();
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::default_random_engine rng(t + 1);
+            std::uniform_int_distribution<int> key_distribution(0, key_range - 1);
+            std::uniform_int_distribution<int> op_distribution(0, 99);
+            size_t hits = 0;
+            for (size_t i = 0; i < ops_per_thread; i++) {
+                int key = key_distribution(rng);
+                int op = op_distribution(rng);
+                if (op < read_percent) {
+                    hits += map.contains(key);
+                } else if (op % 2 == 0) {
+                    map.insert({key, key});
+                } else {
+                    map.erase(key);
+                }
+            }
+            benchmark_sink += hits;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    auto end = clock_type::now();
+
+    double seconds = std::chrono::duration_cast<ns>(end - start).count() / 1e9;
+    return threads * ops_per_thread / seconds / 1e6;
+}
+
+void benchmark_thread_scaling(int read_percent) {
+    std::cout << "Task: " << read_percent << "/" << 100 - read_percent
+              << " read/write mix over 1,000,000 keys, measured in million ops/sec." << '\n';
+    const size_t ops_per_thread = 200000;
+    const int key_range = 1000000;
+    for (size_t threads : {1, 2, 4, 8, 16}) {
+        double locked = run_mix<LockedHashMap>(threads, read_percent, ops_per_thread, key_range);
+        double concurrent = run_mix<ConcurrentHashMap<int, int>>(threads, read_percent, ops_per_thread, key_range);
+        std::cout << "threads " << std::setw(3) << threads << std::fixed << std::setprecision(2);
+        std::cout << " | HashMap + std::mutex: " << std::setw(8) << locked;
+        std::cout << " | ConcurrentHashMap: " << std::setw(8) << concurrent << '\n';
+    }
+}
+#endif
+
+int main() {
+    std::cout << "Concurrent Performance Test (" << std::thread::hardware_concurrency() << " hardware threads): " << std::endl;
+#if RUN_TEST_PERF
+    benchmark_thread_scaling(90);
+    benchmark_thread_scaling(50);
+#endif
+    return 0;
+}
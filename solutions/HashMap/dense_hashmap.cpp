@@ -0,0 +1,338 @@
+#include "dense_hashmap.h"
+
+template<typename K, typename M, typename H>
+DenseHashMap<K, M, H>::DenseHashMap() : DenseHashMap(kMinBuckets) {};
+
+template<typename K, typename M, typename H>
+DenseHashMap<K, M, H>::DenseHashMap(size_t bucket_count, const H& hash):
+    _size(0),
+    _hash_function(hash),
+    _table(normalize_buckets(bucket_count), Entry{kEmpty, 0}),
+    _values(std::allocator<value_type>().allocate(max_load(_table.size()))) {};
+
+template<typename K, typename M, typename H>
+DenseHashMap<K, M, H>::~DenseHashMap() {
+    destroy_values();
+    std::allocator<value_type>().deallocate(_values, max_load(_table.size()));
+}
+
+template<typename K, typename M, typename H>
+inline size_t DenseHashMap<K, M, H>::size() const {
+    return _size;
+}
+
+template<typename K, typename M, typename H>
+inline bool DenseHashMap<K, M, H>::empty() const {
+    return _size == 0;
+}
+
+template<typename K, typename M, typename H>
+inline float DenseHashMap<K, M, H>::load_factor() const {
+    return ((float) _size) / _table.size();
+}
+
+template<typename K, typename M, typename H>
+inline size_t DenseHashMap<K, M, H>::bucket_count() const {
+    return _table.size();
+}
+
+template<typename K, typename M, typename H>
+bool DenseHashMap<K, M, H>::contains(const K& key) const {
+    return find_bucket(key, tag_of(key)) != npos;
+}
+
+template<typename K, typename M, typename H>
+M& DenseHashMap<K, M, H>::at(const K& key) {
+    size_t bucket = find_bucket(key, tag_of(key));
+    if (bucket == npos) throw std::out_of_range("DenseHashMap<K, M, H>::at: key not found");
+    return _values[_table[bucket].index].second;
+}
+
+template<typename K, typename M, typename H>
+const M& DenseHashMap<K, M, H>::at(const K& key) const {
+    return static_cast<const M&>(const_cast<DenseHashMap<K, M, H> *>(this)->at(key));
+}
+
+template<typename K, typename M, typename H>
+void DenseHashMap<K, M, H>::clear() {
+    destroy_values();
+    std::fill(_table.begin(), _table.end(), Entry{kEmpty, 0});
+}
+
+template<typename K, typename M, typename H>
+std::pair<typename DenseHashMap<K, M, H>::iterator, bool> DenseHashMap<K, M, H>::insert(const value_type& kv_pair) {
+    uint32_t tag = tag_of(kv_pair.first);
+    size_t bucket = find_bucket(kv_pair.first, tag);
+    if (bucket != npos) return {_values + _table[bucket].index, false};
+
+    if (_size == max_load(_table.size())) resize(2 * _table.size());
+    new (&_values[_size]) value_type(kv_pair);
+    _table[find_empty(tag)] = Entry{static_cast<uint32_t>(_size), tag};
+    return {_values + _size++, true};
+}
+
+template<typename K, typename M, typename H>
+bool DenseHashMap<K, M, H>::erase(const K& key) {
+    size_t bucket = find_bucket(key, tag_of(key));
+    if (bucket == npos) return false;
+    erase_bucket(bucket);
+    return true;
+}
+
+template<typename K, typename M, typename H>
+typename DenseHashMap<K, M, H>::iterator DenseHashMap<K, M, H>::erase(const_iterator pos) {
+    size_t index = pos - _values;
+    if (index >= _size) return end();
+    erase_bucket(find_bucket_of_index(tag_of(pos->first), index));
+    return _values + index;
+}
+
+template<typename K, typename M, typename H>
+void DenseHashMap<K, M, H>::rehash(size_t new_buckets) {
+    if (new_buckets == 0) throw std::out_of_range("DenseHashMap<K, M, H>::rehash: Invalid Input Parameters");
+    size_t buckets = normalize_buckets(new_buckets);
+    while (max_load(buckets) < _size) buckets *= 2;
+    resize(buckets);
+}
+
+template<typename K, typename M, typename H>
+typename DenseHashMap<K, M, H>::iterator DenseHashMap<K, M, H>::begin() {
+    return _values;
+}
+
+template<typename K, typename M, typename H>
+typename DenseHashMap<K, M, H>::const_iterator DenseHashMap<K, M, H>::begin() const {
+    return _values;
+}
+
+template<typename K, typename M, typename H>
+typename DenseHashMap<K, M, H>::iterator DenseHashMap<K, M, H>::end() {
+    return _values + _size;
+}
+
+template<typename K, typename M, typename H>
+typename DenseHashMap<K, M, H>::const_iterator DenseHashMap<K, M, H>::end() const {
+    return _values + _size;
+}
+
+template<typename K, typename M, typename H>
+typename DenseHashMap<K, M, H>::iterator DenseHashMap<K, M, H>::find(const K& key) {
+    size_t bucket = find_bucket(key, tag_of(key));
+    return bucket == npos ? end() : _values + _table[bucket].index;
+}
+
+template<typename K, typename M, typename H>
+typename DenseHashMap<K, M, H>::const_iterator DenseHashMap<K, M, H>::find(const K& key) const {
+    return const_cast<DenseHashMap<K, M, H> *>(this)->find(key);
+}
+
+template<typename K, typename M, typename H>
+void DenseHashMap<K, M, H>::debug() {
+    std::cout << "DenseHashMap Debug Info:" << std::endl;
+    std::cout << "Bucket Count=" << bucket_count() << " Size=" << size() << " Load Factor=" << load_factor()
+              << std::endl;
+    for (size_t i = 0; i < _table.size(); i++) {
+        std::cout << "  Bucket-" << i << ": ";
+        if (_table[i].index == kEmpty) {
+            std::cout << "E";
+        } else {
+            std::cout << "[" << _table[i].index << ", " << _table[i].tag << "]";
+        }
+        std::cout << std::endl;
+    }
+    for (size_t i = 0; i < _size; i++) {
+        std::cout << "  Element-" << i << ": " << _values[i].first << "-" << _values[i].second << std::endl;
+    }
+}
+
+template<typename K, typename M, typename H>
+template<typename InputIter>
+DenseHashMap<K, M, H>::DenseHashMap(InputIter begin, InputIter end, size_t bucket_count, const H& hash):
+    DenseHashMap(bucket_count, hash) {
+    for (InputIter iter = begin; iter != end; iter++) {
+        insert(*iter);
+    }
+}
+
+template<typename K, typename M, typename H>
+DenseHashMap<K, M, H>::DenseHashMap(std::initializer_list<value_type> init, size_t bucket_count, const H& hash):
+    DenseHashMap(init.begin(), init.end(), bucket_count, hash) {}
+
+template<typename K, typename M, typename H>
+M& DenseHashMap<K, M, H>::operator[](const K& key) {
+    uint32_t tag = tag_of(key);
+    size_t bucket = find_bucket(key, tag);
+    if (bucket != npos) return _values[_table[bucket].index].second;
+
+    if (_size == max_load(_table.size())) resize(2 * _table.size());
+    new (&_values[_size]) value_type(key, M());
+    _table[find_empty(tag)] = Entry{static_cast<uint32_t>(_size), tag};
+    return _values[_size++].second;
+}
+
+template<typename K, typename M, typename H>
+DenseHashMap<K, M, H>::DenseHashMap(const DenseHashMap<K, M, H>& map):
+    DenseHashMap(map.bucket_count(), map._hash_function) {
+    for (const auto& kv_pair : map) {
+        insert(kv_pair);
+    }
+}
+
+template<typename K, typename M, typename H>
+DenseHashMap<K, M, H>::DenseHashMap(DenseHashMap<K, M, H>&& map):
+    _size(map._size),
+    _hash_function(std::move(map._hash_function)),
+    _table(std::move(map._table)),
+    _values(map._values) {
+
+    map._size = 0;
+    map._table.assign(kMinBuckets, Entry{kEmpty, 0});
+    map._values = std::allocator<value_type>().allocate(max_load(kMinBuckets));
+}
+
+template<typename K, typename M, typename H>
+DenseHashMap<K, M, H>& DenseHashMap<K, M, H>::operator=(const DenseHashMap<K, M, H>& map) {
+    if (this == &map) return *this;
+    clear();
+    _hash_function = map._hash_function;
+    for (const auto& kv_pair : map) {
+        insert(kv_pair);
+    }
+    return *this;
+}
+
+template<typename K, typename M, typename H>
+DenseHashMap<K, M, H>& DenseHashMap<K, M, H>::operator=(DenseHashMap<K, M, H>&& map) {
+    if (this == &map) return *this;
+    destroy_values();
+    std::allocator<value_type>().deallocate(_values, max_load(_table.size()));
+
+    _size = map._size;
+    _hash_function = std::move(map._hash_function);
+    _table = std::move(map._table);
+    _values = map._values;
+
+    map._size = 0;
+    map._table.assign(kMinBuckets, Entry{kEmpty, 0});
+    map._values = std::allocator<value_type>().allocate(max_load(kMinBuckets));
+    return *this;
+}
+
+template<typename K, typename M, typename H>
+size_t DenseHashMap<K, M, H>::normalize_buckets(size_t bucket_count) {
+    size_t buckets = kMinBuckets;
+    while (buckets < bucket_count) buckets *= 2;
+    return buckets;
+}
+
+template<typename K, typename M, typename H>
+size_t DenseHashMap<K, M, H>::find_bucket(const K& key, uint32_t tag) const {
+    size_t mask = _table.size() - 1;
+    for (size_t bucket = home(tag); ; bucket = (bucket + 1) & mask) {
+        const Entry& entry = _table[bucket];
+        if (entry.index == kEmpty) return npos;
+        if (entry.tag == tag && _values[entry.index].first == key) return bucket;
+    }
+}
+
+template<typename K, typename M, typename H>
+size_t DenseHashMap<K, M, H>::find_bucket_of_index(uint32_t tag, uint32_t index) const {
+    size_t mask = _table.size() - 1;
+    for (size_t bucket = home(tag); ; bucket = (bucket + 1) & mask) {
+        if (_table[bucket].index == index) return bucket;
+        if (_table[bucket].index == kEmpty) return npos;
+    }
+}
+
+template<typename K, typename M, typename H>
+size_t DenseHashMap<K, M, H>::find_empty(uint32_t tag) const {
+    size_t mask = _table.size() - 1;
+    size_t bucket = home(tag);
+    while (_table[bucket].index != kEmpty) bucket = (bucket + 1) & mask;
+    return bucket;
+}
+
+template<typename K, typename M, typename H>
+void DenseHashMap<K, M, H>::erase_bucket(size_t bucket) {
+    size_t mask = _table.size() - 1;
+    uint32_t index = _table[bucket].index;
+
+    // backward-shift deletion: an entry may fill the hole if its home is not in (hole, next]
+    size_t hole = bucket;
+    for (size_t next = (hole + 1) & mask; _table[next].index != kEmpty; next = (next + 1) & mask) {
+        size_t distance_to_home = (next - home(_table[next].tag)) & mask;
+        if (distance_to_home >= ((next - hole) & mask)) {
+            _table[hole] = _table[next];
+            hole = next;
+        }
+    }
+    _table[hole] = Entry{kEmpty, 0};
+
+    // swap-and-pop: the last element takes the place of the erased one
+    uint32_t last = static_cast<uint32_t>(_size - 1);
+    _values[index].~value_type();
+    if (index != last) {
+        _table[find_bucket_of_index(tag_of(_values[last].first), last)].index = index;
+        new (&_values[index]) value_type(std::move(_values[last]));
+        _values[last].~value_type();
+    }
+    --_size;
+}
+
+template<typename K, typename M, typename H>
+void DenseHashMap<K, M, H>::resize(size_t new_buckets) {
+    value_type* old_values = _values;
+    size_t old_capacity = max_load(_table.size());
+
+    _values = std::allocator<value_type>().allocate(max_load(new_buckets));
+    for (size_t i = 0; i < _size; i++) {
+        new (&_values[i]) value_type(std::move(old_values[i]));
+        old_values[i].~value_type();
+    }
+    std::allocator<value_type>().deallocate(old_values, old_capacity);
+
+    // the tags hold the low 32 bits of each hash, so the new table is built without hashing any key
+    std::vector<Entry> old_table = std::move(_table);
+    _table.assign(new_buckets, Entry{kEmpty, 0});
+    for (const Entry& entry : old_table) {
+        if (entry.index != kEmpty) _table[find_empty(entry.tag)] = entry;
+    }
+}
+
+template<typename K, typename M, typename H>
+void DenseHashMap<K, M, H>::destroy_values() {
+    for (size_t i = 0; i < _size; i++) {
+        _values[i].~value_type();
+    }
+    _size = 0;
+}
+
+template<typename K, typename M, typename H>
+std::ostream& operator<<(std::ostream& stream, const DenseHashMap<K, M, H>& map) {
+    std::stringstream str_stream;
+    for (const auto& kv_pair : map) {
+        str_stream << kv_pair.first << ":" << kv_pair.second << ", ";
+    }
+    std::string str = str_stream.str();
+    if (str.size() != 0) {
+        str.erase(str.size() - 2, 2);
+    }
+
+    stream << "{" << str << "}";
+    return stream;
+}
+
+template<typename K, typename M, typename H>
+bool operator==(const DenseHashMap<K, M, H>& lhs, const DenseHashMap<K, M, H>& rhs) {
+    if (lhs.size() != rhs.size()) return false;
+    for (const auto& kv_pair : lhs) {
+        auto iter = rhs.find(kv_pair.first);
+        if (iter == rhs.end() || iter->second != kv_pair.second) return false;
+    }
+    return true;
+}
+
+template<typename K, typename M, typename H>
+bool operator!=(const DenseHashMap<K, M, H>& lhs, const DenseHashMap<K, M, H>& rhs) {
+    return !(lhs == rhs);
+}
@@ -0,0 +1,196 @@
+#ifndef DENSE_HASHMAP_H
+#define DENSE_HASHMAP_H
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <memory>       // for std::allocator
+#include <cstdint>      // for uint32_t
+#include <stdexcept>    // for std::out_of_range
+#include <utility>      // for std::pair, std::move
+
+#include "hash_functions.h"
+
+/*
+* Template class for a DenseHashMap
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* DenseHashMap has the same public interface as HashMap, but is built for maps that are
+* iterated over much more often than they are modified:
+*
+*      - all elements live contiguously in one array, in insertion order. There are no nodes,
+*        and iterators are plain pointers into that array, so a full iteration is a sequential
+*        walk over memory, which the hardware prefetcher handles perfectly.
+*      - the hash table itself only stores (index, tag) pairs of 8 bytes each: the position of
+*        the element in the array and the low 32 bits of its (mixed) hash. It uses linear probing,
+*        and the tag filters out almost every other key without touching the elements.
+*      - erase moves the last element into the hole (swap-and-pop), so the array never has gaps.
+*        Iteration order therefore is insertion order until the first erase, which moves the
+*        most recently inserted element into the erased position.
+*      - erase does not leave tombstones: the entries behind the erased one are shifted back
+*        (backward-shift deletion), so lookups never slow down after many erases.
+*
+* The table grows automatically: its number of buckets is always a power of two, and it
+* doubles once 3/4 of the buckets are in use. The element array always has room for exactly
+* that many elements, so both grow together. A map holds at most 2^32 - 1 elements.
+*
+* Iterator invalidation: an insert that grows the map invalidates all iterators, pointers and
+* references. erase invalidates iterators to the erased element and to the last element.
+*
+* Usage:
+*      DenseHashMap<std::string, int> map;
+*      map.insert({"Avery", 3});
+*      for (const auto& [name, count] : map) { ... }      // a plain array walk
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - K and M must be regular (copyable, default constructible, and equality comparable).
+*/
+template<typename K, typename M, typename H = std::hash<K>>
+class DenseHashMap {
+public:
+    using value_type = std::pair<const K, M>;
+    using iterator = value_type*;
+    using const_iterator = const value_type*;
+
+    /*
+    * Default constructor
+    * Creates an empty DenseHashMap with kMinBuckets buckets and the default hash function.
+    *
+    * Complexity: O(1)
+    */
+    DenseHashMap();
+
+    /*
+    * Constructor with bucket_count and hash function as parameters. bucket_count is rounded up
+    * to a power of two (at least kMinBuckets), and room for 3/4 as many elements is reserved.
+    *
+    * Usage:
+    *      DenseHashMap<int, int> map(1000);
+    *
+    * Complexity: O(B), B = number of buckets
+    */
+    explicit DenseHashMap(size_t bucket_count, const H& hash = H());
+
+    /*
+    * Destructor. Destroys every element and releases the element array and the table.
+    *
+    * Complexity: O(N), N = number of elements
+    */
+    ~DenseHashMap();
+
+    inline size_t size() const;
+    inline bool empty() const;
+    inline float load_factor() const;
+    inline size_t bucket_count() const;
+
+    /*
+    * The following functions behave exactly like their HashMap counterparts,
+    * see hashmap.h for the documentation.
+    *
+    * erase(pos) returns pos itself, which then holds the element that used to be last
+    * (or is end() if pos was the last element), so the usual erase-while-iterating loop
+    * still visits every element exactly once.
+    *
+    * Complexity: O(1) average case.
+    */
+    bool contains(const K& key) const;
+    M& at(const K& key);
+    const M& at(const K& key) const;
+    std::pair<iterator, bool> insert(const value_type& val);
+    bool erase(const K& key);
+    iterator erase(const_iterator pos);
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    M& operator[](const K& key);
+
+    /*
+    * Removes all elements. The number of buckets stays the same.
+    *
+    * Complexity: O(N + B)
+    */
+    void clear();
+
+    /*
+    * Rebuilds the table with at least new_buckets buckets, but never fewer than are needed to
+    * hold size() elements, so rehash(1) shrinks the map to fit. The order of the elements is kept.
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0.
+    *
+    * Complexity: O(N + B)
+    */
+    void rehash(size_t new_buckets);
+
+    iterator begin();
+    const_iterator begin() const;
+    iterator end();
+    const_iterator end() const;
+
+    /*
+    * Prints the size, the number of buckets, every bucket (E = empty, or the index and tag of its
+    * entry) and the element array in order.
+    */
+    void debug();
+
+    template<typename InputIter>
+    DenseHashMap(InputIter begin, InputIter end, size_t bucket_count = kMinBuckets, const H& hash = H());
+    DenseHashMap(std::initializer_list<value_type> init, size_t bucket_count = kMinBuckets, const H& hash = H());
+
+    DenseHashMap(const DenseHashMap<K, M, H>& map);
+    DenseHashMap(DenseHashMap<K, M, H>&& map);
+
+    DenseHashMap<K, M, H>& operator=(const DenseHashMap<K, M, H>& map);
+    DenseHashMap<K, M, H>& operator=(DenseHashMap<K, M, H>&& map);
+
+private:
+    /*
+    * A bucket of the table. index is the position of the element in the element array,
+    * or kEmpty. tag is the low 32 bits of the element's mixed hash, which is also where
+    * its home bucket comes from, so the table can be grown and shifted without rehashing keys.
+    */
+    struct Entry {
+        uint32_t index;
+        uint32_t tag;
+    };
+    static constexpr uint32_t kEmpty = static_cast<uint32_t>(-1);
+    static constexpr size_t kMinBuckets = 16;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    /*
+    * The same hash_mix step as FlatHashMap, so that weak hash functions (e.g. the
+    * identity std::hash<int>) still spread their keys over the buckets.
+    */
+    uint32_t tag_of(const K& key) const { return static_cast<uint32_t>(hash_mix(_hash_function(key))); }
+    size_t home(uint32_t tag) const { return tag & (_table.size() - 1); }
+    static size_t max_load(size_t buckets) { return buckets - buckets / 4; }
+    static size_t normalize_buckets(size_t bucket_count);
+
+    /*
+    * find_bucket returns the bucket that holds key (or holds the element at index, for
+    * find_bucket_of_index), or npos. find_empty returns the first empty bucket from tag's home.
+    */
+    size_t find_bucket(const K& key, uint32_t tag) const;
+    size_t find_bucket_of_index(uint32_t tag, uint32_t index) const;
+    size_t find_empty(uint32_t tag) const;
+
+    /*
+    * Removes the element that bucket points to: backward-shifts the entries behind it, then
+    * moves the last element of the array into its place and repoints the last element's entry.
+    */
+    void erase_bucket(size_t bucket);
+    void resize(size_t new_buckets);
+    void destroy_values();
+
+    /* Private member variables */
+    size_t _size;
+    H _hash_function;
+    std::vector<Entry> _table;  // a power of two number of buckets, >= kMinBuckets
+    value_type* _values;        // room for max_load(_table.size()) elements, the first _size are constructed
+};
+
+#include "dense_hashmap.cpp"
+#endif
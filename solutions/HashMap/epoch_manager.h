@@ -0,0 +1,142 @@
+#ifndef EPOCH_MANAGER_H
+#define EPOCH_MANAGER_H
+
+#include <atomic>
+#include <cstdint>      // for uint64_t
+#include <cstddef>      // for size_t
+#include <vector>
+#include <thread>       // for std::this_thread::yield
+
+/*
+* EpochManager
+*
+* Epoch-based memory reclamation (EBR) for lock-free readers, as used by ConcurrentHashMap.
+*
+* A lock-free reader may still be looking at a node that a writer has just unlinked, so the
+* writer cannot delete the node right away. Instead:
+*
+*      - every read (and write) runs inside an EpochManager::Guard. Entering a guard announces the
+*        current global epoch in one of kMaxSlots announcement slots; leaving it clears the slot.
+*      - after unlinking an object, a writer retires it: the global epoch is advanced, and the
+*        object is tagged with the epoch it was retired in.
+*      - an object retired in epoch r can only be reached by guards that announced an epoch <= r,
+*        because guards entered later read the advanced epoch, and therefore see the unlink.
+*        collect() frees every retired object whose tag is smaller than all announced epochs.
+*
+* Guards are cheap (a compare-and-swap on an announcement slot and a fence), never block each
+* other as long as fewer than kMaxSlots threads are inside a guard at the same time, and never
+* wait for writers. Retired lists are not synchronized: the caller keeps one list per lock
+* (e.g. per lock stripe) and only touches it while holding that lock.
+*/
+class EpochManager {
+public:
+    /*
+    * An object waiting to be freed, together with the function that frees it.
+    */
+    struct Retired {
+        uint64_t epoch;
+        void* object;
+        void (*deleter)(void*);
+    };
+    using retired_list = std::vector<Retired>;
+
+    static constexpr size_t kMaxSlots = 256;
+
+    EpochManager() = default;
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    /*
+    * RAII critical section: everything reachable when the guard is created stays allocated
+    * until the guard is destroyed.
+    *
+    * Usage:
+    *      EpochManager::Guard guard(epochs);
+    *      Node* node = bucket.load(std::memory_order_acquire);    // safe to dereference
+    */
+    class Guard {
+    public:
+        explicit Guard(EpochManager& manager) : _slot(manager.enter()) {}
+        ~Guard() { _slot->store(kInactive, std::memory_order_release); }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        std::atomic<uint64_t>* _slot;
+    };
+
+    /*
+    * Tags object with the current epoch and appends it to list. Must be called after the object
+    * has been unlinked, i.e. once no new reader can reach it.
+    */
+    void retire(retired_list& list, void* object, void (*deleter)(void*)) {
+        uint64_t epoch = _global_epoch.fetch_add(1, std::memory_order_acq_rel);
+        list.push_back({epoch, object, deleter});
+    }
+
+    /*
+    * Frees the objects of list that no guard can still reference.
+    */
+    void collect(retired_list& list) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t oldest = _global_epoch.load(std::memory_order_acquire);
+        for (const auto& slot : _slots) {
+            uint64_t epoch = slot.epoch.load(std::memory_order_acquire);
+            if (epoch != kInactive && epoch < oldest) oldest = epoch;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < list.size(); i++) {
+            if (list[i].epoch < oldest) {
+                list[i].deleter(list[i].object);
+            } else {
+                list[kept++] = list[i];
+            }
+        }
+        list.resize(kept);
+    }
+
+    /*
+    * Frees every object of list. Only valid when no guard is active, e.g. in a destructor.
+    */
+    static void free_all(retired_list& list) {
+        for (const auto& retired : list) {
+            retired.deleter(retired.object);
+        }
+        list.clear();
+    }
+
+private:
+    static constexpr uint64_t kInactive = 0;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{kInactive};
+    };
+
+    /*
+    * Claims a free announcement slot and publishes the current epoch in it. Each thread starts
+    * looking at its own preferred slot, so in the common case the first compare-and-swap succeeds.
+    */
+    std::atomic<uint64_t>* enter() {
+        static std::atomic<size_t> next_thread{0};
+        thread_local size_t preferred = next_thread.fetch_add(1, std::memory_order_relaxed) % kMaxSlots;
+
+        size_t index = preferred;
+        while (true) {
+            uint64_t epoch = _global_epoch.load(std::memory_order_acquire);
+            uint64_t expected = kInactive;
+            if (_slots[index].epoch.compare_exchange_strong(expected, epoch, std::memory_order_relaxed)) {
+                // pairs with the fence in collect: either collect sees our slot, or we see its unlinks
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                return &_slots[index].epoch;
+            }
+            index = (index + 1) % kMaxSlots;
+            if (index == preferred) std::this_thread::yield();
+        }
+    }
+
+    std::atomic<uint64_t> _global_epoch{1};
+    Slot _slots[kMaxSlots];
+};
+
+#endif
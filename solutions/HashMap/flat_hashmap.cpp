@@ -0,0 +1,449 @@
+
+#include "flat_hashmap.h"
+
+template<typename K, typename M, typename H>
+FlatHashMap<K, M, H>::FlatHashMap() : FlatHashMap(kGroupWidth) {};
+
+template<typename K, typename M, typename H>
+FlatHashMap<K, M, H>::FlatHashMap(size_t bucket_count, const H& hash):
+    _size(0),
+    _capacity(0),
+    _growth_left(0),
+    _hash_function(hash),
+    _slots(nullptr) {
+    initialize(normalize_capacity(bucket_count));
+};
+
+template<typename K, typename M, typename H>
+FlatHashMap<K, M, H>::~FlatHashMap() {
+    destroy_slots();
+    std::allocator<value_type>().deallocate(_slots, _capacity);
+}
+
+template<typename K, typename M, typename H>
+inline size_t FlatHashMap<K, M, H>::size() const {
+    return _size;
+}
+
+template<typename K, typename M, typename H>
+inline bool FlatHashMap<K, M, H>::empty() const {
+    return _size == 0;
+}
+
+template<typename K, typename M, typename H>
+inline float FlatHashMap<K, M, H>::load_factor() const {
+    return ((float) _size) / _capacity;
+}
+
+template<typename K, typename M, typename H>
+inline size_t FlatHashMap<K, M, H>::bucket_count() const {
+    return _capacity;
+}
+
+template<typename K, typename M, typename H>
+bool FlatHashMap<K, M, H>::contains(const K& key) const {
+    return find_index(key, hash_of(key)) != npos;
+}
+
+template<typename K, typename M, typename H>
+M& FlatHashMap<K, M, H>::at(const K& key) {
+    size_t index = find_index(key, hash_of(key));
+    if (index == npos) throw std::out_of_range("FlatHashMap<K, M, H>::at: key not found");
+    return _slots[index].second;
+}
+
+template<typename K, typename M, typename H>
+const M& FlatHashMap<K, M, H>::at(const K& key) const {
+    return static_cast<const M&>(const_cast<FlatHashMap<K, M, H> *>(this)->at(key));
+}
+
+template<typename K, typename M, typename H>
+void FlatHashMap<K, M, H>::clear() {
+    destroy_slots();
+    std::fill(_ctrl.begin(), _ctrl.begin() + _capacity, kEmpty);
+    _size = 0;
+    _growth_left = max_load(_capacity);
+}
+
+template<typename K, typename M, typename H>
+std::pair<typename FlatHashMap<K, M, H>::iterator, bool> FlatHashMap<K, M, H>::insert(const value_type& kv_pair) {
+    size_t hash = hash_of(kv_pair.first);
+    size_t index = find_index(kv_pair.first, hash);
+    if (index != npos) return {make_iterator(index), false};
+
+    index = prepare_insert(hash);
+    new (&_slots[index]) value_type(kv_pair);
+    set_ctrl(index, h2(hash));
+    ++_size;
+    return {make_iterator(index), true};
+}
+
+template<typename K, typename M, typename H>
+bool FlatHashMap<K, M, H>::erase(const K& key) {
+    size_t index = find_index(key, hash_of(key));
+    if (index == npos) return false;
+    erase_at(index);
+    return true;
+}
+
+template<typename K, typename M, typename H>
+typename FlatHashMap<K, M, H>::iterator FlatHashMap<K, M, H>::erase(const_iterator pos) {
+    size_t index = pos._ctrl - _ctrl.data();
+    if (index >= _capacity) return end();
+    iterator temp = make_iterator(index);
+    ++temp;
+    erase_at(index);
+    return temp;
+}
+
+template<typename K, typename M, typename H>
+void FlatHashMap<K, M, H>::rehash(size_t new_buckets) {
+    if (new_buckets == 0) throw std::out_of_range("FlatHashMap<K,M,H>::rehash: Invalid Input Parameters");
+    size_t new_capacity = normalize_capacity(new_buckets);
+    while (max_load(new_capacity) < _size) new_capacity *= 2;
+    resize(new_capacity);
+}
+
+template<typename K, typename M, typename H>
+typename FlatHashMap<K, M, H>::iterator FlatHashMap<K, M, H>::begin() {
+    iterator iter(_ctrl.data(), _slots);
+    if (!is_full(_ctrl[0])) ++iter;
+    return iter;
+}
+
+template<typename K, typename M, typename H>
+typename FlatHashMap<K, M, H>::const_iterator FlatHashMap<K, M, H>::begin() const {
+    return const_cast<FlatHashMap<K, M, H> *>(this)->begin();
+}
+
+template<typename K, typename M, typename H>
+typename FlatHashMap<K, M, H>::iterator FlatHashMap<K, M, H>::end() {
+    return make_iterator(_capacity);
+}
+
+template<typename K, typename M, typename H>
+typename FlatHashMap<K, M, H>::const_iterator FlatHashMap<K, M, H>::end() const {
+    return const_cast<FlatHashMap<K, M, H> *>(this)->end();
+}
+
+template<typename K, typename M, typename H>
+typename FlatHashMap<K, M, H>::iterator FlatHashMap<K, M, H>::find(const K& key) {
+    size_t index = find_index(key, hash_of(key));
+    return make_iterator(index == npos ? _capacity : index);
+}
+
+template<typename K, typename M, typename H>
+typename FlatHashMap<K, M, H>::const_iterator FlatHashMap<K, M, H>::find(const K& key) const {
+    return const_cast<FlatHashMap<K, M, H> *>(this)->find(key);
+}
+
+template<typename K, typename M, typename H>
+void FlatHashMap<K, M, H>::debug() {
+    std::cout << "FlatHashMap Debug Info:" << std::endl;
+    std::cout << "Capacity=" << bucket_count() << " Size=" << size() << " Load Factor=" << load_factor()
+              << " Growth Left=" << _growth_left << std::endl;
+    for (size_t i = 0; i < _capacity; i++) {
+        if (i % kGroupWidth == 0) std::cout << "Group-" << i / kGroupWidth << ":" << std::endl;
+        std::cout << "  Slot-" << i << ": ";
+        if (_ctrl[i] == kEmpty) {
+            std::cout << "E";
+        } else if (_ctrl[i] == kDeleted) {
+            std::cout << "D";
+        } else {
+            std::cout << "[" << (int) _ctrl[i] << "] " << _slots[i].first << "-" << _slots[i].second;
+        }
+        std::cout << std::endl;
+    }
+}
+
+template<typename K, typename M, typename H>
+template<typename InputIter>
+FlatHashMap<K, M, H>::FlatHashMap(InputIter begin, InputIter end, size_t bucket_count, const H& hash):
+    FlatHashMap(bucket_count, hash) {
+    for (InputIter iter = begin; iter != end; iter++) {
+        insert(*iter);
+    }
+}
+
+template<typename K, typename M, typename H>
+FlatHashMap<K, M, H>::FlatHashMap(std::initializer_list<value_type> init, size_t bucket_count, const H& hash):
+    FlatHashMap(init.begin(), init.end(), bucket_count, hash) {}
+
+template<typename K, typename M, typename H>
+M& FlatHashMap<K, M, H>::operator[](const K& key) {
+    size_t hash = hash_of(key);
+    size_t index = find_index(key, hash);
+    if (index != npos) return _slots[index].second;
+
+    index = prepare_insert(hash);
+    new (&_slots[index]) value_type(key, M());
+    set_ctrl(index, h2(hash));
+    ++_size;
+    return _slots[index].second;
+}
+
+template<typename K, typename M, typename H>
+FlatHashMap<K, M, H>::FlatHashMap(const FlatHashMap<K, M, H>& map):
+    FlatHashMap(map._capacity, map._hash_function) {
+    for (const auto& kv_pair : map) {
+        insert(kv_pair);
+    }
+}
+
+template<typename K, typename M, typename H>
+FlatHashMap<K, M, H>::FlatHashMap(FlatHashMap<K, M, H>&& map):
+    _size(map._size),
+    _capacity(map._capacity),
+    _growth_left(map._growth_left),
+    _hash_function(std::move(map._hash_function)),
+    _ctrl(std::move(map._ctrl)),
+    _slots(map._slots) {
+
+    map._slots = nullptr;
+    map._size = 0;
+    map.initialize(kGroupWidth);
+}
+
+template<typename K, typename M, typename H>
+FlatHashMap<K, M, H>& FlatHashMap<K, M, H>::operator=(const FlatHashMap<K, M, H>& map) {
+    if (this == &map) return *this;
+    clear();
+    _hash_function = map._hash_function;
+    for (const auto& kv_pair : map) {
+        insert(kv_pair);
+    }
+    return *this;
+}
+
+template<typename K, typename M, typename H>
+FlatHashMap<K, M, H>& FlatHashMap<K, M, H>::operator=(FlatHashMap<K, M, H>&& map) {
+    if (this == &map) return *this;
+    destroy_slots();
+    std::allocator<value_type>().deallocate(_slots, _capacity);
+
+    _size = map._size;
+    _capacity = map._capacity;
+    _growth_left = map._growth_left;
+    _hash_function = std::move(map._hash_function);
+    _ctrl = std::move(map._ctrl);
+    _slots = map._slots;
+
+    map._slots = nullptr;
+    map._size = 0;
+    map.initialize(kGroupWidth);
+    return *this;
+}
+
+#if defined(__SSE2__)
+template<typename K, typename M, typename H>
+FlatHashMap<K, M, H>::Group::Group(const ctrl_t* pos) : ctrl(pos) {}
+
+template<typename K, typename M, typename H>
+uint32_t FlatHashMap<K, M, H>::Group::match(ctrl_t h2) const {
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), group));
+}
+
+template<typename K, typename M, typename H>
+uint32_t FlatHashMap<K, M, H>::Group::match_empty() const {
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(kEmpty), group));
+}
+
+template<typename K, typename M, typename H>
+uint32_t FlatHashMap<K, M, H>::Group::match_empty_or_deleted() const {
+    // empty and deleted are the only values with the sign bit set inside a group
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    return _mm_movemask_epi8(group);
+}
+#else
+template<typename K, typename M, typename H>
+FlatHashMap<K, M, H>::Group::Group(const ctrl_t* pos) : ctrl(pos) {}
+
+template<typename K, typename M, typename H>
+uint32_t FlatHashMap<K, M, H>::Group::match(ctrl_t h2) const {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupWidth; i++) {
+        mask |= static_cast<uint32_t>(ctrl[i] == h2) << i;
+    }
+    return mask;
+}
+
+template<typename K, typename M, typename H>
+uint32_t FlatHashMap<K, M, H>::Group::match_empty() const {
+    return match(kEmpty);
+}
+
+template<typename K, typename M, typename H>
+uint32_t FlatHashMap<K, M, H>::Group::match_empty_or_deleted() const {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupWidth; i++) {
+        mask |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+    }
+    return mask;
+}
+#endif
+
+template<typename K, typename M, typename H>
+size_t FlatHashMap<K, M, H>::normalize_capacity(size_t bucket_count) {
+    size_t capacity = kGroupWidth;
+    while (capacity < bucket_count) capacity *= 2;
+    return capacity;
+}
+
+template<typename K, typename M, typename H>
+size_t FlatHashMap<K, M, H>::count_trailing_zeros(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    size_t count = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+template<typename K, typename M, typename H>
+size_t FlatHashMap<K, M, H>::find_index(const K& key, size_t hash) const {
+    size_t group_mask = _capacity / kGroupWidth - 1;
+    size_t group_index = h1(hash) & group_mask;
+    ctrl_t tag = h2(hash);
+    for (size_t probe = 1; ; probe++) {
+        size_t offset = group_index * kGroupWidth;
+        Group group(&_ctrl[offset]);
+        for (uint32_t mask = group.match(tag); mask != 0; mask &= mask - 1) {
+            size_t index = offset + count_trailing_zeros(mask);
+            if (_slots[index].first == key) return index;
+        }
+        if (group.match_empty() != 0) return npos;
+        group_index = (group_index + probe) & group_mask;
+    }
+}
+
+template<typename K, typename M, typename H>
+size_t FlatHashMap<K, M, H>::find_first_non_full(const ctrl_t* ctrl, size_t capacity, size_t hash) {
+    size_t group_mask = capacity / kGroupWidth - 1;
+    size_t group_index = h1(hash) & group_mask;
+    for (size_t probe = 1; ; probe++) {
+        size_t offset = group_index * kGroupWidth;
+        uint32_t mask = Group(&ctrl[offset]).match_empty_or_deleted();
+        if (mask != 0) return offset + count_trailing_zeros(mask);
+        group_index = (group_index + probe) & group_mask;
+    }
+}
+
+template<typename K, typename M, typename H>
+size_t FlatHashMap<K, M, H>::find_first_non_full(size_t hash) const {
+    return find_first_non_full(_ctrl.data(), _capacity, hash);
+}
+
+template<typename K, typename M, typename H>
+size_t FlatHashMap<K, M, H>::prepare_insert(size_t hash) {
+    size_t index = find_first_non_full(hash);
+    if (_growth_left == 0 && _ctrl[index] != kDeleted) {
+        // if at least half of the used slots are tombstones, purging them is enough
+        resize(_size <= max_load(_capacity) / 2 ? _capacity : _capacity * 2);
+        index = find_first_non_full(hash);
+    }
+    if (_ctrl[index] == kEmpty) --_growth_left;
+    return index;
+}
+
+template<typename K, typename M, typename H>
+void FlatHashMap<K, M, H>::set_ctrl(size_t index, ctrl_t ctrl) {
+    _ctrl[index] = ctrl;
+}
+
+template<typename K, typename M, typename H>
+void FlatHashMap<K, M, H>::erase_at(size_t index) {
+    _slots[index].~value_type();
+    --_size;
+
+    // If the group still has an empty slot, no probe sequence has ever passed through
+    // this group, so the slot can become empty again. Otherwise a tombstone is needed
+    // to keep lookups for keys further down the probe sequence working.
+    Group group(&_ctrl[index & ~(kGroupWidth - 1)]);
+    if (group.match_empty() != 0) {
+        set_ctrl(index, kEmpty);
+        ++_growth_left;
+    } else {
+        set_ctrl(index, kDeleted);
+    }
+}
+
+template<typename K, typename M, typename H>
+void FlatHashMap<K, M, H>::resize(size_t new_capacity) {
+    // the new arrays are built on the side, so that the map is left untouched if allocating throws
+    std::vector<ctrl_t> new_ctrl(new_capacity + 1, kEmpty);
+    new_ctrl[new_capacity] = kSentinel;
+    value_type* new_slots = std::allocator<value_type>().allocate(new_capacity);
+
+    for (size_t i = 0; i < _capacity; i++) {
+        if (!is_full(_ctrl[i])) continue;
+        size_t hash = hash_of(_slots[i].first);
+        size_t index = find_first_non_full(new_ctrl.data(), new_capacity, hash);
+        new (&new_slots[index]) value_type(std::move(_slots[i]));
+        new_ctrl[index] = h2(hash);
+        _slots[i].~value_type();
+    }
+    std::allocator<value_type>().deallocate(_slots, _capacity);
+
+    _ctrl.swap(new_ctrl);
+    _slots = new_slots;
+    _capacity = new_capacity;
+    _growth_left = max_load(new_capacity) - _size;
+}
+
+template<typename K, typename M, typename H>
+void FlatHashMap<K, M, H>::initialize(size_t capacity) {
+    _capacity = capacity;
+    _ctrl.assign(capacity + 1, kEmpty);
+    _ctrl[capacity] = kSentinel;
+    _slots = std::allocator<value_type>().allocate(capacity);
+    _growth_left = max_load(capacity);
+}
+
+template<typename K, typename M, typename H>
+void FlatHashMap<K, M, H>::destroy_slots() {
+    if (_size == 0) return;
+    for (size_t i = 0; i < _capacity; i++) {
+        if (is_full(_ctrl[i])) _slots[i].~value_type();
+    }
+}
+
+template<typename K, typename M, typename H>
+typename FlatHashMap<K, M, H>::iterator FlatHashMap<K, M, H>::make_iterator(size_t index) {
+    return iterator(&_ctrl[index], _slots + index);
+}
+
+template<typename K, typename M, typename H>
+std::ostream& operator<<(std::ostream& stream, const FlatHashMap<K, M, H>& map) {
+    std::stringstream str_stream;
+    for (const auto& kv_pair : map) {
+        str_stream << kv_pair.first << ":" << kv_pair.second << ", ";
+    }
+    std::string str = str_stream.str();
+    if (str.size() != 0) {
+        str.erase(str.size() - 2, 2);
+    }
+
+    stream << "{" << str << "}";
+    return stream;
+}
+
+template<typename K, typename M, typename H>
+bool operator==(const FlatHashMap<K, M, H>& lhs, const FlatHashMap<K, M, H>& rhs) {
+    if (lhs.size() != rhs.size()) return false;
+    for (const auto& kv_pair : lhs) {
+        auto iter = rhs.find(kv_pair.first);
+        if (iter == rhs.end() || iter->second != kv_pair.second) return false;
+    }
+    return true;
+}
+
+template<typename K, typename M, typename H>
+bool operator!=(const FlatHashMap<K, M, H>& lhs, const FlatHashMap<K, M, H>& rhs) {
+    return !(lhs == rhs);
+}
@@ -0,0 +1,227 @@
+#ifndef FLAT_HASHMAP_H
+#define FLAT_HASHMAP_H
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <memory>       // for std::allocator
+#include <cstdint>      // for int8_t, uint32_t
+#include <stdexcept>    // for std::out_of_range
+#include <algorithm>    // for std::fill
+#if defined(__SSE2__)
+#include <emmintrin.h>  // for SSE2 intrinsics used to match a group of control bytes
+#endif
+
+#include "flat_hashmap_iterator.h"
+#include "hash_functions.h"
+
+/*
+* Template class for a FlatHashMap
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* FlatHashMap has the same public interface as HashMap, but a completely different storage
+* engine. HashMap keeps each element in its own heap-allocated node, so every lookup is a
+* pointer chase. FlatHashMap instead uses open addressing in the style of Abseil's SwissTable:
+*
+*      - the elements (slots) live inline in one flat array, there are no per-element allocations.
+*      - a parallel array of one-byte control bytes records the state of each slot: empty, deleted,
+*        or full. A full control byte holds the low 7 bits of the element's hash (called H2).
+*      - slots are grouped in groups of 16. A lookup hashes the key once, uses the rest of the
+*        hash (H1) to pick a starting group, and then compares the 16 control bytes of the group
+*        against H2 with a single SSE2 instruction. Only the (rare) H2 matches touch the slots.
+*      - if the group contains an empty slot, the key cannot be further down the probe sequence,
+*        so the lookup stops. Otherwise the next group is probed (triangular/quadratic probing).
+*
+* The table grows automatically: its capacity is always a power of two (at least one group),
+* and it is rehashed into a bigger array once 7/8 of the slots are in use.
+*
+* Iterator invalidation: any insert that causes the table to grow invalidates all iterators,
+* pointers and references. erase only invalidates iterators to the erased element.
+* This is weaker than the guarantees of HashMap, where nodes never move.
+*
+* Usage:
+*      FlatHashMap<std::string, int> map;
+*      map.insert({"Avery", 3});
+*      if (map.contains("Avery")) { ... }
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - K and M must be regular (copyable, default constructible, and equality comparable).
+*/
+template<typename K, typename M, typename H = std::hash<K>>
+class FlatHashMap {
+public:
+    using value_type = std::pair<const K, M>;
+    using iterator = FlatHashMapIterator<FlatHashMap, false>;
+    using const_iterator = FlatHashMapIterator<FlatHashMap, true>;
+
+    friend class FlatHashMapIterator<FlatHashMap, false>;
+    friend class FlatHashMapIterator<FlatHashMap, true>;
+
+    /*
+    * Default constructor
+    * Creates an empty FlatHashMap with one group of slots and the default hash function.
+    *
+    * Complexity: O(1)
+    */
+    FlatHashMap();
+
+    /*
+    * Constructor with bucket_count and hash function as parameters.
+    * bucket_count is the minimal number of slots, it is rounded up to a power of two
+    * which is at least the group width (16).
+    *
+    * Usage:
+    *      FlatHashMap<int, int> map(1000);
+    *
+    * Complexity: O(B), B = number of slots
+    */
+    explicit FlatHashMap(size_t bucket_count, const H& hash = H());
+
+    /*
+    * Destructor. Destroys every element and releases the slot and control arrays.
+    *
+    * Complexity: O(B), B = number of slots
+    */
+    ~FlatHashMap();
+
+    inline size_t size() const;
+    inline bool empty() const;
+    inline float load_factor() const;
+
+    /*
+    * Returns the number of slots. For an open-addressing table a "bucket" is a single slot.
+    */
+    inline size_t bucket_count() const;
+
+    /*
+    * The following functions behave exactly like their HashMap counterparts,
+    * see hashmap.h for the documentation.
+    *
+    * Complexity: O(1) average case. Thanks to the control bytes a lookup usually
+    * probes a single group and compares at most one key.
+    */
+    bool contains(const K& key) const;
+    M& at(const K& key);
+    const M& at(const K& key) const;
+    std::pair<iterator, bool> insert(const value_type& val);
+    bool erase(const K& key);
+    iterator erase(const_iterator pos);
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    M& operator[](const K& key);
+
+    /*
+    * Removes all elements. Unlike HashMap::clear, the capacity stays the same but
+    * every control byte (including tombstones) is reset to empty.
+    *
+    * Complexity: O(B), B = number of slots
+    */
+    void clear();
+
+    /*
+    * Rebuilds the table with at least new_buckets slots. The table never shrinks below
+    * what is needed to hold size() elements under the maximum load factor, so
+    * rehash(1) is a convenient way to shrink to fit. Rehashing also purges tombstones.
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0.
+    *
+    * Complexity: O(N + B)
+    */
+    void rehash(size_t new_buckets);
+
+    iterator begin();
+    const_iterator begin() const;
+    iterator end();
+    const_iterator end() const;
+
+    /*
+    * Prints the size, capacity, and the control byte of each slot (E = empty, D = deleted,
+    * or the H2 value and the element for full slots).
+    */
+    void debug();
+
+    template<typename InputIter>
+    FlatHashMap(InputIter begin, InputIter end, size_t bucket_count = kGroupWidth, const H& hash = H());
+    FlatHashMap(std::initializer_list<value_type> init, size_t bucket_count = kGroupWidth, const H& hash = H());
+
+    FlatHashMap(const FlatHashMap<K, M, H>& map);
+    FlatHashMap(FlatHashMap<K, M, H>&& map);
+
+    FlatHashMap<K, M, H>& operator=(const FlatHashMap<K, M, H>& map);
+    FlatHashMap<K, M, H>& operator=(FlatHashMap<K, M, H>&& map);
+
+private:
+    /*
+    * Control byte values. A full slot stores H2, the low 7 bits of the hash, so its
+    * control byte is non-negative. All special values have the sign bit set, which
+    * lets a group find all empty-or-deleted slots with a single movemask.
+    */
+    using ctrl_t = int8_t;
+    static constexpr ctrl_t kEmpty = -128;     // 0b10000000
+    static constexpr ctrl_t kDeleted = -2;     // 0b11111110
+    static constexpr ctrl_t kSentinel = -1;    // 0b11111111, one past the last slot, ends iteration
+
+    static bool is_full(ctrl_t ctrl) { return ctrl >= 0; }
+    static bool is_sentinel(ctrl_t ctrl) { return ctrl == kSentinel; }
+
+    static constexpr size_t kGroupWidth = 16;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    /*
+    * A view of kGroupWidth consecutive control bytes. Each match function returns a
+    * bitmask where bit i is set iff control byte i satisfies the predicate.
+    * With SSE2 each match is a compare plus a movemask; otherwise it falls back to a loop.
+    */
+    struct Group {
+        explicit Group(const ctrl_t* pos);
+        uint32_t match(ctrl_t h2) const;
+        uint32_t match_empty() const;
+        uint32_t match_empty_or_deleted() const;
+
+        const ctrl_t* ctrl;
+    };
+
+    /*
+    * H1 and H2 are taken from the user's hash after hash_mix (see hash_functions.h), so that weak
+    * hash functions (e.g. the identity std::hash<int>) still spread their keys over the groups
+    * and use all 7 bits of H2.
+    */
+    size_t hash_of(const K& key) const { return hash_mix(_hash_function(key)); }
+    static ctrl_t h2(size_t hash) { return static_cast<ctrl_t>(hash & 0x7F); }
+    static size_t h1(size_t hash) { return hash >> 7; }
+    static size_t max_load(size_t capacity) { return capacity - capacity / 8; }
+    static size_t normalize_capacity(size_t bucket_count);
+    static size_t count_trailing_zeros(uint32_t mask);
+
+    /*
+    * Returns the first empty or deleted slot on the probe sequence of hash, in the given control
+    * bytes (resize probes the new ones before they replace _ctrl) or in _ctrl.
+    */
+    static size_t find_first_non_full(const ctrl_t* ctrl, size_t capacity, size_t hash);
+    size_t find_first_non_full(size_t hash) const;
+
+    size_t find_index(const K& key, size_t hash) const;
+    size_t prepare_insert(size_t hash);
+    void set_ctrl(size_t index, ctrl_t ctrl);
+    void erase_at(size_t index);
+    void resize(size_t new_capacity);
+    void initialize(size_t capacity);
+    void destroy_slots();
+    iterator make_iterator(size_t index);
+
+    /* Private member variables */
+    size_t _size;
+    size_t _capacity;           // number of slots, a power of two >= kGroupWidth
+    size_t _growth_left;        // number of inserts into empty slots left before we must grow
+    H _hash_function;
+    std::vector<ctrl_t> _ctrl;  // _capacity control bytes followed by one kSentinel
+    value_type* _slots;         // _capacity slots, only the full ones hold constructed elements
+};
+
+#include "flat_hashmap.cpp"
+#endif
@@ -0,0 +1,134 @@
+
+#ifndef FLAT_HASHMAP_ITERATOR_H
+#define FLAT_HASHMAP_ITERATOR_H
+
+#include <iterator>     // for std::forward_iterator_tag
+#include <functional>   // for std::conditional_t
+
+/*
+* Template class for an iterator over an open-addressing hash map.
+*
+* Map = the type of map this class is an iterator for.
+* IsConst = whether this is a const_iterator class.
+*
+* Open-addressing maps store their elements inline in an array of slots, and keep
+* a parallel array of one-byte control (metadata) entries telling whether each slot
+* is occupied. The control array ends with a sentinel byte, so incrementing an
+* iterator is a plain walk over the control bytes that stops at the next occupied
+* slot or at the sentinel (which is what end() points to).
+*
+* Concept requirements:
+* - Map must define the types value_type and ctrl_t.
+* - Map must define static bool is_full(ctrl_t) and static bool is_sentinel(ctrl_t).
+*/
+template <typename Map, bool IsConst = true>
+class FlatHashMapIterator {
+public:
+    /*
+    * Same aliases as HashMapIterator, so code written against one iterator
+    * type compiles against the other.
+    */
+    using value_type = std::conditional_t<IsConst, const typename Map::value_type, typename Map::value_type>;
+    using iterator_category =   std::forward_iterator_tag;
+    using difference_type   =   std::ptrdiff_t;
+    using pointer           =   value_type*;
+    using reference         =   value_type&;
+
+    friend Map;
+    friend FlatHashMapIterator<Map, true>;
+    friend FlatHashMapIterator<Map, false>;
+
+    /*
+    * Conversion operator: converts any iterator (iterator or const_iterator) to a const_iterator.
+    *
+    * Usage:
+    *      iterator iter = map.begin();
+    *      const_iterator c_iter = iter;    // implicit conversion
+    */
+    operator FlatHashMapIterator<Map, true>() const {
+        return FlatHashMapIterator<Map, true>(_ctrl, _slot);
+    }
+
+    reference operator*() const;
+    pointer operator->() const;
+
+    FlatHashMapIterator<Map, IsConst>& operator++();
+    FlatHashMapIterator<Map, IsConst> operator++(int);
+
+    template <typename Map_, bool IsConst_>
+    friend bool operator==(const FlatHashMapIterator<Map_, IsConst_>& lhs, const FlatHashMapIterator<Map_, IsConst_>& rhs);
+
+    template <typename Map_, bool IsConst_>
+    friend bool operator!=(const FlatHashMapIterator<Map_, IsConst_>& lhs, const FlatHashMapIterator<Map_, IsConst_>& rhs);
+
+    FlatHashMapIterator(const FlatHashMapIterator<Map, IsConst>& rhs) = default;
+    FlatHashMapIterator<Map, IsConst>& operator=(const FlatHashMapIterator<Map, IsConst>& rhs) = default;
+
+    FlatHashMapIterator(FlatHashMapIterator<Map, IsConst>&& rhs) = default;
+    FlatHashMapIterator<Map, IsConst>& operator=(FlatHashMapIterator<Map, IsConst>&& rhs) = default;
+
+private:
+    using ctrl_t = typename Map::ctrl_t;
+    using slot_type = typename Map::value_type;
+
+    /*
+    * Instance variable: pointer to the control byte of the current slot.
+    * For end(), this points to the sentinel byte past the last slot.
+    */
+    const ctrl_t* _ctrl;
+
+    /*
+    * Instance variable: pointer to the slot this iterator is currently pointing to.
+    */
+    slot_type* _slot;
+
+    /*
+    * Private constructor, only HashMaps can hand out iterators.
+    * The caller must ensure that ctrl points to a full slot or the sentinel.
+    */
+    FlatHashMapIterator(const ctrl_t* ctrl, slot_type* slot);
+};
+
+template<typename Map, bool IsConst>
+typename FlatHashMapIterator<Map, IsConst>::reference FlatHashMapIterator<Map, IsConst>::operator*() const {
+    return *_slot;
+}
+
+template<typename Map, bool IsConst>
+typename FlatHashMapIterator<Map, IsConst>::pointer FlatHashMapIterator<Map, IsConst>::operator->() const {
+    return _slot;
+}
+
+template<typename Map, bool IsConst>
+FlatHashMapIterator<Map, IsConst>::FlatHashMapIterator(const ctrl_t* ctrl, slot_type* slot):
+    _ctrl(ctrl),
+    _slot(slot) {};
+
+template<typename Map, bool IsConst>
+FlatHashMapIterator<Map, IsConst>& FlatHashMapIterator<Map, IsConst>::operator++() {
+    if (Map::is_sentinel(*_ctrl)) return *this;
+    do {
+        ++_ctrl;
+        ++_slot;
+    } while (!Map::is_full(*_ctrl) && !Map::is_sentinel(*_ctrl));
+    return *this;
+}
+
+template<typename Map, bool IsConst>
+FlatHashMapIterator<Map, IsConst> FlatHashMapIterator<Map, IsConst>::operator++(int) {
+    FlatHashMapIterator<Map, IsConst> temp = *this;
+    ++(*this);
+    return temp;
+}
+
+template<typename Map, bool IsConst>
+bool operator==(const FlatHashMapIterator<Map, IsConst>& lhs, const FlatHashMapIterator<Map, IsConst>& rhs) {
+    return lhs._ctrl == rhs._ctrl;
+}
+
+template <typename Map, bool IsConst>
+bool operator!=(const FlatHashMapIterator<Map, IsConst>& lhs, const FlatHashMapIterator<Map, IsConst>& rhs) {
+    return lhs._ctrl != rhs._ctrl;
+}
+
+#endif
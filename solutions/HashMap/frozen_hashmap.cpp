@@ -0,0 +1,280 @@
+#include "frozen_hashmap.h"
+
+#include <algorithm>    // for std::stable_sort, std::find
+
+template<typename K, typename M, typename H, typename E>
+FrozenHashMap<K, M, H, E>::FrozenHashMap() :
+    _size(0),
+    _hash_function(H()),
+    _key_equal(E()),
+    _values(nullptr) {};
+
+template<typename K, typename M, typename H, typename E>
+template<typename InputIter>
+FrozenHashMap<K, M, H, E>::FrozenHashMap(InputIter first, InputIter last, const H& hash, const E& equal) :
+    _size(0),
+    _hash_function(hash),
+    _key_equal(equal),
+    _values(nullptr) {
+
+    std::vector<std::pair<K, M>> staging(first, last);
+    std::vector<Hashed> hashed;
+    hashed.reserve(staging.size());
+    for (size_t i = 0; i < staging.size(); i++) {
+        hashed.push_back({hash_mix(_hash_function(staging[i].first)), i});
+    }
+    build(hashed, [&](size_t source) -> const K& { return staging[source].first; },
+          [&](value_type* slot, size_t source) { new (slot) value_type(std::move(staging[source])); });
+}
+
+template<typename K, typename M, typename H, typename E>
+FrozenHashMap<K, M, H, E>::FrozenHashMap(std::initializer_list<value_type> init, const H& hash, const E& equal) :
+    FrozenHashMap(init.begin(), init.end(), hash, equal) {};
+
+template<typename K, typename M, typename H, typename E>
+FrozenHashMap<K, M, H, E>::FrozenHashMap(const std::vector<std::pair<size_t, const value_type*>>& elements,
+                                         const H& hash, const E& equal) :
+    _size(0),
+    _hash_function(hash),
+    _key_equal(equal),
+    _values(nullptr) {
+
+    std::vector<Hashed> hashed;
+    hashed.reserve(elements.size());
+    for (size_t i = 0; i < elements.size(); i++) {
+        hashed.push_back({hash_mix(elements[i].first), i});
+    }
+    build(hashed, [&](size_t source) -> const K& { return elements[source].second->first; },
+          [&](value_type* slot, size_t source) { new (slot) value_type(*elements[source].second); });
+}
+
+template<typename K, typename M, typename H, typename E>
+FrozenHashMap<K, M, H, E>::~FrozenHashMap() {
+    destroy_values();
+}
+
+template<typename K, typename M, typename H, typename E>
+inline size_t FrozenHashMap<K, M, H, E>::size() const {
+    return _size;
+}
+
+template<typename K, typename M, typename H, typename E>
+inline bool FrozenHashMap<K, M, H, E>::empty() const {
+    return _size == 0;
+}
+
+template<typename K, typename M, typename H, typename E>
+bool FrozenHashMap<K, M, H, E>::contains(const K& key) const {
+    return find(key) != end();
+}
+
+template<typename K, typename M, typename H, typename E>
+size_t FrozenHashMap<K, M, H, E>::count(const K& key) const {
+    return contains(key) ? 1 : 0;
+}
+
+template<typename K, typename M, typename H, typename E>
+const M& FrozenHashMap<K, M, H, E>::at(const K& key) const {
+    const_iterator found = find(key);
+    if (found == end()) throw std::out_of_range("FrozenHashMap<K, M, H, E>::at: key not found");
+    return found->second;
+}
+
+template<typename K, typename M, typename H, typename E>
+typename FrozenHashMap<K, M, H, E>::const_iterator FrozenHashMap<K, M, H, E>::find(const K& key) const {
+    if (_size == 0) return end();
+    size_t hash = hash_mix(_hash_function(key));
+    const value_type* slot = _values + slot_of(hash);
+    return _key_equal(slot->first, key) ? slot : end();
+}
+
+template<typename K, typename M, typename H, typename E>
+typename FrozenHashMap<K, M, H, E>::const_iterator FrozenHashMap<K, M, H, E>::begin() const {
+    return _values;
+}
+
+template<typename K, typename M, typename H, typename E>
+typename FrozenHashMap<K, M, H, E>::const_iterator FrozenHashMap<K, M, H, E>::end() const {
+    return _values + _size;
+}
+
+template<typename K, typename M, typename H, typename E>
+FrozenHashMap<K, M, H, E>::FrozenHashMap(const FrozenHashMap<K, M, H, E>& map) :
+    _size(0),
+    _hash_function(map._hash_function),
+    _key_equal(map._key_equal),
+    _pilots(map._pilots),
+    _remap(map._remap),
+    _values(nullptr) {
+
+    if (map._size == 0) return;
+    // the pilots and the remap table stay valid as long as every element keeps its slot
+    _values = std::allocator<value_type>().allocate(map._size);
+    try {
+        for (; _size < map._size; _size++) {
+            new (&_values[_size]) value_type(map._values[_size]);
+        }
+    } catch (...) {
+        for (size_t i = 0; i < _size; i++) {
+            _values[i].~value_type();
+        }
+        std::allocator<value_type>().deallocate(_values, map._size);
+        throw;
+    }
+}
+
+template<typename K, typename M, typename H, typename E>
+FrozenHashMap<K, M, H, E>::FrozenHashMap(FrozenHashMap<K, M, H, E>&& map) :
+    _size(map._size),
+    _hash_function(std::move(map._hash_function)),
+    _key_equal(std::move(map._key_equal)),
+    _pilots(std::move(map._pilots)),
+    _remap(std::move(map._remap)),
+    _values(map._values) {
+
+    map._size = 0;
+    map._pilots.clear();
+    map._remap.clear();
+    map._values = nullptr;
+}
+
+template<typename K, typename M, typename H, typename E>
+FrozenHashMap<K, M, H, E>& FrozenHashMap<K, M, H, E>::operator=(const FrozenHashMap<K, M, H, E>& map) {
+    if (this == &map) return *this;
+    FrozenHashMap<K, M, H, E> copy(map);
+    return *this = std::move(copy);
+}
+
+template<typename K, typename M, typename H, typename E>
+FrozenHashMap<K, M, H, E>& FrozenHashMap<K, M, H, E>::operator=(FrozenHashMap<K, M, H, E>&& map) {
+    if (this == &map) return *this;
+    destroy_values();
+
+    _size = map._size;
+    _hash_function = std::move(map._hash_function);
+    _key_equal = std::move(map._key_equal);
+    _pilots = std::move(map._pilots);
+    _remap = std::move(map._remap);
+    _values = map._values;
+
+    map._size = 0;
+    map._pilots.clear();
+    map._remap.clear();
+    map._values = nullptr;
+    return *this;
+}
+
+template<typename K, typename M, typename H, typename E>
+template<typename KeyOf, typename Construct>
+void FrozenHashMap<K, M, H, E>::build(std::vector<Hashed>& hashed, KeyOf key_of, Construct construct) {
+    // group the elements by bucket (a counting sort, stable, so the sources stay in order)
+    size_t buckets = std::max<size_t>((hashed.size() + kAverageBucketSize - 1) / kAverageBucketSize, 1);
+    std::vector<size_t> bucket_start(buckets + 1, 0);
+    for (const Hashed& element : hashed) {
+        bucket_start[bucket_of(element.hash, buckets) + 1]++;
+    }
+    for (size_t bucket = 0; bucket < buckets; bucket++) {
+        bucket_start[bucket + 1] += bucket_start[bucket];
+    }
+    std::vector<Hashed> grouped(hashed.size());
+    std::vector<size_t> next(bucket_start.begin(), bucket_start.end() - 1);
+    for (const Hashed& element : hashed) {
+        grouped[next[bucket_of(element.hash, buckets)]++] = element;
+    }
+
+    // drop the duplicate keys, keeping the first one. Equal keys have equal hashes, so they
+    // are in the same bucket, and buckets only hold a handful of elements
+    size_t unique = 0;
+    for (size_t bucket = 0; bucket < buckets; bucket++) {
+        size_t first = unique;
+        for (size_t i = bucket_start[bucket]; i < bucket_start[bucket + 1]; i++) {
+            bool duplicate = false;
+            for (size_t kept = first; kept < unique && !duplicate; kept++) {
+                if (grouped[kept].hash != grouped[i].hash) continue;
+                if (!_key_equal(key_of(grouped[kept].source), key_of(grouped[i].source))) {
+                    throw std::length_error("FrozenHashMap<K, M, H, E>: two different keys have the same hash");
+                }
+                duplicate = true;
+            }
+            if (!duplicate) grouped[unique++] = grouped[i];
+        }
+        bucket_start[bucket] = first;
+    }
+    bucket_start[buckets] = unique;
+    hashed = std::move(grouped);
+    hashed.resize(unique);
+    if (unique == 0) return;
+
+    // the largest buckets are the hardest to place, so they go first, while most slots are free
+    std::vector<size_t> order(buckets);
+    for (size_t bucket = 0; bucket < buckets; bucket++) {
+        order[bucket] = bucket;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return bucket_start[lhs + 1] - bucket_start[lhs] > bucket_start[rhs + 1] - bucket_start[rhs];
+    });
+
+    size_t positions = (unique * 100 + kLoadPercent - 1) / kLoadPercent;
+    std::vector<uint32_t> pilots(buckets, 0);
+    std::vector<bool> taken(positions, false);     // one bit per position, so it stays in the cache
+    std::vector<size_t> found;
+    for (size_t bucket : order) {
+        size_t first = bucket_start[bucket], last = bucket_start[bucket + 1];
+        if (first == last) break;
+        for (uint64_t pilot = 0; ; pilot++) {
+            if (pilot > UINT32_MAX) throw std::length_error("FrozenHashMap<K, M, H, E>: no pilot fits a bucket");
+            found.clear();
+            for (size_t i = first; i < last; i++) {
+                size_t position = position_of(hashed[i].hash, static_cast<uint32_t>(pilot), positions);
+                if (taken[position] || std::find(found.begin(), found.end(), position) != found.end()) break;
+                found.push_back(position);
+            }
+            if (found.size() == last - first) {
+                pilots[bucket] = static_cast<uint32_t>(pilot);
+                for (size_t position : found) taken[position] = true;
+                break;
+            }
+        }
+    }
+
+    // exactly as many positions >= unique are taken as slots < unique are free: pair them up
+    std::vector<uint32_t> remap(positions - unique, 0);
+    size_t free_slot = 0;
+    for (size_t position = unique; position < positions; position++) {
+        if (!taken[position]) continue;
+        while (taken[free_slot]) free_slot++;
+        remap[position - unique] = static_cast<uint32_t>(free_slot++);
+    }
+    _pilots = std::move(pilots);
+    _remap = std::move(remap);
+    _size = unique;
+
+    value_type* values = std::allocator<value_type>().allocate(unique);
+    size_t constructed = 0;
+    try {
+        for (; constructed < unique; constructed++) {
+            construct(values + slot_of(hashed[constructed].hash), hashed[constructed].source);
+        }
+    } catch (...) {
+        for (size_t i = 0; i < constructed; i++) {
+            values[slot_of(hashed[i].hash)].~value_type();
+        }
+        std::allocator<value_type>().deallocate(values, unique);
+        _size = 0;
+        _pilots.clear();
+        _remap.clear();
+        throw;
+    }
+    _values = values;
+}
+
+template<typename K, typename M, typename H, typename E>
+void FrozenHashMap<K, M, H, E>::destroy_values() {
+    if (_values == nullptr) return;
+    for (size_t i = 0; i < _size; i++) {
+        _values[i].~value_type();
+    }
+    std::allocator<value_type>().deallocate(_values, _size);
+    _size = 0;
+    _values = nullptr;
+}
@@ -0,0 +1,170 @@
+#ifndef FROZEN_HASHMAP_H
+#define FROZEN_HASHMAP_H
+
+#include <vector>
+#include <memory>       // for std::allocator
+#include <cstdint>      // for uint32_t
+#include <stdexcept>    // for std::out_of_range, std::length_error
+#include <utility>      // for std::pair, std::move
+#include <functional>   // for std::equal_to
+#include <initializer_list>
+
+#include "hash_functions.h"
+
+/*
+* Template class for a FrozenHashMap
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to DefaultHash<K> (see hash_functions.h)
+* E = key equality function type used to compare two keys; if not provided, defaults to std::equal_to<K>
+*
+* FrozenHashMap is an immutable map for data that is built once and then only read. It is usually
+* made by HashMap::freeze(), or built directly from a range of elements. Lookups cost exactly one
+* probe into the element array and one key compare, hit or miss:
+*
+*      - the elements live in one flat array of exactly size() slots. There are no nodes, no
+*        next pointers and no empty slots, so the map costs sizeof(value_type) + about 1.5 bytes
+*        per element, and no element is allocated on its own.
+*      - the slot of a key comes from a minimal perfect hash function (CHD, "compress, hash and
+*        displace", with the remapping of PTHash): the keys are split into buckets of
+*        kAverageBucketSize keys on average, and every bucket stores one 32-bit pilot, chosen at
+*        build time so that the positions of all keys of all buckets are distinct. Positions range
+*        over size() * 100 / kLoadPercent places, and the few keys whose position is size() or
+*        more are remapped to the slots below size() that no key took. A lookup hashes the key,
+*        reads the pilot of its bucket, combines both into the position (reading the remap table
+*        for about 10% of the keys) and compares the key in that slot.
+*      - construction places the largest buckets first and tries pilots 0, 1, 2, ... until all
+*        keys of the bucket land on free positions. Since at least 10% of the positions stay
+*        free, that takes a few trials per key.
+*
+* Iteration visits the elements in slot order, which is unrelated to the insertion order.
+*
+* Usage:
+*      HashMap<std::string, int> map = ...;
+*      FrozenHashMap<std::string, int> frozen = map.freeze();
+*      int count = frozen.at("Avery");
+*
+* Exceptions: construction throws std::length_error if two different keys have the same hash under H,
+* since no function of the hash can tell them apart. std::hash is injective for the integer types,
+* and collisions of 64-bit hashes such as DefaultHash are vanishingly rare, but a deliberately
+* weak H (e.g. one that returns a constant) cannot be frozen.
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - E is function type that with function prototype bool equal(const K& lhs, const K& rhs).
+*      - K and M must be copyable, or movable for the range constructor.
+*      - the map holds at most 2^32 - 1 elements.
+*/
+template<typename K, typename M, typename H = DefaultHash<K>, typename E = std::equal_to<K>>
+class FrozenHashMap {
+public:
+    using value_type = std::pair<const K, M>;
+    using iterator = const value_type*;
+    using const_iterator = const value_type*;
+
+    /*
+    * Default constructor: creates an empty FrozenHashMap.
+    *
+    * Complexity: O(1)
+    */
+    FrozenHashMap();
+
+    /*
+    * Range constructor: builds the map from the elements in [first, last). If a key appears more
+    * than once, the first element with that key is kept, as with HashMap::insert.
+    *
+    * Usage:
+    *      std::vector<std::pair<int, int>> vec {{1, 2}, {3, 4}};
+    *      FrozenHashMap<int, int> frozen(vec.begin(), vec.end());
+    *
+    * Complexity: O(N), N = std::distance(first, last)
+    */
+    template<typename InputIter>
+    FrozenHashMap(InputIter first, InputIter last, const H& hash = H(), const E& equal = E());
+    FrozenHashMap(std::initializer_list<value_type> init, const H& hash = H(), const E& equal = E());
+
+    ~FrozenHashMap();
+
+    inline size_t size() const;
+    inline bool empty() const;
+
+    /*
+    * The following functions behave exactly like their HashMap counterparts,
+    * see hashmap.h for the documentation. at throws std::out_of_range if key is not in the map.
+    *
+    * Complexity: O(1) worst case: one hash, one pilot, one key compare.
+    */
+    bool contains(const K& key) const;
+    size_t count(const K& key) const;
+    const M& at(const K& key) const;
+    const_iterator find(const K& key) const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    FrozenHashMap(const FrozenHashMap<K, M, H, E>& map);
+    FrozenHashMap(FrozenHashMap<K, M, H, E>&& map);
+
+    FrozenHashMap<K, M, H, E>& operator=(const FrozenHashMap<K, M, H, E>& map);
+    FrozenHashMap<K, M, H, E>& operator=(FrozenHashMap<K, M, H, E>&& map);
+
+private:
+    // HashMap::freeze builds the map straight from the nodes and their cached hashes
+    template<typename, typename, typename, typename, typename> friend class HashMap;
+
+    /*
+    * Builds the map from elements, given as (hash under H, element) pairs of distinct keys.
+    */
+    FrozenHashMap(const std::vector<std::pair<size_t, const value_type*>>& elements, const H& hash, const E& equal);
+
+    static constexpr size_t kAverageBucketSize = 4;
+    static constexpr size_t kLoadPercent = 90;
+
+    /*
+    * An element to place: its mixed hash (hash_mix of H, as in FlatHashMap, so that weak hash
+    * functions still spread their keys over the buckets and the slots), and its index in the
+    * source of the build.
+    */
+    struct Hashed {
+        size_t hash;
+        size_t source;
+    };
+
+    /*
+    * bucket_of maps a mixed hash to its bucket with fastrange, which keeps
+    * the order of the hashes, so elements sorted by hash are also grouped by bucket.
+    * position_of combines the hash with a pilot into a position in [0, positions).
+    * slot_of is the slot of the element with the given mixed hash.
+    */
+    static size_t bucket_of(size_t hash, size_t buckets) {
+        return fastrange(hash, buckets);
+    }
+    static size_t position_of(size_t hash, uint32_t pilot, size_t positions) {
+        return fastrange(hash_mix(hash ^ hash_mix(pilot + 1)), positions);
+    }
+    size_t slot_of(size_t hash) const {
+        size_t position = position_of(hash, _pilots[bucket_of(hash, _pilots.size())], _size + _remap.size());
+        return position < _size ? position : _remap[position - _size];
+    }
+
+    /*
+    * Drops duplicate keys (keeping the lowest source index), chooses the pilots, fills the remap
+    * table and constructs every element in its slot. key_of(source) returns the key of a source
+    * element, and construct(slot, source) constructs it at slot.
+    */
+    template<typename KeyOf, typename Construct>
+    void build(std::vector<Hashed>& hashed, KeyOf key_of, Construct construct);
+    void destroy_values();
+
+    /* Private member variables */
+    size_t _size;
+    H _hash_function;
+    E _key_equal;
+    std::vector<uint32_t> _pilots;  // one per bucket, about size() / kAverageBucketSize of them
+    std::vector<uint32_t> _remap;   // the slot of position size() + i, for i < positions - size()
+    value_type* _values;            // exactly _size constructed elements, or nullptr if empty
+};
+
+#include "frozen_hashmap.cpp"
+#endif
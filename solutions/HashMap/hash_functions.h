@@ -0,0 +1,195 @@
+#ifndef HASH_FUNCTIONS_H
+#define HASH_FUNCTIONS_H
+
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint32_t, uint64_t, uintptr_t
+#include <cstring>      // for std::memcpy
+#include <functional>   // for std::hash
+#include <string>
+#include <string_view>
+#include <type_traits>  // for std::enable_if_t, std::is_integral, std::is_enum, std::is_floating_point
+
+/*
+* Hash functions shared by the maps of this directory.
+*
+* std::hash is the identity for the integer types on libstdc++ and libc++, so keys with a common
+* factor (multiples of the bucket count, pointers aligned to 64 bytes, IDs that step by 1024)
+* land in the same few buckets of a table that reduces the hash with a mask. The functions below
+* are cheap enough to call on every lookup and spread every input bit over the whole result.
+*/
+
+/*
+* The 64x64->128-bit multiply used by every function below: a becomes the low half of the
+* product, b the high half. GCC and Clang do it with one instruction through __uint128_t;
+* other compilers get four 32x32->64-bit multiplies (hash_multiply_portable, which gives the
+* same results everywhere). Usable in constant expressions.
+*/
+constexpr void hash_multiply_portable(uint64_t& a, uint64_t& b) {
+    uint64_t a_low = a & 0xFFFFFFFFull, a_high = a >> 32;
+    uint64_t b_low = b & 0xFFFFFFFFull, b_high = b >> 32;
+    uint64_t low_low = a_low * b_low;
+    uint64_t high_low = a_high * b_low;
+    uint64_t low_high = a_low * b_high;
+    uint64_t high_high = a_high * b_high;
+    // cannot overflow: low_high <= (2^32 - 1)^2 leaves room for the two other, 32-bit terms
+    uint64_t middle = (low_low >> 32) + (high_low & 0xFFFFFFFFull) + low_high;
+    a = (middle << 32) | (low_low & 0xFFFFFFFFull);
+    b = high_high + (high_low >> 32) + (middle >> 32);
+}
+
+constexpr void hash_multiply(uint64_t& a, uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(product);
+    b = static_cast<uint64_t>(product >> 64);
+#else
+    hash_multiply_portable(a, b);
+#endif
+}
+
+/*
+* Multiply-fold mixer: the 128-bit product of x and 2^64 / phi, with the high half xor-ed into
+* the low half. Each output bit depends on every input bit below it (the low half) and on the
+* input bits above it (the high half). One multiply, so about 1 ns. Usable in constant expressions.
+*/
+constexpr uint64_t hash_mix(uint64_t x) {
+    uint64_t high = 0x9E3779B97F4A7C15ull;
+    hash_multiply(x, high);
+    return high ^ x;
+}
+
+/*
+* The finalizer of MurmurHash3: a bijection on 64-bit values in which every input bit affects
+* every output bit. Slower than hash_mix (two multiplies, three shifts), for the places that need
+* a bijection or a full avalanche, such as deriving seeds. Usable in constant expressions.
+*/
+constexpr uint64_t hash_avalanche(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    return x ^ (x >> 33);
+}
+
+/*
+* Maps hash to [0, n) with a multiply-high ("fastrange"): (hash * n) / 2^64. Costs a multiply
+* where hash % n costs a division (20-40 cycles), works for any n, and uses the high bits of
+* hash, so hash should be mixed. Tables whose size is a power of two use a mask instead.
+*/
+constexpr size_t fastrange(uint64_t hash, size_t n) {
+    uint64_t high = n;
+    hash_multiply(hash, high);
+    return static_cast<size_t>(high);
+}
+
+/*
+* Helpers of hash_bytes: unaligned reads, and the 64x64->128-bit multiply folded into one half.
+*/
+inline uint64_t hash_read64(const unsigned char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+inline uint64_t hash_read32(const unsigned char* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+inline uint64_t hash_multiply_fold(uint64_t a, uint64_t b) {
+    hash_multiply(a, b);
+    return a ^ b;
+}
+
+/*
+* Hashes len bytes, in the style of wyhash: 16 bytes per 64x64->128-bit multiply, three
+* independent lanes for inputs longer than 48 bytes, and overlapping (unaligned) reads for the
+* tail instead of a byte loop. Strings of up to 16 bytes, the common case for keys, take two
+* multiplies and no loop at all. Not a cryptographic hash: an attacker who knows the seed can
+* build colliding keys, so pass a random seed where keys come from untrusted input.
+*/
+inline uint64_t hash_bytes(const void* data, size_t len, uint64_t seed = 0) {
+    constexpr uint64_t kSecret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+                                     0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    seed ^= hash_multiply_fold(seed ^ kSecret[0], kSecret[1]);
+    uint64_t a = 0, b = 0;
+    if (len <= 16) {
+        if (len >= 4) {
+            // two (possibly overlapping) 4-byte reads from each end cover 4..16 bytes
+            size_t middle = (len >> 3) << 2;
+            a = (hash_read32(p) << 32) | hash_read32(p + middle);
+            b = (hash_read32(p + len - 4) << 32) | hash_read32(p + len - 4 - middle);
+        } else if (len > 0) {
+            a = (uint64_t(p[0]) << 16) | (uint64_t(p[len >> 1]) << 8) | p[len - 1];
+        }
+    } else {
+        size_t remaining = len;
+        if (remaining > 48) {
+            uint64_t lane1 = seed, lane2 = seed;
+            do {
+                seed = hash_multiply_fold(hash_read64(p) ^ kSecret[1], hash_read64(p + 8) ^ seed);
+                lane1 = hash_multiply_fold(hash_read64(p + 16) ^ kSecret[2], hash_read64(p + 24) ^ lane1);
+                lane2 = hash_multiply_fold(hash_read64(p + 32) ^ kSecret[3], hash_read64(p + 40) ^ lane2);
+                p += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= lane1 ^ lane2;
+        }
+        while (remaining > 16) {
+            seed = hash_multiply_fold(hash_read64(p) ^ kSecret[1], hash_read64(p + 8) ^ seed);
+            p += 16;
+            remaining -= 16;
+        }
+        // the last 16 bytes of the input, which may overlap bytes already hashed
+        a = hash_read64(p + remaining - 16);
+        b = hash_read64(p + remaining - 8);
+    }
+    a ^= kSecret[1];
+    b ^= seed;
+    hash_multiply(a, b);
+    return hash_multiply_fold(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+}
+
+/*
+* The default hash function of HashMap, SmallHashMap and ConcurrentHashMap.
+*
+*      - integers, enums and pointers: hash_mix of the value.
+*      - floating point: hash_mix of the bits, with -0.0 hashed like 0.0 (they compare equal).
+*      - std::string and std::string_view: hash_bytes of the characters. Both specializations
+*        declare is_transparent and hash std::string, std::string_view and const char* alike, so
+*        a map with std::string keys and E = std::equal_to<> can be searched with a string_view.
+*        (Keys of type const char* are pointers, hashed and compared by address.)
+*      - everything else: hash_mix of std::hash<K>, so a user type only needs a std::hash
+*        specialization, even a weak one.
+*
+* Every result is a deterministic function of the key: the same key has the same hash in every
+* process, which keeps saved snapshots and frozen maps valid across runs.
+*/
+template<typename K, typename = void>
+struct DefaultHash {
+    size_t operator()(const K& key) const { return hash_mix(std::hash<K>()(key)); }
+};
+
+template<typename K>
+struct DefaultHash<K, std::enable_if_t<std::is_integral<K>::value || std::is_enum<K>::value>> {
+    size_t operator()(K key) const { return hash_mix(static_cast<uint64_t>(key)); }
+};
+
+template<typename K>
+struct DefaultHash<K, std::enable_if_t<std::is_floating_point<K>::value>> {
+    size_t operator()(K key) const {
+        if (key == K(0)) return hash_mix(0);
+        return hash_mix(std::hash<K>()(key));
+    }
+};
+
+template<typename T>
+struct DefaultHash<T*> {
+    size_t operator()(T* key) const { return hash_mix(reinterpret_cast<uintptr_t>(key)); }
+};
+
+struct DefaultStringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const { return hash_bytes(key.data(), key.size()); }
+};
+
+template<>
+struct DefaultHash<std::string> : DefaultStringHash {};
+
+template<>
+struct DefaultHash<std::string_view> : DefaultStringHash {};
+
+#endif
@@ -1,176 +1,473 @@
 
 #include "hashmap.h"
 
-template<typename K, typename M, typename H>
-HashMap<K, M, H>::HashMap() : _size(0), _hash_function(H()), _buckets_array(kDefaultBuckets, nullptr) {};
+template<typename K, typename M, typename H, typename E, typename A>
+HashMap<K, M, H, E, A>::HashMap() :
+    _size(0),
+    _hash_function(H()),
+    _key_equal(E()),
+    _buckets_array(kDefaultBuckets, nullptr),
+    _max_load_factor(1.0),
+    _min_load_factor(0.0),
+    _node_allocator(),
+    _migrate_idx(0),
+    _incremental_rehash(false),
+    _occupied(occupancy_words(kDefaultBuckets), 0),
+    _first_occupied(kDefaultBuckets) {};
 
-template<typename K, typename M, typename H>
-HashMap<K, M, H>::HashMap(size_t bucket_count, const H& hash):
+template<typename K, typename M, typename H, typename E, typename A>
+HashMap<K, M, H, E, A>::HashMap(size_t bucket_count, const H& hash, const E& equal, const A& alloc):
     _size(0), 
     _hash_function(hash), 
-    _buckets_array(bucket_count, nullptr) {};
+    _key_equal(equal),
+    _buckets_array(round_up_buckets(bucket_count), nullptr),
+    _max_load_factor(1.0),
+    _min_load_factor(0.0),
+    _node_allocator(alloc),
+    _migrate_idx(0),
+    _incremental_rehash(false),
+    _occupied(occupancy_words(_buckets_array.size()), 0),
+    _first_occupied(_buckets_array.size()) {};
 
-template<typename K, typename M, typename H>
-HashMap<K, M, H>::~HashMap() {
+template<typename K, typename M, typename H, typename E, typename A>
+HashMap<K, M, H, E, A>::~HashMap() {
     clear();
 }
 
-template<typename K, typename M, typename H>
-inline size_t HashMap<K, M, H>::size() const {
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::allocator_type HashMap<K, M, H, E, A>::get_allocator() const {
+    return allocator_type(_node_allocator);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+H HashMap<K, M, H, E, A>::hash_function() const {
+    return _hash_function;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+E HashMap<K, M, H, E, A>::key_eq() const {
+    return _key_equal;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+inline size_t HashMap<K, M, H, E, A>::size() const {
     return _size;
 }
 
-template<typename K, typename M, typename H>
-inline bool HashMap<K, M, H>::empty() const {
+template<typename K, typename M, typename H, typename E, typename A>
+inline bool HashMap<K, M, H, E, A>::empty() const {
     return _size == 0;
 }
 
-template<typename K, typename M, typename H>
-inline float HashMap<K, M, H>::load_factor() const {
+template<typename K, typename M, typename H, typename E, typename A>
+inline float HashMap<K, M, H, E, A>::load_factor() const {
     return ((float) _size) / _buckets_array.size();
 }
 
-template<typename K, typename M, typename H>
-inline size_t HashMap<K, M, H>::bucket_count() const {
+template<typename K, typename M, typename H, typename E, typename A>
+inline size_t HashMap<K, M, H, E, A>::bucket_count() const {
     return _buckets_array.size();
 }
 
-template<typename K, typename M, typename H>
-bool HashMap<K, M, H>::contains(const K& key) const {
-    auto [pre_node, cur_node] = find_node(key);
-    return cur_node != nullptr;
+template<typename K, typename M, typename H, typename E, typename A>
+inline float HashMap<K, M, H, E, A>::max_load_factor() const {
+    return _max_load_factor;
+}
 
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::max_load_factor(float ml) {
+    if (!(ml > 0) || ml < 4 * _min_load_factor) {
+        throw std::out_of_range("HashMap<K, M, H, E, A>::max_load_factor: Invalid Input Parameters");
+    }
+    _max_load_factor = ml;
+    if (load_factor() > _max_load_factor) {
+        rehash(bucket_count());
+    } else if (_bloom.enabled()) {
+        // the filter is sized for bucket_count() * max_load_factor() elements
+        finish_migration();
+        rebuild_bloom();
+    }
 }
 
-template<typename K, typename M, typename H>
-M& HashMap<K, M, H>::at(const K& key) {
-    auto [pre_node, cur_node] = find_node(key);
-    if (cur_node == nullptr) throw std::out_of_range("HashMap<K, M, H>::at: key not found");
+template<typename K, typename M, typename H, typename E, typename A>
+inline float HashMap<K, M, H, E, A>::min_load_factor() const {
+    return _min_load_factor;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::min_load_factor(float ml) {
+    if (ml < 0 || 4 * ml > _max_load_factor) {
+        throw std::out_of_range("HashMap<K, M, H, E, A>::min_load_factor: Invalid Input Parameters");
+    }
+    _min_load_factor = ml;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+inline bool HashMap<K, M, H, E, A>::incremental_rehash() const {
+    return _incremental_rehash;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::incremental_rehash(bool enabled) {
+    _incremental_rehash = enabled;
+    if (!enabled) finish_migration();
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+inline bool HashMap<K, M, H, E, A>::bloom_filter() const {
+    return _bloom.enabled();
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::bloom_filter(bool enabled) {
+    if (enabled == bloom_filter()) return;
+    if (!enabled) {
+        _bloom.release();
+        _next_bloom.release();
+        return;
+    }
+    finish_migration();
+    rebuild_bloom();
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+bool HashMap<K, M, H, E, A>::contains(const K& key) const {
+    return lookup_node(key, _hash_function(key)) != nullptr;
+
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Q, typename>
+bool HashMap<K, M, H, E, A>::contains(const Q& key) const {
+    return lookup_node(key, _hash_function(key)) != nullptr;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+size_t HashMap<K, M, H, E, A>::count(const K& key) const {
+    return contains(key) ? 1 : 0;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Q, typename>
+size_t HashMap<K, M, H, E, A>::count(const Q& key) const {
+    return contains(key) ? 1 : 0;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+M& HashMap<K, M, H, E, A>::at(const K& key) {
+    Node* cur_node = lookup_node(key, _hash_function(key));
+    if (cur_node == nullptr) throw std::out_of_range("HashMap<K, M, H, E, A>::at: key not found");
     auto& [cur_key, cur_value] = cur_node->value;
     return cur_value;
 }
 
-template<typename K, typename M, typename H>
-const M& HashMap<K, M, H>::at(const K& key) const {
-    return static_cast<const M&>(const_cast<HashMap<K,M,H> *>(this)->at(key));
+template<typename K, typename M, typename H, typename E, typename A>
+const M& HashMap<K, M, H, E, A>::at(const K& key) const {
+    return static_cast<const M&>(const_cast<HashMap<K, M, H, E, A> *>(this)->at(key));
 }
 
-template<typename K, typename M, typename H>
-void HashMap<K, M, H>::clear() {
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Q, typename>
+M& HashMap<K, M, H, E, A>::at(const Q& key) {
+    Node* cur_node = lookup_node(key, _hash_function(key));
+    if (cur_node == nullptr) throw std::out_of_range("HashMap<K, M, H, E, A>::at: key not found");
+    return cur_node->value.second;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Q, typename>
+const M& HashMap<K, M, H, E, A>::at(const Q& key) const {
+    return static_cast<const M&>(const_cast<HashMap<K, M, H, E, A> *>(this)->at(key));
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::clear() {
+    if constexpr (kBulkRelease) {
+        // no destructor has to run, so forget the chains and hand every slab back at once
+        if (_node_allocator.owns_pool_exclusively()) {
+            std::fill(_buckets_array.begin(), _buckets_array.end(), nullptr);
+            // a migration is dropped halfway, and _next_bloom is the filter sized for _buckets_array
+            if (migrating()) std::swap(_bloom, _next_bloom);
+            _old_buckets_array = bucket_array_type();
+            _migrate_idx = 0;
+            rebuild_occupancy();
+            _next_bloom.release();
+            _bloom.clear();
+            _node_allocator.release();
+            _size = 0;
+            return;
+        }
+    }
+    finish_migration();
     for (auto& bucket : _buckets_array) {
         while (bucket != nullptr)
         {
             auto temp_bkt = bucket->next;
-            delete bucket;
+            destroy_node(bucket);
             bucket = temp_bkt;
         } 
     }
+    rebuild_occupancy();
+    _bloom.clear();
     _size = 0;
 }
 
-template<typename K, typename M, typename H>
-std::pair<typename HashMap<K, M, H>::iterator, bool> HashMap<K, M, H>::insert(const value_type& kv_pair) {
-    auto [pre_node, cur_node] = find_node(kv_pair.first);
-    size_t index = _hash_function(kv_pair.first) % _buckets_array.size();
+template<typename K, typename M, typename H, typename E, typename A>
+std::pair<typename HashMap<K, M, H, E, A>::iterator, bool> HashMap<K, M, H, E, A>::insert(const value_type& kv_pair) {
+    advance_migration();
+    size_t hash = _hash_function(kv_pair.first);
+    auto [pre_node, cur_node] = find_node(kv_pair.first, hash);
     if (cur_node != nullptr) return {make_iterator(cur_node), false};
-    Node* new_node = new Node{kv_pair, nullptr};
+    return {link_new_node(pre_node, create_node(hash, kv_pair)), true};
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+std::pair<typename HashMap<K, M, H, E, A>::iterator, bool> HashMap<K, M, H, E, A>::insert(value_type&& kv_pair) {
+    advance_migration();
+    size_t hash = _hash_function(kv_pair.first);
+    auto [pre_node, cur_node] = find_node(kv_pair.first, hash);
+    if (cur_node != nullptr) return {make_iterator(cur_node), false};
+    return {link_new_node(pre_node, create_node(hash, std::move(kv_pair))), true};
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename... Args>
+std::pair<typename HashMap<K, M, H, E, A>::iterator, bool> HashMap<K, M, H, E, A>::emplace(Args&&... args) {
+    advance_migration();
+    // the key is only known once the element exists, so build the node first
+    Node* new_node = create_node(0, std::forward<Args>(args)...);
+    new_node->hash = _hash_function(new_node->value.first);
+    auto [pre_node, cur_node] = find_node(new_node->value.first, new_node->hash);
+    if (cur_node != nullptr) {
+        destroy_node(new_node);
+        return {make_iterator(cur_node), false};
+    }
+    return {link_new_node(pre_node, new_node), true};
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename... Args>
+std::pair<typename HashMap<K, M, H, E, A>::iterator, bool> HashMap<K, M, H, E, A>::try_emplace(const K& key, Args&&... args) {
+    return try_emplace_key(key, std::forward<Args>(args)...);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename... Args>
+std::pair<typename HashMap<K, M, H, E, A>::iterator, bool> HashMap<K, M, H, E, A>::try_emplace(K&& key, Args&&... args) {
+    return try_emplace_key(std::move(key), std::forward<Args>(args)...);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Obj>
+std::pair<typename HashMap<K, M, H, E, A>::iterator, bool> HashMap<K, M, H, E, A>::insert_or_assign(const K& key, Obj&& obj) {
+    return insert_or_assign_key(key, std::forward<Obj>(obj));
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Obj>
+std::pair<typename HashMap<K, M, H, E, A>::iterator, bool> HashMap<K, M, H, E, A>::insert_or_assign(K&& key, Obj&& obj) {
+    return insert_or_assign_key(std::move(key), std::forward<Obj>(obj));
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename F>
+bool HashMap<K, M, H, E, A>::update(const K& key, F&& fn) {
+    auto [iter, inserted] = try_emplace_key(key);
+    std::forward<F>(fn)(iter->second);
+    return inserted;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename F>
+bool HashMap<K, M, H, E, A>::update(K&& key, F&& fn) {
+    auto [iter, inserted] = try_emplace_key(std::move(key));
+    std::forward<F>(fn)(iter->second);
+    return inserted;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+bool HashMap<K, M, H, E, A>::erase(const K& key) {
+    return erase_key(key);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Q, typename>
+bool HashMap<K, M, H, E, A>::erase(const Q& key) {
+    return erase_key(key);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::iterator HashMap<K, M, H, E, A>::link_new_node(Node* pre_node, Node* new_node) {
+    if (grow_if_needed()) {
+        // the chain has been rebuilt or has started to move, so find its new tail
+        pre_node = bucket_head(new_node->hash);
+        while (pre_node != nullptr && pre_node->next != nullptr) pre_node = pre_node->next;
+    }
+
     if (pre_node == nullptr) {
-        _buckets_array[index] = new_node;
+        Node*& bucket = bucket_for(new_node->hash);
+        bucket = new_node;
+        update_occupancy(bucket);
     } else {
         pre_node->next = new_node;
     }
+    _bloom.add(new_node->hash);
+    _next_bloom.add(new_node->hash);
     ++_size;
-    return {make_iterator(new_node), true}; 
+    return make_iterator(new_node);
 }
 
-template<typename K, typename M, typename H>
-bool HashMap<K, M, H>::erase(const K& key) {
-    size_t index = _hash_function(key) % _buckets_array.size();
-    auto [pre_node, cur_node] = find_node(key);
-    if (cur_node == nullptr) return false;
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename KK, typename... Args>
+std::pair<typename HashMap<K, M, H, E, A>::iterator, bool> HashMap<K, M, H, E, A>::try_emplace_key(KK&& key, Args&&... args) {
+    advance_migration();
+    size_t hash = _hash_function(key);
+    auto [pre_node, cur_node] = find_node(key, hash);
+    if (cur_node != nullptr) return {make_iterator(cur_node), false};
+    Node* new_node = create_node(hash, std::piecewise_construct, std::forward_as_tuple(std::forward<KK>(key)),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+    return {link_new_node(pre_node, new_node), true};
+}
 
-    Node * temp = cur_node->next;
-    delete cur_node;
-    if (pre_node != nullptr) {
-        pre_node->next = temp;
-    } else {
-        _buckets_array[index] = temp;
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename KK, typename Obj>
+std::pair<typename HashMap<K, M, H, E, A>::iterator, bool> HashMap<K, M, H, E, A>::insert_or_assign_key(KK&& key, Obj&& obj) {
+    advance_migration();
+    size_t hash = _hash_function(key);
+    auto [pre_node, cur_node] = find_node(key, hash);
+    if (cur_node != nullptr) {
+        cur_node->value.second = std::forward<Obj>(obj);
+        return {make_iterator(cur_node), false};
     }
-    
-    _size--;
+    Node* new_node = create_node(hash, std::forward<KK>(key), std::forward<Obj>(obj));
+    return {link_new_node(pre_node, new_node), true};
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Q>
+bool HashMap<K, M, H, E, A>::erase_key(const Q& key) {
+    advance_migration();
+    size_t hash = _hash_function(key);
+    auto [pre_node, cur_node] = find_node(key, hash);
+    if (cur_node == nullptr) return false;
+
+    erase_node(bucket_for(hash), pre_node, cur_node);
+    shrink_if_needed();
     return true;
 }
 
-template<typename K, typename M, typename H>
-typename HashMap<K, M, H>::iterator HashMap<K, M, H>::erase(const_iterator pos) {
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::iterator HashMap<K, M, H, E, A>::erase(const_iterator pos) {
     iterator temp = make_iterator(pos._node);
     ++temp;
     if (pos._node != nullptr) {
-        erase(pos._node->value.first);
+        Node*& bucket = (*pos._buckets_array)[pos._bucket_idx];
+        erase_node(bucket, find_predecessor(bucket, pos._node), pos._node);
     }
     return temp;
 }
 
-template<typename K, typename M, typename H>
-void HashMap<K, M, H>::rehash(size_t new_buckets) {
-    if (new_buckets == 0) throw std::out_of_range("HashMap<K,M,H>::rehash: Invalid Input Parameters");
-    //if (new_buckets == bucket_count()) return;
-    bucket_array_type temp_bkt_array = _buckets_array;
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::rehash(size_t new_buckets) {
+    if (new_buckets == 0) throw std::out_of_range("HashMap<K, M, H, E, A>::rehash: Invalid Input Parameters");
+    finish_migration();
+    size_t min_buckets = static_cast<size_t>(std::ceil(_size / _max_load_factor));
+    new_buckets = round_up_buckets(std::max(new_buckets, min_buckets));
 
-    _buckets_array.clear();
-    _buckets_array.resize(new_buckets, nullptr);
+    bucket_array_type temp_bkt_array(new_buckets, nullptr);
+    std::swap(temp_bkt_array, _buckets_array);
     
     for (auto& temp_bkt : temp_bkt_array) {
         while (temp_bkt != nullptr)
         {
             Node* temp = temp_bkt;
             temp_bkt = temp_bkt->next;
-            const auto& [key, mapped] = temp->value;
-            size_t index = _hash_function(key) % new_buckets;
+            size_t index = bucket_index(temp->hash);
 
             temp->next = _buckets_array[index];
             _buckets_array[index] = temp;
         }
         
     }
+    rebuild_occupancy();
+    if (_bloom.enabled()) rebuild_bloom();
 }
 
-template<typename K, typename M, typename H>
-typename HashMap<K, M, H>::iterator HashMap<K, M, H>::begin() {
-    size_t index = first_not_empty_bucket();
-    return make_iterator(_buckets_array[index]);
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::iterator HashMap<K, M, H, E, A>::begin() {
+    // during an incremental rehash, the elements that have not moved yet come first
+    for (size_t i = _migrate_idx; i < _old_buckets_array.size(); i++) {
+        if (_old_buckets_array[i] != nullptr) return make_iterator(_old_buckets_array[i]);
+    }
+    if (_first_occupied == _buckets_array.size()) return end();
+    return make_iterator(_buckets_array[_first_occupied]);
 }
 
-template<typename K, typename M, typename H>
-typename HashMap<K, M, H>::const_iterator HashMap<K, M, H>::begin() const {
-    return const_cast<HashMap<K, M, H> *>(this)->begin();
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::const_iterator HashMap<K, M, H, E, A>::begin() const {
+    return const_cast<HashMap<K, M, H, E, A> *>(this)->begin();
 }
 
-template<typename K, typename M, typename H>
-typename HashMap<K, M, H>::iterator HashMap<K, M, H>::end() {
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::iterator HashMap<K, M, H, E, A>::end() {
     return make_iterator(nullptr);
 }
 
-template<typename K, typename M, typename H>
-typename HashMap<K, M, H>::const_iterator HashMap<K, M, H>::end() const {
-    return const_cast<HashMap<K, M, H> *>(this)->end();
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::const_iterator HashMap<K, M, H, E, A>::end() const {
+    return const_cast<HashMap<K, M, H, E, A> *>(this)->end();
 }
 
-template<typename K, typename M, typename H>
-typename HashMap<K, M, H>::iterator HashMap<K, M, H>::find(const K& key) {
-    auto [pre_node, cur_node] = find_node(key);
-    return make_iterator(cur_node);
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::iterator HashMap<K, M, H, E, A>::find(const K& key) {
+    advance_migration();
+    return make_iterator(lookup_node(key, _hash_function(key)));
 }
 
-template<typename K, typename M, typename H>
-typename HashMap<K, M, H>::const_iterator HashMap<K, M, H>::find(const K& key) const {
-    return const_cast<HashMap<K, M, H> *>(this)->find(key);
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::const_iterator HashMap<K, M, H, E, A>::find(const K& key) const {
+    // unlike the non-const find, this one never advances an incremental rehash, so it stays read-only
+    return const_cast<HashMap<K, M, H, E, A> *>(this)->make_iterator(lookup_node(key, _hash_function(key)));
 }
 
-template<typename K, typename M, typename H>
-void HashMap<K, M, H>::debug() {
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Q, typename>
+typename HashMap<K, M, H, E, A>::iterator HashMap<K, M, H, E, A>::find(const Q& key) {
+    advance_migration();
+    return make_iterator(lookup_node(key, _hash_function(key)));
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Q, typename>
+typename HashMap<K, M, H, E, A>::const_iterator HashMap<K, M, H, E, A>::find(const Q& key) const {
+    return const_cast<HashMap<K, M, H, E, A> *>(this)->make_iterator(lookup_node(key, _hash_function(key)));
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename ForwardIt, typename OutputIt>
+OutputIt HashMap<K, M, H, E, A>::find_many(ForwardIt first, ForwardIt last, OutputIt out) {
+    lookup_batched(first, last, [&](Node* node) { *out++ = make_iterator(node); });
+    return out;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename ForwardIt, typename OutputIt>
+OutputIt HashMap<K, M, H, E, A>::find_many(ForwardIt first, ForwardIt last, OutputIt out) const {
+    return const_cast<HashMap<K, M, H, E, A> *>(this)->find_many(first, last, out);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename ForwardIt, typename OutputIt>
+OutputIt HashMap<K, M, H, E, A>::contains_many(ForwardIt first, ForwardIt last, OutputIt out) const {
+    lookup_batched(first, last, [&](Node* node) { *out++ = (node != nullptr); });
+    return out;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::debug() {
     std::cout << "HashMap Debug Info:" << std::endl;
-    std::cout << "Bucket Count=" << bucket_count() <<" Size=" << size() << " Load Factor="<<load_factor()<< std::endl;
+    std::cout << "Bucket Count=" << bucket_count() <<" Size=" << size() << " Load Factor="<<load_factor()
+              << " Max Load Factor=" << max_load_factor() << std::endl;
     for (size_t i = 0; i < _buckets_array.size(); i++) {
         std::cout << "Bucket-" << i << ": ";
         Node* temp = _buckets_array[i];
@@ -181,109 +478,1093 @@ void HashMap<K, M, H>::debug() {
         }
         std::cout << std::endl;
     }
+    for (size_t i = _migrate_idx; i < _old_buckets_array.size(); i++) {
+        std::cout << "Old Bucket-" << i << ": ";
+        for (Node* temp = _old_buckets_array[i]; temp != nullptr; temp = temp->next) {
+            std::cout << temp->value.first << "-" << temp->value.second << " ";
+        }
+        std::cout << std::endl;
+    }
 }
 
-template<typename K, typename M, typename H>
+template<typename K, typename M, typename H, typename E, typename A>
 template<typename InputIter>
-HashMap<K, M, H>::HashMap(InputIter begin, InputIter end, size_t bucket_count, const H& hash):HashMap(bucket_count, hash){
-    for (InputIter iter = begin; iter != end; iter++) {
-        insert(*iter);
+HashMap<K, M, H, E, A>::HashMap(InputIter begin, InputIter end, size_t bucket_count, const H& hash, const E& equal,
+                                const A& alloc):
+    HashMap(bucket_count, hash, equal, alloc){
+    using category = typename std::iterator_traits<InputIter>::iterator_category;
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag, category>) {
+        size_t count = end - begin;
+        size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                          count / kBuildPerThread + 1);
+        bulk_build(begin, count, threads);
+    } else {
+        for (InputIter iter = begin; iter != end; iter++) {
+            insert(*iter);
+        }
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+HashMap<K, M, H, E, A>::HashMap(std::initializer_list<value_type> init, size_t bucket_count, const H& hash,
+                                const E& equal, const A& alloc):
+    HashMap(init.begin(), init.end(), bucket_count, hash, equal, alloc){}
+
+template<typename K, typename M, typename H, typename E, typename A>
+M& HashMap<K, M, H, E, A>::operator[](const K& key) {
+    return try_emplace_key(key).first->second;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+M& HashMap<K, M, H, E, A>::operator[](K&& key) {
+    return try_emplace_key(std::move(key)).first->second;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+HashMapStats HashMap<K, M, H, E, A>::stats() const {
+    HashMapStats stats;
+    stats.size = _size;
+    stats.bucket_count = bucket_count();
+    stats.load_factor = load_factor();
+
+    size_t buckets = 0;
+    auto add_chain = [&](const Node* head) {
+        size_t length = 0;
+        for (; head != nullptr; head = head->next) length++;
+        if (length >= stats.chain_length_histogram.size()) stats.chain_length_histogram.resize(length + 1, 0);
+        stats.chain_length_histogram[length]++;
+        stats.max_chain_length = std::max(stats.max_chain_length, length);
+        buckets++;
+    };
+    // during an incremental rehash, the buckets that have not been migrated count as well
+    for (size_t i = _migrate_idx; i < _old_buckets_array.size(); i++) add_chain(_old_buckets_array[i]);
+    for (const Node* head : _buckets_array) add_chain(head);
+    stats.empty_bucket_ratio = (float) stats.chain_length_histogram[0] / buckets;
+
+    stats.node_size = sizeof(Node);
+    stats.node_bytes = _size * sizeof(Node);
+    stats.bucket_array_bytes = (_buckets_array.capacity() + _old_buckets_array.capacity()) * sizeof(Node*) +
+                               _occupied.capacity() * sizeof(uint64_t);
+    stats.bloom_filter_bytes = _bloom.bytes() + _next_bloom.bytes();
+    stats.bloom_false_positive_rate = _bloom.false_positive_rate();
+
+#if HASHMAP_PROBE_COUNTERS
+    stats.probe_counters_enabled = true;
+    stats.successful_lookups = _probe_counters.successful.load(std::memory_order_relaxed);
+    stats.unsuccessful_lookups = _probe_counters.unsuccessful.load(std::memory_order_relaxed);
+    stats.bloom_rejected_lookups = _probe_counters.bloom_rejected.load(std::memory_order_relaxed);
+    size_t successful_probes = _probe_counters.successful_probes.load(std::memory_order_relaxed);
+    size_t unsuccessful_probes = _probe_counters.unsuccessful_probes.load(std::memory_order_relaxed);
+    if (stats.successful_lookups != 0) {
+        stats.average_probes_successful = (float) successful_probes / stats.successful_lookups;
+    }
+    if (stats.unsuccessful_lookups != 0) {
+        stats.average_probes_unsuccessful = (float) unsuccessful_probes / stats.unsuccessful_lookups;
     }
+#endif
+    return stats;
 }
 
-template<typename K, typename M, typename H>
-HashMap<K, M, H>::HashMap(std::initializer_list<value_type> init, size_t bucket_count, const H& hash):
-    HashMap(init.begin(), init.end(), bucket_count, hash){}
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::reset_probe_counters() {
+#if HASHMAP_PROBE_COUNTERS
+    _probe_counters.successful = 0;
+    _probe_counters.successful_probes = 0;
+    _probe_counters.unsuccessful = 0;
+    _probe_counters.unsuccessful_probes = 0;
+    _probe_counters.bloom_rejected = 0;
+#endif
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Fn>
+void HashMap<K, M, H, E, A>::for_each_chain(Fn fn) const {
+    // during an incremental rehash, the buckets that have not been migrated yet come first
+    for (size_t i = _migrate_idx; i < _old_buckets_array.size(); i++) fn(_old_buckets_array[i]);
+    for (const Node* head : _buckets_array) fn(head);
+}
 
-template<typename K, typename M, typename H>
-M& HashMap<K, M, H>::operator[](const K& key) {
-    value_type default_kv{key, {}};
-    auto [iter, success] = insert(default_kv);
-    return iter->second;
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::write_snapshot_header(std::ostream& out, uint32_t format, uint64_t section_bytes) const {
+    bool bytes = format == kSnapshotBytes;
+    uint64_t fields[] = {bytes ? sizeof(K) : 0, bytes ? sizeof(M) : 0, _size, bucket_count(), section_bytes};
+    out.write("HMAPSNAP", 8);
+    out.write(reinterpret_cast<const char*>(&kSnapshotVersion), sizeof(kSnapshotVersion));
+    out.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    out.write(reinterpret_cast<const char*>(fields), sizeof(fields));
 }
 
-template<typename K, typename M, typename H>
-HashMap<K, M, H>::HashMap(const HashMap<K, M, H>& map): 
+template<typename K, typename M, typename H, typename E, typename A>
+std::pair<size_t, size_t> HashMap<K, M, H, E, A>::read_snapshot_header(std::istream& in, uint32_t format,
+                                                                        uint64_t& section_bytes) const {
+    char magic[8];
+    uint32_t version = 0, file_format = 0;
+    uint64_t fields[5];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&file_format), sizeof(file_format));
+    in.read(reinterpret_cast<char*>(fields), sizeof(fields));
+    if (!in || std::memcmp(magic, "HMAPSNAP", 8) != 0) {
+        throw std::runtime_error("HashMap<K, M, H, E, A>::load: not a HashMap snapshot");
+    }
+    if (version != kSnapshotVersion) {
+        throw std::runtime_error("HashMap<K, M, H, E, A>::load: unsupported snapshot version " + std::to_string(version));
+    }
+    bool bytes = format == kSnapshotBytes;
+    if (file_format != format || fields[0] != (bytes ? sizeof(K) : 0) || fields[1] != (bytes ? sizeof(M) : 0)) {
+        throw std::runtime_error("HashMap<K, M, H, E, A>::load: snapshot has a different element format");
+    }
+    size_t buckets = fields[3];
+    if (buckets == 0 || (buckets & (buckets - 1)) != 0) {
+        throw std::runtime_error("HashMap<K, M, H, E, A>::load: corrupt snapshot header");
+    }
+    section_bytes = fields[4];
+    return {buckets, fields[2]};
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::link_loaded(Node* node, Node*& tail) {
+    size_t index = bucket_index(node->hash);
+    if (tail != nullptr && bucket_index(tail->hash) == index) {
+        node->next = tail->next;
+        tail->next = node;
+    } else {
+        node->next = _buckets_array[index];
+        _buckets_array[index] = node;
+    }
+    tail = node;
+    _size++;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::take_loaded(HashMap<K, M, H, E, A>& loaded) {
+    // loaded allocated its nodes with a copy of our allocator, so we can free them
+    clear();
+    _buckets_array.swap(loaded._buckets_array);
+    std::swap(_size, loaded._size);
+    rebuild_occupancy();
+    loaded.rebuild_occupancy();
+    if (_size > _max_load_factor * bucket_count()) {
+        // the snapshot was written by a map with a higher max_load_factor (rehash also rebuilds the filter)
+        rehash(static_cast<size_t>(std::ceil(_size / _max_load_factor)));
+    } else if (_bloom.enabled()) {
+        rebuild_bloom();
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::check_loaded_hash(const Node* node) const {
+    if (_hash_function(node->value.first) != node->hash) {
+        throw std::runtime_error("HashMap<K, M, H, E, A>::load: snapshot was written with a different hash function");
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::save(const std::string& path) const {
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<M>::value,
+                  "HashMap::save(path) copies bytes, use save(path, serializer) for other types");
+    constexpr size_t record_bytes = sizeof(size_t) + sizeof(K) + sizeof(M);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("HashMap<K, M, H, E, A>::save: cannot open " + path);
+    write_snapshot_header(out, kSnapshotBytes, _size * record_bytes);
+
+    std::vector<char> block(std::max<size_t>(kSnapshotBlock / record_bytes, 1) * record_bytes);
+    size_t used = 0;
+    for_each_chain([&](const Node* head) {
+        for (; head != nullptr; head = head->next) {
+            char* record = block.data() + used;
+            std::memcpy(record, &head->hash, sizeof(size_t));
+            std::memcpy(record + sizeof(size_t), &head->value.first, sizeof(K));
+            std::memcpy(record + sizeof(size_t) + sizeof(K), &head->value.second, sizeof(M));
+            used += record_bytes;
+            if (used == block.size()) {
+                out.write(block.data(), used);
+                used = 0;
+            }
+        }
+    });
+    out.write(block.data(), used);
+    out.flush();
+    if (!out) throw std::runtime_error("HashMap<K, M, H, E, A>::save: cannot write " + path);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::load(const std::string& path) {
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<M>::value,
+                  "HashMap::load(path) copies bytes, use load(path, serializer) for other types");
+    constexpr size_t record_bytes = sizeof(size_t) + sizeof(K) + sizeof(M);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("HashMap<K, M, H, E, A>::load: cannot open " + path);
+    uint64_t section_bytes = 0;
+    auto [buckets, count] = read_snapshot_header(in, kSnapshotBytes, section_bytes);
+    if (section_bytes != count * record_bytes) {
+        throw std::runtime_error("HashMap<K, M, H, E, A>::load: corrupt snapshot header");
+    }
+
+    // build the new contents on the side, so that *this is untouched if anything throws
+    HashMap<K, M, H, E, A> loaded(buckets, _hash_function, _key_equal, get_allocator());
+    std::vector<char> block(std::max<size_t>(kSnapshotBlock / record_bytes, 1) * record_bytes);
+    Node* tail = nullptr;
+    for (size_t remaining = count; remaining > 0;) {
+        size_t records = std::min(remaining, block.size() / record_bytes);
+        if (!in.read(block.data(), records * record_bytes)) {
+            throw std::runtime_error("HashMap<K, M, H, E, A>::load: truncated snapshot " + path);
+        }
+        for (const char* record = block.data(); record != block.data() + records * record_bytes; record += record_bytes) {
+            size_t hash;
+            K key;
+            M mapped;
+            std::memcpy(&hash, record, sizeof(size_t));
+            std::memcpy(&key, record + sizeof(size_t), sizeof(K));
+            std::memcpy(&mapped, record + sizeof(size_t) + sizeof(K), sizeof(M));
+            loaded.link_loaded(loaded.create_node(hash, key, mapped), tail);
+            if (remaining == count && record == block.data()) loaded.check_loaded_hash(tail);
+        }
+        remaining -= records;
+    }
+    take_loaded(loaded);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Serializer>
+void HashMap<K, M, H, E, A>::save(const std::string& path, const Serializer& serializer) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("HashMap<K, M, H, E, A>::save: cannot open " + path);
+    // the length of the element section is only known at the end, it is patched in then
+    write_snapshot_header(out, kSnapshotSerialized, 0);
+    auto section_start = out.tellp();
+
+    std::ostringstream record;
+    for_each_chain([&](const Node* head) {
+        for (; head != nullptr; head = head->next) {
+            record.str("");
+            serializer.write(record, head->value);
+            std::string bytes = record.str();
+            uint64_t length = bytes.size();
+            out.write(reinterpret_cast<const char*>(&head->hash), sizeof(size_t));
+            out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            out.write(bytes.data(), bytes.size());
+        }
+    });
+    uint64_t section_bytes = out.tellp() - section_start;
+    out.seekp(0);
+    write_snapshot_header(out, kSnapshotSerialized, section_bytes);
+    out.flush();
+    if (!out) throw std::runtime_error("HashMap<K, M, H, E, A>::save: cannot write " + path);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Serializer>
+void HashMap<K, M, H, E, A>::load(const std::string& path, const Serializer& serializer) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("HashMap<K, M, H, E, A>::load: cannot open " + path);
+    uint64_t section_bytes = 0;
+    auto [buckets, count] = read_snapshot_header(in, kSnapshotSerialized, section_bytes);
+
+    HashMap<K, M, H, E, A> loaded(buckets, _hash_function, _key_equal, get_allocator());
+    Node* tail = nullptr;
+    std::string bytes;
+    std::istringstream record;
+    uint64_t consumed = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t hash;
+        uint64_t length;
+        in.read(reinterpret_cast<char*>(&hash), sizeof(size_t));
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        consumed += sizeof(size_t) + sizeof(length) + length;
+        if (!in || consumed > section_bytes) {
+            throw std::runtime_error("HashMap<K, M, H, E, A>::load: truncated snapshot " + path);
+        }
+        bytes.resize(length);
+        if (!in.read(bytes.data(), length)) {
+            throw std::runtime_error("HashMap<K, M, H, E, A>::load: truncated snapshot " + path);
+        }
+        record.str(bytes);
+        record.clear();
+        auto value = serializer.read(record);
+        if (record.fail()) throw std::runtime_error("HashMap<K, M, H, E, A>::load: serializer failed on " + path);
+        loaded.link_loaded(loaded.create_node(hash, std::move(value.first), std::move(value.second)), tail);
+        if (i == 0) loaded.check_loaded_hash(tail);
+    }
+    if (consumed != section_bytes) throw std::runtime_error("HashMap<K, M, H, E, A>::load: corrupt snapshot " + path);
+    take_loaded(loaded);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+FrozenHashMap<K, M, H, E> HashMap<K, M, H, E, A>::freeze() const {
+    std::vector<std::pair<size_t, const value_type*>> elements;
+    elements.reserve(_size);
+    for_each_chain([&](const Node* head) {
+        for (; head != nullptr; head = head->next) {
+            elements.push_back({head->hash, &head->value});
+        }
+    });
+    return FrozenHashMap<K, M, H, E>(elements, _hash_function, _key_equal);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::merge(HashMap<K, M, H, E, A>& source) {
+    if (&source == this || source._size == 0) return;
+    source.finish_migration();
+    // size the bucket array for the case where every key is new, so that it grows at most once
+    if (_size + source._size > _max_load_factor * bucket_count()) {
+        rehash(static_cast<size_t>(std::ceil((_size + source._size) / _max_load_factor)));
+    }
+    bool adopt = _node_allocator == source._node_allocator;
+    for (Node*& bucket : source._buckets_array) {
+        Node* pre_node = nullptr;
+        for (Node* node = bucket; node != nullptr;) {
+            Node* next = node->next;
+            size_t hash = hash_for(*this, node);
+            auto [tail, found] = find_node(node->value.first, hash);
+            if (found != nullptr) {
+                pre_node = node;
+                node = next;
+                continue;
+            }
+            if (adopt) {
+                (pre_node != nullptr ? pre_node->next : bucket) = next;
+                node->next = nullptr;
+                node->hash = hash;
+                link_new_node(tail, node);
+            } else {
+                // our allocator cannot free a node of source, so the element moves to a node of ours
+                link_new_node(tail, create_node(hash, node->value.first, std::move(node->value.second)));
+                (pre_node != nullptr ? pre_node->next : bucket) = next;
+                source.destroy_node(node);
+            }
+            source._size--;
+            node = next;
+        }
+    }
+    source.rebuild_occupancy();
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::merge(HashMap<K, M, H, E, A>&& source) {
+    merge(source);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+size_t HashMap<K, M, H, E, A>::intersect_with(const HashMap<K, M, H, E, A>& other) {
+    if (&other == this) return 0;
+    size_t erased = 0;
+    if (_size <= other._size) {
+        erased = erase_nodes_if([&](const Node* node) {
+            return other.find_node(node->value.first, hash_for(other, node)).second == nullptr;
+        });
+    } else {
+        // probe the keys of other, and set aside the nodes they find: those are the ones to keep
+        finish_migration();
+        std::vector<Node*> kept;
+        kept.reserve(other._size);
+        other.for_each_chain([&](const Node* head) {
+            for (; head != nullptr; head = head->next) {
+                size_t hash = hash_for(*this, head);
+                auto [pre_node, cur_node] = find_node(head->value.first, hash);
+                if (cur_node == nullptr) continue;
+                (pre_node != nullptr ? pre_node->next : _buckets_array[bucket_index(hash)]) = cur_node->next;
+                kept.push_back(cur_node);
+            }
+        });
+        erased = _size - kept.size();
+        for (Node*& bucket : _buckets_array) {
+            while (bucket != nullptr) {
+                Node* next = bucket->next;
+                destroy_node(bucket);
+                bucket = next;
+            }
+        }
+        for (Node* node : kept) {
+            Node*& bucket = _buckets_array[bucket_index(node->hash)];
+            node->next = bucket;
+            bucket = node;
+        }
+        _size = kept.size();
+        rebuild_occupancy();
+        // most of the bits of the filter may belong to erased keys by now
+        if (_bloom.enabled()) rebuild_bloom();
+    }
+    shrink_if_needed();
+    return erased;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+size_t HashMap<K, M, H, E, A>::difference_with(const HashMap<K, M, H, E, A>& other) {
+    if (&other == this) {
+        size_t erased = _size;
+        clear();
+        return erased;
+    }
+    size_t erased = 0;
+    if (_size <= other._size) {
+        erased = erase_nodes_if([&](const Node* node) {
+            return other.find_node(node->value.first, hash_for(other, node)).second != nullptr;
+        });
+    } else {
+        other.for_each_chain([&](const Node* head) {
+            for (; head != nullptr; head = head->next) {
+                size_t hash = hash_for(*this, head);
+                auto [pre_node, cur_node] = find_node(head->value.first, hash);
+                if (cur_node == nullptr) continue;
+                erase_node(bucket_for(hash), pre_node, cur_node);
+                erased++;
+            }
+        });
+    }
+    shrink_if_needed();
+    return erased;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+HashMap<K, M, H, E, A> HashMap<K, M, H, E, A>::symmetric_difference(const HashMap<K, M, H, E, A>& other) const {
+    bool larger = _size >= other._size;
+    // copying the larger map keeps its chains as they are (see copy_chains), the smaller one is probed into it
+    HashMap<K, M, H, E, A> result(larger ? *this : other);
+    const HashMap<K, M, H, E, A>& smaller = larger ? other : *this;
+    smaller.for_each_chain([&](const Node* head) {
+        for (; head != nullptr; head = head->next) {
+            size_t hash = hash_for(result, head);
+            auto [pre_node, cur_node] = result.find_node(head->value.first, hash);
+            if (cur_node != nullptr) {
+                result.erase_node(result.bucket_for(hash), pre_node, cur_node);
+            } else {
+                result.link_new_node(pre_node, result.create_node(hash, head->value));
+            }
+        }
+    });
+    result.shrink_if_needed();
+    return result;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+size_t HashMap<K, M, H, E, A>::hash_for(const HashMap<K, M, H, E, A>& map, const Node* node) {
+    if constexpr (std::is_empty<H>::value) {
+        return node->hash;
+    } else {
+        return map._hash_function(node->value.first);
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Pred>
+size_t HashMap<K, M, H, E, A>::erase_nodes_if(Pred pred) {
+    finish_migration();
+    size_t erased = 0;
+    try {
+        for (Node*& bucket : _buckets_array) {
+            Node* pre_node = nullptr;
+            for (Node* node = bucket; node != nullptr;) {
+                Node* next = node->next;
+                if (pred(node)) {
+                    (pre_node != nullptr ? pre_node->next : bucket) = next;
+                    destroy_node(node);
+                    erased++;
+                } else {
+                    pre_node = node;
+                }
+                node = next;
+            }
+        }
+    } catch (...) {
+        _size -= erased;
+        rebuild_occupancy();
+        throw;
+    }
+    _size -= erased;
+    rebuild_occupancy();
+    return erased;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+HashMap<K, M, H, E, A>::HashMap(const HashMap<K, M, H, E, A>& map): 
     _size(0), 
     _hash_function(map._hash_function),
-    _buckets_array(map.bucket_count(), nullptr){
+    _key_equal(map._key_equal),
+    _buckets_array(map.bucket_count(), nullptr),
+    _max_load_factor(map._max_load_factor),
+    _min_load_factor(map._min_load_factor),
+    _node_allocator(node_traits::select_on_container_copy_construction(map._node_allocator)),
+    _migrate_idx(0),
+    _incremental_rehash(map._incremental_rehash),
+    _occupied(occupancy_words(map.bucket_count()), 0),
+    _first_occupied(map.bucket_count()) {
 
-    for (const auto& kv_pair : map) {
-        insert(kv_pair);
+    try {
+        copy_chains(map);
+    } catch (...) {
+        clear();
+        throw;
     }
 }
 
-template<typename K, typename M, typename H>
-HashMap<K, M, H>::HashMap(HashMap<K, M, H>&& map):
+template<typename K, typename M, typename H, typename E, typename A>
+HashMap<K, M, H, E, A>::HashMap(HashMap<K, M, H, E, A>&& map):
     _size(std::move(map._size)),
     _hash_function(std::move(map._hash_function)),
-    _buckets_array(std::move(map._buckets_array)) {
+    _key_equal(std::move(map._key_equal)),
+    _buckets_array(std::move(map._buckets_array)),
+    _max_load_factor(map._max_load_factor),
+    _min_load_factor(map._min_load_factor),
+    _node_allocator(map._node_allocator),
+    _old_buckets_array(std::move(map._old_buckets_array)),
+    _migrate_idx(map._migrate_idx),
+    _incremental_rehash(map._incremental_rehash),
+    _occupied(std::move(map._occupied)),
+    _first_occupied(map._first_occupied),
+    _bloom(std::move(map._bloom)),
+    _next_bloom(std::move(map._next_bloom)) {
 
-    map._buckets_array.resize(_buckets_array.size(), nullptr);
+    // the moved-from map restarts with the default bucket count, so that moving
+    // stays O(1) no matter how much the bucket array of map has grown
+    map._buckets_array.assign(kDefaultBuckets, nullptr);
+    map._old_buckets_array.clear();
+    map._migrate_idx = 0;
+    map.rebuild_occupancy();
     map._size = 0;
+    // it keeps its settings, the filter included
+    map._next_bloom.release();
+    if (_bloom.enabled()) map.rebuild_bloom();
+    // the nodes now belong to us, give map an allocator of its own (a fresh pool for PoolAllocator)
+    map._node_allocator = node_traits::select_on_container_copy_construction(_node_allocator);
 }
 
-template<typename K, typename M, typename H>
-HashMap<K, M, H>& HashMap<K, M, H>::operator=(const HashMap<K, M, H>& map) {
+template<typename K, typename M, typename H, typename E, typename A>
+HashMap<K, M, H, E, A>& HashMap<K, M, H, E, A>::operator=(const HashMap<K, M, H, E, A>& map) {
     if (this == &map) return *this;
     clear();
+    if constexpr (node_traits::propagate_on_container_copy_assignment::value) {
+        _node_allocator = map._node_allocator;
+    }
     _hash_function = map._hash_function;
-    for(const auto& kv_pair : map) {
-        insert(kv_pair);
+    _key_equal = map._key_equal;
+    _max_load_factor = map._max_load_factor;
+    _min_load_factor = map._min_load_factor;
+    _incremental_rehash = map._incremental_rehash;
+    _buckets_array.assign(map.bucket_count(), nullptr);
+    try {
+        copy_chains(map);
+    } catch (...) {
+        clear();
+        throw;
     }
     return *this;
 }
 
-template<typename K, typename M, typename H>
-HashMap<K, M, H>& HashMap<K, M, H>::operator=(HashMap<K, M, H>&& map) {
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::copy_chains(const HashMap<K, M, H, E, A>& map) {
+    // with the same elements and bucket count, the copy can start from the filter of map as is,
+    // unless map is halfway through a migration
+    _next_bloom.release();
+    _bloom = map.migrating() ? BlockedBloomFilter() : map._bloom;
+    if constexpr (kBulkCopy) {
+        // copying a pool full of erased nodes would cost more than copying the live ones
+        const NodePool& pool = map._node_allocator.pool();
+        if (!map.migrating() && map._node_allocator.owns_pool_exclusively() && _node_allocator.pool().slab_count() == 0 &&
+            pool.bytes_reserved() <= 2 * map._size * sizeof(Node)) {
+            // the nodes keep their offsets, so only the next pointers and the bucket heads are redirected,
+            // reading the copied slabs front to back instead of chasing the chains of map
+            NodePool::Relocation relocation = _node_allocator.copy_pool(map._node_allocator,
+                    [](void* chunk, const NodePool::Relocation& relocation) {
+                Node* node = static_cast<Node*>(chunk);
+                if (node->next != nullptr) node->next = static_cast<Node*>(relocation(node->next));
+            });
+            for (size_t i = 0; i < _buckets_array.size(); i++) {
+                Node* head = map._buckets_array[i];
+                if (head != nullptr) _buckets_array[i] = static_cast<Node*>(relocation(head));
+            }
+            _size = map._size;
+            rebuild_occupancy();
+            return;
+        }
+    }
+    try {
+        map.for_each_chain([&](const Node* head) {
+            Node* tail = nullptr;
+            for (; head != nullptr; head = head->next) {
+                link_loaded(create_node(head->hash, head->value), tail);
+            }
+        });
+    } catch (...) {
+        // the nodes copied so far are linked, so the caller can clear() them
+        rebuild_occupancy();
+        throw;
+    }
+    rebuild_occupancy();
+    if (map.migrating() && map._bloom.enabled()) rebuild_bloom();
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+HashMap<K, M, H, E, A>& HashMap<K, M, H, E, A>::operator=(HashMap<K, M, H, E, A>&& map) {
     if (this == &map) return *this;
     clear();
-    _size = std::move(map._size);
     _hash_function = map._hash_function;
+    _key_equal = map._key_equal;
+    _max_load_factor = map._max_load_factor;
+    _min_load_factor = map._min_load_factor;
+    _incremental_rehash = map._incremental_rehash;
+    if constexpr (!node_traits::propagate_on_container_move_assignment::value) {
+        if (_node_allocator != map._node_allocator) {
+            // our allocator cannot free map's nodes, so the elements have to be moved one by one
+            bloom_filter(map.bloom_filter());
+            for (auto& kv_pair : map) {
+                try_emplace(kv_pair.first, std::move(kv_pair.second));
+            }
+            map.clear();
+            return *this;
+        }
+    }
+
+    _size = std::move(map._size);
     _buckets_array = std::move(map._buckets_array);
+    _old_buckets_array = std::move(map._old_buckets_array);
+    _migrate_idx = map._migrate_idx;
+    _occupied = std::move(map._occupied);
+    _first_occupied = map._first_occupied;
+    _bloom = std::move(map._bloom);
+    _next_bloom = std::move(map._next_bloom);
+    if constexpr (node_traits::propagate_on_container_move_assignment::value) {
+        _node_allocator = map._node_allocator;
+        map._node_allocator = node_traits::select_on_container_copy_construction(_node_allocator);
+    }
 
     map._size = 0;
-    map._buckets_array.resize(_buckets_array.size(), nullptr);
+    map._buckets_array.assign(kDefaultBuckets, nullptr);
+    map._old_buckets_array.clear();
+    map._migrate_idx = 0;
+    map.rebuild_occupancy();
+    map._next_bloom.release();
+    if (_bloom.enabled()) map.rebuild_bloom();
 
     return *this;
 }
 
-template<typename K, typename M, typename H>
-typename HashMap<K, M, H>::node_pair HashMap<K, M, H>::find_node(const K& key) const{
-    size_t index = _hash_function(key) % _buckets_array.size();
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::rehash(size_t new_buckets, size_t threads) {
+    if (new_buckets == 0) throw std::out_of_range("HashMap<K, M, H, E, A>::rehash: Invalid Input Parameters");
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    finish_migration();
+    size_t min_buckets = static_cast<size_t>(std::ceil(_size / _max_load_factor));
+    new_buckets = round_up_buckets(std::max(new_buckets, min_buckets));
+
+    bucket_array_type temp_bkt_array(new_buckets, nullptr);
+    std::swap(temp_bkt_array, _buckets_array);
+
+    // residues are split evenly, but a thread gets at least a few cache lines of buckets
+    size_t stride = std::min(temp_bkt_array.size(), _buckets_array.size());
+    threads = std::max<size_t>(1, std::min(threads, stride / 64));
+    run_parallel(threads, [&](size_t t) {
+        redistribute(temp_bkt_array, stride, stride * t / threads, stride * (t + 1) / threads);
+    });
+    // neighbouring buckets share bitmap words, so the bitmap is built after the threads are done
+    rebuild_occupancy();
+    if (_bloom.enabled()) rebuild_bloom();
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename RandomIt>
+void HashMap<K, M, H, E, A>::bulk_build(RandomIt first, size_t count, size_t threads) {
+    size_t min_buckets = static_cast<size_t>(std::ceil(count / _max_load_factor));
+    _buckets_array.assign(round_up_buckets(std::max(_buckets_array.size(), min_buckets)), nullptr);
+    rebuild_occupancy();
+    if (count == 0) return;
+    const size_t buckets = _buckets_array.size();
+    // partition p owns buckets [p * span, (p + 1) * span), and is linked by thread p
+    const size_t span = (buckets + threads - 1) / threads;
+
+    // pass 1: hash every key of our slice of the input, and count the keys of each partition
+    std::vector<size_t> hashes(count);
+    std::vector<size_t> offsets(threads * threads, 0);       // [partition][thread]
+    run_parallel(threads, [&](size_t t) {
+        H hash_function = _hash_function;
+        for (size_t i = count * t / threads; i < count * (t + 1) / threads; i++) {
+            hashes[i] = hash_function(first[i].first);
+            offsets[bucket_index(hashes[i]) / span * threads + t]++;
+        }
+    });
+    size_t total = 0;
+    for (auto& offset : offsets) {
+        size_t slice = offset;
+        offset = total;
+        total += slice;
+    }
+
+    // pass 2: scatter the input positions by partition. Positions stay in input order within each
+    // partition, which is what keeps the first of several equal keys, like insert does
+    std::vector<size_t> order(count);
+    run_parallel(threads, [&](size_t t) {
+        std::vector<size_t> next(threads);
+        for (size_t p = 0; p < threads; p++) next[p] = offsets[p * threads + t];
+        for (size_t i = count * t / threads; i < count * (t + 1) / threads; i++) {
+            order[next[bucket_index(hashes[i]) / span]++] = i;
+        }
+    });
+
+    // the allocator is not required to be thread safe, so every node is allocated up front,
+    // and the ones that turn out to hold duplicate keys are given back afterwards
+    std::vector<Node*> nodes(count, nullptr);
+    try {
+        for (auto& node : nodes) node = node_traits::allocate(_node_allocator, 1);
+    } catch (...) {
+        for (Node* node : nodes) {
+            if (node != nullptr) node_traits::deallocate(_node_allocator, node, 1);
+        }
+        throw;
+    }
+
+    // pass 3: every thread builds the chains of its own bucket range
+    std::vector<char> linked(count, false);
+    std::vector<size_t> sizes(threads, 0);
+    std::exception_ptr error;
+    try {
+        run_parallel(threads, [&](size_t p) {
+            E key_equal = _key_equal;
+            size_t begin = offsets[p * threads], end = (p + 1 < threads) ? offsets[(p + 1) * threads] : count;
+            for (size_t k = begin; k < end; k++) {
+                size_t i = order[k];
+                Node*& bucket = _buckets_array[bucket_index(hashes[i])];
+                Node* cur_node = bucket;
+                while (cur_node != nullptr && !(cur_node->hash == hashes[i] && key_equal(cur_node->value.first, first[i].first))) {
+                    cur_node = cur_node->next;
+                }
+                if (cur_node != nullptr) continue;
+                node_traits::construct(_node_allocator, nodes[i], hashes[i], first[i]);
+                nodes[i]->next = bucket;
+                bucket = nodes[i];
+                linked[i] = true;
+                sizes[p]++;
+            }
+        });
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!linked[i]) node_traits::deallocate(_node_allocator, nodes[i], 1);
+    }
+    for (size_t size : sizes) _size += size;
+    rebuild_occupancy();
+    if (_bloom.enabled()) rebuild_bloom();
+    // the linked nodes are complete, so the destructor cleans them up
+    if (error) std::rethrow_exception(error);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Fn>
+void HashMap<K, M, H, E, A>::run_parallel(size_t threads, Fn fn) {
+    std::vector<std::exception_ptr> errors(threads);
+    auto task = [&fn, &errors](size_t t) {
+        try {
+            fn(t);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t t = 1; t < threads; t++) {
+        try {
+            workers.emplace_back(task, t);
+        } catch (const std::system_error&) {
+            task(t);
+        }
+    }
+    task(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::redistribute(std::vector<Node *>& old_buckets, size_t stride, size_t first, size_t last) {
+    for (size_t base = 0; base < old_buckets.size(); base += stride) {
+        for (size_t i = base + first; i < base + last; i++) {
+            Node* temp_bkt = old_buckets[i];
+            while (temp_bkt != nullptr) {
+                Node* temp = temp_bkt;
+                temp_bkt = temp_bkt->next;
+                size_t index = bucket_index(temp->hash);
+                temp->next = _buckets_array[index];
+                _buckets_array[index] = temp;
+            }
+        }
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Q>
+typename HashMap<K, M, H, E, A>::node_pair HashMap<K, M, H, E, A>::find_node(const Q& key, size_t hash) const{
     Node* pre_node = nullptr;
-    Node* cur_node = _buckets_array[index];
+    Node* cur_node = bucket_head(hash);
+    size_t probes = 0;
     while (cur_node != nullptr)
     {
-        const auto& [cur_key, cur_val] = cur_node->value;
-        if (cur_key == key) return {pre_node, cur_node};
+        ++probes;
+        // the cheap hash compare filters out almost every other key in the chain
+        if (cur_node->hash == hash && _key_equal(cur_node->value.first, key)) {
+            record_lookup(true, probes);
+            return {pre_node, cur_node};
+        }
         pre_node = cur_node;
         cur_node = cur_node->next;
     }
+    record_lookup(false, probes);
     return {pre_node, cur_node};
 }
 
-template<typename K, typename M, typename H>
-size_t HashMap<K, M, H>::first_not_empty_bucket() const {
-    for (size_t i = 0; i < _buckets_array.size(); i++) {
-        if (_buckets_array[i] != nullptr) return i;
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename Q>
+typename HashMap<K, M, H, E, A>::Node* HashMap<K, M, H, E, A>::lookup_node(const Q& key, size_t hash) const {
+    if (_bloom.enabled() && !_bloom.may_contain(hash)) {
+        record_bloom_rejection();
+        return nullptr;
+    }
+    return find_node(key, hash).second;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::Node* HashMap<K, M, H, E, A>::find_predecessor(Node* head, const Node* node) const {
+    Node* pre_node = nullptr;
+    Node* cur_node = head;
+    while (cur_node != node) {
+        pre_node = cur_node;
+        cur_node = cur_node->next;
+    }
+    return pre_node;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+size_t HashMap<K, M, H, E, A>::round_up_buckets(size_t bucket_count) {
+    size_t buckets = 1;
+    while (buckets < bucket_count) buckets <<= 1;
+    return buckets;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+bool HashMap<K, M, H, E, A>::grow_if_needed() {
+    if (_size + 1 <= _max_load_factor * bucket_count()) return false;
+    size_t min_buckets = static_cast<size_t>(std::ceil((_size + 1) / _max_load_factor));
+    size_t new_buckets = std::max(2 * bucket_count(), min_buckets);
+    if (_incremental_rehash) {
+        start_migration(new_buckets);
+    } else {
+        rehash(new_buckets);
+    }
+    return true;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::Node* const& HashMap<K, M, H, E, A>::bucket_head(size_t hash) const {
+    if (migrating()) {
+        size_t old_index = hash & (_old_buckets_array.size() - 1);
+        if (old_index >= _migrate_idx) return _old_buckets_array[old_index];
+    }
+    return _buckets_array[bucket_index(hash)];
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::Node*& HashMap<K, M, H, E, A>::bucket_for(size_t hash) {
+    return const_cast<Node*&>(bucket_head(hash));
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::start_migration(size_t new_buckets) {
+    finish_migration();
+    new_buckets = round_up_buckets(new_buckets);
+    _old_buckets_array = bucket_array_type(new_buckets, nullptr);
+    std::swap(_old_buckets_array, _buckets_array);
+    _migrate_idx = 0;
+    rebuild_occupancy();
+    if (_bloom.enabled()) _next_bloom.reset(bloom_capacity(new_buckets));
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::migrate_step(size_t count) {
+    size_t end = std::min(_old_buckets_array.size(), _migrate_idx + count);
+    for (; _migrate_idx < end; _migrate_idx++) {
+        Node*& old_bkt = _old_buckets_array[_migrate_idx];
+        while (old_bkt != nullptr) {
+            Node* temp = old_bkt;
+            old_bkt = old_bkt->next;
+            size_t index = bucket_index(temp->hash);
+            temp->next = _buckets_array[index];
+            _buckets_array[index] = temp;
+            mark_occupied(index);
+            _next_bloom.add(temp->hash);
+        }
+    }
+    if (_migrate_idx == _old_buckets_array.size()) {
+        // give the memory of the old array back, not just its contents
+        bucket_array_type().swap(_old_buckets_array);
+        _migrate_idx = 0;
+        if (_bloom.enabled()) {
+            _bloom = std::move(_next_bloom);
+            _next_bloom.release();
+        }
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::finish_migration() {
+    if (migrating()) migrate_step(_old_buckets_array.size());
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::rebuild_bloom() {
+    _bloom.reset(bloom_capacity(bucket_count()));
+    for_each_chain([&](const Node* head) {
+        for (; head != nullptr; head = head->next) _bloom.add(head->hash);
+    });
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+size_t HashMap<K, M, H, E, A>::next_occupied(const std::vector<uint64_t>& bits, size_t from) {
+    size_t word = from / 64;
+    if (word >= bits.size()) return bits.size() * 64;
+    // drop the bits of the buckets before from, then skip whole empty words
+    uint64_t rest = bits[word] & (~uint64_t(0) << (from % 64));
+    while (rest == 0) {
+        if (++word == bits.size()) return bits.size() * 64;
+        rest = bits[word];
+    }
+    return word * 64 + count_trailing_zeros(rest);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::mark_occupied(size_t index) {
+    _occupied[index / 64] |= uint64_t(1) << (index % 64);
+    _first_occupied = std::min(_first_occupied, index);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::update_occupancy(Node* const& bucket) {
+    // only _buckets_array has a bitmap, the old array of an incremental rehash is scanned
+    if (std::less<Node* const*>()(&bucket, _buckets_array.data()) ||
+        !std::less<Node* const*>()(&bucket, _buckets_array.data() + _buckets_array.size())) return;
+    size_t index = &bucket - _buckets_array.data();
+    if (bucket != nullptr) {
+        mark_occupied(index);
+        return;
+    }
+    _occupied[index / 64] &= ~(uint64_t(1) << (index % 64));
+    if (index == _first_occupied) {
+        _first_occupied = std::min(next_occupied(_occupied, index + 1), _buckets_array.size());
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::rebuild_occupancy() {
+    _occupied.assign(occupancy_words(_buckets_array.size()), 0);
+    _first_occupied = _buckets_array.size();
+    for (size_t i = _buckets_array.size(); i-- > 0;) {
+        if (_buckets_array[i] != nullptr) mark_occupied(i);
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::shrink_if_needed() {
+    if (_min_load_factor == 0 || bucket_count() <= kDefaultBuckets) return;
+    if (_size < _min_load_factor * bucket_count()) {
+        // shrink straight to a load factor of about max_load_factor / 2, which is above
+        // min_load_factor, but far enough from max_load_factor that we do not grow right away
+        size_t new_buckets = static_cast<size_t>(std::ceil(2 * _size / _max_load_factor));
+        rehash(std::max(new_buckets, kDefaultBuckets));
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename ForwardIt, typename Emit>
+void HashMap<K, M, H, E, A>::lookup_batched(ForwardIt first, ForwardIt last, Emit emit) const {
+    size_t hashes[kLookupBatch];
+    Node* heads[kLookupBatch];
+    bool rejected[kLookupBatch];
+    while (first != last) {
+        // pass 1: hash the group and prefetch the buckets of the keys the Bloom filter lets through
+        ForwardIt group_end = first;
+        size_t count = 0;
+        for (; group_end != last && count < kLookupBatch; ++group_end, ++count) {
+            hashes[count] = _hash_function(*group_end);
+            rejected[count] = _bloom.enabled() && !_bloom.may_contain(hashes[count]);
+            if (!rejected[count]) prefetch(&bucket_head(hashes[count]));
+        }
+        // pass 2: read the buckets and prefetch the chain heads
+        for (size_t i = 0; i < count; ++i) {
+            heads[i] = rejected[i] ? nullptr : bucket_head(hashes[i]);
+            if (heads[i] != nullptr) prefetch(heads[i]);
+        }
+        // pass 3: walk the chains, most of them are in the cache by now
+        for (size_t i = 0; i < count; ++i, ++first) {
+            if (rejected[i]) {
+                record_bloom_rejection();
+                emit(nullptr);
+                continue;
+            }
+            Node* cur_node = heads[i];
+            size_t probes = 0;
+            for (; cur_node != nullptr; cur_node = cur_node->next) {
+                ++probes;
+                if (cur_node->hash == hashes[i] && _key_equal(cur_node->value.first, *first)) break;
+            }
+            record_lookup(cur_node != nullptr, probes);
+            emit(cur_node);
+        }
+    }
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::erase_node(Node*& bucket, Node* pre_node, Node* cur_node) {
+    Node * temp = cur_node->next;
+    destroy_node(cur_node);
+    if (pre_node != nullptr) {
+        pre_node->next = temp;
+    } else {
+        bucket = temp;
+        update_occupancy(bucket);
+    }
+    _size--;
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+template<typename... Args>
+typename HashMap<K, M, H, E, A>::Node* HashMap<K, M, H, E, A>::create_node(size_t hash, Args&&... args) {
+    Node* node = node_traits::allocate(_node_allocator, 1);
+    try {
+        node_traits::construct(_node_allocator, node, hash, std::forward<Args>(args)...);
+    } catch (...) {
+        node_traits::deallocate(_node_allocator, node, 1);
+        throw;
     }
-    return _buckets_array.size() - 1;
+    return node;
 }
 
-template<typename K, typename M, typename H>
-typename HashMap<K, M, H>::iterator HashMap<K, M, H>::make_iterator(Node* curr) {
+template<typename K, typename M, typename H, typename E, typename A>
+void HashMap<K, M, H, E, A>::destroy_node(Node* node) {
+    node_traits::destroy(_node_allocator, node);
+    node_traits::deallocate(_node_allocator, node, 1);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+typename HashMap<K, M, H, E, A>::iterator HashMap<K, M, H, E, A>::make_iterator(Node* curr) {
     size_t index = bucket_count();
     if (curr != nullptr) {
-        index = _hash_function(curr->value.first) % _buckets_array.size();
+        if (migrating()) {
+            // a node that has not been migrated yet is still in the old array, and the iterator
+            // has to visit the rest of the old array before it moves on to the new one
+            size_t old_index = curr->hash & (_old_buckets_array.size() - 1);
+            if (old_index >= _migrate_idx) return iterator(&_old_buckets_array, curr, old_index, &_buckets_array, &_occupied);
+        }
+        index = bucket_index(curr->hash);
     }
 
-    return iterator(&_buckets_array, curr, index);
+    return iterator(&_buckets_array, curr, index, nullptr, &_occupied);
 
 }
 
-template<typename K, typename M, typename H>
-std::ostream& operator<<(std::ostream& stream, const HashMap<K, M, H>& map) {
+template<typename K, typename M, typename H, typename E, typename A>
+std::ostream& operator<<(std::ostream& stream, const HashMap<K, M, H, E, A>& map) {
     std::stringstream str_stream;
     for (const auto& kv_pair : map) {
         str_stream << kv_pair.first << ":" << kv_pair.second << ", ";
@@ -297,16 +1578,19 @@ std::ostream& operator<<(std::ostream& stream, const HashMap<K, M, H>& map) {
     return stream;
 }
 
-template<typename K, typename M, typename H>
-bool operator==(const HashMap<K, M, H>& lhs, const HashMap<K, M, H>& rhs) {
+template<typename K, typename M, typename H, typename E, typename A>
+bool operator==(const HashMap<K, M, H, E, A>& lhs, const HashMap<K, M, H, E, A>& rhs) {
+    // maps of different sizes are never equal, and otherwise one lookup per element settles it
+    if (lhs.size() != rhs.size()) return false;
+    auto rhs_end = rhs.end();
     for(const auto& kv_pair : lhs) {
-        if (!rhs.contains(kv_pair.first)) return false;
-        if (rhs.at(kv_pair.first) != kv_pair.second) return false;
+        auto found = rhs.find(kv_pair.first);
+        if (found == rhs_end || found->second != kv_pair.second) return false;
     }
-    return lhs.size() == rhs.size();
+    return true;
 }
 
-template<typename K, typename M, typename H>
-bool operator!=(const HashMap<K, M, H>& lhs, const HashMap<K, M, H>& rhs) {
+template<typename K, typename M, typename H, typename E, typename A>
+bool operator!=(const HashMap<K, M, H, E, A>& lhs, const HashMap<K, M, H, E, A>& rhs) {
     return !(lhs == rhs);
 }
@@ -6,15 +6,107 @@
 #include <iomanip>
 #include <sstream>
 #include <vector>
+#include <cmath>        // for std::ceil
+#include <algorithm>    // for std::max
+#include <memory>       // for std::allocator, std::allocator_traits
+#include <type_traits>  // for std::is_trivially_destructible, std::enable_if_t
+#include <functional>   // for std::equal_to
+#include <tuple>        // for std::forward_as_tuple
+#include <utility>      // for std::piecewise_construct, std::forward
+#include <thread>       // for std::thread, std::thread::hardware_concurrency
+#include <system_error> // for std::system_error
+#include <exception>    // for std::exception_ptr
+#include <iterator>     // for std::iterator_traits
+#include <cstdint>      // for uint64_t
+#include <atomic>       // for the optional probe counters
+#include <fstream>      // for save and load
+#include <cstring>      // for std::memcpy
+#include <stdexcept>    // for std::runtime_error
+#include <string>
 
 #include "hashmap_iterator.h"
+#include "pool_allocator.h"
+#include "frozen_hashmap.h"
+#include "hash_functions.h"
+#include "bloom_filter.h"
+
+/*
+* Define HASHMAP_PROBE_COUNTERS to 1 (before including hashmap.h) to make every HashMap count
+* the lookups it does and the chain nodes each of them compares, for HashMap::stats().
+* The counters are relaxed atomics, so concurrent const lookups stay safe. When the macro is 0
+* (the default), neither the counters nor any code that updates them is compiled in.
+*/
+#ifndef HASHMAP_PROBE_COUNTERS
+#define HASHMAP_PROBE_COUNTERS 0
+#endif
+
+/*
+* A snapshot of the shape and memory use of a HashMap, returned by HashMap::stats().
+*/
+struct HashMapStats {
+    size_t size = 0;
+    size_t bucket_count = 0;
+    float load_factor = 0;
+
+    /*
+    * chain_length_histogram[i] is the number of buckets whose chain has exactly i nodes, so
+    * chain_length_histogram[0] counts the empty buckets. With a good hash function and a load
+    * factor of 1, it follows a Poisson distribution: about 37% / 37% / 18% / 6% / 1.5% for 0-4.
+    * A long tail or a large max_chain_length points to a degenerate hash function.
+    */
+    std::vector<size_t> chain_length_histogram;
+    size_t max_chain_length = 0;
+    float empty_bucket_ratio = 0;
+
+    /*
+    * Memory: node_bytes is size * sizeof(node) (the allocator may round each node up), and
+    * bucket_array_bytes covers the bucket array(s) and the occupancy bitmap.
+    */
+    size_t node_size = 0;
+    size_t node_bytes = 0;
+    size_t bucket_array_bytes = 0;
+
+    /*
+    * Bloom filter (see HashMap::bloom_filter), all zero when it is disabled.
+    * bloom_false_positive_rate is the estimated chance that a lookup of an absent key gets past
+    * the filter. With probe counters, bloom_rejected_lookups counts the unsuccessful lookups the
+    * filter answered on its own, so 1 - bloom_rejected_lookups / unsuccessful_lookups is the
+    * measured rate (for a workload without hits on erased keys).
+    */
+    size_t bloom_filter_bytes = 0;
+    float bloom_false_positive_rate = 0;
+    size_t bloom_rejected_lookups = 0;
+
+    /*
+    * Lookup cost, only filled in if HASHMAP_PROBE_COUNTERS is enabled. Counts every key lookup,
+    * including the ones done by insert and erase, since construction or reset_probe_counters().
+    * A probe is one chain node compared against the key.
+    */
+    bool probe_counters_enabled = false;
+    size_t successful_lookups = 0;
+    size_t unsuccessful_lookups = 0;
+    float average_probes_successful = 0;
+    float average_probes_unsuccessful = 0;
+};
+
+/*
+* Type trait telling whether a hash or key equality function type declares is_transparent,
+* i.e. whether it accepts other types than the key type (see HashMap's heterogeneous lookup).
+*/
+template <typename T, typename = void>
+struct is_transparent : std::false_type {};
+
+template <typename T>
+struct is_transparent<T, std::void_t<typename T::is_transparent>> : std::true_type {};
 
 /*
 * Template class for a HashMap
 *
 * K = key type
 * M = mapped type
-* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+* H = hash function type used to hash a key; if not provided, defaults to DefaultHash<K> (see hash_functions.h)
+* E = key equality function type used to compare two keys; if not provided, defaults to std::equal_to<K>
+* A = allocator type for the elements; if not provided, defaults to std::allocator<value_type>
 *
 * Notes: When dealing with the Stanford libraries, we often call M the value
 * (and maps store key/value pairs).
@@ -34,9 +126,48 @@
 * Concept requirements:
 *      - H is function type that with function prototype size_t hash(const K& key).
 *           The const and reference are not required, but key cannot be modified in function.
+*      - E is function type that with function prototype bool equal(const K& lhs, const K& rhs).
+*           Keys that are equal under E must have the same hash under H.
 *      - K and M must be regular (copyable, default constructible, and equality comparable).
+*      - A must satisfy the standard Allocator requirements. Like std::unordered_map, HashMap
+*           never allocates a value_type on its own: A is rebound (std::allocator_traits) to
+*           the internal node type, so every element costs exactly one allocate(1) call.
+*           The bucket array always uses std::allocator.
+*
+* Allocators:
+*      PoolAllocator (see pool_allocator.h) carves the nodes out of large slabs and recycles
+*      them through a free list, which removes the general purpose heap from insert and erase:
+*
+*          HashMap<int, int, std::hash<int>, std::equal_to<int>,
+*                  PoolAllocator<std::pair<const int, int>>> map;
+*
+*      If in addition K and M are trivially destructible, clear() and the destructor do not
+*      visit the nodes at all and drop the whole pool in O(#slabs) instead.
+*
+* Heterogeneous lookup:
+*      If both H and E declare a member type is_transparent, find, contains, count, at and erase
+*      also accept any key type Q that H can hash and E can compare with K, without building a
+*      temporary K. H must give a Q and the K it is equal to the same hash. For instance,
+*      std::string_view lookups into a map with std::string keys:
+*
+*          struct StringHash {
+*              using is_transparent = void;
+*              size_t operator()(std::string_view str) const { return std::hash<std::string_view>()(str); }
+*          };
+*          HashMap<std::string, int, StringHash, std::equal_to<>> map;
+*          map.find(std::string_view(buffer + offset, length));     // no std::string is allocated
+*
+*      The default DefaultHash<std::string> is transparent already, so
+*      HashMap<std::string, int, DefaultHash<std::string>, std::equal_to<>> does the same.
+*
+* Hash quality:
+*      The bucket of a key is the low bits of its hash (see bucket_index), so H must spread its
+*      keys over the low bits. std::hash<int> is the identity, and with it keys that are multiples
+*      of the bucket count all share bucket 0. DefaultHash runs every hash through a multiply-fold
+*      mixer (wyhash-style hashing for strings), which costs about 1 ns per lookup.
 */
-template<typename K, typename M, typename H = std::hash<K>>
+template<typename K, typename M, typename H = DefaultHash<K>, typename E = std::equal_to<K>,
+         typename A = std::allocator<std::pair<const K, M>>>
 class HashMap {
 public:
     /*
@@ -49,6 +180,11 @@ public:
     */
     using value_type = std::pair<const K, M>;
 
+    /*
+    * Alias for the allocator type, as given by the client (i.e. not rebound to the node type).
+    */
+    using allocator_type = A;
+
     /*
     * Alias for the iterator type. Recall that it's impossible for an external client
     * to figure out the type of this iterator (you would've never guessed what the template
@@ -81,9 +217,20 @@ public:
     friend class HashMapIterator<HashMap, false>;
     friend class HashMapIterator<HashMap, true>;
 
+private:
+    /*
+    * Enables the heterogeneous overloads for key type Q. Types that convert to an iterator are
+    * excluded, so that erase(iterator) still calls erase(const_iterator).
+    */
+    template <typename Q>
+    using enable_if_transparent_t = std::enable_if_t<is_transparent<H>::value && is_transparent<E>::value &&
+                                                     !std::is_convertible<const Q&, const_iterator>::value>;
+
+public:
+
     /*
     * Default constructor
-    * Creates an empty HashMap with default number of buckets and hash function.
+    * Creates an empty HashMap with default number of buckets (16) and hash function.
     *
     * Usage:
     *      HashMap map;
@@ -99,6 +246,9 @@ public:
     * Creates an empty HashMap with a specified initial bucket_count and hash funciton.
     * If no hash function provided, default value of H is used.
     *
+    * The number of buckets is always a power of two, so that the bucket of a hash value can be
+    * computed with a bit mask instead of a division. bucket_count is rounded up accordingly.
+    *
     * Usage:
     *      HashMap(10) map;
     *      HashMap map(10, [](const K& key) {return key % 10; });
@@ -113,7 +263,7 @@ public:
     * HashMap<int, int> map(1.0);  // double -> int conversion not allowed.
     * HashMap<int, int> map = 1;   // copy-initialization, does not compile.
     */
-    explicit HashMap(size_t bucket_count, const H& hash = H());
+    explicit HashMap(size_t bucket_count, const H& hash = H(), const E& equal = E(), const A& alloc = A());
 
     /*
     * Destructor.
@@ -121,14 +271,105 @@ public:
     * Usage: (implicitly called when HashMap goes out of scope)
     *
     * Complexity: O(N), N = number of elements
+    *             O(B + S), S = number of slabs, for a PoolAllocator and trivially destructible K and M
     */
     ~HashMap();
 
+    /*
+    * Returns a copy of the allocator used by the HashMap.
+    */
+    allocator_type get_allocator() const;
+
+    /*
+    * Return copies of the hash function and of the key equality function used by the HashMap.
+    */
+    H hash_function() const;
+    E key_eq() const;
+
     inline size_t size() const;
     inline bool empty() const;
     inline float load_factor() const;
     inline size_t bucket_count() const;
 
+    /*
+    * Returns or sets the maximum load factor (default 1.0).
+    * Whenever an insertion would make load_factor() exceed max_load_factor(), the number
+    * of buckets is doubled before the element is inserted, so inserting N elements into
+    * a default constructed HashMap costs O(N) in total (amortized O(1) per insert).
+    * Setting a lower maximum immediately grows the bucket array if necessary.
+    *
+    * Usage:
+    *      map.max_load_factor(0.5f);       // trade memory for shorter chains
+    *
+    * Exceptions: std::out_of_range if ml is not positive, or smaller than 4 * min_load_factor().
+    */
+    inline float max_load_factor() const;
+    void max_load_factor(float ml);
+
+    /*
+    * Returns or sets the minimum load factor (default 0, which disables shrinking).
+    * When positive, erase(key) shrinks the bucket array whenever load_factor() drops below
+    * min_load_factor(), to about twice the buckets needed under max_load_factor(), but never
+    * below the default bucket count. This gives back the memory of the bucket array after
+    * a mass erase. The factor of 4 required between the two load factors keeps the map
+    * from oscillating between growing and shrinking.
+    *
+    * erase(const_iterator) never shrinks the map, so the usual erase-while-iterating
+    * loop stays valid.
+    *
+    * Exceptions: std::out_of_range if ml is negative, or 4 * ml > max_load_factor().
+    */
+    inline float min_load_factor() const;
+    void min_load_factor(float ml);
+
+    /*
+    * Returns or sets whether the map grows incrementally (default false).
+    *
+    * Normally, the insertion that pushes the map over max_load_factor() moves every element into
+    * the new bucket array before it returns, so one insert out of many costs O(N). In incremental
+    * mode, that insertion only allocates the new array. Both arrays then stay alive side by side,
+    * and every insert, emplace, non-const find and erase(key) first moves the next kMigrateBuckets
+    * buckets of the old array over. Lookups check the old array for buckets that have not been
+    * moved yet and the new one for the rest, so the map behaves exactly the same, but the worst
+    * case latency of a single operation drops from O(N) to O(kMigrateBuckets) plus allocating
+    * (and zeroing) the new array. Const lookups never move anything.
+    *
+    * In incremental mode, iterators may be invalidated by insertions, non-const find and erase(key),
+    * even when they do not grow the map. References and pointers to elements stay valid.
+    * Disabling the mode, rehash() and clear() finish an ongoing migration.
+    *
+    * Usage:
+    *      map.incremental_rehash(true);    // e.g. for a latency-sensitive server
+    *
+    * Complexity: O(1) to enable, O(N) to disable while a migration is in progress
+    */
+    inline bool incremental_rehash() const;
+    void incremental_rehash(bool enabled);
+
+    /*
+    * Enables or disables the Bloom filter of the map (disabled by default). When enabled, the
+    * map keeps a BlockedBloomFilter (see bloom_filter.h) of the hashes of its elements, and
+    * contains, count, at, find, find_many and contains_many ask it before they read the bucket.
+    * A key it rejects costs one cache line of the filter instead of the bucket and the chain,
+    * which pays off when nearly all lookups are misses. Every hit pays for the filter on top of
+    * the bucket and the chain, and when hits and misses are mixed the branch on the answer of
+    * the filter is mispredicted often: with half of the lookups missing, the filter makes them
+    * about twice as slow (see the bloom_filter benchmark in hashmap_perf.cpp). Compile with
+    * AVX2 (-mavx2 or -march=native) for the fastest version of the filter.
+    *
+    * The filter holds bucket_count() * max_load_factor() elements at 2 bytes each. Inserts add
+    * to it, and every rehash rebuilds it (an incremental rehash builds the new filter as it
+    * moves the elements). Erase cannot remove bits, so after many erases the filter lets more
+    * misses through, until the next rehash. stats() reports its size and false positive rate.
+    *
+    * Usage:
+    *      map.bloom_filter(true);      // e.g. for a map that mostly answers "not found"
+    *
+    * Complexity: O(N) to enable, O(1) to disable
+    */
+    inline bool bloom_filter() const;
+    void bloom_filter(bool enabled);
+
     /*
     * Returns whether or not the HashMap contains the given key.
     *
@@ -147,6 +388,30 @@ public:
     */
     bool contains(const K& key) const;
 
+    /*
+    * Heterogeneous overloads of contains, count, at, find and erase.
+    * They only take part in overload resolution if both H and E are transparent (see above).
+    *
+    * Usage:
+    *      std::string_view name = ...;
+    *      if (map.contains(name)) { map.at(name); ... }
+    */
+    template <typename Q, typename = enable_if_transparent_t<Q>>
+    bool contains(const Q& key) const;
+
+    /*
+    * Returns the number of elements with the given key, which is 0 or 1.
+    *
+    * Usage:
+    *      if (map.count("Avery") == 1) { ... }
+    *
+    * Complexity: O(1) amortized average case, O(N) worst case, N = number of elements
+    */
+    size_t count(const K& key) const;
+
+    template <typename Q, typename = enable_if_transparent_t<Q>>
+    size_t count(const Q& key) const;
+
     /*
     * Returns a l-value reference to the mapped value given a key.
     * If no such element exists, throws exception of type std::out_of_range.
@@ -169,6 +434,12 @@ public:
     M& at(const K& key);
     const M& at(const K& key) const;
 
+    template <typename Q, typename = enable_if_transparent_t<Q>>
+    M& at(const Q& key);
+
+    template <typename Q, typename = enable_if_transparent_t<Q>>
+    const M& at(const Q& key) const;
+
     /*
     * Removes all K/M pairs in the HashMap.
     *
@@ -179,6 +450,8 @@ public:
     *      map.clear();
     *
     * Complexity: O(N), N = number of elements
+    *             O(B + S), B = number of buckets, S = number of slabs, if A is a PoolAllocator that
+    *             is not shared with another container, and K and M are trivially destructible.
     *
     * Notes: clear removes all the elements in the HashMap and frees the memory associated
     * with those elements, but the HashMap should still be in a valid state and is
@@ -205,8 +478,82 @@ public:
     *      auto [iter2, insert2] = map.insert({3, "Anna"});  // no-op, iter2 points to {3, "Avery"}, insert2 = false
     *
     * Complexity: O(1) amortized average case
+    *
+    * Notes: if the insertion triggers a rehash, all iterators are invalidated
+    * (but references to elements stay valid, since the nodes never move).
     */
     std::pair<iterator, bool> insert(const value_type& val);
+
+    /*
+    * Same as insert(const value_type&), but moves the mapped value out of val instead of
+    * copying it. The key is still copied, because value_type's key is const.
+    */
+    std::pair<iterator, bool> insert(value_type&& val);
+
+    /*
+    * Constructs a value_type in place from args, and inserts it if its key does not exist yet.
+    * The element has to be constructed before its key is known, so on a duplicate key it is
+    * constructed and destroyed again; use try_emplace to avoid that.
+    *
+    * Usage:
+    *      map.emplace(3, "Avery");
+    *      map.emplace(std::piecewise_construct, std::forward_as_tuple(3), std::forward_as_tuple(5, 'a'));
+    *
+    * Return value: same as insert.
+    *
+    * Complexity: O(1) amortized average case
+    */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+
+    /*
+    * If key is not in the map, inserts an element whose mapped value is constructed in place
+    * from args. If key already exists, nothing is constructed at all: the arguments are not
+    * moved from, and M's constructor is not called.
+    *
+    * Usage:
+    *      map.try_emplace("Avery", 3, 'x');        // inserts {"Avery", "xxx"} for M = std::string
+    *
+    * Return value: same as insert.
+    *
+    * Complexity: O(1) amortized average case, a single walk of one bucket
+    */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args);
+
+    /*
+    * Inserts {key, obj} if key is not in the map, otherwise assigns obj to the mapped value.
+    *
+    * Return value: iterator to the element, and true if it was inserted, false if assigned.
+    *
+    * Complexity: O(1) amortized average case, a single walk of one bucket
+    */
+    template <typename Obj>
+    std::pair<iterator, bool> insert_or_assign(const K& key, Obj&& obj);
+
+    template <typename Obj>
+    std::pair<iterator, bool> insert_or_assign(K&& key, Obj&& obj);
+
+    /*
+    * Read-modify-write: calls fn(mapped) on the mapped value of key, after inserting a value
+    * initialized M for key if it was not in the map yet (like operator[]).
+    *
+    * Usage:
+    *      HashMap<std::string, int> counts;
+    *      for (const auto& word : words) counts.update(word, [](int& count) { ++count; });
+    *
+    * Return value: true if key was inserted, false if it already existed.
+    *
+    * Complexity: O(1) amortized average case, a single walk of one bucket plus the cost of fn.
+    */
+    template <typename F>
+    bool update(const K& key, F&& fn);
+
+    template <typename F>
+    bool update(K&& key, F&& fn);
     
     /*
     * Erases a K/M pair (if one exists) corresponding to given key from the HashMap.
@@ -225,6 +572,9 @@ public:
     */
     bool erase(const K& key);
 
+    template <typename Q, typename = enable_if_transparent_t<Q>>
+    bool erase(const Q& key);
+
     /*
     * Erases the K/M pair that pos points to.
     * Behavior is undefined if pos is not a valid and dereferencable iterator.
@@ -246,22 +596,23 @@ public:
     /*
     * Resizes the array of buckets, and rehashes all elements. new_buckets could
     * be larger than, smaller than, or equal to the original number of buckets.
+    * Like std::unordered_map::rehash, the new number of buckets is the smallest power of two
+    * that is at least new_buckets and keeps load_factor() <= max_load_factor().
     *
-    * Parameters: new_buckets - the new number of buckets. Must be greater than 0.
+    * Parameters: new_buckets - the requested number of buckets. Must be greater than 0.
     * Return value: none
     *
     * Usage:
-    *      map.rehash(30)
+    *      map.rehash(30)                  // bucket_count() is now 32 (or more for a large map)
     *
     * Exceptions: std::out_of_range if new_buckets = 0.
     *
     * Complexity: O(N) amortized average case, O(N^2) worst case, N = number of elements
     *
-    * Notes: our minimal HashMap implementation does not support automatic rehashing, but
-    * std::unordered_map will automatically rehash, even if you rehash to
-    * a very small number of buckets. For this reason, std::unordered_map.rehash(0)
-    * is allowed and forces an unconditional rehash. We will not require this behavior.
-    * If you want, you could implement this.
+    * Notes: insert calls this function automatically when the map is about to exceed its
+    * maximum load factor, so clients only need it to pre-size or compact a map.
+    * std::unordered_map.rehash(0) is allowed and forces an unconditional rehash.
+    * We will not require this behavior.
     *
     * Previously, this function was part of the assignment. However, it's a fairly challenging
     * linked list problem, and students had a difficult time finding an elegant solution.
@@ -269,6 +620,30 @@ public:
     */
     void rehash(size_t new_bucket);
 
+    /*
+    * Same as rehash(new_buckets), but redistributes the nodes on the given number of threads
+    * (0 = std::thread::hardware_concurrency()). Meant for very large maps, where the single
+    * pass over the old bucket array dominates.
+    *
+    * Both bucket counts are powers of two, so with m = min(old, new bucket count), a node in
+    * old bucket i can only move to a new bucket j with j % m == i % m. Every thread owns one
+    * contiguous range of these residues: it reads only its own old buckets and writes only
+    * its own new buckets, so there is no lock, and no merge step after the threads are joined.
+    * When growing, each thread walks one contiguous slice of the old array.
+    *
+    * Usage:
+    *      map.rehash(1 << 26, 8);          // reindex a huge map on 8 threads
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0. If a thread cannot be started, its
+    * share of the work runs on the calling thread instead.
+    *
+    * Complexity: O(N / threads + B) average case, B = number of (old and new) buckets
+    *
+    * Notes: H, E and the allocator are not used by the worker threads, since the hash of every
+    * node is cached, so they do not need to be thread safe.
+    */
+    void rehash(size_t new_buckets, size_t threads);
+
     /*
     * Returns an iterator to the first element.
     * This overload is used when the HashMap is non-const.
@@ -315,6 +690,42 @@ public:
 
     const_iterator find(const K& key) const;
 
+    template <typename Q, typename = enable_if_transparent_t<Q>>
+    iterator find(const Q& key);
+
+    template <typename Q, typename = enable_if_transparent_t<Q>>
+    const_iterator find(const Q& key) const;
+
+    /*
+    * Batched lookup: writes find(key) for every key in [first, last) to out, in order, and returns
+    * the output iterator one past the last result. contains_many writes contains(key) instead.
+    *
+    * For a map much larger than the cache, every find() is a chain of dependent cache misses
+    * (bucket array, then each node), and looking keys up one at a time pays them one after another.
+    * The batched versions work on groups of kLookupBatch keys in three passes: hash every key and
+    * prefetch its bucket, then load every bucket and prefetch the chain head, and only then walk
+    * the chains and compare keys. The misses of a whole group are thus in flight at the same time.
+    *
+    * Requirements: ForwardIt must be a forward iterator (e.g. a pointer) to K, or to a key type
+    * accepted by the heterogeneous overloads. OutputIt must accept iterators (find_many), or bools
+    * (contains_many).
+    *
+    * Usage:
+    *      std::vector<int> keys = ...;
+    *      std::vector<HashMap<int, int>::iterator> results(keys.size());
+    *      map.find_many(keys.data(), keys.data() + keys.size(), results.begin());
+    *
+    * Complexity: O(n) amortized average case, n = std::distance(first, last)
+    */
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_many(ForwardIt first, ForwardIt last, OutputIt out);
+
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_many(ForwardIt first, ForwardIt last, OutputIt out) const;
+
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt contains_many(ForwardIt first, ForwardIt last, OutputIt out) const;
+
     /*
     * Function that will print to std::cout the contents of the hash table as
     * linked lists, and also displays the size, number of buckets, and load factor.
@@ -337,6 +748,116 @@ public:
     */
     void debug();
 
+    /*
+    * Returns the chain length histogram, memory use and (if compiled in) average lookup probes
+    * of the map, see HashMapStats. Unlike debug, it does not print anything and runs in one
+    * pass over the bucket array, so it is cheap enough to call periodically on a production map.
+    * Nothing is computed or stored for it as long as it is not called.
+    *
+    * Usage:
+    *      auto stats = map.stats();
+    *      if (stats.max_chain_length > 16) alert("degenerate hash function");
+    *
+    * Complexity: O(N + B)
+    */
+    HashMapStats stats() const;
+
+    /*
+    * Restarts the probe counters reported by stats(). Does nothing if HASHMAP_PROBE_COUNTERS is 0.
+    */
+    void reset_probe_counters();
+
+    /*
+    * Binary snapshots. save writes every element to the file at path, load replaces the contents
+    * of the map with those of a snapshot. The one-argument versions require trivially copyable
+    * K and M and copy their bytes; the others call a serializer for every element:
+    *
+    *      struct Serializer {
+    *          void write(std::ostream& out, const std::pair<const K, M>& value) const;
+    *          std::pair<K, M> read(std::istream& in) const;
+    *      };
+    *
+    * The file starts with a header (magic, format version, element format, sizeof(K) and sizeof(M)
+    * for the byte copies, size, bucket count), followed by the byte length of the element section
+    * and the elements themselves, bucket by bucket. Every element is stored with its cached hash
+    * (and, with a serializer, with its own byte length). load therefore sizes the bucket array once,
+    * reads the elements in large blocks and links every node straight into its bucket, without
+    * calling the hash function or comparing keys. The loaded map has the bucket count and the
+    * chain order of the saved one.
+    *
+    * Usage:
+    *      map.save("/var/cache/index.bin");
+    *      ...
+    *      HashMap<uint64_t, uint32_t> index;
+    *      index.load("/var/cache/index.bin");
+    *
+    * Exceptions: std::runtime_error if the file cannot be opened, read or written, or is not a
+    * snapshot of a map with the same element format. If load throws, the map is left unchanged.
+    *
+    * Complexity: O(N + B)
+    *
+    * Notes: the stored hashes are only valid if H gives the same values in the loading process,
+    * so H must not be seeded per process. load checks this on the first element. The byte copies
+    * use the native layout and byte order, so a snapshot is meant to be read back on the same platform.
+    */
+    void save(const std::string& path) const;
+    void load(const std::string& path);
+
+    template <typename Serializer>
+    void save(const std::string& path, const Serializer& serializer) const;
+
+    template <typename Serializer>
+    void load(const std::string& path, const Serializer& serializer);
+
+    /*
+    * Returns a read-only copy of the map, with a minimal perfect hash function and all elements
+    * in one flat array, so that every lookup is one probe and one key compare (see frozen_hashmap.h).
+    * The cached hash of every node is reused, so H is not called while freezing.
+    *
+    * Usage:
+    *      auto frozen = map.freeze();
+    *      frozen.at(key);
+    *
+    * Exceptions: std::length_error if two different keys have the same hash under H.
+    *
+    * Complexity: O(N + B)
+    */
+    FrozenHashMap<K, M, H, E> freeze() const;
+
+    /*
+    * Set algebra on the keys of two maps.
+    *
+    * merge moves every element of source whose key is not in this map into this map, and leaves
+    * the others in source, like std::unordered_map::merge. The nodes themselves are relinked, so
+    * no element is allocated, copied or moved, and iterators to the moved elements now belong to
+    * this map. If the allocators of the two maps are not equal (e.g. two PoolAllocators with
+    * different pools), the nodes cannot change hands, so each element is move-constructed into
+    * a new node instead.
+    *
+    * intersect_with erases the elements whose key is not in other, difference_with erases the
+    * elements whose key is in other, and both return the number of elements erased.
+    * symmetric_difference returns a new map holding the elements whose key is in exactly one of
+    * the two maps; it starts as a copy of the larger map, so it takes its H, E and allocator.
+    *
+    * All of them probe the keys of the smaller map into the larger one, so, apart from the
+    * elements that have to be destroyed or copied anyway, they cost O(min(size(), other.size()))
+    * lookups. When H is an empty class (such as DefaultHash), the hash of a key is the same in both
+    * maps and the cached hash of the node is used instead of calling H.
+    *
+    * Usage:
+    *      HashMap<std::string, int> today = ..., yesterday = ...;
+    *      auto changed = today.symmetric_difference(yesterday);
+    *      today.difference_with(yesterday);    // only the keys that are new today are left
+    *      yesterday.merge(today);              // and now yesterday has them too
+    *
+    * Complexity: O(N + M) worst case, O(min(N, M)) lookups, N = size(), M = other.size()
+    */
+    void merge(HashMap<K, M, H, E, A>& source);
+    void merge(HashMap<K, M, H, E, A>&& source);
+    size_t intersect_with(const HashMap<K, M, H, E, A>& other);
+    size_t difference_with(const HashMap<K, M, H, E, A>& other);
+    HashMap<K, M, H, E, A> symmetric_difference(const HashMap<K, M, H, E, A>& other) const;
+
     /* EXTRA CONSTURCTORS */
 
     /*
@@ -350,9 +871,17 @@ public:
     *      HashMap<char, int> map{vec.begin(), vec.end()};
     *
     * Complexity: O(N), where N = std::distance(first, last);
+    *
+    * Notes: if a key appears more than once, the first element with that key is kept, as with insert.
+    * For random-access iterators the map is bulk built instead of inserted into element by element:
+    * the bucket array is sized for N up front, and ranges of at least kBuildPerThread elements per
+    * thread are hashed, radix-partitioned by bucket range and linked on several threads (one
+    * partition per thread, without locks). In that case, H and E are copied into each thread,
+    * and constructing value_type from *first must be safe to do concurrently.
     */
     template<typename InputIter>
-    HashMap(InputIter begin, InputIter end, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    HashMap(InputIter begin, InputIter end, size_t bucket_count = kDefaultBuckets, const H& hash = H(),
+            const E& equal = E(), const A& alloc = A());
 
     /*
     * Initializer list constructor
@@ -372,7 +901,8 @@ public:
     *
     * Also, you should check out the delegating constructor note in the .cpp file.
     */
-    HashMap(std::initializer_list<value_type> init, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    HashMap(std::initializer_list<value_type> init, size_t bucket_count = kDefaultBuckets, const H& hash = H(),
+            const E& equal = E(), const A& alloc = A());
 
     /*
     * Indexing operator
@@ -386,22 +916,38 @@ public:
     *      auto name = map[3]; // name is now "Avery"
     *      auto name2 = map[4]; // creates the pair {4, ""}, name2 is now ""
     *
-    * Complexity: O(1) average case amortized plus complexity of K and M's constructor
+    * Complexity: O(1) average case amortized plus complexity of K and M's constructor.
+    * M is only constructed if the key does not exist yet.
     */
     M& operator[](const K& key);
+    M& operator[](K&& key);
 
 
     // TODO: declare headers for copy constructor/assignment, move constructor/assignment
-    HashMap(const HashMap<K, M, H>& map);
-    HashMap(HashMap<K, M, H>&& map);
+    /*
+    * Copy constructor and copy assignment: the copy has the same bucket count as map, and every
+    * chain is cloned in order into the same bucket, so iteration visits the elements in the same
+    * order and nothing is rehashed (the cached hashes are copied). With a PoolAllocator and
+    * trivially copyable K and M, the node pool of map is copied slab by slab with memcpy.
+    * If map is in the middle of an incremental rehash, the copy is not: it starts out migrated.
+    *
+    * Complexity: O(N + B), N = map.size(), B = map.bucket_count()
+    */
+    HashMap(const HashMap<K, M, H, E, A>& map);
+    HashMap(HashMap<K, M, H, E, A>&& map);
 
-    HashMap<K, M, H>& operator=(const HashMap<K, M, H>& map);
-    HashMap<K, M, H>& operator=(HashMap<K, M, H>&& map);
+    HashMap<K, M, H, E, A>& operator=(const HashMap<K, M, H, E, A>& map);
+    HashMap<K, M, H, E, A>& operator=(HashMap<K, M, H, E, A>&& map);
 
 private:
     /*
     * node structure represented a node in a linked list.
-    * Each node consists of a value_type (K/M pair) and a next pointer.
+    * Each node consists of a value_type (K/M pair), a next pointer, and the full hash of the key.
+    *
+    * The hash is computed once, when the node is created. Rehashing, iterator construction and
+    * erase(const_iterator) read it instead of calling the hash function again, and lookups compare
+    * it before calling operator== on the keys, so a mismatching key (e.g. a long std::string)
+    * is almost never compared in full.
     *
     * This is implemented in the private section as clients should not be dealing
     * with anything related to the node struct.
@@ -415,17 +961,236 @@ private:
     {
         value_type value;
         Node* next;
+        size_t hash;
        /*
         * Default constructor, so even if you forget to set next to nullptr it'll be fine.
         *
         */
-        Node() : value(value_type()), next(nullptr) {};
-        Node(const value_type& value, Node* next):value(value), next(next) {};
+        Node() : value(value_type()), next(nullptr), hash(0) {};
+        template <typename... Args>
+        Node(size_t hash, Args&&... args):value(std::forward<Args>(args)...), next(nullptr), hash(hash) {};
     };
 
+    /*
+    * The client's allocator rebound to Node. All nodes are created and destroyed through
+    * create_node and destroy_node, never with new and delete.
+    */
+    using node_allocator_type = typename std::allocator_traits<A>::template rebind_alloc<Node>;
+    using node_traits = std::allocator_traits<node_allocator_type>;
+
+    template <typename... Args>
+    Node* create_node(size_t hash, Args&&... args);
+    void destroy_node(Node* node);
+
+    /*
+    * Whether clear() may skip the per-node destructors and let the allocator drop all nodes at once.
+    */
+    static constexpr bool kBulkRelease = supports_bulk_release<node_allocator_type>::value &&
+                                         std::is_trivially_destructible<value_type>::value;
+
+    /*
+    * Whether a copy may duplicate the pool of the original slab by slab instead of node by node,
+    * see copy_chains.
+    */
+    static constexpr bool kBulkCopy = supports_bulk_release<node_allocator_type>::value &&
+                                      std::is_trivially_copyable<K>::value && std::is_trivially_copyable<M>::value;
+
+    /*
+    * Copies the elements of map into this map, which must be empty and have map.bucket_count()
+    * buckets. Every chain of map is cloned into the same bucket, in the same order, using the
+    * cached hashes, so no key is hashed or compared. With kBulkCopy, when map owns its pool and
+    * the pool is mostly live nodes, the slabs are copied with memcpy and only the links are redone.
+    */
+    void copy_chains(const HashMap<K, M, H, E, A>& map);
+
+    /*
+    * Set algebra helpers. hash_for returns the hash of the key of node under the hash function
+    * of map, reusing the cached hash when H is stateless. erase_nodes_if destroys every node for
+    * which pred(node) is true and returns how many it destroyed.
+    */
+    static size_t hash_for(const HashMap<K, M, H, E, A>& map, const Node* node);
+    template <typename Pred>
+    size_t erase_nodes_if(Pred pred);
+
+    /*
+    * Returns the node holding key and its predecessor in the chain (nullptr if it is the head).
+    * If key is not in the map, the node is nullptr and the predecessor is the tail of the chain.
+    * hash must be _hash_function(key); every public function computes it exactly once.
+    * Q is K, or any key type accepted by the heterogeneous overloads.
+    */
     using node_pair = std::pair<Node *, Node *>;
-    node_pair find_node(const K& key) const;
-    size_t first_not_empty_bucket() const;
+    template <typename Q>
+    node_pair find_node(const Q& key, size_t hash) const;
+
+    /*
+    * The node of key, or nullptr, for the lookups that only read: asks the Bloom filter first,
+    * if it is enabled, and only walks the chain if the filter lets the key through.
+    */
+    template <typename Q>
+    Node* lookup_node(const Q& key, size_t hash) const;
+    Node* find_predecessor(Node* head, const Node* node) const;
+
+    /*
+    * Maps a hash value to a bucket. The number of buckets is a power of two,
+    * so this is a bit mask instead of a (much slower) modulo. A multiply-high (fastrange) would
+    * take the high bits instead, but then doubling the table would not send old bucket i to new
+    * buckets i and i + m, which the incremental and the parallel rehash rely on.
+    */
+    size_t bucket_index(size_t hash) const { return hash & (_buckets_array.size() - 1); }
+    static size_t round_up_buckets(size_t bucket_count);
+
+    /*
+    * grow_if_needed doubles the bucket array if one more element would exceed the maximum
+    * load factor, and returns whether it did. shrink_if_needed shrinks the bucket array if
+    * the map has dropped below the (non-zero) minimum load factor.
+    */
+    bool grow_if_needed();
+    void shrink_if_needed();
+
+    /*
+    * Incremental rehash. While migrating() is true, buckets [_migrate_idx, _old_buckets_array.size())
+    * of the old array have not been moved to _buckets_array yet.
+    *
+    * bucket_head returns the chain head slot that holds hash, in whichever array that is, and
+    * bucket_for returns the same slot writable. start_migration swaps in a new (empty) array of
+    * new_buckets buckets, migrate_step moves up to count more old buckets, and frees the old
+    * array after the last one, and finish_migration moves everything that is left.
+    */
+    static constexpr size_t kMigrateBuckets = 8;
+    bool migrating() const { return !_old_buckets_array.empty(); }
+    void advance_migration() { if (migrating()) migrate_step(kMigrateBuckets); }
+    Node* const& bucket_head(size_t hash) const;
+    Node*& bucket_for(size_t hash);
+    void start_migration(size_t new_buckets);
+
+    /*
+    * Moves the nodes of every bucket i of old_buckets with i % stride in [first, last) into
+    * _buckets_array. stride must divide both bucket counts. Calls on disjoint ranges touch
+    * disjoint buckets, which is what lets rehash(new_buckets, threads) run them concurrently.
+    */
+    void redistribute(std::vector<Node *>& old_buckets, size_t stride, size_t first, size_t last);
+
+    /*
+    * Calls fn(t) for every t in [0, threads), each on its own thread (t = 0 on the calling one),
+    * and waits for all of them. Rethrows the first exception thrown by any fn(t), after joining.
+    */
+    template <typename Fn>
+    static void run_parallel(size_t threads, Fn fn);
+
+    /*
+    * Builds an empty map from the count elements starting at first, on the given number of threads.
+    * Used by the range constructor for random-access iterators.
+    */
+    static constexpr size_t kBuildPerThread = 1 << 16;
+    template <typename RandomIt>
+    void bulk_build(RandomIt first, size_t count, size_t threads);
+    void migrate_step(size_t count);
+    void finish_migration();
+
+    /*
+    * Bloom filter upkeep. _bloom is enabled iff bloom_filter() is true. rebuild_bloom sizes it
+    * for bucket_count() * max_load_factor() elements and adds every element again; it must not
+    * be called during an incremental rehash. While a migration is in progress, _next_bloom is
+    * the filter of the new bucket array: migrate_step adds the elements it moves, link_new_node
+    * adds new elements to both filters, and the last step of the migration swaps it in.
+    */
+    size_t bloom_capacity(size_t buckets) const { return static_cast<size_t>(std::ceil(buckets * _max_load_factor)); }
+    void rebuild_bloom();
+
+    /*
+    * Occupancy bitmap of _buckets_array: bit i of _occupied is set iff bucket i is not empty, and
+    * _first_occupied is the first such bucket (bucket_count() if there is none). begin() and the
+    * iterators use them to jump straight to the next non-empty bucket, 64 buckets per word, so
+    * iterating a sparse map costs O(N + B / 64) instead of O(N + B).
+    *
+    * update_occupancy refreshes the bit of a bucket whose head has just changed (a no-op for
+    * buckets of the old array), and rebuild_occupancy recomputes everything after a bulk change.
+    * next_occupied returns the first set bit at or after from, or 64 * bits.size() if none.
+    */
+    static size_t occupancy_words(size_t buckets) { return (buckets + 63) / 64; }
+    static size_t next_occupied(const std::vector<uint64_t>& bits, size_t from);
+    void mark_occupied(size_t index);
+    void update_occupancy(Node* const& bucket);
+    void rebuild_occupancy();
+
+    /*
+    * Records one lookup that compared probes chain nodes, if HASHMAP_PROBE_COUNTERS is enabled.
+    */
+    void record_lookup(bool found, size_t probes) const {
+#if HASHMAP_PROBE_COUNTERS
+        auto& lookups = found ? _probe_counters.successful : _probe_counters.unsuccessful;
+        auto& total = found ? _probe_counters.successful_probes : _probe_counters.unsuccessful_probes;
+        lookups.fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(probes, std::memory_order_relaxed);
+#else
+        (void) found;
+        (void) probes;
+#endif
+    }
+
+    /*
+    * Records one unsuccessful lookup that the Bloom filter answered without reading the bucket.
+    */
+    void record_bloom_rejection() const {
+#if HASHMAP_PROBE_COUNTERS
+        _probe_counters.bloom_rejected.fetch_add(1, std::memory_order_relaxed);
+#endif
+        record_lookup(false, 0);
+    }
+
+    static size_t count_trailing_zeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(word);
+#else
+        size_t count = 0;
+        while ((word & 1) == 0) {
+            word >>= 1;
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    /*
+    * Looks up every key of [first, last) with the three-pass batched pipeline described at find_many,
+    * and calls emit(node) for each of them in order (node is nullptr if the key is missing).
+    */
+    static constexpr size_t kLookupBatch = 16;
+    template <typename ForwardIt, typename Emit>
+    void lookup_batched(ForwardIt first, ForwardIt last, Emit emit) const;
+
+    static void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#else
+        (void) address;
+#endif
+    }
+
+    /*
+    * Links new_node, whose key is not in the map, behind pre_node (the tail of its chain, or nullptr
+    * if the chain is empty). Grows the bucket array first if needed.
+    */
+    iterator link_new_node(Node* pre_node, Node* new_node);
+
+    /*
+    * Shared implementations of the const K& and K&& overloads of the emplace functions.
+    */
+    template <typename KK, typename... Args>
+    std::pair<iterator, bool> try_emplace_key(KK&& key, Args&&... args);
+    template <typename KK, typename Obj>
+    std::pair<iterator, bool> insert_or_assign_key(KK&& key, Obj&& obj);
+
+    /*
+    * Shared implementation of erase(const K&) and its heterogeneous overload.
+    */
+    template <typename Q>
+    bool erase_key(const Q& key);
+
+    /*
+    * Unlinks and deletes cur_node, which is in the chain starting at bucket and follows pre_node (or is the head).
+    */
+    void erase_node(Node*& bucket, Node* pre_node, Node* cur_node);
 
     /*
     * Creates an iterator that points to the element curr->value.
@@ -434,12 +1199,62 @@ private:
     */
     iterator make_iterator(Node* curr);
 
+    /*
+    * Snapshot helpers, see save and load. The element section holds (hash, key bytes, mapped bytes)
+    * records for kSnapshotBytes, and (hash, length, serialized element) records for kSnapshotSerialized.
+    * for_each_chain calls fn(head) for every chain, in bucket order. read_snapshot_header checks
+    * the header against what this map expects and returns the bucket count and the element count.
+    * link_loaded links node behind tail if both are in the same bucket, and at the head of its
+    * bucket otherwise. take_loaded replaces the elements of the map with those of loaded, a map
+    * built by load with a copy of our allocator, and leaves loaded empty.
+    */
+    static constexpr uint32_t kSnapshotVersion = 1;
+    static constexpr uint32_t kSnapshotBytes = 0;
+    static constexpr uint32_t kSnapshotSerialized = 1;
+    static constexpr size_t kSnapshotBlock = 1 << 20;
+    template <typename Fn>
+    void for_each_chain(Fn fn) const;
+    void write_snapshot_header(std::ostream& out, uint32_t format, uint64_t section_bytes) const;
+    std::pair<size_t, size_t> read_snapshot_header(std::istream& in, uint32_t format, uint64_t& section_bytes) const;
+    void link_loaded(Node* node, Node*& tail);
+    void take_loaded(HashMap<K, M, H, E, A>& loaded);
+    void check_loaded_hash(const Node* node) const;
+
     /* Private member variables */
     size_t _size;
     H _hash_function;
+    E _key_equal;
     std::vector<Node *> _buckets_array;
+    float _max_load_factor;
+    float _min_load_factor;
+    node_allocator_type _node_allocator;
+    std::vector<Node *> _old_buckets_array;
+    size_t _migrate_idx;
+    bool _incremental_rehash;
+    std::vector<uint64_t> _occupied;
+    size_t _first_occupied;
+    BlockedBloomFilter _bloom;
+    BlockedBloomFilter _next_bloom;
+
+#if HASHMAP_PROBE_COUNTERS
+    /*
+    * Lookup counters for stats(). A copy of a map starts counting from zero.
+    */
+    struct ProbeCounters {
+        ProbeCounters() = default;
+        ProbeCounters(const ProbeCounters&) {}
+        ProbeCounters& operator=(const ProbeCounters&) { return *this; }
+
+        std::atomic<size_t> successful{0};
+        std::atomic<size_t> successful_probes{0};
+        std::atomic<size_t> unsuccessful{0};
+        std::atomic<size_t> unsuccessful_probes{0};
+        std::atomic<size_t> bloom_rejected{0};
+    };
+    mutable ProbeCounters _probe_counters;
+#endif
 
-    static const size_t kDefaultBuckets = 10;
+    static constexpr size_t kDefaultBuckets = 16;
     using bucket_array_type = decltype(_buckets_array);
 };
 
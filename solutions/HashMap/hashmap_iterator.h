@@ -4,9 +4,11 @@
 
 #include <iterator>     // for std::forward_iterator_tag
 #include <functional>   // for std::conditional_t
+#include <vector>
+#include <cstdint>      // for uint64_t
 
 // forward declaration for the HashMap class
-template <typename K, typename M, typename H> class HashMap;
+template <typename K, typename M, typename H, typename E, typename A> class HashMap;
 
 /*
 * Template class for a HashMapIterator
@@ -15,7 +17,7 @@ template <typename K, typename M, typename H> class HashMap;
 * IsConst = whether this is a const_iterator class.
 *
 * Concept requirements:
-* - Map must be a valid class HashMap<K, M, H>
+* - Map must be a valid class HashMap<K, M, H, E, A>
 */
 template <typename Map, bool IsConst = true>
 class HashMapIterator {
@@ -46,6 +48,13 @@ public:
     friend HashMapIterator<Map, true>;
     friend HashMapIterator<Map, false>;
 
+    /*
+    * Default constructor: creates a singular iterator, which may only be assigned to.
+    * Forward iterators must be default constructible, e.g. to fill a std::vector of results.
+    */
+    HashMapIterator() : _buckets_array(nullptr), _next_buckets_array(nullptr), _occupied(nullptr),
+                        _node(nullptr), _bucket_idx(0) {};
+
     /*
     * Conversion operator: converts any iterator (iterator or const_iterator) to a const_iterator.
     *
@@ -62,7 +71,7 @@ public:
     * because that gives the client write access the map itself is const.
     */
     operator HashMapIterator<Map, true>() const {
-        return HashMapIterator<Map, true>(_buckets_array, _node, _bucket_idx);
+        return HashMapIterator<Map, true>(_buckets_array, _node, _bucket_idx, _next_buckets_array, _occupied);
     }
 
     /*
@@ -130,6 +139,19 @@ private:
     */
     bucket_array_type* _buckets_array;
 
+    /*
+    * Instance variable: the bucket array to continue with once _buckets_array is exhausted, or nullptr.
+    * While an incremental rehash is in progress, the HashMap has two bucket arrays, and iteration
+    * walks the (not yet migrated part of the) old one first, then the new one.
+    */
+    bucket_array_type* _next_buckets_array;
+
+    /*
+    * Instance variable: the occupancy bitmap of the HashMap's main bucket array (see HashMap::next_occupied),
+    * used to skip empty buckets 64 at a time once the iterator is in that array, or nullptr.
+    */
+    const std::vector<uint64_t>* _occupied;
+
     /*
     * Instance variable: pointer to the node that stores the element this iterator is currently pointing to.
     */
@@ -148,7 +170,8 @@ private:
     * so a client can't randomly construct a HashMapIterator without asking for one 
     * through the HashMap's interface.
     */
-    HashMapIterator(bucket_array_type* buckets_array, Node* node, size_t bucket_idx);
+    HashMapIterator(bucket_array_type* buckets_array, Node* node, size_t bucket_idx,
+                    bucket_array_type* next_buckets_array = nullptr, const std::vector<uint64_t>* occupied = nullptr);
 };
 
 template<typename Map, bool IsConst>
@@ -162,8 +185,12 @@ typename HashMapIterator<Map, IsConst>::pointer HashMapIterator<Map, IsConst>::o
 }
 
 template<typename Map, bool IsConst>
-HashMapIterator<Map, IsConst>::HashMapIterator(bucket_array_type* buckets_array, Node* node, size_t bucket_idx):
+HashMapIterator<Map, IsConst>::HashMapIterator(bucket_array_type* buckets_array, Node* node, size_t bucket_idx,
+                                               bucket_array_type* next_buckets_array,
+                                               const std::vector<uint64_t>* occupied):
     _buckets_array(buckets_array),
+    _next_buckets_array(next_buckets_array),
+    _occupied(occupied),
     _node(node),
     _bucket_idx(bucket_idx) {};
 
@@ -172,9 +199,24 @@ HashMapIterator<Map, IsConst>& HashMapIterator<Map, IsConst>::operator++(){
 
     if (_node != nullptr) {
         Node* next_node = _node->next;
-        while (next_node == nullptr && _bucket_idx < (_buckets_array->size() - 1))
+        while (next_node == nullptr)
         {
-            next_node = (*_buckets_array)[++_bucket_idx];
+            if (_next_buckets_array == nullptr && _occupied != nullptr) {
+                // jump straight to the next non-empty bucket, or to the end
+                _bucket_idx = Map::next_occupied(*_occupied, _bucket_idx + 1);
+                if (_bucket_idx < _buckets_array->size()) next_node = (*_buckets_array)[_bucket_idx];
+                break;
+            } else if (_bucket_idx < (_buckets_array->size() - 1)) {
+                next_node = (*_buckets_array)[++_bucket_idx];
+            } else if (_next_buckets_array != nullptr) {
+                // end of the old array of an incremental rehash, continue with the new one
+                _buckets_array = _next_buckets_array;
+                _next_buckets_array = nullptr;
+                _bucket_idx = 0;
+                next_node = (*_buckets_array)[0];
+            } else {
+                break;
+            }
         }
         _node = next_node;
     }
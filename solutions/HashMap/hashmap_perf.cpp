@@ -1,12 +1,34 @@
 
 #include <random>
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <iostream>
 #include <algorithm>
 #include <unordered_map>
+#include <fstream>
+#include <thread>
+#include <iomanip>
+#include <memory>       // for std::unique_ptr
+#include <list>
+#include <tuple>
+#if defined(__GLIBC__)
+#include <malloc.h>     // for mallinfo2
+#endif
+#if defined(__linux__)
+#include <unistd.h>     // for sysconf
+#endif
 
 #include "hashmap.h"
+#include "flat_hashmap.h"
+#include "robin_hood_hashmap.h"
+#include "dense_hashmap.h"
+#include "frozen_hashmap.h"
+#include "static_hashmap.h"
+#include "small_hashmap.h"
+#include "hash_functions.h"
+#include "lru_cache.h"
+#include "benchmark_suite.h"
 #include "gtest/gtest.h"
 #include "test_settings.h"
 
@@ -49,14 +71,220 @@ std::string print_with_commas(long long int n) {
 }
 
 #if RUN_TEST_PERF
-void benchmark_insert_erase() {
-    std::cout << "Task: insert then erase N elements, measured in ns." << '\n';
-    auto good_hash_function = [](const int& key) {
-       return (key * 43037 + 52081) % 79229;
+// results of the timed loops are written here, so that the optimizer cannot remove the loops
+volatile size_t benchmark_sink;
+
+/*
+* The timing helpers are templated on the map type, so that every container with the
+* HashMap interface (HashMap, FlatHashMap, std::unordered_map) runs exactly the same code.
+*/
+template <typename Map, typename Hash>
+size_t time_insert_erase(const std::vector<int>& keys, size_t size, const Hash& hash) {
+    auto start = clock_type::now();
+
+    Map map(size, hash);
+    for (int element : keys) {
+        map.insert({element, element});
+    }
+
+    for (int element : keys) {
+        map.erase(element);
+    }
+
+    auto end = clock_type::now();
+    return std::chrono::duration_cast<ns>(end - start).count();
+}
+
+template <typename Map, typename Hash>
+size_t time_find(const std::vector<int>& keys, const std::vector<int>& lookup, size_t size, const Hash& hash) {
+    Map map(size, hash);
+    for (size_t i = 0; i < keys.size(); i += 2) {
+        int element = keys[i];
+        map.insert({element, element});
+    }
+    auto start = clock_type::now();
+    int count = 0;
+    for (size_t i = 0; i < lookup.size(); i += 2) {
+        int element = lookup[i];
+        auto found = map.find(element);
+        count += (found == map.end());
+    }
+
+    auto end = clock_type::now();
+    benchmark_sink = count;
+    return std::chrono::duration_cast<ns>(end - start).count();
+}
+
+template <typename Map, typename Hash>
+size_t time_iterate(const std::vector<int>& keys, size_t size, const Hash& hash) {
+    Map map(size, hash);
+    for (int element : keys) {
+        map.insert({element, element});
+    }
+
+    auto start = clock_type::now();
+    size_t count = 0;
+    for (const auto& [key, value] : map) {
+        count += key;
+    }
+    auto end = clock_type::now();
+    benchmark_sink = count;
+    return std::chrono::duration_cast<ns>(end - start).count();
+}
+
+/*
+* Inserts every key into a default constructed map, so the map has to grow on its own.
+*/
+template <typename Map>
+size_t time_insert_from_default(const std::vector<int>& keys) {
+    auto start = clock_type::now();
+    Map map;
+    for (int element : keys) {
+        map.insert({element, element});
+    }
+    auto end = clock_type::now();
+    benchmark_sink = map.bucket_count();
+    return std::chrono::duration_cast<ns>(end - start).count();
+}
+
+/*
+* Returns the number of bytes the process currently has allocated from the heap, including
+* large mmap-ed blocks. Where glibc's mallinfo2 is not available, falls back to the resident set
+* size, which only grows and is therefore only meaningful for the first large map of the run.
+*/
+size_t memory_in_use() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0, resident_pages = 0;
+    if (statm >> total_pages >> resident_pages) {
+        return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+/*
+* Inserts all keys, erases the first half and inserts them again, then clears the map.
+* Returns the elapsed time and stores the memory used by the full map (nodes and buckets).
+*/
+template <typename Map>
+size_t time_node_churn(const std::vector<int>& keys, size_t& memory_used) {
+    size_t memory_before = memory_in_use();
+    auto start = clock_type::now();
+    Map map(keys.size());
+    for (int element : keys) {
+        map.insert({element, element});
+    }
+    size_t memory_after = memory_in_use();
+    memory_used = memory_after - std::min(memory_before, memory_after);
+    for (size_t i = 0; i < keys.size() / 2; i++) {
+        map.erase(keys[i]);
+    }
+    for (size_t i = 0; i < keys.size() / 2; i++) {
+        map.insert({keys[i], keys[i]});
+    }
+    map.clear();
+    auto end = clock_type::now();
+    benchmark_sink = map.size();
+    return std::chrono::duration_cast<ns>(end - start).count();
+}
+
+void print_result(size_t size, size_t my_map_result, size_t flat_map_result, size_t std_map_result) {
+    std::cout << "size "  << std::setw(10) << size;
+    std::cout << " | HashMap: " <<  std::setw(13) << print_with_commas(my_map_result);
+    std::cout << " | FlatHashMap: " <<  std::setw(13) << print_with_commas(flat_map_result);
+    std::cout << " | std:unordered_map: "  << std::setw(13) << print_with_commas(std_map_result) << '\n';
+}
+
+/*
+* Asymptotic sanity checks on HashMap, independent of --size: with a good hash function,
+* insert + erase, find and iteration over N = 10 elements must be much cheaper than over
+* N = 10000, and the cost per insert into a default constructed map must not grow with N.
+*/
+void benchmark_complexity() {
+    std::cout << "Task: HashMap complexity checks, measured in ns." << '\n';
+    using hash_type = DefaultHash<int>;
+    hash_type good_hash_function;
+    auto shuffled = [](size_t size) {
+        std::vector<int> keys;
+        for (size_t i = 0; i < size; i++) {
+            keys.push_back(i);
+        }
+        auto rng = std::default_random_engine {};
+        std::shuffle(keys.begin(), keys.end(), rng);
+        return keys;
     };
 
-    std::vector<size_t> my_map_timing;
-    std::vector<int> sizes{10, 100, 1000, 10000, 100000, 1000000};
+    size_t insert_erase[2], find[2], iterate[2];
+    std::vector<size_t> sizes{10, 10000};
+    for (size_t i = 0; i < sizes.size(); i++) {
+        size_t size = sizes[i];
+        std::vector<int> keys = shuffled(size);
+        std::vector<int> doubled = shuffled(2 * size);
+        insert_erase[i] = time_insert_erase<HashMap<int, int, hash_type>>(keys, size, good_hash_function);
+        find[i] = time_find<HashMap<int, int, hash_type>>(doubled, shuffled(2 * size), size, good_hash_function);
+        iterate[i] = time_iterate<HashMap<int, int, hash_type>>(keys, size, good_hash_function);
+        std::cout << "size " << std::setw(10) << size << " | insert+erase: " << std::setw(13)
+                  << print_with_commas(insert_erase[i]) << " | find: " << std::setw(13) << print_with_commas(find[i])
+                  << " | iterate: " << std::setw(13) << print_with_commas(iterate[i]) << '\n';
+    }
+    // Ensure runtime of N = 10 is much faster than N = 10000
+    EXPECT_TRUE(10 * insert_erase[0] < insert_erase[1]);
+    EXPECT_TRUE(10 * find[0] < find[1]);
+    EXPECT_TRUE(10 * iterate[0] < iterate[1]);
+
+    double per_insert[2];
+    sizes = {1000, 1000000};
+    for (size_t i = 0; i < sizes.size(); i++) {
+        per_insert[i] = double(time_insert_from_default<HashMap<int, int>>(shuffled(sizes[i]))) / sizes[i];
+        std::cout << "size " << std::setw(10) << sizes[i] << " | ns per insert into a default map: "
+                  << per_insert[i] << '\n';
+    }
+    // amortized O(1): the cost per insert must not grow with N (up to cache effects),
+    // without automatic growth the chains at N = 1M would be 100,000 nodes long
+    EXPECT_TRUE(per_insert[1] < 10 * per_insert[0]);
+}
+
+void benchmark_sparse_iterate() {
+    std::cout << "Task: iterate over 1k elements in a map with 1M buckets, measured in ns." << '\n';
+    std::vector<int> keys;
+    for (size_t i = 0; i < 1000; i++) {
+        keys.push_back(i * 7919);
+    }
+    const size_t buckets = 1 << 20;
+    size_t my_map_result = time_iterate<HashMap<int, int, std::hash<int>>>(keys, buckets, std::hash<int>());
+    size_t flat_map_result = time_iterate<FlatHashMap<int, int>>(keys, buckets, std::hash<int>());
+    size_t std_map_result = time_iterate<std::unordered_map<int, int>>(keys, buckets, std::hash<int>());
+    print_result(keys.size(), my_map_result, flat_map_result, std_map_result);
+}
+
+void benchmark_probe_lengths() {
+    std::cout << "Task: probe-sequence length distribution of RobinHoodHashMap with 1,000,000 elements." << '\n';
+    RobinHoodHashMap<int, int> map;
+    for (int i = 0; i < 1000000; i++) {
+        map.insert({i, i});
+    }
+
+    auto histogram = map.probe_length_histogram();
+    double total = 0;
+    for (size_t psl = 0; psl < histogram.size(); psl++) {
+        total += psl * histogram[psl];
+        std::cout << "psl " << std::setw(3) << psl << " | " << std::setw(9) << print_with_commas(histogram[psl])
+                  << " | " << std::string(histogram[psl] * 60 / map.size(), '#') << '\n';
+    }
+    std::cout << "load factor " << map.load_factor() << ", average psl " << total / map.size()
+              << ", max psl " << histogram.size() - 1 << '\n';
+}
+
+void benchmark_pool_allocator() {
+    std::cout << "Task: insert N, erase and re-insert N/2, clear; std::allocator vs PoolAllocator nodes, "
+              << "measured in ns (memory of the full map in KiB)." << '\n';
+    using pool_type = PoolAllocator<std::pair<const int, int>>;
+
+    std::vector<int> sizes{1000, 10000, 100000, 1000000};
     for (size_t size : sizes) {
         std::vector<int> million;
         for (size_t i = 0; i < size; i++) {
@@ -64,185 +292,1046 @@ void benchmark_insert_erase() {
         }
         auto rng = std::default_random_engine {};
         std::shuffle(million.begin(), million.end(), rng);
-        size_t my_map_result, std_map_result;
-        {
-            auto my_start = clock_type::now();
 
-            HashMap<int, int, decltype(good_hash_function)> my_map(size, good_hash_function);
-            for (int element : million) {
-                my_map.insert({element, element});
-            }
+        size_t pool_memory = 0, std_memory = 0;
+        size_t pool_result = time_node_churn<HashMap<int, int, std::hash<int>, std::equal_to<int>, pool_type>>(million, pool_memory);
+        size_t std_result = time_node_churn<HashMap<int, int>>(million, std_memory);
 
-            for (int element : million) {
-                my_map.erase(element);
-            }
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | std::allocator: " <<  std::setw(13) << print_with_commas(std_result)
+                  << " (" << std::setw(7) << print_with_commas(std_memory / 1024) << ")";
+        std::cout << " | PoolAllocator: "  << std::setw(13) << print_with_commas(pool_result)
+                  << " (" << std::setw(7) << print_with_commas(pool_memory / 1024) << ")" << '\n';
+    }
+}
+
+/*
+* Hash function for the heterogeneous lookup benchmark: hashes std::string and std::string_view alike.
+*/
+struct TransparentStringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view str) const { return std::hash<std::string_view>()(str); }
+};
+
+void benchmark_string_view_lookup() {
+    std::cout << "Task: look up N std::string_view slices of one buffer in a map with std::string keys, "
+              << "measured in ns." << '\n';
+
+    std::vector<int> sizes{1000, 10000, 100000, 1000000};
+    for (size_t size : sizes) {
+        // keys longer than the small string buffer, so that every temporary std::string allocates
+        HashMap<std::string, int> plain_map;
+        HashMap<std::string, int, TransparentStringHash, std::equal_to<>> transparent_map;
+        std::string buffer;
+        std::vector<std::pair<size_t, size_t>> slices;
+        for (size_t i = 0; i < size; i++) {
+            std::string key = "session-id-" + std::to_string(i * 7919) + "-payload";
+            plain_map.insert({key, int(i)});
+            transparent_map.insert({key, int(i)});
+            slices.push_back({buffer.size(), key.size()});
+            buffer += key;
+        }
+        auto rng = std::default_random_engine {};
+        std::shuffle(slices.begin(), slices.end(), rng);
+        std::string_view view(buffer);
 
-            auto my_end = clock_type::now();
-            auto end = std::chrono::duration_cast<ns>(my_end - my_start);
+        auto start = clock_type::now();
+        size_t count = 0;
+        for (auto [offset, length] : slices) {
+            count += plain_map.find(std::string(view.substr(offset, length)))->second;
+        }
+        auto end = clock_type::now();
+        size_t plain_result = std::chrono::duration_cast<ns>(end - start).count();
 
-            my_map_result = end.count();
+        start = clock_type::now();
+        for (auto [offset, length] : slices) {
+            count += transparent_map.find(view.substr(offset, length))->second;
         }
+        end = clock_type::now();
+        size_t transparent_result = std::chrono::duration_cast<ns>(end - start).count();
+        benchmark_sink = count;
 
-        {
-            auto std_start = clock_type::now();
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | find(std::string(view)): " <<  std::setw(13) << print_with_commas(plain_result);
+        std::cout << " | find(view): "  << std::setw(13) << print_with_commas(transparent_result) << '\n';
+    }
+}
 
-            std::unordered_map<int, int, decltype(good_hash_function)> std_map(size, good_hash_function);
-            for (int element : million) {
-                std_map.insert({element, element});
-            }
+/*
+* Appends to the payload of keys[i] for every i, with three idioms: the old contains + insert + at
+* sequence (up to three lookups and a copy of an empty payload), operator[], and update.
+*/
+template <typename Payload, typename Append>
+void time_payload_updates(const std::vector<int>& keys, Append append) {
+    size_t results[3];
+    {
+        HashMap<int, Payload> map;
+        auto start = clock_type::now();
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (!map.contains(keys[i])) map.insert({keys[i], Payload()});
+            append(map.at(keys[i]), i);
+        }
+        results[0] = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        benchmark_sink = map.size();
+    }
+    {
+        HashMap<int, Payload> map;
+        auto start = clock_type::now();
+        for (size_t i = 0; i < keys.size(); i++) {
+            append(map[keys[i]], i);
+        }
+        results[1] = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        benchmark_sink = map.size();
+    }
+    {
+        HashMap<int, Payload> map;
+        auto start = clock_type::now();
+        for (size_t i = 0; i < keys.size(); i++) {
+            map.update(keys[i], [&](Payload& payload) { append(payload, i); });
+        }
+        results[2] = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        benchmark_sink = map.size();
+    }
+    std::cout << "size "  << std::setw(10) << keys.size();
+    std::cout << " | contains+insert+at: " <<  std::setw(13) << print_with_commas(results[0]);
+    std::cout << " | operator[]: " <<  std::setw(13) << print_with_commas(results[1]);
+    std::cout << " | update: "  << std::setw(13) << print_with_commas(results[2]) << '\n';
+}
 
-            for (int element : million) {
-                std_map.erase(element);
-            }
+void benchmark_payload_updates() {
+    std::vector<int> sizes{10000, 100000, 1000000};
+    std::vector<std::vector<int>> all_keys;
+    for (size_t size : sizes) {
+        // every key is updated 10 times on average
+        std::vector<int> keys;
+        auto rng = std::default_random_engine {};
+        std::uniform_int_distribution<int> distribution(0, size / 10);
+        for (size_t i = 0; i < size; i++) {
+            keys.push_back(distribution(rng));
+        }
+        all_keys.push_back(keys);
+    }
+
+    std::cout << "Task: append to the std::vector<int> payload of a random key N times, measured in ns." << '\n';
+    for (const auto& keys : all_keys) {
+        time_payload_updates<std::vector<int>>(keys, [](std::vector<int>& payload, size_t i) {
+            payload.push_back(i);
+        });
+    }
+    std::cout << "Task: append to the std::string payload of a random key N times, measured in ns." << '\n';
+    for (const auto& keys : all_keys) {
+        time_payload_updates<std::string>(keys, [](std::string& payload, size_t i) {
+            payload.push_back('a' + i % 26);
+        });
+    }
+}
+
+void benchmark_find_many() {
+    std::cout << "Task: 4M lookups in batches of 64 keys, map with 10M elements, measured in ns." << '\n';
+    const size_t size = 10000000, lookups = 4000000, batch = 64;
+    std::vector<int> million;
+    for (size_t i = 0; i < size; i++) {
+        million.push_back(i);
+    }
+    auto rng = std::default_random_engine {};
+    std::shuffle(million.begin(), million.end(), rng);
+
+    HashMap<int, int> map(size);
+    for (int element : million) {
+        map.insert({element, element});
+    }
+    // random keys, half of them missing, so that consecutive lookups touch unrelated cache lines
+    std::uniform_int_distribution<int> distribution(0, 2 * size - 1);
+    std::vector<int> keys;
+    for (size_t i = 0; i < lookups; i++) {
+        keys.push_back(distribution(rng));
+    }
+
+    size_t count = 0;
+    auto start = clock_type::now();
+    for (int key : keys) {
+        auto found = map.find(key);
+        if (found != map.end()) count += found->second;
+    }
+    size_t find_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+    std::vector<HashMap<int, int>::iterator> results(batch);
+    start = clock_type::now();
+    for (size_t i = 0; i < lookups; i += batch) {
+        map.find_many(keys.data() + i, keys.data() + i + batch, results.begin());
+        for (const auto& found : results) {
+            if (found != map.end()) count += found->second;
+        }
+    }
+    size_t find_many_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+    start = clock_type::now();
+    for (int key : keys) {
+        count += map.contains(key);
+    }
+    size_t contains_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+    bool found[batch];
+    start = clock_type::now();
+    for (size_t i = 0; i < lookups; i += batch) {
+        map.contains_many(keys.data() + i, keys.data() + i + batch, found);
+        for (bool hit : found) count += hit;
+    }
+    size_t contains_many_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    benchmark_sink = count;
 
-            auto std_end = clock_type::now();
-            auto end = std::chrono::duration_cast<ns>(std_end - std_start);
+    std::cout << "find: " << print_with_commas(find_result) << " | find_many: " << print_with_commas(find_many_result)
+              << " | contains: " << print_with_commas(contains_result)
+              << " | contains_many: " << print_with_commas(contains_many_result) << '\n';
+}
+
+/*
+* Inserts keys one by one into a default constructed map, timing every single insert.
+* Reports the total, the maximum and the 99.9th percentile latency.
+*/
+void time_insert_latencies(const std::vector<int>& keys, bool incremental) {
+    HashMap<int, int> map;
+    map.incremental_rehash(incremental);
+    std::vector<size_t> latencies;
+    latencies.reserve(keys.size());
+    auto total_start = clock_type::now();
+    for (int key : keys) {
+        auto start = clock_type::now();
+        map.insert({key, key});
+        latencies.push_back(std::chrono::duration_cast<ns>(clock_type::now() - start).count());
+    }
+    size_t total = std::chrono::duration_cast<ns>(clock_type::now() - total_start).count();
+    benchmark_sink = map.size();
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t p999 = latencies[latencies.size() * 999 / 1000];
+    std::cout << (incremental ? "incremental: " : "stop-the-world: ")
+              << "total " << print_with_commas(total) << " | max " << print_with_commas(latencies.back())
+              << " | p99.9 " << print_with_commas(p999) << '\n';
+}
+
+void benchmark_incremental_rehash() {
+    std::cout << "Task: per-insert latency while growing a default map to 4M elements, measured in ns." << '\n';
+    const size_t size = 4000000;
+    std::vector<int> keys;
+    for (size_t i = 0; i < size; i++) {
+        keys.push_back(i);
+    }
+    auto rng = std::default_random_engine {};
+    std::shuffle(keys.begin(), keys.end(), rng);
 
-            std_map_result = end.count();
+    time_insert_latencies(keys, false);
+    time_insert_latencies(keys, true);
+}
+void benchmark_parallel_rehash() {
+    std::cout << "Task: rehash a map with 8M elements from 8M to 16M buckets, by thread count, measured in ns." << '\n';
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << '\n';
+    const size_t size = 8000000;
+    std::vector<int> keys;
+    for (size_t i = 0; i < size; i++) {
+        keys.push_back(i);
+    }
+    auto rng = std::default_random_engine {};
+    std::shuffle(keys.begin(), keys.end(), rng);
+    HashMap<int, int> map(size);
+    for (int key : keys) {
+        map.insert({key, key});
+    }
+
+    for (size_t threads : {1, 2, 4, 8, 16}) {
+        map.rehash(size);
+        auto start = clock_type::now();
+        map.rehash(2 * size, threads);
+        size_t result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        benchmark_sink = map.bucket_count();
+        std::cout << "threads: " << std::setw(2) << threads << " | " << print_with_commas(result) << '\n';
+    }
+}
+void benchmark_bulk_build() {
+    std::cout << "Task: build a map from a vector of 5M rows (random keys, about 40% duplicates), measured in ns." << '\n';
+    const size_t size = 5000000;
+    std::vector<std::pair<int, int>> rows;
+    auto rng = std::default_random_engine {};
+    std::uniform_int_distribution<int> distribution(0, size * 9 / 10);
+    for (size_t i = 0; i < size; i++) {
+        rows.push_back({distribution(rng), static_cast<int>(i)});
+    }
+
+    auto start = clock_type::now();
+    {
+        HashMap<int, int> map;
+        for (const auto& row : rows) {
+            map.insert(row);
         }
+        benchmark_sink = map.size();
+    }
+    size_t insert_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
 
-        std::cout << "size "  << std::setw(10) << size;
-        std::cout << " | HashMap: " <<  std::setw(13) << print_with_commas(my_map_result);
-        std::cout << " | std:unordered_map: "  << std::setw(13) << print_with_commas(std_map_result) << '\n';
-        my_map_timing.push_back(my_map_result);
+    start = clock_type::now();
+    {
+        HashMap<int, int> map(rows.size());
+        for (const auto& row : rows) {
+            map.insert(row);
+        }
+        benchmark_sink = map.size();
+    }
+    size_t presized_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+    start = clock_type::now();
+    {
+        HashMap<int, int> map(rows.begin(), rows.end());
+        benchmark_sink = map.size();
+    }
+    size_t bulk_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+    std::cout << "insert loop: " << print_with_commas(insert_result) << " | presized insert loop: "
+              << print_with_commas(presized_result) << " | range constructor (" << std::thread::hardware_concurrency()
+              << " threads): " << print_with_commas(bulk_result) << '\n';
+}
+void benchmark_snapshot() {
+    std::cout << "Task: restore a map with 10M elements, by insert() or from a snapshot, measured in ns." << '\n';
+    const size_t size = 10000000;
+    const std::string path = "hashmap_perf_snapshot.bin";
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i < size; i++) {
+        keys.push_back(benchmark_mix(i));
     }
-    EXPECT_TRUE(10*my_map_timing[0] < my_map_timing[3]); // Ensure runtime of N = 10 is much faster than N = 10000
+
+    auto start = clock_type::now();
+    HashMap<uint64_t, uint64_t> map;
+    for (size_t i = 0; i < size; i++) {
+        map.insert({keys[i], i});
+    }
+    size_t insert_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+    start = clock_type::now();
+    map.save(path);
+    size_t save_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    size_t file_bytes = file.tellg();
+    map.clear();
+
+    start = clock_type::now();
+    HashMap<uint64_t, uint64_t> loaded;
+    loaded.load(path);
+    size_t load_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    benchmark_sink = loaded.size();
+    std::remove(path.c_str());
+
+    std::cout << "insert loop: " << print_with_commas(insert_result) << " | save: " << print_with_commas(save_result)
+              << " (" << print_with_commas(file_bytes / 1024) << " KiB) | load: " << print_with_commas(load_result) << '\n';
+}
+
+void benchmark_frozen() {
+    std::cout << "Task: 4M random lookups (half of them misses) in a map with 4M elements, HashMap vs "
+              << "its freeze(), measured in ns (memory in bytes per element)." << '\n';
+    const size_t size = 4000000;
+    std::vector<uint64_t> lookups;
+    auto rng = std::default_random_engine {};
+    std::uniform_int_distribution<uint64_t> distribution(0, 2 * size - 1);
+    for (size_t i = 0; i < size; i++) {
+        lookups.push_back(benchmark_mix(distribution(rng)));
+    }
+
+    size_t memory_before = memory_in_use();
+    HashMap<uint64_t, uint64_t> map;
+    for (size_t i = 0; i < size; i++) {
+        map.insert({benchmark_mix(i), i});
+    }
+    size_t map_memory = memory_in_use() - memory_before;
+
+    memory_before = memory_in_use();
+    auto start = clock_type::now();
+    auto frozen = map.freeze();
+    size_t freeze_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    size_t frozen_memory = memory_in_use() - memory_before;
+
+    size_t count = 0;
+    start = clock_type::now();
+    for (uint64_t key : lookups) {
+        auto found = map.find(key);
+        if (found != map.end()) count += found->second;
+    }
+    size_t map_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+    start = clock_type::now();
+    for (uint64_t key : lookups) {
+        auto found = frozen.find(key);
+        if (found != frozen.end()) count += found->second;
+    }
+    size_t frozen_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    benchmark_sink = count;
+
+    std::cout << "HashMap: " << print_with_commas(map_result) << " (" << std::fixed << std::setprecision(1)
+              << double(map_memory) / size << " B)" << " | FrozenHashMap: " << print_with_commas(frozen_result)
+              << " (" << double(frozen_memory) / size << " B) | freeze(): " << print_with_commas(freeze_result)
+              << std::defaultfloat << '\n';
 }
 
-void benchmark_find() {
-    std::cout << "Task: find N elements (random hit/miss), measured in ns." << '\n';
-    auto good_hash_function = [](const int& key) {
-       return (key * 43037 + 52081) % 79229;
+void benchmark_copy() {
+    std::cout << "Task: copy a map with 1M elements: one insert per element (the old copy constructor) vs "
+              << "the chain-by-chain copy constructor, measured in ns (destroying the copy is not timed)." << '\n';
+    using PoolMap = HashMap<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                            PoolAllocator<std::pair<const uint64_t, uint64_t>>>;
+    const size_t size = 1000000;
+    HashMap<uint64_t, uint64_t> map;
+    PoolMap pool_map;
+    std::unordered_map<uint64_t, uint64_t> std_map;
+    for (size_t i = 0; i < size; i++) {
+        map.insert({benchmark_mix(i), i});
+        pool_map.insert({benchmark_mix(i), i});
+        std_map.insert({benchmark_mix(i), i});
+    }
+
+    // copy() returns the copy, so that it is destroyed after the clock stops
+    auto time_copy = [](auto copy) {
+        auto start = clock_type::now();
+        auto result = copy();
+        size_t elapsed = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        benchmark_sink = result.size();
+        return elapsed;
     };
+    size_t insert_result = time_copy([&] {
+        HashMap<uint64_t, uint64_t> copy;
+        copy.rehash(map.bucket_count());
+        for (const auto& kv_pair : map) copy.insert(kv_pair);
+        return copy;
+    });
+    size_t chain_result = time_copy([&] { return HashMap<uint64_t, uint64_t>(map); });
+    size_t slab_result = time_copy([&] { return PoolMap(pool_map); });
+    size_t std_result = time_copy([&] { return std::unordered_map<uint64_t, uint64_t>(std_map); });
 
-    std::vector<size_t> my_map_timing;
-    std::vector<int> sizes{10, 100, 1000, 10000, 100000, 1000000};
-    for (size_t size : sizes) {
-        std::vector<int> million;
-        std::vector<int> lookup;
-        for (size_t i = 0; i < 2*size; i++) {
-            million.push_back(i);
-            lookup.push_back(i);
+    std::cout << "insert per element: " << print_with_commas(insert_result)
+              << " | chain by chain: " << print_with_commas(chain_result)
+              << " | PoolAllocator slabs: " << print_with_commas(slab_result)
+              << " | std::unordered_map: " << print_with_commas(std_result) << '\n';
+}
+
+void benchmark_set_algebra() {
+    std::cout << "Task: set operations on two maps with 1M elements each, half of the keys in common, "
+              << "by hand (iteration and insert / erase) vs the HashMap member functions, measured in ns." << '\n';
+    using Map = HashMap<uint64_t, uint64_t>;
+    const size_t size = 1000000;
+    Map lhs, rhs;
+    for (size_t i = 0; i < size; i++) {
+        lhs.insert({benchmark_mix(i), i});
+        rhs.insert({benchmark_mix(i + size / 2), i});
+    }
+
+    // each body gets fresh copies of the inputs, made before the clock starts
+    auto time_op = [&](auto body) {
+        Map lhs_copy = lhs, rhs_copy = rhs;
+        auto start = clock_type::now();
+        body(lhs_copy, rhs_copy);
+        return size_t(std::chrono::duration_cast<ns>(clock_type::now() - start).count());
+    };
+    auto report = [](const std::string& name, size_t by_hand, size_t member) {
+        std::cout << std::left << std::setw(22) << name << std::right << "by hand: " << std::setw(13)
+                  << print_with_commas(by_hand) << " | member: " << std::setw(13) << print_with_commas(member) << '\n';
+    };
+
+    report("merge", time_op([](Map& a, Map& b) {
+        for (auto it = b.begin(); it != b.end();) it = a.insert(*it).second ? b.erase(it) : ++it;
+    }), time_op([](Map& a, Map& b) { a.merge(b); }));
+
+    report("intersect_with", time_op([](Map& a, Map& b) {
+        Map result;
+        for (const auto& kv_pair : a) if (b.contains(kv_pair.first)) result.insert(kv_pair);
+        a = std::move(result);
+    }), time_op([](Map& a, Map& b) { a.intersect_with(b); }));
+
+    report("difference_with", time_op([](Map& a, Map& b) {
+        for (const auto& kv_pair : b) a.erase(kv_pair.first);
+    }), time_op([](Map& a, Map& b) { a.difference_with(b); }));
+
+    report("symmetric_difference", time_op([](Map& a, Map& b) {
+        Map result;
+        for (const auto& kv_pair : a) if (!b.contains(kv_pair.first)) result.insert(kv_pair);
+        for (const auto& kv_pair : b) if (!a.contains(kv_pair.first)) result.insert(kv_pair);
+        benchmark_sink = result.size();
+    }), time_op([](Map& a, Map& b) { benchmark_sink = a.symmetric_difference(b).size(); }));
+
+    // equal maps, so that neither version can stop early
+    report("operator==", time_op([&](Map& a, Map&) {
+        bool equal = true;
+        for (const auto& kv_pair : a) {
+            if (!lhs.contains(kv_pair.first) || lhs.at(kv_pair.first) != kv_pair.second) equal = false;
         }
-        auto rng = std::default_random_engine {};
-        std::shuffle(million.begin(), million.end(), rng);
-        std::shuffle(lookup.begin(), lookup.end(), rng);
-        size_t my_map_result, std_map_result;
-        {
-
-            HashMap<int, int, decltype(good_hash_function)> my_map(size, good_hash_function);
-            for (size_t i = 0; i < million.size(); i += 2) {
-                int element = million[i];
-                my_map.insert({element, element});
-            }
-            auto my_start = clock_type::now();
-            int count = 0;
-            for (size_t i = 0; i < lookup.size(); i += 2) {
-                int element = lookup[i];
-                auto found = my_map.find(element);
-                count += (found == my_map.end());
-            }
+        benchmark_sink = equal && a.size() == lhs.size();
+    }), time_op([&](Map& a, Map&) { benchmark_sink = a == lhs; }));
+}
+
+/*
+* The reserved words of C++, as a keyword table would hold them.
+*/
+constexpr auto static_keywords = make_static_hash_map<std::string_view, int>({
+    {"alignas", 0}, {"alignof", 1}, {"and", 2}, {"asm", 3}, {"auto", 4}, {"bool", 5}, {"break", 6},
+    {"case", 7}, {"catch", 8}, {"char", 9}, {"class", 10}, {"const", 11}, {"constexpr", 12},
+    {"const_cast", 13}, {"continue", 14}, {"decltype", 15}, {"default", 16}, {"delete", 17}, {"do", 18},
+    {"double", 19}, {"dynamic_cast", 20}, {"else", 21}, {"enum", 22}, {"explicit", 23}, {"export", 24},
+    {"extern", 25}, {"false", 26}, {"float", 27}, {"for", 28}, {"friend", 29}, {"goto", 30}, {"if", 31},
+    {"inline", 32}, {"int", 33}, {"long", 34}, {"mutable", 35}, {"namespace", 36}, {"new", 37},
+    {"noexcept", 38}, {"not", 39}, {"nullptr", 40}, {"operator", 41}, {"or", 42}, {"private", 43},
+    {"protected", 44}, {"public", 45}, {"register", 46}, {"reinterpret_cast", 47}, {"return", 48},
+    {"short", 49}, {"signed", 50}, {"sizeof", 51}, {"static", 52}, {"static_assert", 53},
+    {"static_cast", 54}, {"struct", 55}, {"switch", 56}, {"template", 57}, {"this", 58},
+    {"thread_local", 59}, {"throw", 60}, {"true", 61}, {"try", 62}, {"typedef", 63}, {"typeid", 64},
+    {"typename", 65}, {"union", 66}, {"unsigned", 67}, {"using", 68}, {"virtual", 69}, {"void", 70},
+    {"volatile", 71}, {"wchar_t", 72}, {"while", 73}, {"xor", 74},
+});
+
+void benchmark_static_map() {
+    std::cout << "Task: build a table of the 75 C++ keywords 10K times, then look up 10M tokens (half of "
+              << "them keywords), HashMap from an initializer_list vs a constexpr StaticHashMap, in ns." << '\n';
+    std::vector<std::pair<std::string_view, int>> keywords(static_keywords.begin(), static_keywords.end());
+    std::vector<std::string_view> identifiers {"x", "value", "count", "i", "next", "size", "map", "node", "key"};
 
-            auto my_end = clock_type::now();
-            auto end = std::chrono::duration_cast<ns>(my_end - my_start);
+    auto start = clock_type::now();
+    size_t checksum = 0;
+    for (size_t i = 0; i < 10000; i++) {
+        // the same elements as an initializer_list in the source, without writing them out twice
+        HashMap<std::string_view, int> table(keywords.begin(), keywords.end());
+        checksum += table.size();
+    }
+    size_t build_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+    std::vector<std::string_view> tokens;
+    auto rng = std::default_random_engine {};
+    for (size_t i = 0; i < 10000000; i++) {
+        tokens.push_back(i % 2 ? keywords[rng() % keywords.size()].first : identifiers[rng() % identifiers.size()]);
+    }
+    HashMap<std::string_view, int> table(keywords.begin(), keywords.end());
+    start = clock_type::now();
+    for (std::string_view token : tokens) {
+        auto found = table.find(token);
+        if (found != table.end()) checksum += found->second;
+    }
+    size_t map_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+    start = clock_type::now();
+    for (std::string_view token : tokens) {
+        auto found = static_keywords.find(token);
+        if (found != static_keywords.end()) checksum += found->second;
+    }
+    size_t static_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    benchmark_sink = checksum;
+
+    std::cout << "build: HashMap: " << print_with_commas(build_result) << " | StaticHashMap: 0 (compile time)" << '\n'
+              << "lookups: HashMap: " << print_with_commas(map_result)
+              << " | StaticHashMap: " << print_with_commas(static_result) << '\n';
+}
 
-            my_map_result = end.count();
+/*
+* Builds count maps of size elements each, as a program that keeps a map per object would, and
+* reports the time to construct and fill them and the heap memory they use per map.
+*/
+template <typename Map>
+std::pair<size_t, size_t> time_small_maps(size_t count, size_t size) {
+    size_t memory_before = memory_in_use();
+    auto start = clock_type::now();
+    std::vector<Map> maps(count);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < size; j++) {
+            maps[i].insert({benchmark_mix(i * size + j), j});
         }
+    }
+    size_t result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    size_t memory = memory_in_use() - memory_before;
+    benchmark_sink = maps.back().size();
+    return {result, memory / count};
+}
+
+void benchmark_small_maps() {
+    std::cout << "Task: construct 1M maps and insert 0, 4, 8 or 16 elements into each, HashMap vs "
+              << "SmallHashMap with 8 inline elements, measured in ns (memory in bytes per map, "
+              << "including the vector that holds the maps)." << '\n';
+    const size_t count = 1000000;
+    for (size_t size : {0, 4, 8, 16}) {
+        auto [map_result, map_memory] = time_small_maps<HashMap<uint64_t, uint64_t>>(count, size);
+        auto [small_result, small_memory] = time_small_maps<SmallHashMap<uint64_t, uint64_t, 8>>(count, size);
+        std::cout << size << " elements: HashMap: " << print_with_commas(map_result) << " (" << map_memory
+                  << " B) | SmallHashMap: " << print_with_commas(small_result) << " (" << small_memory << " B)" << '\n';
+    }
+}
 
-        {
-            std::unordered_map<int, int, decltype(good_hash_function)> std_map(size, good_hash_function);
-            for (size_t i = 0; i < million.size(); i += 2) {
-                int element = million[i];
-                std_map.insert({element, element});
+/*
+* Inserts keys into a HashMap with hash function H and looks every key up once. Returns the time
+* in ns and the longest chain of the map.
+*/
+template <typename H>
+std::pair<size_t, size_t> time_hash_pattern(const std::vector<uint64_t>& keys) {
+    auto start = clock_type::now();
+    HashMap<uint64_t, uint64_t, H> map;
+    for (uint64_t key : keys) {
+        map.insert({key, key});
+    }
+    size_t count = 0;
+    for (uint64_t key : keys) {
+        count += map.contains(key);
+    }
+    size_t result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    benchmark_sink = count;
+    return {result, map.stats().max_chain_length};
+}
+
+void benchmark_hash_functions() {
+    std::cout << "Task: insert 20K keys of a pattern into a HashMap and find them all, identity std::hash vs "
+              << "DefaultHash, measured in ns (longest chain in parentheses)." << '\n';
+    const size_t size = 20000;
+    const std::vector<std::pair<std::string, uint64_t>> patterns {
+        {"sequential", 1}, {"multiples of 1024", 1024}, {"multiples of 2^20", 1 << 20}, {"multiples of 2^32", 1ull << 32},
+    };
+    for (const auto& [name, stride] : patterns) {
+        std::vector<uint64_t> keys;
+        for (uint64_t i = 0; i < size; i++) {
+            keys.push_back(i * stride);
+        }
+        auto [identity_result, identity_chain] = time_hash_pattern<std::hash<uint64_t>>(keys);
+        auto [default_result, default_chain] = time_hash_pattern<DefaultHash<uint64_t>>(keys);
+        std::cout << std::setw(18) << name << ": std::hash: " << std::setw(13) << print_with_commas(identity_result)
+                  << " (" << identity_chain << ") | DefaultHash: " << std::setw(11)
+                  << print_with_commas(default_result) << " (" << default_chain << ")" << '\n';
+    }
+
+    std::cout << "Task: hash 10K strings of each length 100 times (the strings stay in cache), "
+              << "std::hash<std::string_view> vs DefaultHash, in ns." << '\n';
+    for (size_t length : {8, 16, 32, 64, 256}) {
+        std::vector<std::string> keys(10000);
+        for (size_t i = 0; i < keys.size(); i++) {
+            make_key(i, length, keys[i]);
+        }
+        size_t checksum = 0;
+        auto start = clock_type::now();
+        for (size_t pass = 0; pass < 100; pass++) {
+            for (const std::string& key : keys) {
+                checksum += std::hash<std::string_view>()(key);
             }
-            auto std_start = clock_type::now();
-            int count = 0;
-            for (size_t i = 0; i < lookup.size(); i += 2) {
-                int element = lookup[i];
-                auto found = std_map.find(element);
-                count += (found == std_map.end());
+        }
+        size_t std_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        start = clock_type::now();
+        for (size_t pass = 0; pass < 100; pass++) {
+            for (const std::string& key : keys) {
+                checksum += DefaultHash<std::string>()(key);
             }
+        }
+        size_t default_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        benchmark_sink = checksum;
+        std::cout << "length " << std::setw(3) << length << ": std::hash: " << std::setw(11)
+                  << print_with_commas(std_result) << " | DefaultHash: " << std::setw(11)
+                  << print_with_commas(default_result) << '\n';
+    }
 
-            auto std_end = clock_type::now();
-            auto end = std::chrono::duration_cast<ns>(std_end - std_start);
+    std::cout << "Task: reduce 10M hashes to [0, 1000003), modulo vs fastrange, in ns." << '\n';
+    std::vector<uint64_t> hashes;
+    for (size_t i = 0; i < 10000000; i++) {
+        hashes.push_back(benchmark_mix(i));
+    }
+    size_t n = 1000003;
+    size_t checksum = 0;
+    auto start = clock_type::now();
+    for (uint64_t hash : hashes) {
+        checksum += hash % n;
+    }
+    size_t modulo_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    start = clock_type::now();
+    for (uint64_t hash : hashes) {
+        checksum += fastrange(hash, n);
+    }
+    size_t fastrange_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    benchmark_sink = checksum;
+    std::cout << "modulo: " << print_with_commas(modulo_result) << " | fastrange: "
+              << print_with_commas(fastrange_result) << '\n';
+}
 
-            std_map_result = end.count();
-        }
+/*
+* Looks up every key of lookups in map and returns the time in ns.
+*/
+template <typename Map>
+size_t time_lookups(const Map& map, const std::vector<uint64_t>& lookups) {
+    auto start = clock_type::now();
+    size_t count = 0;
+    for (uint64_t key : lookups) {
+        count += map.contains(key);
+    }
+    size_t result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    benchmark_sink = count;
+    return result;
+}
 
-        std::cout << "size "  << std::setw(10) << size;
-        std::cout << " | HashMap: " <<  std::setw(13) << print_with_commas(my_map_result);
-        std::cout << " | std:unordered_map: "  << std::setw(13) << print_with_commas(std_map_result) << '\n';
-        my_map_timing.push_back(my_map_result);
+void benchmark_bloom_filter() {
+    std::cout << "Task: 10M lookups in a HashMap of 1M elements, of which 50%, 90% or 99% miss, "
+              << "without and with the Bloom filter, measured in ns." << '\n';
+    const size_t size = 1000000, lookups = 10000000;
+    HashMap<uint64_t, uint64_t> map;
+    for (size_t i = 0; i < size; i++) {
+        map.insert({benchmark_mix(i), i});
+    }
+    std::mt19937_64 generator(42);
+    for (size_t miss_percent : {50, 90, 99}) {
+        std::vector<uint64_t> keys(lookups);
+        for (uint64_t& key : keys) {
+            // the present keys are the mixes of 0..size-1, the absent ones those of size..
+            bool miss = generator() % 100 < miss_percent;
+            key = benchmark_mix(miss ? size + generator() % (4 * size) : generator() % size);
+        }
+        map.bloom_filter(false);
+        size_t plain_result = time_lookups(map, keys);
+        map.bloom_filter(true);
+        size_t bloom_result = time_lookups(map, keys);
+        std::cout << miss_percent << "% misses: HashMap: " << print_with_commas(plain_result)
+                  << " | HashMap with Bloom filter: " << print_with_commas(bloom_result) << '\n';
     }
-    EXPECT_TRUE(10*my_map_timing[0] < my_map_timing[3]); // Ensure runtime of N = 10 is much faster than N = 10000
+    HashMapStats stats = map.stats();
+    std::cout << "Bloom filter: " << print_with_commas(stats.bloom_filter_bytes) << " bytes for "
+              << print_with_commas(stats.size) << " elements, estimated false positive rate "
+              << stats.bloom_false_positive_rate << '\n';
 }
 
-void benchmark_iterate() {
-    std::cout << "Task: iterate over all N elements, measured in ns." << '\n';
-    auto good_hash_function = [](const int& key) {
-       return (key * 43037 + 52081) % 79229;
-    };
+/*
+* The parametric suite. Every case runs on every container below with exactly the same keys and
+* the same sequence of operations, --runs times, and reports ns per operation together with the
+* ratio to std::unordered_map. The case names are
+*
+*      insert/<keys>                                       insert N keys into a default map
+*      erase/<keys>                                        erase all N keys of a full map
+*      iterate/<keys>                                      visit every element of a full map
+*      find/<keys>/<uniform|zipf>/hit<100|50|0>/<warm|cold>
+*      mixed/<keys>/read<90|50>/<uniform|zipf>
+*
+* <keys> is uint64 (random 64-bit integers) or string8, string32, string128 (random strings of
+* that many characters: 8 fits in the small string buffer, the longer ones are heap allocated).
+* find does N lookups with the given share of hits; the misses are drawn with the same access
+* pattern from keys that are never inserted. warm lookups run once untimed before every timed run,
+* cold ones first evict the caches. mixed does N operations on a map that starts full: reads are
+* finds, the other operations alternate between operator[] and erase on keys drawn from twice
+* as many keys as the map holds, so the size stays around N.
+*/
+template <typename Map>
+struct ContainerTag {
+    using type = Map;
+};
 
-    std::vector<size_t> my_map_timing;
-    std::vector<size_t> std_map_timing;
-    std::vector<int> sizes{10, 100, 1000, 10000, 100000, 1000000};
-    for (size_t size : sizes) {
-        std::vector<int> million;
+template <typename Key, typename Fn>
+void for_each_container(Fn fn) {
+    fn(ContainerTag<HashMap<Key, uint64_t>>(), "HashMap");
+    fn(ContainerTag<FlatHashMap<Key, uint64_t>>(), "FlatHashMap");
+    fn(ContainerTag<RobinHoodHashMap<Key, uint64_t>>(), "RobinHoodHashMap");
+    fn(ContainerTag<DenseHashMap<Key, uint64_t>>(), "DenseHashMap");
+    fn(ContainerTag<std::unordered_map<Key, uint64_t>>(), "std::unordered_map");
+}
+
+template <typename Key>
+struct SuiteKeys {
+    std::string name;
+    std::vector<Key> present;   // the keys in the map
+    std::vector<Key> absent;    // keys that are never inserted
+};
+
+template <typename Key>
+SuiteKeys<Key> make_suite_keys(const std::string& name, size_t size, size_t length) {
+    SuiteKeys<Key> keys{name, std::vector<Key>(size), std::vector<Key>(size)};
+    for (size_t i = 0; i < size; i++) {
+        make_key(i, length, keys.present[i]);
+        make_key(size + i, length, keys.absent[i]);
+    }
+    return keys;
+}
+
+/*
+* Returns count indices into a vector of size keys: uniformly random, or Zipf distributed with
+* the ranks scattered over the vector, so that the hot keys are not also neighbours in memory.
+*/
+std::vector<size_t> make_access_pattern(size_t size, size_t count, bool zipf, std::default_random_engine& rng) {
+    std::vector<size_t> pattern;
+    pattern.reserve(count);
+    if (zipf) {
+        std::vector<size_t> rank_to_index(size);
         for (size_t i = 0; i < size; i++) {
-            million.push_back(i);
+            rank_to_index[i] = i;
         }
-        auto rng = std::default_random_engine {};
-        std::shuffle(million.begin(), million.end(), rng);
-        size_t my_map_result, std_map_result;
-        {
-            HashMap<int, int, decltype(good_hash_function)> my_map(size, good_hash_function);
-            for (int element : million) {
-                my_map.insert({element, element});
+        std::shuffle(rank_to_index.begin(), rank_to_index.end(), rng);
+        ZipfDistribution distribution(size, 0.99);
+        for (size_t i = 0; i < count; i++) {
+            pattern.push_back(rank_to_index[distribution(rng)]);
+        }
+    } else {
+        std::uniform_int_distribution<size_t> distribution(0, size - 1);
+        for (size_t i = 0; i < count; i++) {
+            pattern.push_back(distribution(rng));
+        }
+    }
+    return pattern;
+}
+
+/*
+* Runs one case on every container and hands the results to the reporter. run(tag, runs, operations)
+* returns the ns per operation of every run for the container ContainerTag tag stands for.
+*/
+template <typename Key, typename Run>
+void run_case(const std::string& name, const BenchmarkOptions& options, BenchmarkReporter& reporter, Run run) {
+    if (!options.selected(name)) return;
+    std::vector<BenchmarkResult> results;
+    for_each_container<Key>([&](auto tag, const char* container) {
+        BenchmarkResult result;
+        result.name = name;
+        result.container = container;
+        result.size = options.size;
+        result.runs = options.runs;
+        result.ns_per_op = BenchmarkStatistics::of(run(tag, options.runs, result.operations));
+        results.push_back(result);
+    });
+    reporter.add_case(results);
+}
+
+template <typename Map, typename Key>
+void fill(Map& map, const std::vector<Key>& keys) {
+    for (size_t i = 0; i < keys.size(); i++) {
+        map.insert({keys[i], i});
+    }
+}
+
+template <typename Key>
+void run_suite_for(const SuiteKeys<Key>& keys, const BenchmarkOptions& options, BenchmarkReporter& reporter) {
+    const size_t size = keys.present.size();
+
+    run_case<Key>("insert/" + keys.name, options, reporter, [&](auto tag, size_t runs, size_t& operations) {
+        using Map = typename decltype(tag)::type;
+        std::unique_ptr<Map> map;
+        return time_runs(runs, [&] { map = std::make_unique<Map>(); }, [&] {
+            fill(*map, keys.present);
+            return size;
+        }, operations);
+    });
+
+    run_case<Key>("erase/" + keys.name, options, reporter, [&](auto tag, size_t runs, size_t& operations) {
+        using Map = typename decltype(tag)::type;
+        std::unique_ptr<Map> map;
+        return time_runs(runs, [&] { map = std::make_unique<Map>(); fill(*map, keys.present); }, [&] {
+            for (const Key& key : keys.present) {
+                map->erase(key);
             }
+            return size;
+        }, operations);
+    });
 
-            auto my_start = clock_type::now();
+    run_case<Key>("iterate/" + keys.name, options, reporter, [&](auto tag, size_t runs, size_t& operations) {
+        typename decltype(tag)::type map;
+        fill(map, keys.present);
+        return time_runs(runs, [] {}, [&] {
             size_t count = 0;
-            for (const auto& [key, value] : my_map) {
-                count += key;
+            for (const auto& [key, value] : map) {
+                count += value;
             }
-            auto my_end = clock_type::now();
-            auto end = std::chrono::duration_cast<ns>(my_end - my_start);
+            benchmark_sink = count;
+            return size;
+        }, operations);
+    });
 
-            my_map_result = end.count();
+    std::default_random_engine rng;
+    for (bool zipf : {false, true}) {
+        std::vector<size_t> pattern = make_access_pattern(size, size, zipf, rng);
+        for (int hit_percent : {100, 50, 0}) {
+            std::vector<const Key*> lookups;
+            std::uniform_int_distribution<int> percent(0, 99);
+            for (size_t index : pattern) {
+                lookups.push_back(percent(rng) < hit_percent ? &keys.present[index] : &keys.absent[index]);
+            }
+            for (bool cold : {false, true}) {
+                std::string name = "find/" + keys.name + (zipf ? "/zipf" : "/uniform") + "/hit"
+                                   + std::to_string(hit_percent) + (cold ? "/cold" : "/warm");
+                run_case<Key>(name, options, reporter, [&](auto tag, size_t runs, size_t& operations) {
+                    typename decltype(tag)::type map;
+                    fill(map, keys.present);
+                    auto find_all = [&] {
+                        size_t count = 0;
+                        for (const Key* key : lookups) {
+                            count += map.find(*key) != map.end();
+                        }
+                        benchmark_sink = count;
+                        return lookups.size();
+                    };
+                    auto setup = [&] {
+                        if (cold) {
+                            benchmark_sink = evict_caches();
+                        } else {
+                            find_all();
+                        }
+                    };
+                    return time_runs(runs, setup, find_all, operations);
+                });
+            }
         }
+    }
 
-        {
-            std::unordered_map<int, int, decltype(good_hash_function)> std_map(size, good_hash_function);
-            for (int element : million) {
-                std_map.insert({element, element});
+    for (int read_percent : {90, 50}) {
+        for (bool zipf : {false, true}) {
+            // index i < size is keys.present[i], index size + i is keys.absent[i]
+            std::vector<size_t> pattern = make_access_pattern(2 * size, size, zipf, rng);
+            std::vector<std::pair<const Key*, bool>> operations_list;
+            std::uniform_int_distribution<int> percent(0, 99);
+            for (size_t index : pattern) {
+                const Key* key = index < size ? &keys.present[index] : &keys.absent[index - size];
+                operations_list.push_back({key, percent(rng) < read_percent});
             }
+            std::string name = "mixed/" + keys.name + "/read" + std::to_string(read_percent)
+                               + (zipf ? "/zipf" : "/uniform");
+            run_case<Key>(name, options, reporter, [&](auto tag, size_t runs, size_t& operations) {
+                using Map = typename decltype(tag)::type;
+                std::unique_ptr<Map> map;
+                return time_runs(runs, [&] { map = std::make_unique<Map>(); fill(*map, keys.present); }, [&] {
+                    size_t count = 0, writes = 0;
+                    for (const auto& [key, read] : operations_list) {
+                        if (read) {
+                            count += map->find(*key) != map->end();
+                        } else if (writes++ % 2 == 0) {
+                            (*map)[*key] = writes;
+                        } else {
+                            count += map->erase(*key);
+                        }
+                    }
+                    benchmark_sink = count;
+                    return operations_list.size();
+                }, operations);
+            });
+        }
+    }
+}
 
-            auto std_start = clock_type::now();
-            size_t count = 0;
-            for (const auto& [key, value] : std_map) {
-                count += key;
-            }
-            auto std_end = clock_type::now();
-            auto end = std::chrono::duration_cast<ns>(std_end - std_start);
+void run_suite(const BenchmarkOptions& options, BenchmarkReporter& reporter) {
+    run_suite_for(make_suite_keys<uint64_t>("uint64", options.size, 0), options, reporter);
+    for (size_t length : {8, 32, 128}) {
+        std::string name = "string" + std::to_string(length);
+        run_suite_for(make_suite_keys<std::string>(name, options.size, length), options, reporter);
+    }
+}
+
+/*
+* The usual LRU cache: a map from keys to iterators into a std::list that keeps the entries in
+* recency order. Two nodes per entry, and a hit follows the map node to the list node.
+*/
+template <template <typename...> class Map>
+class MapListLRU {
+public:
+    explicit MapListLRU(size_t capacity) : _capacity(capacity) {}
 
-            std_map_result = end.count();
+    uint64_t* get(uint64_t key) {
+        auto found = _index.find(key);
+        if (found == _index.end()) return nullptr;
+        _order.splice(_order.begin(), _order, found->second);
+        return &found->second->second;
+    }
+
+    void put(uint64_t key, uint64_t value) {
+        auto found = _index.find(key);
+        if (found != _index.end()) {
+            found->second->second = value;
+            _order.splice(_order.begin(), _order, found->second);
+            return;
         }
+        if (_order.size() == _capacity) {
+            _index.erase(_order.back().first);
+            _order.pop_back();
+        }
+        _order.push_front({key, value});
+        _index.insert({key, _order.begin()});
+    }
 
-        std::cout << "size "  << std::setw(10) << size;
-        std::cout << " | HashMap: " <<  std::setw(13) << print_with_commas(my_map_result);
-        std::cout << " | std:unordered_map: "  << std::setw(13) << print_with_commas(std_map_result) << '\n';
-        my_map_timing.push_back(my_map_result);
+private:
+    size_t _capacity;
+    std::list<std::pair<uint64_t, uint64_t>> _order;
+    Map<uint64_t, std::list<std::pair<uint64_t, uint64_t>>::iterator> _index;
+};
+
+/*
+* Runs read-through traffic (get, and put on a miss) over keys and returns the time in ns,
+* the hit rate and the heap memory of the full cache per entry.
+*/
+template <typename Cache>
+std::tuple<size_t, double, size_t> time_lru(size_t capacity, const std::vector<uint64_t>& keys) {
+    size_t memory_before = memory_in_use();
+    Cache cache(capacity);
+    size_t hits = 0;
+    auto start = clock_type::now();
+    for (uint64_t key : keys) {
+        if (uint64_t* value = cache.get(key)) {
+            hits++;
+            benchmark_sink += *value;
+        } else {
+            cache.put(key, key);
+        }
     }
-    EXPECT_TRUE(10*my_map_timing[0] < my_map_timing[3]); // Ensure runtime of N = 10 is much faster than N = 10000
+    size_t result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+    size_t memory_after = memory_in_use();
+    size_t memory = memory_after - std::min(memory_before, memory_after);
+    return {result, double(hits) / keys.size(), memory / capacity};
 }
+
+void benchmark_lru_cache() {
+    std::cout << "Task: 10M Zipf distributed (s = 0.99) reads over 10M keys through an LRU cache of 10K, "
+              << "100K or 1M entries, filled on every miss: HashMap + std::list, std::unordered_map + "
+              << "std::list and LRUCache, measured in ns (heap memory in bytes per entry)." << '\n';
+    const size_t universe = 10000000, count = 10000000;
+    std::default_random_engine rng(42);
+    std::vector<uint64_t> keys;
+    keys.reserve(count);
+    for (size_t index : make_access_pattern(universe, count, true, rng)) {
+        keys.push_back(benchmark_mix(index));
+    }
+    for (size_t capacity : {10000, 100000, 1000000}) {
+        auto [list_result, list_hits, list_memory] = time_lru<MapListLRU<HashMap>>(capacity, keys);
+        auto [std_result, std_hits, std_memory] = time_lru<MapListLRU<std::unordered_map>>(capacity, keys);
+        auto [lru_result, lru_hits, lru_memory] = time_lru<LRUCache<uint64_t, uint64_t>>(capacity, keys);
+        std::cout << print_with_commas(capacity) << " entries, hit rate " << std::setprecision(3) << lru_hits
+                  << ": HashMap + std::list: " << print_with_commas(list_result) << " (" << list_memory << " B)"
+                  << " | std::unordered_map + std::list: " << print_with_commas(std_result) << " (" << std_memory << " B)"
+                  << " | LRUCache: " << print_with_commas(lru_result) << " (" << lru_memory << " B)" << '\n';
+        if (list_hits != lru_hits || std_hits != lru_hits) std::cout << "hit rates differ!" << '\n';
+    }
+}
+
+/*
+* Benchmarks of single features (allocators, batched lookups, rehash strategies, ...). They compare
+* variants of one container rather than containers and have their own fixed sizes. They only print
+* text: --filter selects them by name, and --format=csv or json skips them.
+*/
+const std::vector<std::pair<std::string, void (*)()>> feature_benchmarks = {
+    {"complexity", benchmark_complexity},
+    {"sparse_iterate", benchmark_sparse_iterate},
+    {"probe_lengths", benchmark_probe_lengths},
+    {"pool_allocator", benchmark_pool_allocator},
+    {"string_view_lookup", benchmark_string_view_lookup},
+    {"payload_updates", benchmark_payload_updates},
+    {"find_many", benchmark_find_many},
+    {"incremental_rehash", benchmark_incremental_rehash},
+    {"parallel_rehash", benchmark_parallel_rehash},
+    {"bulk_build", benchmark_bulk_build},
+    {"snapshot", benchmark_snapshot},
+    {"frozen", benchmark_frozen},
+    {"copy", benchmark_copy},
+    {"set_algebra", benchmark_set_algebra},
+    {"static_map", benchmark_static_map},
+    {"small_maps", benchmark_small_maps},
+    {"hash_functions", benchmark_hash_functions},
+    {"bloom_filter", benchmark_bloom_filter},
+    {"lru_cache", benchmark_lru_cache},
+};
 #endif
 
-int main() {
-    std::cout << "Performance Test: " << std::endl;
+/*
+* See benchmark_suite.h for the command line options.
+*/
+int main(int argc, char** argv) {
+    BenchmarkOptions options = BenchmarkOptions::parse(argc, argv);
+    if (options.format == "text") std::cout << "Performance Test: " << std::endl;
 #if RUN_TEST_PERF
-    benchmark_find();
-    benchmark_insert_erase();
-    benchmark_iterate();
+    BenchmarkReporter reporter(options);
+    run_suite(options, reporter);
+    reporter.finish();
+    if (options.format == "text") {
+        for (const auto& [name, benchmark] : feature_benchmarks) {
+            if (options.selected(name)) benchmark();
+        }
+    }
 #endif
     return 0;
-}
\ No newline at end of file
+}
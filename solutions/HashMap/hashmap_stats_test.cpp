@@ -0,0 +1,108 @@
+#include <vector>
+
+#include "test_settings.h"
+#include "gtest/gtest.h"
+// the lookup counters of HashMap::stats() are off by default; they change the layout of
+// HashMap, so they are turned on for this whole test program, never next to other tests
+#define HASHMAP_PROBE_COUNTERS 1
+#include "hashmap.h"
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: stats */
+
+/*
+* Verifies the chain length histogram, memory figures and probe counters of HashMap::stats(),
+* for a well-spread map and for a degenerate hash function.
+*/
+#if RUN_TEST_20A
+TEST(HashMapTest, TEST_20A_STATS) {
+    HashMap<int, int, std::hash<int>> map(64);
+    auto stats = map.stats();
+    ASSERT_EQ(stats.size, 0);
+    ASSERT_EQ(stats.bucket_count, 64);
+    ASSERT_EQ(stats.chain_length_histogram, std::vector<size_t>{64});
+    ASSERT_EQ(stats.max_chain_length, 0);
+    ASSERT_FLOAT_EQ(stats.empty_bucket_ratio, 1.0);
+    ASSERT_EQ(stats.node_bytes, 0);
+    ASSERT_GE(stats.bucket_array_bytes, 64 * sizeof(void*));
+    ASSERT_TRUE(stats.probe_counters_enabled);
+
+    // std::hash<int> is the identity, so keys 0..31 fill half of the buckets with one node each
+    for (int i = 0; i < 32; ++i) map.insert({i, i});
+    map.reset_probe_counters();
+    for (int i = 0; i < 32; ++i) ASSERT_TRUE(map.contains(i));
+    ASSERT_FALSE(map.contains(40));
+    stats = map.stats();
+    ASSERT_EQ((stats.chain_length_histogram), (std::vector<size_t>{32, 32}));
+    ASSERT_EQ(stats.max_chain_length, 1);
+    ASSERT_FLOAT_EQ(stats.empty_bucket_ratio, 0.5);
+    ASSERT_EQ(stats.node_bytes, 32 * stats.node_size);
+    ASSERT_EQ(stats.successful_lookups, 32);
+    ASSERT_FLOAT_EQ(stats.average_probes_successful, 1.0);
+    ASSERT_EQ(stats.unsuccessful_lookups, 1);
+    ASSERT_FLOAT_EQ(stats.average_probes_unsuccessful, 0.0);
+
+    // a constant hash puts everything into a single chain
+    auto bad_hash = [](const int&) { return size_t(7); };
+    HashMap<int, int, decltype(bad_hash)> bad(16, bad_hash);
+    for (int i = 0; i < 10; ++i) bad.insert({i, i});
+    bad.reset_probe_counters();
+    ASSERT_TRUE(bad.contains(0));           // the head of the chain
+    ASSERT_TRUE(bad.contains(9));           // the tail of the chain
+    ASSERT_FALSE(bad.contains(10));
+    auto bad_stats = bad.stats();
+    ASSERT_EQ(bad_stats.max_chain_length, 10);
+    ASSERT_EQ(bad_stats.chain_length_histogram.size(), 11);
+    ASSERT_EQ(bad_stats.chain_length_histogram[0], 15);
+    ASSERT_EQ(bad_stats.chain_length_histogram[10], 1);
+    ASSERT_FLOAT_EQ(bad_stats.average_probes_successful, 5.5);
+    ASSERT_FLOAT_EQ(bad_stats.average_probes_unsuccessful, 10.0);
+
+    // every bucket is counted exactly once in the middle of an incremental rehash
+    HashMap<int, int> growing;
+    growing.incremental_rehash(true);
+    size_t buckets = growing.bucket_count();
+    int next = 0;
+    while (growing.bucket_count() == buckets) {
+        growing.insert({next, next});
+        ++next;
+    }
+    stats = growing.stats();
+    size_t counted = 0, nodes = 0;
+    for (size_t length = 0; length < stats.chain_length_histogram.size(); ++length) {
+        counted += stats.chain_length_histogram[length];
+        nodes += length * stats.chain_length_histogram[length];
+    }
+    ASSERT_EQ(nodes, growing.size());
+    ASSERT_GE(counted, growing.bucket_count());
+}
+#endif
+
+/*
+* Checks that the Bloom filter answers almost every miss on its own: all the misses are counted
+* as unsuccessful lookups, and more than 99% of them are rejected by the filter.
+*/
+#if RUN_TEST_28C
+TEST(HashMapTest, TEST_28C_BLOOM_FILTER_COUNTERS) {
+    HashMap<int, int> map;
+    map.bloom_filter(true);
+    for (int i = 0; i < 20000; ++i) map.insert({i, -i});
+    ASSERT_TRUE(map.stats().probe_counters_enabled);
+
+    map.reset_probe_counters();
+    const int misses = 100000;
+    for (int i = 0; i < misses; ++i) ASSERT_FALSE(map.contains(1000000 + i));
+    auto stats = map.stats();
+    ASSERT_EQ(stats.unsuccessful_lookups, misses);
+    ASSERT_GT(stats.bloom_rejected_lookups, misses * 99 / 100);
+    ASSERT_EQ(stats.successful_lookups, 0);
+
+    // lookups that get past the filter are counted as probes, not as rejections
+    map.bloom_filter(false);
+    map.reset_probe_counters();
+    for (int i = 0; i < 100; ++i) ASSERT_FALSE(map.contains(1000000 + i));
+    stats = map.stats();
+    ASSERT_EQ(stats.unsuccessful_lookups, 100);
+    ASSERT_EQ(stats.bloom_rejected_lookups, 0);
+}
+#endif
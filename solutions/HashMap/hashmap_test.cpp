@@ -1,9 +1,24 @@
 #include <vector>
+#include <list>
 #include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <memory>
+#include <thread>
+#include <atomic>
 
 #include "test_settings.h"
 #include "gtest/gtest.h"
 #include "hashmap.h"
+#include "flat_hashmap.h"
+#include "robin_hood_hashmap.h"
+#include "concurrent_hashmap.h"
+#include "dense_hashmap.h"
+#include "frozen_hashmap.h"
+#include "static_hashmap.h"
+#include "small_hashmap.h"
+#include "hash_functions.h"
+#include "lru_cache.h"
 
 // ----------------------------------------------------------------------------------------------
 /* Type Alias and Common Test Utilities */
@@ -42,7 +57,7 @@ TEST(HashMapTest, TEST_1A_BASIC) {
     std::unordered_map<std::string, int> answer;
     HashMap<std::string, int> map;
     CHECK_MAP_EQUAL(map, answer);
-    ASSERT_EQ(map.bucket_count(), 10);
+    ASSERT_EQ(map.bucket_count(), 16);
 }
 #endif
 
@@ -54,14 +69,14 @@ TEST(HashMapTest, TEST_1B_INSERT) {
     std::unordered_map<std::string, int> answer;
     HashMap<std::string, int> map;
     CHECK_MAP_EQUAL(map, answer);
-    ASSERT_EQ(map.bucket_count(), 10);
+    ASSERT_EQ(map.bucket_count(), 16);
 
     for (const auto& kv_pair : vec) {
         answer.insert(kv_pair);
         map.insert(kv_pair);
         CHECK_MAP_EQUAL(map, answer);
     }
-    ASSERT_EQ(map.bucket_count(), 10);
+    ASSERT_EQ(map.bucket_count(), 16);
 }
 #endif
 
@@ -220,12 +235,14 @@ TEST(HashMapTest, TEST_1F_CUSTOM_BUCKET_COUNT) {
     CHECK_MAP_EQUAL(many_buckets, answer);
     CHECK_MAP_EQUAL(one_bucket, answer);
 
-    ASSERT_EQ(many_buckets.bucket_count(), 10000);
-    ASSERT_EQ(one_bucket.bucket_count(), 1);
+    // bucket counts are rounded up to a power of two, and grow to respect max_load_factor
+    ASSERT_EQ(many_buckets.bucket_count(), 16384);
+    ASSERT_EQ(one_bucket.bucket_count(), 128);
 
     float epsilon = 0.001;
-    ASSERT_LT(std::abs(many_buckets.load_factor() - 0.01), epsilon);
-    ASSERT_LT(std::abs(one_bucket.load_factor() - 100), epsilon);
+    ASSERT_LT(std::abs(many_buckets.load_factor() - 100.0 / 16384), epsilon);
+    ASSERT_LT(std::abs(one_bucket.load_factor() - 100.0 / 128), epsilon);
+    ASSERT_LE(one_bucket.load_factor(), one_bucket.max_load_factor());
 }
 #endif
 
@@ -308,12 +325,15 @@ TEST(HashMapTest, TEST_1I_REHASH_BASIC) {
     std::unordered_map<int, int> answer;
     std::vector<int> vals;
 
-    ASSERT_TRUE(map.bucket_count() == 10);
+    ASSERT_TRUE(map.bucket_count() == 16);
     for (size_t M1_Review_count : {10, 20, 20, 15, 1000, 100, 2, 1, 2, 1}) {
 
        map.rehash(M1_Review_count);
 
-       ASSERT_TRUE(map.bucket_count() == M1_Review_count);
+       // smallest power of two >= the requested count that keeps load_factor <= max_load_factor
+       size_t expected = 1;
+       while (expected < M1_Review_count || expected * map.max_load_factor() < map.size()) expected *= 2;
+       ASSERT_TRUE(map.bucket_count() == expected);
 
         for (size_t i = 0; i < 18; ++i) {
             CHECK_MAP_EQUAL(map, answer);
@@ -1787,3 +1807,2238 @@ TEST(HashMapTest, TEST_4H_MOVE_ASSIGN_TIME) {
     ASSERT_TRUE(3*big_time.count() > huge_time.count());
 }
 #endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: open-addressing FlatHashMap */
+
+/*
+* Verifies insert/erase/find of FlatHashMap against std::unordered_map while the table
+* grows from a single group, and while erases leave tombstones behind.
+*/
+#if RUN_TEST_6A
+TEST(FlatHashMapTest, TEST_6A_FLAT_BASIC) {
+    FlatHashMap<int, int> map;
+    std::unordered_map<int, int> answer;
+    ASSERT_EQ(map.bucket_count(), 16);
+    CHECK_MAP_EQUAL(map, answer);
+
+    for (int i = 0; i < 1000; ++i) {
+        auto [iter, added] = map.insert({i, -i});
+        answer.insert({i, -i});
+        ASSERT_TRUE(added);
+        ASSERT_EQ(iter->first, i);
+        ASSERT_FALSE(map.insert({i, i}).second);
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_LE(map.load_factor(), 0.875);
+
+    // erase every other key, then reinsert, so that tombstones get reused and purged
+    for (int round = 0; round < 5; ++round) {
+        for (int i = round % 2; i < 1000; i += 2) {
+            ASSERT_TRUE(map.erase(i));
+            answer.erase(i);
+            ASSERT_FALSE(map.contains(i));
+        }
+        CHECK_MAP_EQUAL(map, answer);
+        for (int i = round % 2; i < 1000; i += 2) {
+            map[i] = round;
+            answer[i] = round;
+        }
+        CHECK_MAP_EQUAL(map, answer);
+    }
+    ASSERT_FALSE(map.erase(-1));
+    ASSERT_TRUE(map.find(-1) == map.end());
+
+    map.clear();
+    answer.clear();
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_TRUE(map.begin() == map.end());
+
+    try {
+        map.at(3);
+        ASSERT_TRUE(false);
+    } catch (const std::out_of_range& e) {
+    }
+}
+#endif
+
+/*
+* Verifies iterators, erase by iterator, rehash and the special member functions of FlatHashMap.
+*/
+#if RUN_TEST_6B
+TEST(FlatHashMapTest, TEST_6B_FLAT_ITER_AND_SMF) {
+    FlatHashMap<std::string, int> map;
+    std::unordered_map<std::string, int> answer;
+    for (const auto& kv_pair : vec) {
+        map.insert(kv_pair);
+        answer.insert(kv_pair);
+    }
+
+    ASSERT_TRUE(std::is_permutation(map.begin(), map.end(), answer.begin(), answer.end()));
+    const auto& cmap = map;
+    FlatHashMap<std::string, int>::const_iterator c_iter = map.begin();
+    ASSERT_TRUE(c_iter == cmap.begin());
+    ASSERT_EQ(std::distance(cmap.begin(), cmap.end()), (long) answer.size());
+
+    map.rehash(1000);
+    ASSERT_EQ(map.bucket_count(), 1024);
+    CHECK_MAP_EQUAL(map, answer);
+    map.rehash(1);
+    ASSERT_EQ(map.bucket_count(), 16);
+    CHECK_MAP_EQUAL(map, answer);
+
+    FlatHashMap<std::string, int> copy = map;
+    ASSERT_TRUE(copy == map);
+    copy["Avery"] = 0;
+    ASSERT_TRUE(copy != map);
+
+    FlatHashMap<std::string, int> moved = std::move(copy);
+    ASSERT_TRUE(copy.empty());
+    ASSERT_EQ(moved.at("Avery"), 0);
+    copy = std::move(moved);
+    ASSERT_EQ(copy.at("Avery"), 0);
+
+    // erase everything through iterators
+    auto iter = map.begin();
+    while (iter != map.end()) {
+        answer.erase(iter->first);
+        iter = map.erase(iter);
+        CHECK_MAP_EQUAL(map, answer);
+    }
+    ASSERT_TRUE(map.empty());
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: RobinHoodHashMap */
+
+/*
+* Verifies RobinHoodHashMap against std::unordered_map through growth, backward-shift
+* deletion and reinsertion, and checks that the probe length histogram accounts for every element.
+*/
+#if RUN_TEST_7A
+TEST(RobinHoodHashMapTest, TEST_7A_ROBIN_HOOD_BASIC) {
+    RobinHoodHashMap<int, int> map;
+    std::unordered_map<int, int> answer;
+    CHECK_MAP_EQUAL(map, answer);
+
+    for (int i = 0; i < 2000; ++i) {
+        auto [iter, added] = map.insert({i * 7, i});
+        answer.insert({i * 7, i});
+        ASSERT_TRUE(added);
+        ASSERT_EQ(iter->first, i * 7);
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    for (int i = 0; i < 2000; ++i) {
+        ASSERT_FALSE(map.contains(i * 7 + 1));
+    }
+
+    auto histogram = map.probe_length_histogram();
+    size_t total = 0;
+    for (size_t count : histogram) total += count;
+    ASSERT_EQ(total, map.size());
+
+    for (int round = 0; round < 4; ++round) {
+        for (int i = round; i < 2000; i += 3) {
+            ASSERT_EQ(map.erase(i * 7), answer.erase(i * 7) == 1);
+        }
+        CHECK_MAP_EQUAL(map, answer);
+        for (int i = round; i < 2000; i += 5) {
+            map[i * 7] = -i;
+            answer[i * 7] = -i;
+        }
+        CHECK_MAP_EQUAL(map, answer);
+    }
+
+    map.rehash(1);
+    CHECK_MAP_EQUAL(map, answer);
+    map.clear();
+    answer.clear();
+    CHECK_MAP_EQUAL(map, answer);
+}
+#endif
+
+/*
+* Verifies iterators, erase by iterator and special member functions, and that a map with a
+* weak hash function (many identical hash values) still works.
+*/
+#if RUN_TEST_7B
+TEST(RobinHoodHashMapTest, TEST_7B_ROBIN_HOOD_ITER_AND_COLLISIONS) {
+    auto weak_hash = [](const int& key) { return key % 16; };
+    RobinHoodHashMap<int, int, decltype(weak_hash)> map(1, weak_hash);
+    std::unordered_map<int, int> answer;
+    for (int i = 0; i < 500; ++i) {
+        map.insert({i, i});
+        answer.insert({i, i});
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_TRUE(std::is_permutation(map.begin(), map.end(), answer.begin(), answer.end()));
+
+    auto copy = map;
+    ASSERT_TRUE(copy == map);
+    auto moved = std::move(copy);
+    ASSERT_TRUE(copy.empty());
+    ASSERT_TRUE(moved == map);
+
+    // erase the even keys through iterators, every odd key must still be visited exactly once
+    std::set<int> visited;
+    auto iter = map.begin();
+    while (iter != map.end()) {
+        if (iter->first % 2 == 0) {
+            answer.erase(iter->first);
+            iter = map.erase(iter);
+        } else {
+            ASSERT_TRUE(visited.insert(iter->first).second);
+            ++iter;
+        }
+    }
+    ASSERT_EQ(visited.size(), 250);
+    CHECK_MAP_EQUAL(map, answer);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: automatic growth and shrinking of HashMap */
+
+/*
+* Verifies that insert keeps load_factor <= max_load_factor with power-of-two bucket counts,
+* and that a positive min_load_factor shrinks the map after a mass erase.
+*/
+#if RUN_TEST_8A
+TEST(HashMapTest, TEST_8A_LOAD_FACTOR_POLICY) {
+    HashMap<int, int> map;
+    std::unordered_map<int, int> answer;
+    ASSERT_FLOAT_EQ(map.max_load_factor(), 1.0);
+    ASSERT_FLOAT_EQ(map.min_load_factor(), 0.0);
+
+    for (int i = 0; i < 5000; ++i) {
+        map.insert({i, i});
+        answer.insert({i, i});
+        ASSERT_LE(map.load_factor(), map.max_load_factor());
+        ASSERT_EQ(map.bucket_count() & (map.bucket_count() - 1), 0);
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_EQ(map.bucket_count(), 8192);
+
+    map.max_load_factor(0.25);
+    ASSERT_LE(map.load_factor(), 0.25);
+    ASSERT_EQ(map.bucket_count(), 32768);
+    CHECK_MAP_EQUAL(map, answer);
+
+    // without a minimum load factor, erasing never shrinks the map
+    map.max_load_factor(1.0);
+    for (int i = 0; i < 4000; ++i) {
+        map.erase(i);
+        answer.erase(i);
+    }
+    ASSERT_EQ(map.bucket_count(), 32768);
+    CHECK_MAP_EQUAL(map, answer);
+
+    map.min_load_factor(0.25);
+    for (int i = 4000; i < 4990; ++i) {
+        map.erase(i);
+        answer.erase(i);
+        ASSERT_TRUE(map.load_factor() >= 0.25 || map.bucket_count() == 16);
+    }
+    ASSERT_EQ(map.bucket_count(), 32);  // 10 elements left, shrunk to a load factor of about 1/2
+    CHECK_MAP_EQUAL(map, answer);
+
+    // erase(const_iterator) never shrinks, so erasing while iterating visits every element
+    for (int i = 0; i < 1000; ++i) map.insert({i, i});
+    size_t visited = 0;
+    for (auto iter = map.begin(); iter != map.end(); ++visited) {
+        iter = map.erase(iter);
+    }
+    ASSERT_EQ(visited, 1010);
+    ASSERT_TRUE(map.empty());
+
+    ASSERT_THROW(map.max_load_factor(0), std::out_of_range);
+    ASSERT_THROW(map.max_load_factor(0.4), std::out_of_range);
+    ASSERT_THROW(map.min_load_factor(-1), std::out_of_range);
+    ASSERT_THROW(map.min_load_factor(0.6), std::out_of_range);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: pooled node allocator */
+
+/*
+* Verifies that HashMap works with PoolAllocator: erased nodes are recycled, clear releases the
+* slabs, copies get a pool of their own, and non-trivial element types still work.
+*/
+#if RUN_TEST_9A
+TEST(HashMapTest, TEST_9A_POOL_ALLOCATOR) {
+    using PoolMap = HashMap<int, int, std::hash<int>, std::equal_to<int>, PoolAllocator<std::pair<const int, int>>>;
+    PoolMap map;
+    std::unordered_map<int, int> answer;
+    for (int i = 0; i < 10000; ++i) {
+        map.insert({i, i * 3});
+        answer.insert({i, i * 3});
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    const NodePool& pool = map.get_allocator().pool();
+    size_t reserved = pool.bytes_reserved();
+    ASSERT_GT(pool.slab_count(), 0);
+
+    // erase then insert the same number of elements, the nodes come from the free list
+    for (int i = 0; i < 5000; ++i) {
+        map.erase(i);
+        answer.erase(i);
+    }
+    for (int i = 10000; i < 15000; ++i) {
+        map.insert({i, i});
+        answer.insert({i, i});
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_EQ(pool.bytes_reserved(), reserved);
+
+    // copies use their own pool, and the original is left untouched by changes to the copy
+    PoolMap copy = map;
+    ASSERT_TRUE(copy == map);
+    ASSERT_TRUE(copy.get_allocator() != map.get_allocator());
+    copy.clear();
+    CHECK_MAP_EQUAL(map, answer);
+
+    // a move hands the pool over, and the moved-from map keeps working with a fresh one
+    PoolMap moved = std::move(map);
+    CHECK_MAP_EQUAL(moved, answer);
+    map.insert({-1, -1});
+    ASSERT_EQ(map.size(), 1);
+    ASSERT_TRUE(map.get_allocator() != moved.get_allocator());
+
+    // clear drops all slabs at once for trivially destructible elements
+    moved.clear();
+    ASSERT_TRUE(moved.empty());
+    ASSERT_EQ(moved.get_allocator().pool().slab_count(), 0);
+    for (int i = 0; i < 100; ++i) moved.insert({i, i});
+    ASSERT_EQ(moved.size(), 100);
+    ASSERT_EQ(moved.at(42), 42);
+
+    // elements with destructors are still destroyed one by one
+    HashMap<std::string, std::vector<int>, std::hash<std::string>, std::equal_to<std::string>,
+            PoolAllocator<std::pair<const std::string, std::vector<int>>>> strings;
+    for (int i = 0; i < 1000; ++i) {
+        strings[std::to_string(i)].push_back(i);
+    }
+    ASSERT_EQ(strings.size(), 1000);
+    ASSERT_EQ(strings.at("999").front(), 999);
+    strings.erase("999");
+    strings.clear();
+    ASSERT_TRUE(strings.empty());
+}
+#endif
+
+#if RUN_TEST_9B
+/*
+* A std::allocator that does not follow the map on move assignment, and only compares equal
+* to allocators with the same id, so that moving between maps with different ids cannot
+* steal the nodes.
+*/
+template <typename T>
+struct TaggedAllocator {
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::false_type;
+    using is_always_equal = std::false_type;
+
+    int id;
+
+    explicit TaggedAllocator(int id = 0) : id(id) {}
+    template <typename U>
+    TaggedAllocator(const TaggedAllocator<U>& other) : id(other.id) {}
+
+    T* allocate(size_t n) { return std::allocator<T>().allocate(n); }
+    void deallocate(T* ptr, size_t n) { std::allocator<T>().deallocate(ptr, n); }
+
+    template <typename U>
+    friend bool operator==(const TaggedAllocator<T>& lhs, const TaggedAllocator<U>& rhs) { return lhs.id == rhs.id; }
+    template <typename U>
+    friend bool operator!=(const TaggedAllocator<T>& lhs, const TaggedAllocator<U>& rhs) { return lhs.id != rhs.id; }
+};
+
+/*
+* Verifies that move assignment works with move-only mapped values, both when the nodes are
+* stolen and when an allocator that cannot free them forces an element-wise move.
+*/
+TEST(HashMapTest, TEST_9B_MOVE_ASSIGN_MOVE_ONLY) {
+    HashMap<int, std::unique_ptr<int>> a, b;
+    for (int i = 0; i < 100; ++i) b.insert({i, std::make_unique<int>(i)});
+    a = std::move(b);
+    ASSERT_EQ(a.size(), 100);
+    ASSERT_TRUE(b.empty());
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(*a.at(i), i);
+    }
+
+    using TaggedMap = HashMap<int, std::unique_ptr<int>, std::hash<int>, std::equal_to<int>,
+                              TaggedAllocator<std::pair<const int, std::unique_ptr<int>>>>;
+    using Tagged = TaggedAllocator<std::pair<const int, std::unique_ptr<int>>>;
+    TaggedMap c(16, std::hash<int>(), std::equal_to<int>(), Tagged(1));
+    TaggedMap d(16, std::hash<int>(), std::equal_to<int>(), Tagged(2));
+    for (int i = 0; i < 100; ++i) d.insert({i, std::make_unique<int>(i)});
+    c = std::move(d);
+    ASSERT_EQ(c.get_allocator().id, 1);
+    ASSERT_EQ(c.size(), 100);
+    ASSERT_TRUE(d.empty());
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(*c.at(i), i);
+    }
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: cached hash values in HashMap nodes */
+
+/*
+* Verifies that every public operation calls the hash function at most once, and that
+* growing, iterating and erasing through an iterator never call it.
+*/
+#if RUN_TEST_10A
+TEST(HashMapTest, TEST_10A_HASH_COMPUTED_ONCE) {
+    static size_t hash_calls = 0;
+    struct CountingHash {
+        size_t operator()(const std::string& key) const {
+            ++hash_calls;
+            return std::hash<std::string>()(key);
+        }
+    };
+
+    HashMap<std::string, int, CountingHash> map;
+    std::unordered_map<std::string, int> answer;
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({std::to_string(i), i});
+        answer.insert({std::to_string(i), i});
+    }
+    ASSERT_EQ(hash_calls, 1000);    // including the rehashes while growing from 16 buckets
+    CHECK_MAP_EQUAL(map, answer);
+
+    hash_calls = 0;
+    map.rehash(4096);
+    for (const auto& [key, value] : map) {
+        ASSERT_EQ(std::stoi(key), value);
+    }
+    ASSERT_EQ(hash_calls, 0);
+
+    ASSERT_TRUE(map.contains("42"));
+    ASSERT_EQ(map.at("42"), 42);
+    ASSERT_NE(map.find("43"), map.end());
+    ASSERT_TRUE(map.erase("44"));
+    answer.erase("44");
+    ASSERT_FALSE(map.insert({"45", 0}).second);
+    map["1000"] = 1000;
+    answer["1000"] = 1000;
+    ASSERT_EQ(hash_calls, 6);
+
+    hash_calls = 0;
+    for (auto iter = map.begin(); iter != map.end();) {
+        if (iter->second % 2 == 0) {
+            answer.erase(iter->first);
+            iter = map.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    ASSERT_EQ(hash_calls, 0);
+    CHECK_MAP_EQUAL(map, answer);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: heterogeneous lookup */
+
+/*
+* Verifies that a map with transparent hash and key equality functions can be searched
+* with std::string_view and const char* keys, and that erase(iterator) is unaffected.
+*/
+#if RUN_TEST_11A
+TEST(HashMapTest, TEST_11A_TRANSPARENT_LOOKUP) {
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view str) const { return std::hash<std::string_view>()(str); }
+    };
+    HashMap<std::string, int, StringHash, std::equal_to<>> map;
+    std::unordered_map<std::string, int> answer;
+    for (int i = 0; i < 100; ++i) {
+        map.insert({"key" + std::to_string(i), i});
+        answer.insert({"key" + std::to_string(i), i});
+    }
+
+    // keys arrive as slices of one buffer, none of them is copied into a std::string
+    std::string buffer = "key7|key42|key99|key100|nokey";
+    std::string_view view(buffer);
+    std::string_view key7 = view.substr(0, 4), key42 = view.substr(5, 5), key99 = view.substr(11, 5);
+    std::string_view key100 = view.substr(17, 6), nokey = view.substr(24);
+
+    ASSERT_TRUE(map.contains(key7));
+    ASSERT_FALSE(map.contains(key100));
+    ASSERT_EQ(map.count(key42), 1);
+    ASSERT_EQ(map.count(nokey), 0);
+    ASSERT_EQ(map.at(key99), 99);
+    ASSERT_THROW(map.at(key100), std::out_of_range);
+    ASSERT_EQ(map.find(key42)->second, 42);
+    ASSERT_EQ(map.find(nokey), map.end());
+    ASSERT_EQ(map.at("key3"), 3);
+    ASSERT_EQ(map.count(std::string("key4")), 1);
+
+    const auto& cmap = map;
+    ASSERT_EQ(cmap.at(key7), 7);
+    ASSERT_EQ(cmap.find(key7)->first, "key7");
+
+    ASSERT_TRUE(map.erase(key42));
+    ASSERT_FALSE(map.erase(key42));
+    answer.erase("key42");
+    CHECK_MAP_EQUAL(map, answer);
+
+    // erase(iterator) must still pick the const_iterator overload
+    auto iter = map.find(key7);
+    map.erase(iter);
+    answer.erase("key7");
+    CHECK_MAP_EQUAL(map, answer);
+
+    // the non-transparent default map keeps its K-only overloads
+    HashMap<std::string, int> plain{{"a", 1}};
+    ASSERT_EQ(plain.count("a"), 1);
+    ASSERT_EQ(plain.count("b"), 0);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: emplace, try_emplace, insert_or_assign, update */
+
+/*
+* Verifies the in-place insertion functions, in particular that try_emplace, operator[] and
+* update never construct a mapped value for a key that already exists.
+*/
+#if RUN_TEST_12A
+TEST(HashMapTest, TEST_12A_EMPLACE_AND_UPDATE) {
+    static int constructions = 0;
+    struct Counted {
+        Counted() : value(0) { ++constructions; }
+        Counted(int value) : value(value) { ++constructions; }
+        Counted(const Counted& other) : value(other.value) { ++constructions; }
+        Counted& operator=(const Counted& other) = default;
+        int value;
+    };
+
+    HashMap<std::string, Counted> map;
+    auto [iter1, inserted1] = map.try_emplace("a", 1);
+    ASSERT_TRUE(inserted1);
+    ASSERT_EQ(iter1->second.value, 1);
+    ASSERT_EQ(constructions, 1);
+    auto [iter2, inserted2] = map.try_emplace("a", 2);
+    ASSERT_FALSE(inserted2);
+    ASSERT_EQ(iter2, iter1);
+    ASSERT_EQ(map.at("a").value, 1);
+    ASSERT_EQ(constructions, 1);
+
+    map["a"].value = 5;
+    ASSERT_EQ(constructions, 1);
+    map["b"];
+    ASSERT_EQ(constructions, 2);
+    ASSERT_EQ(map.at("b").value, 0);
+
+    ASSERT_FALSE(map.update("a", [](Counted& c) { c.value *= 2; }));
+    ASSERT_EQ(map.at("a").value, 10);
+    ASSERT_EQ(constructions, 2);
+    ASSERT_TRUE(map.update("c", [](Counted& c) { c.value += 7; }));
+    ASSERT_EQ(map.at("c").value, 7);
+    ASSERT_EQ(constructions, 3);
+
+    auto [iter3, inserted3] = map.insert_or_assign("a", Counted(-1));
+    ASSERT_FALSE(inserted3);
+    ASSERT_EQ(iter3->second.value, -1);
+    ASSERT_TRUE(map.insert_or_assign(std::string("d"), 4).second);
+    ASSERT_EQ(map.at("d").value, 4);
+
+    ASSERT_TRUE(map.emplace("e", 8).second);
+    ASSERT_FALSE(map.emplace("e", 9).second);
+    ASSERT_EQ(map.at("e").value, 8);
+    ASSERT_TRUE(map.emplace(std::piecewise_construct, std::forward_as_tuple("f"), std::forward_as_tuple(6)).second);
+    ASSERT_EQ(map.at("f").value, 6);
+    ASSERT_EQ(map.size(), 6);
+
+    // move-only mapped values work with the rvalue insert, try_emplace and insert_or_assign
+    HashMap<int, std::unique_ptr<int>> owners;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(owners.insert({i, std::make_unique<int>(i)}).second);
+    }
+    auto ptr = std::make_unique<int>(-1);
+    ASSERT_FALSE(owners.try_emplace(5, std::move(ptr)).second);
+    ASSERT_NE(ptr, nullptr);                // not moved from on a duplicate key
+    ASSERT_TRUE(owners.try_emplace(100, std::move(ptr)).second);
+    ASSERT_EQ(*owners.at(100), -1);
+    owners.insert_or_assign(5, std::make_unique<int>(50));
+    ASSERT_EQ(*owners.at(5), 50);
+    for (int i = 0; i < 100; ++i) {
+        if (i != 5) { ASSERT_EQ(*owners.at(i), i); }
+    }
+
+    // counter update loop
+    HashMap<std::string, std::vector<int>> groups;
+    std::unordered_map<std::string, std::vector<int>> answer;
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = std::to_string(i % 37);
+        groups.update(key, [i](std::vector<int>& v) { v.push_back(i); });
+        answer[key].push_back(i);
+    }
+    ASSERT_EQ(groups.size(), answer.size());
+    for (const auto& [key, values] : answer) {
+        ASSERT_TRUE(groups.at(key) == values);
+    }
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: batched lookups */
+
+/*
+* Verifies that find_many and contains_many give the same answers as find and contains,
+* for batches that are not a multiple of the internal group size, and for const maps.
+*/
+#if RUN_TEST_13A
+TEST(HashMapTest, TEST_13A_FIND_MANY) {
+    HashMap<int, int> map;
+    for (int i = 0; i < 5000; ++i) {
+        map.insert({2 * i, i});
+    }
+    std::vector<int> keys;
+    for (int i = 0; i < 1001; ++i) {
+        keys.push_back((i * 7919) % 10007);     // a mix of hits (even) and misses (odd)
+    }
+
+    std::vector<HashMap<int, int>::iterator> results(keys.size());
+    auto end = map.find_many(keys.data(), keys.data() + keys.size(), results.begin());
+    ASSERT_EQ(end, results.end());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQ(results[i], map.find(keys[i]));
+        if (results[i] != map.end()) results[i]->second = -1;
+    }
+    for (int key : keys) {
+        if (map.contains(key)) { ASSERT_EQ(map.at(key), -1); }
+    }
+
+    const auto& cmap = map;
+    std::vector<HashMap<int, int>::const_iterator> const_results;
+    cmap.find_many(keys.begin(), keys.end(), std::back_inserter(const_results));
+    ASSERT_EQ(const_results.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQ(const_results[i], cmap.find(keys[i]));
+    }
+
+    std::vector<bool> found;
+    cmap.contains_many(keys.begin(), keys.end(), std::back_inserter(found));
+    ASSERT_EQ(found.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQ(found[i], keys[i] % 2 == 0 && keys[i] < 10000);
+    }
+
+    // empty batch
+    ASSERT_EQ(map.contains_many(keys.begin(), keys.begin(), found.begin()), found.begin());
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: ConcurrentHashMap */
+
+/*
+* Verifies the single-threaded semantics of ConcurrentHashMap, including growth from the
+* minimal table through many resizes.
+*/
+#if RUN_TEST_14A
+TEST(ConcurrentHashMapTest, TEST_14A_CONCURRENT_BASIC) {
+    ConcurrentHashMap<int, int> map;
+    std::unordered_map<int, int> answer;
+    ASSERT_TRUE(map.empty());
+    size_t initial_buckets = map.bucket_count();
+    for (int i = 0; i < 20000; ++i) {
+        ASSERT_TRUE(map.insert({i, i}));
+        answer.insert({i, i});
+    }
+    ASSERT_FALSE(map.insert({5, 50}));
+    ASSERT_EQ(map.size(), 20000);
+    ASSERT_GT(map.bucket_count(), initial_buckets);
+    for (int i = 0; i < 20000; ++i) {
+        ASSERT_TRUE(map.contains(i));
+        ASSERT_EQ(map.find(i).value(), i);
+    }
+    ASSERT_FALSE(map.contains(20000));
+    ASSERT_FALSE(map.find(-1).has_value());
+
+    for (int i = 0; i < 20000; i += 2) {
+        ASSERT_TRUE(map.erase(i));
+    }
+    ASSERT_FALSE(map.erase(0));
+    ASSERT_EQ(map.size(), 10000);
+
+    ASSERT_FALSE(map.insert_or_assign(1, 100));
+    ASSERT_TRUE(map.insert_or_assign(2, 200));
+    ASSERT_EQ(map.find(1).value(), 100);
+    ASSERT_EQ(map.find(2).value(), 200);
+    ASSERT_FALSE(map.update(3, [](int& value) { value += 1000; }));
+    ASSERT_TRUE(map.update(4, [](int& value) { value += 1000; }));
+    ASSERT_EQ(map.find(3).value(), 1003);
+    ASSERT_EQ(map.find(4).value(), 1000);
+
+    ConcurrentHashMap<std::string, std::string> strings(1000);
+    strings.insert({"Avery", "CS106L"});
+    ASSERT_EQ(strings.find("Avery").value(), "CS106L");
+    ASSERT_THROW(strings.max_load_factor(0), std::out_of_range);
+}
+#endif
+
+/*
+* Runs writers and lock-free readers at the same time, across several resizes, and checks that
+* readers only ever see consistent values and that no update is lost.
+*/
+#if RUN_TEST_14B
+TEST(ConcurrentHashMapTest, TEST_14B_CONCURRENT_STRESS) {
+    ConcurrentHashMap<int, int> map;
+    const int kWriters = 4, kPerWriter = 20000;
+    std::atomic<bool> done{false};
+    std::atomic<int> inconsistent{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&, r] {
+            int key = r;
+            while (!done.load()) {
+                auto value = map.find(key);
+                if (value.has_value() && *value != 3 * key) inconsistent++;
+                key = (key + 7919) % (kWriters * kPerWriter);
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; ++w) {
+        writers.emplace_back([&, w] {
+            for (int i = w * kPerWriter; i < (w + 1) * kPerWriter; ++i) {
+                map.insert({i, 3 * i});
+            }
+            for (int i = w * kPerWriter; i < (w + 1) * kPerWriter; i += 3) {
+                map.erase(i);
+            }
+            for (int i = 0; i < 10000; ++i) {
+                map.update(-1, [](int& value) { ++value; });     // one contended counter
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    done = true;
+    for (auto& reader : readers) reader.join();
+
+    ASSERT_EQ(inconsistent.load(), 0);
+    ASSERT_EQ(map.find(-1).value(), kWriters * 10000);
+    size_t expected = 1;
+    for (int i = 0; i < kWriters * kPerWriter; ++i) {
+        bool erased = (i % kPerWriter) % 3 == 0;
+        ASSERT_EQ(map.contains(i), !erased);
+        if (!erased) ++expected;
+    }
+    ASSERT_EQ(map.size(), expected);
+}
+#endif
+
+/*
+* Verifies that the tables replaced by a resize are freed once the migration is over and no
+* guard can see them anymore, rather than when the map is destroyed: after many resizes, the
+* only mapped values alive are the ones in the map.
+*/
+#if RUN_TEST_14C
+TEST(ConcurrentHashMapTest, TEST_14C_CONCURRENT_OLD_TABLES_FREED) {
+    static long live = 0;
+    struct Counted {
+        Counted() : value(0) { ++live; }
+        Counted(int value) : value(value) { ++live; }
+        Counted(const Counted& other) : value(other.value) { ++live; }
+        ~Counted() { --live; }
+        int value;
+    };
+
+    {
+        ConcurrentHashMap<int, Counted> map;
+        const int kElems = 100000;
+        for (int i = 0; i < kElems; ++i) {
+            ASSERT_TRUE(map.insert({i, Counted(i)}));
+        }
+        // every writer migrates a stripe, then frees the tables nobody can see anymore
+        for (size_t i = 0; i < 2 * ConcurrentHashMap<int, Counted>::kStripes; ++i) {
+            ASSERT_FALSE(map.erase(-1));
+        }
+        ASSERT_EQ(map.size(), static_cast<size_t>(kElems));
+        ASSERT_EQ(live, kElems);
+        ASSERT_EQ(map.find(kElems / 2).value().value, kElems / 2);
+    }
+    ASSERT_EQ(live, 0);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: incremental rehash */
+
+/*
+* Verifies that an incrementally rehashing map behaves exactly like a std::unordered_map
+* while the old and new bucket arrays are both in use: lookups, erases, iteration
+* (which has to cover both arrays), and erasing while iterating.
+*/
+#if RUN_TEST_15A
+TEST(HashMapTest, TEST_15A_INCREMENTAL_REHASH) {
+    HashMap<int, int> map;
+    std::unordered_map<int, int> answer;
+    map.incremental_rehash(true);
+    ASSERT_TRUE(map.incremental_rehash());
+
+    for (int i = 0; i < 3000; ++i) {
+        map.insert({i, i * i});
+        answer.insert({i, i * i});
+        if (i % 7 == 0) {
+            ASSERT_TRUE(map.erase(i / 2) == (answer.erase(i / 2) == 1));
+        }
+        if (i % 97 == 0) {
+            // check the whole map, wherever the migration stands
+            CHECK_MAP_EQUAL(map, answer);
+            const auto& cmap = map;
+            for (const auto& [key, value] : answer) {
+                ASSERT_EQ(cmap.find(key)->second, value);
+            }
+        }
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_LE(map.load_factor(), map.max_load_factor());
+
+    // stop right after a grow, so that most of the elements are still in the old array
+    size_t buckets = map.bucket_count();
+    int next = 3000;
+    while (map.bucket_count() == buckets) {
+        map.insert({next, next});
+        answer.insert({next, next});
+        ++next;
+    }
+    size_t visited = 0;
+    for (auto iter = map.begin(); iter != map.end(); ++iter) {
+        ASSERT_EQ(answer.at(iter->first), iter->second);
+        ++visited;
+    }
+    ASSERT_EQ(visited, answer.size());
+    auto iter = map.begin();
+    ASSERT_EQ(map.find(iter->first), iter);
+
+    // erase every odd key while iterating over both arrays
+    for (auto iter = map.begin(); iter != map.end();) {
+        if (iter->first % 2 != 0) {
+            answer.erase(iter->first);
+            iter = map.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    CHECK_MAP_EQUAL(map, answer);
+
+    // turning the mode off finishes the migration, and the map stays the same
+    map.incremental_rehash(false);
+    CHECK_MAP_EQUAL(map, answer);
+    map.rehash(1);
+    CHECK_MAP_EQUAL(map, answer);
+
+    // moves and copies carry a migration in progress along
+    map.incremental_rehash(true);
+    while (map.bucket_count() == buckets * 2) {
+        map.insert({next, next});
+        answer.insert({next, next});
+        ++next;
+    }
+    HashMap<int, int> copy = map;
+    CHECK_MAP_EQUAL(copy, answer);
+    HashMap<int, int> moved = std::move(map);
+    CHECK_MAP_EQUAL(moved, answer);
+    moved.clear();
+    ASSERT_TRUE(moved.empty());
+    ASSERT_EQ(moved.begin(), moved.end());
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: parallel rehash */
+
+/*
+* Verifies that rehash(new_buckets, threads) gives the same map as the serial rehash, for
+* growing, shrinking and same-size rehashes and for thread counts that do not divide the
+* number of buckets evenly.
+*/
+#if RUN_TEST_16A
+TEST(HashMapTest, TEST_16A_PARALLEL_REHASH) {
+    HashMap<int, int> map;
+    std::unordered_map<int, int> answer;
+    for (int i = 0; i < 20000; ++i) {
+        map.insert({i * 31, i});
+        answer.insert({i * 31, i});
+    }
+
+    for (size_t threads : {1, 2, 3, 4, 7, 16}) {
+        map.rehash(map.bucket_count() * 4, threads);
+        CHECK_MAP_EQUAL(map, answer);
+        map.rehash(map.bucket_count() / 8, threads);
+        CHECK_MAP_EQUAL(map, answer);
+        map.rehash(map.bucket_count(), threads);
+        CHECK_MAP_EQUAL(map, answer);
+    }
+    // never shrinks below the maximum load factor, like rehash(new_buckets)
+    map.rehash(1, 4);
+    ASSERT_LE(map.load_factor(), map.max_load_factor());
+    CHECK_MAP_EQUAL(map, answer);
+
+    // 0 threads means one per hardware thread, and tiny maps fall back to a single thread
+    map.rehash(1 << 16, 0);
+    ASSERT_EQ(map.bucket_count(), 1 << 16);
+    CHECK_MAP_EQUAL(map, answer);
+    HashMap<int, int> small{{1, 1}, {2, 2}};
+    small.rehash(64, 8);
+    ASSERT_EQ(small.bucket_count(), 64);
+    ASSERT_EQ(small.at(2), 2);
+
+    // a map in the middle of an incremental rehash is migrated first
+    map.incremental_rehash(true);
+    size_t buckets = map.bucket_count();
+    for (int i = 0; map.bucket_count() == buckets; ++i) {
+        map.insert({-i - 1, i});
+        answer.insert({-i - 1, i});
+    }
+    map.rehash(buckets * 4, 4);
+    CHECK_MAP_EQUAL(map, answer);
+    size_t visited = 0;
+    for (const auto& kv_pair : map) {
+        ASSERT_EQ(answer.at(kv_pair.first), kv_pair.second);
+        ++visited;
+    }
+    ASSERT_EQ(visited, answer.size());
+
+    ASSERT_THROW(map.rehash(0, 4), std::out_of_range);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: bulk construction */
+
+/*
+* Verifies the bulk-build path of the range constructor (random-access iterators): duplicate
+* keys keep their first value like insert, bucket_count honors both the request and the
+* maximum load factor, and the result matches element-by-element insertion. The large range is
+* big enough to be built on several threads on a multi-core machine.
+*/
+#if RUN_TEST_17A
+TEST(HashMapTest, TEST_17A_BULK_BUILD) {
+    std::vector<std::pair<int, int>> rows;
+    std::unordered_map<int, int> answer;
+    for (int i = 0; i < 300000; ++i) {
+        // 7919 is prime to 200000, so i and i + 200000 are the only rows that share a key:
+        // the keys of rows 0..99999 appear twice, the other 100000 keys once
+        int key = static_cast<int>((int64_t(i) * 7919) % 200000);
+        rows.push_back({key, i});
+        answer.insert({key, i});
+    }
+
+    HashMap<int, int> map(rows.begin(), rows.end());
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_LE(map.load_factor(), map.max_load_factor());
+    size_t visited = 0;
+    for (const auto& [key, value] : map) {
+        ASSERT_EQ(answer.at(key), value);
+        ++visited;
+    }
+    ASSERT_EQ(visited, answer.size());
+
+    // input iterators still go through insert, with the same result
+    std::list<std::pair<int, int>> list_rows(rows.begin(), rows.begin() + 1000);
+    HashMap<int, int> from_list(list_rows.begin(), list_rows.end());
+    HashMap<int, int> from_vector(rows.begin(), rows.begin() + 1000, 4096);
+    ASSERT_EQ(from_list, from_vector);
+    ASSERT_EQ(from_vector.bucket_count(), 4096);
+
+    HashMap<std::string, int> strings{{"A", 1}, {"B", 2}, {"A", 3}};
+    ASSERT_EQ(strings.size(), 2);
+    ASSERT_EQ(strings.at("A"), 1);
+
+    HashMap<int, int> empty(rows.begin(), rows.begin());
+    ASSERT_TRUE(empty.empty());
+    ASSERT_EQ(empty.begin(), empty.end());
+    empty.insert({1, 1});
+    ASSERT_EQ(empty.at(1), 1);
+
+    // the map keeps working normally afterwards
+    for (int i = 0; i < 1000; ++i) map.erase(i);
+    ASSERT_EQ(map.size(), answer.size() - 1000);
+    map.insert({-1, -1});
+    ASSERT_EQ(map.at(-1), -1);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: occupancy bitmap */
+
+/*
+* Verifies that iteration, which skips empty buckets with the occupancy bitmap, still visits
+* every element exactly once: in a very sparse map, after erasing the first bucket over and
+* over, after a mass erase, and across rehashes, clear and moves.
+*/
+#if RUN_TEST_18A
+TEST(HashMapTest, TEST_18A_OCCUPANCY_BITMAP) {
+    auto check_iteration = [](const HashMap<int, int>& map, const std::unordered_map<int, int>& answer) {
+        size_t visited = 0;
+        for (const auto& [key, value] : map) {
+            ASSERT_EQ(answer.at(key), value);
+            ++visited;
+        }
+        ASSERT_EQ(visited, answer.size());
+    };
+
+    HashMap<int, int> map(1 << 20);
+    std::unordered_map<int, int> answer;
+    ASSERT_EQ(map.begin(), map.end());
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({i * 977, i});
+        answer.insert({i * 977, i});
+    }
+    check_iteration(map, answer);
+
+    // erasing from the front moves begin() along
+    for (int i = 0; i < 300; ++i) {
+        int first = map.begin()->first;
+        map.erase(map.begin());
+        answer.erase(first);
+        ASSERT_EQ(map.size(), answer.size());
+        if (i % 50 == 0) check_iteration(map, answer);
+    }
+    check_iteration(map, answer);
+
+    // buckets 63, 64 and the last one sit on the edges of bitmap words
+    HashMap<int, int> edges(128);
+    std::unordered_map<int, int> edge_answer;
+    for (int key : {63, 64, 127, 0}) {
+        edges.insert({key, key});
+        edge_answer.insert({key, key});
+    }
+    check_iteration(edges, edge_answer);
+    edges.erase(0);
+    edges.erase(64);
+    edge_answer.erase(0);
+    edge_answer.erase(64);
+    check_iteration(edges, edge_answer);
+    ASSERT_EQ(edges.begin()->first, 63);
+
+    // mass erase, then reinsertion in front of begin()
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 10 != 0) {
+            map.erase(i * 977);
+            answer.erase(i * 977);
+        }
+    }
+    check_iteration(map, answer);
+    map.insert({0, -1});
+    answer.insert({0, -1});
+    check_iteration(map, answer);
+
+    map.rehash(64, 2);
+    check_iteration(map, answer);
+    map.rehash(1 << 16);
+    check_iteration(map, answer);
+    HashMap<int, int> moved = std::move(map);
+    check_iteration(moved, answer);
+    check_iteration(map, {});
+    map = std::move(moved);
+    check_iteration(map, answer);
+    map.clear();
+    ASSERT_EQ(map.begin(), map.end());
+    map.insert({5, 5});
+    check_iteration(map, {{5, 5}});
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: DenseHashMap */
+
+/*
+* Verifies insert/erase/find of DenseHashMap against std::unordered_map through growth,
+* swap-and-pop erases and backward-shift deletion, and that iteration follows insertion order
+* until the first erase.
+*/
+#if RUN_TEST_19A
+TEST(DenseHashMapTest, TEST_19A_DENSE_BASIC) {
+    DenseHashMap<int, int> map;
+    std::unordered_map<int, int> answer;
+    ASSERT_EQ(map.bucket_count(), 16);
+    CHECK_MAP_EQUAL(map, answer);
+
+    for (int i = 0; i < 1000; ++i) {
+        auto [iter, added] = map.insert({i, -i});
+        answer.insert({i, -i});
+        ASSERT_TRUE(added);
+        ASSERT_EQ(iter->first, i);
+        ASSERT_FALSE(map.insert({i, i}).second);
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_LE(map.load_factor(), 0.75);
+    int expected = 0;
+    for (const auto& [key, value] : map) {
+        ASSERT_EQ(key, expected++);
+    }
+
+    // erase every other key, then reinsert
+    for (int round = 0; round < 5; ++round) {
+        for (int i = round % 2; i < 1000; i += 2) {
+            ASSERT_TRUE(map.erase(i));
+            answer.erase(i);
+            ASSERT_FALSE(map.contains(i));
+        }
+        CHECK_MAP_EQUAL(map, answer);
+        ASSERT_EQ(std::distance(map.begin(), map.end()), (long) answer.size());
+        for (int i = round % 2; i < 1000; i += 2) {
+            map[i] = round;
+            answer[i] = round;
+        }
+        CHECK_MAP_EQUAL(map, answer);
+    }
+    ASSERT_FALSE(map.erase(-1));
+    ASSERT_TRUE(map.find(-1) == map.end());
+
+    // swap-and-pop moves the last element into the hole
+    DenseHashMap<int, int> small{{1, 1}, {2, 2}, {3, 3}};
+    small.erase(1);
+    ASSERT_EQ(small.begin()->first, 3);
+    ASSERT_EQ((small.begin() + 1)->first, 2);
+
+    // keys that all hash to the same value exercise long probe runs and backward shifts
+    auto weak_hash = [](const int& key) { return static_cast<size_t>(key % 3); };
+    DenseHashMap<int, int, decltype(weak_hash)> collisions(16, weak_hash);
+    std::unordered_map<int, int> collision_answer;
+    for (int i = 0; i < 300; ++i) {
+        collisions.insert({i, i});
+        collision_answer.insert({i, i});
+    }
+    for (int i = 0; i < 300; i += 3) {
+        ASSERT_TRUE(collisions.erase(i));
+        collision_answer.erase(i);
+    }
+    CHECK_MAP_EQUAL(collisions, collision_answer);
+
+    map.clear();
+    answer.clear();
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_TRUE(map.begin() == map.end());
+
+    try {
+        map.at(3);
+        ASSERT_TRUE(false);
+    } catch (const std::out_of_range& e) {
+    }
+}
+#endif
+
+/*
+* Verifies iterators, erase by iterator, rehash and the special member functions of DenseHashMap.
+*/
+#if RUN_TEST_19B
+TEST(DenseHashMapTest, TEST_19B_DENSE_ITER_AND_SMF) {
+    DenseHashMap<std::string, int> map;
+    std::unordered_map<std::string, int> answer;
+    for (const auto& kv_pair : vec) {
+        map.insert(kv_pair);
+        answer.insert(kv_pair);
+    }
+
+    ASSERT_TRUE(std::is_permutation(map.begin(), map.end(), answer.begin(), answer.end()));
+    const auto& cmap = map;
+    DenseHashMap<std::string, int>::const_iterator c_iter = map.begin();
+    ASSERT_TRUE(c_iter == cmap.begin());
+    ASSERT_EQ(std::distance(cmap.begin(), cmap.end()), (long) answer.size());
+
+    map.rehash(1000);
+    ASSERT_EQ(map.bucket_count(), 1024);
+    CHECK_MAP_EQUAL(map, answer);
+    map.rehash(1);
+    ASSERT_EQ(map.bucket_count(), 16);
+    CHECK_MAP_EQUAL(map, answer);
+
+    DenseHashMap<std::string, int> copy = map;
+    ASSERT_TRUE(copy == map);
+    copy["Avery"] = 0;
+    ASSERT_TRUE(copy != map);
+
+    DenseHashMap<std::string, int> moved = std::move(copy);
+    ASSERT_TRUE(copy.empty());
+    ASSERT_EQ(moved.at("Avery"), 0);
+    copy = std::move(moved);
+    ASSERT_EQ(copy.at("Avery"), 0);
+    moved.insert({"Avery", 1});
+    ASSERT_EQ(moved.at("Avery"), 1);
+
+    // erase everything through iterators
+    auto iter = map.begin();
+    while (iter != map.end()) {
+        answer.erase(iter->first);
+        iter = map.erase(iter);
+        CHECK_MAP_EQUAL(map, answer);
+    }
+    ASSERT_TRUE(map.empty());
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: binary snapshots (save / load) */
+
+/*
+* Verifies that a byte copy snapshot restores the elements, the bucket count and the iteration
+* order, also when taken in the middle of an incremental rehash or from a denser map, and that
+* snapshots of other types, truncated or missing files and a different hash function are
+* rejected without changing the receiving map.
+*/
+#if RUN_TEST_21A
+TEST(HashMapTest, TEST_21A_SAVE_LOAD) {
+    std::string path = ::testing::TempDir() + "hashmap_test_21a.bin";
+    HashMap<int, double> map;
+    for (int i = 0; i < 1000; ++i) map.insert({i * 7, i / 2.0});
+    for (int i = 0; i < 1000; i += 3) map.erase(i * 7);
+    map.save(path);
+
+    // load replaces the contents, and restores the bucket count and the iteration order
+    HashMap<int, double> loaded{{-1, -1.0}, {-2, -2.0}};
+    loaded.load(path);
+    CHECK_MAP_EQUAL(loaded, map);
+    ASSERT_EQ(loaded.bucket_count(), map.bucket_count());
+    ASSERT_TRUE(std::equal(map.begin(), map.end(), loaded.begin(), loaded.end()));
+    ASSERT_FALSE(loaded.contains(-1));
+    loaded.insert({-1, -1.0});
+    ASSERT_EQ(loaded.size(), map.size() + 1);
+
+    // a snapshot taken in the middle of an incremental rehash
+    HashMap<int, double> growing;
+    growing.incremental_rehash(true);
+    size_t buckets = growing.bucket_count();
+    for (int i = 0; growing.bucket_count() == buckets; ++i) growing.insert({i, i * 1.5});
+    growing.save(path);
+    loaded.load(path);
+    CHECK_MAP_EQUAL(loaded, growing);
+
+    // a snapshot of a denser map is spread out to the max_load_factor of the receiving map
+    HashMap<int, double> dense(16);
+    dense.max_load_factor(4);
+    for (int i = 0; i < 64; ++i) dense.insert({i, i * 0.5});
+    ASSERT_EQ(dense.bucket_count(), 16);
+    dense.save(path);
+    loaded.load(path);
+    CHECK_MAP_EQUAL(loaded, dense);
+    ASSERT_LE(loaded.load_factor(), loaded.max_load_factor());
+
+    HashMap<int, double> empty;
+    empty.save(path);
+    loaded.load(path);
+    ASSERT_TRUE(loaded.empty());
+
+    // a snapshot of other types, a truncated file and a missing file are rejected,
+    // and leave the map unchanged
+    map.save(path);
+    HashMap<int, int> other{{1, 1}};
+    ASSERT_THROW(other.load(path), std::runtime_error);
+    ASSERT_EQ(other.size(), 1);
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size() - 5);
+    }
+    ASSERT_THROW(loaded.load(path), std::runtime_error);
+    ASSERT_TRUE(loaded.empty());
+    ASSERT_THROW(loaded.load(path + ".missing"), std::runtime_error);
+
+    // the stored hashes are checked against the hash function of the loading map
+    auto shifted_hash = [](const int& key) { return std::hash<int>()(key) + 1; };
+    HashMap<int, double, decltype(shifted_hash)> shifted(16, shifted_hash);
+    map.save(path);
+    ASSERT_THROW(shifted.load(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+#endif
+
+#if RUN_TEST_21B
+/*
+* Serializer for the snapshots of the tests: the string's length, then its characters, then the int.
+*/
+struct StringIntSerializer {
+    void write(std::ostream& out, const std::pair<const std::string, int>& value) const {
+        size_t length = value.first.size();
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(value.first.data(), length);
+        out.write(reinterpret_cast<const char*>(&value.second), sizeof(value.second));
+    }
+    std::pair<std::string, int> read(std::istream& in) const {
+        size_t length = 0;
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        std::string key(length, '\0');
+        in.read(key.data(), length);
+        int mapped = 0;
+        in.read(reinterpret_cast<char*>(&mapped), sizeof(mapped));
+        return {key, mapped};
+    }
+};
+
+/*
+* Verifies save and load with a user serializer, for keys that cannot be byte copied, and that
+* a byte copy snapshot cannot be loaded as a serialized one.
+*/
+TEST(HashMapTest, TEST_21B_SAVE_LOAD_SERIALIZER) {
+    std::string path = ::testing::TempDir() + "hashmap_test_21b.bin";
+    HashMap<std::string, int> map;
+    for (const auto& [key, mapped] : vec) map.insert({key, mapped});
+    map.insert({std::string(100, 'x'), 100});
+    map.insert({"", 0});
+    map.save(path, StringIntSerializer());
+
+    HashMap<std::string, int> loaded{{"stale", 1}};
+    loaded.load(path, StringIntSerializer());
+    CHECK_MAP_EQUAL(loaded, map);
+    ASSERT_TRUE(std::equal(map.begin(), map.end(), loaded.begin(), loaded.end()));
+    ASSERT_FALSE(loaded.contains("stale"));
+
+    // byte copy snapshots and serialized snapshots are not interchangeable
+    HashMap<int, int> ints{{1, 2}};
+    ints.save(path);
+    ASSERT_THROW(loaded.load(path, StringIntSerializer()), std::runtime_error);
+    ASSERT_EQ(loaded.size(), map.size());
+    std::remove(path.c_str());
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: FrozenHashMap */
+
+/*
+* Verifies lookups in FrozenHashMap for empty, small and large key sets: duplicates keep the
+* first element, every key gets a slot of its own, absent keys are never found, and keys whose
+* full hashes collide are rejected.
+*/
+#if RUN_TEST_22A
+TEST(FrozenHashMapTest, TEST_22A_FROZEN_BASIC) {
+    FrozenHashMap<int, int> empty;
+    ASSERT_TRUE(empty.empty());
+    ASSERT_FALSE(empty.contains(0));
+    ASSERT_EQ(empty.begin(), empty.end());
+    ASSERT_THROW(empty.at(0), std::out_of_range);
+
+    // duplicate keys keep the first element, like HashMap::insert
+    FrozenHashMap<std::string, int> small{{"A", 1}, {"B", 2}, {"A", 3}, {"C", 4}};
+    ASSERT_EQ(small.size(), 3);
+    ASSERT_EQ(small.at("A"), 1);
+    ASSERT_EQ(small.count("C"), 1);
+    ASSERT_EQ(small.count("D"), 0);
+    ASSERT_THROW(small.at("D"), std::out_of_range);
+
+    // every key gets its own slot, and every slot is used exactly once
+    for (size_t size : {1, 2, 3, 7, 100, 5000, 100000}) {
+        std::vector<std::pair<int, int>> elements;
+        for (size_t i = 0; i < size; ++i) elements.push_back({int(i * 7919), int(i)});
+        FrozenHashMap<int, int> frozen(elements.begin(), elements.end());
+        ASSERT_EQ(frozen.size(), size);
+        ASSERT_EQ(size_t(std::distance(frozen.begin(), frozen.end())), size);
+        for (const auto& [key, mapped] : elements) {
+            ASSERT_EQ(frozen.at(key), mapped);
+            ASSERT_EQ(frozen.find(key)->first, key);
+        }
+        for (size_t i = 0; i < size; ++i) ASSERT_FALSE(frozen.contains(int(i * 7919 + 1)));
+        std::vector<int> keys;
+        for (const auto& [key, mapped] : frozen) keys.push_back(key);
+        std::sort(keys.begin(), keys.end());
+        ASSERT_EQ(std::adjacent_find(keys.begin(), keys.end()), keys.end());
+    }
+
+    // two different keys with the same hash cannot be frozen
+    auto constant_hash = [](const int&) { return size_t(7); };
+    using constant_map = FrozenHashMap<int, int, decltype(constant_hash)>;
+    ASSERT_THROW(constant_map({{1, 1}, {2, 2}}, constant_hash), std::length_error);
+    constant_map single({{1, 1}, {1, 2}}, constant_hash);
+    ASSERT_EQ(single.at(1), 1);
+}
+#endif
+
+/*
+* Verifies that HashMap::freeze takes an independent copy of the map, and the copy and move
+* operations of FrozenHashMap, including self-assignment and the moved-from state.
+*/
+#if RUN_TEST_22B
+TEST(FrozenHashMapTest, TEST_22B_FREEZE_AND_SMF) {
+    HashMap<std::string, int> map;
+    for (const auto& [key, mapped] : vec) map.insert({key, mapped});
+    for (int i = 0; i < 2000; ++i) map.insert({"key-" + std::to_string(i), i});
+    map.erase("key-17");
+
+    auto frozen = map.freeze();
+    CHECK_MAP_EQUAL(frozen, map);
+    ASSERT_FALSE(frozen.contains("key-17"));
+    // the frozen map is a copy: later changes to the map do not show up in it
+    map.insert({"key-17", 17});
+    ASSERT_FALSE(frozen.contains("key-17"));
+
+    auto copy = frozen;
+    CHECK_MAP_EQUAL(copy, frozen);
+    auto moved = std::move(copy);
+    CHECK_MAP_EQUAL(moved, frozen);
+    ASSERT_TRUE(copy.empty());
+    ASSERT_FALSE(copy.contains("A"));
+    copy = moved;
+    CHECK_MAP_EQUAL(copy, frozen);
+    moved = FrozenHashMap<std::string, int>();
+    ASSERT_TRUE(moved.empty());
+    copy = copy;
+    CHECK_MAP_EQUAL(copy, frozen);
+
+    HashMap<int, int> empty;
+    ASSERT_TRUE(empty.freeze().empty());
+}
+#endif
+
+/* Extension: structure-preserving copies */
+
+/*
+* A copy has the bucket count and the iteration order of the original, including a copy of a map
+* in the middle of an incremental rehash, and both stay independent afterwards.
+*/
+#if RUN_TEST_23A
+TEST(HashMapTest, TEST_23A_COPY_PRESERVES_LAYOUT) {
+    HashMap<std::string, int> map;
+    map.rehash(1000);
+    for (int i = 0; i < 300; ++i) map.insert({"key-" + std::to_string(i), i});
+
+    HashMap<std::string, int> copy = map;
+    ASSERT_EQ(copy.bucket_count(), map.bucket_count());
+    ASSERT_TRUE(std::equal(map.begin(), map.end(), copy.begin(), copy.end()));
+
+    HashMap<std::string, int> assigned;
+    for (int i = 0; i < 50; ++i) assigned.insert({"old-" + std::to_string(i), i});
+    assigned = map;
+    ASSERT_EQ(assigned.bucket_count(), map.bucket_count());
+    ASSERT_TRUE(std::equal(map.begin(), map.end(), assigned.begin(), assigned.end()));
+
+    copy.erase("key-7");
+    copy.at("key-8") = -8;
+    assigned.insert({"key-1000", 1000});
+    ASSERT_EQ(map.size(), 300);
+    ASSERT_EQ(map.at("key-7"), 7);
+    ASSERT_EQ(map.at("key-8"), 8);
+    ASSERT_FALSE(map.contains("key-1000"));
+
+    // copy a map whose elements are split between the old and the new bucket array
+    HashMap<int, int> growing;
+    growing.incremental_rehash(true);
+    std::unordered_map<int, int> answer;
+    for (int i = 0; i < 1000; ++i) {
+        growing.insert({i, -i});
+        answer.insert({i, -i});
+        if (i % 97 == 0) {
+            HashMap<int, int> snapshot = growing;
+            CHECK_MAP_EQUAL(snapshot, answer);
+            ASSERT_EQ(snapshot.bucket_count(), growing.bucket_count());
+            snapshot.insert({-1, 1});
+            ASSERT_FALSE(growing.contains(-1));
+        }
+    }
+
+    HashMap<std::string, int> empty;
+    copy = empty;
+    ASSERT_TRUE(copy.empty());
+    ASSERT_EQ(copy.bucket_count(), empty.bucket_count());
+}
+#endif
+
+/*
+* With a PoolAllocator and trivially copyable elements, a copy duplicates the pool slab by slab,
+* free chunks included, and gets a pool of its own.
+*/
+#if RUN_TEST_23B
+TEST(HashMapTest, TEST_23B_COPY_POOL_SLABS) {
+    using PoolMap = HashMap<int, int, std::hash<int>, std::equal_to<int>, PoolAllocator<std::pair<const int, int>>>;
+    PoolMap map;
+    std::unordered_map<int, int> answer;
+    for (int i = 0; i < 20000; ++i) {
+        map.insert({i, i * 7});
+        answer.insert({i, i * 7});
+    }
+    // a few erased nodes leave chunks on the free list of the pool
+    for (int i = 0; i < 2000; i += 3) {
+        map.erase(i);
+        answer.erase(i);
+    }
+
+    PoolMap copy = map;
+    CHECK_MAP_EQUAL(copy, answer);
+    ASSERT_EQ(copy.bucket_count(), map.bucket_count());
+    ASSERT_TRUE(std::equal(map.begin(), map.end(), copy.begin(), copy.end()));
+    ASSERT_TRUE(copy.get_allocator() != map.get_allocator());
+    ASSERT_EQ(copy.get_allocator().pool().bytes_reserved(), map.get_allocator().pool().bytes_reserved());
+
+    // the copied free list hands out chunks of the copy's own slabs
+    size_t reserved = copy.get_allocator().pool().bytes_reserved();
+    for (int i = 0; i < 2000; i += 3) copy.insert({i, 0});
+    ASSERT_EQ(copy.get_allocator().pool().bytes_reserved(), reserved);
+    for (int i = 0; i < 2000; i += 3) ASSERT_EQ(copy.at(i), 0);
+    copy.erase(5);
+    copy.at(6) = -6;
+    CHECK_MAP_EQUAL(map, answer);
+
+    // copy assignment, then destroying the original, leaves the copy intact
+    PoolMap assigned;
+    assigned.insert({-1, -1});
+    {
+        PoolMap source = map;
+        assigned = source;
+    }
+    CHECK_MAP_EQUAL(assigned, answer);
+    assigned.clear();
+    ASSERT_EQ(assigned.get_allocator().pool().slab_count(), 0);
+    CHECK_MAP_EQUAL(map, answer);
+}
+#endif
+
+/* Extension: set algebra */
+
+/*
+* merge relinks the nodes of the missing keys (pointers to the elements stay valid), leaves the
+* duplicates in the source, and falls back to moving the elements between different pools.
+*/
+#if RUN_TEST_24A
+TEST(HashMapTest, TEST_24A_MERGE) {
+    HashMap<std::string, int> map {{"A", 1}, {"B", 2}, {"C", 3}};
+    HashMap<std::string, int> source {{"B", 20}, {"D", 40}, {"E", 50}};
+    const auto* d_element = &*source.find("D");
+
+    map.merge(source);
+    CHECK_MAP_EQUAL(map, (std::unordered_map<std::string, int>{{"A", 1}, {"B", 2}, {"C", 3}, {"D", 40}, {"E", 50}}));
+    CHECK_MAP_EQUAL(source, (std::unordered_map<std::string, int>{{"B", 20}}));
+    ASSERT_EQ(&*map.find("D"), d_element);
+
+    map.merge(map);
+    ASSERT_EQ(map.size(), 5);
+    map.merge(HashMap<std::string, int>{{"F", 60}, {"A", 0}});
+    ASSERT_EQ(map.size(), 6);
+    ASSERT_EQ(map.at("A"), 1);
+
+    // enough new keys that the bucket array grows, from a source in the middle of a rehash
+    HashMap<int, int> big;
+    HashMap<int, int> growing;
+    growing.incremental_rehash(true);
+    std::unordered_map<int, int> answer;
+    for (int i = 0; i < 5000; ++i) {
+        big.insert({2 * i, i});
+        growing.insert({3 * i, -i});
+        answer.insert({2 * i, i});
+    }
+    for (int i = 0; i < 5000; ++i) answer.insert({3 * i, -i});
+    big.merge(growing);
+    CHECK_MAP_EQUAL(big, answer);
+    for (const auto& [key, mapped] : growing) {
+        ASSERT_EQ(key % 6, 0);
+        ASSERT_EQ(big.at(key), key / 2);
+    }
+    ASSERT_EQ(growing.size(), 1667);
+
+    // nodes of another pool are not adopted, the elements are moved instead
+    using PoolMap = HashMap<std::string, std::vector<int>, std::hash<std::string>, std::equal_to<std::string>,
+                            PoolAllocator<std::pair<const std::string, std::vector<int>>>>;
+    PoolMap pooled {{"x", {1}}, {"y", {2, 2}}};
+    PoolMap other_pool {{"y", {0}}, {"z", {3, 3, 3}}};
+    pooled.merge(other_pool);
+    ASSERT_EQ(pooled.size(), 3);
+    ASSERT_EQ(pooled.at("z"), std::vector<int>({3, 3, 3}));
+    ASSERT_EQ(pooled.at("y"), std::vector<int>({2, 2}));
+    ASSERT_EQ(other_pool.size(), 1);
+    ASSERT_EQ(other_pool.at("y"), std::vector<int>({0}));
+}
+#endif
+
+/*
+* intersect_with, difference_with and symmetric_difference, with either map the smaller one,
+* against the same operations on std::unordered_map.
+*/
+#if RUN_TEST_24B
+TEST(HashMapTest, TEST_24B_SET_OPERATIONS) {
+    for (auto [size_a, size_b] : {std::pair<int, int>{1000, 300}, {300, 1000}, {0, 50}, {50, 0}}) {
+        HashMap<int, int> a, b;
+        std::unordered_map<int, int> std_a, std_b;
+        for (int i = 0; i < size_a; ++i) {
+            a.insert({i * 2, i});
+            std_a.insert({i * 2, i});
+        }
+        for (int i = 0; i < size_b; ++i) {
+            b.insert({i * 3, -i});
+            std_b.insert({i * 3, -i});
+        }
+
+        std::unordered_map<int, int> intersection, difference, symmetric;
+        for (const auto& kv_pair : std_a) {
+            (std_b.count(kv_pair.first) ? intersection : difference).insert(kv_pair);
+            if (!std_b.count(kv_pair.first)) symmetric.insert(kv_pair);
+        }
+        for (const auto& kv_pair : std_b) {
+            if (!std_a.count(kv_pair.first)) symmetric.insert(kv_pair);
+        }
+
+        auto result = a.symmetric_difference(b);
+        CHECK_MAP_EQUAL(result, symmetric);
+        CHECK_MAP_EQUAL(b.symmetric_difference(a), symmetric);
+
+        HashMap<int, int> copy = a;
+        ASSERT_EQ(copy.intersect_with(b), std_a.size() - intersection.size());
+        CHECK_MAP_EQUAL(copy, intersection);
+        copy = a;
+        ASSERT_EQ(copy.difference_with(b), std_a.size() - difference.size());
+        CHECK_MAP_EQUAL(copy, difference);
+        CHECK_MAP_EQUAL(a, std_a);
+        CHECK_MAP_EQUAL(b, std_b);
+    }
+
+    HashMap<std::string, int> map {{"A", 1}, {"B", 2}};
+    ASSERT_EQ(map.intersect_with(map), 0);
+    ASSERT_EQ(map.size(), 2);
+    ASSERT_TRUE(map.symmetric_difference(map).empty());
+    ASSERT_EQ(map.difference_with(map), 2);
+    ASSERT_TRUE(map.empty());
+
+    // a stateful hash function is called again instead of reusing the hashes of the other map
+    auto seeded = [](size_t seed) { return [seed](int key) { return std::hash<int>()(key) ^ seed; }; };
+    HashMap<int, int, std::function<size_t(int)>> lhs(16, seeded(12345)), rhs(16, seeded(678));
+    for (int i = 0; i < 100; ++i) {
+        lhs.insert({i, i});
+        rhs.insert({i + 50, i});
+    }
+    ASSERT_EQ(lhs.symmetric_difference(rhs).size(), 100);
+    ASSERT_EQ(lhs.intersect_with(rhs), 50);
+    ASSERT_EQ(lhs.size(), 50);
+    ASSERT_TRUE(lhs.contains(75) && !lhs.contains(25));
+}
+#endif
+
+/*
+* operator== compares sizes first, then looks every key up once.
+*/
+#if RUN_TEST_24C
+TEST(HashMapTest, TEST_24C_EQUALITY) {
+    HashMap<std::string, int> lhs {{"A", 1}, {"B", 2}, {"C", 3}};
+    HashMap<std::string, int> rhs {{"C", 3}, {"B", 2}, {"A", 1}};
+    ASSERT_TRUE(lhs == rhs);
+    rhs.at("B") = 20;
+    ASSERT_TRUE(lhs != rhs);
+    rhs.at("B") = 2;
+    rhs.insert({"D", 4});
+    ASSERT_TRUE(lhs != rhs && rhs != lhs);
+    rhs.erase("A");
+    ASSERT_TRUE(lhs != rhs && rhs != lhs);
+    rhs.erase("D");
+    rhs.insert({"A", 1});
+    ASSERT_TRUE(lhs == rhs && rhs == lhs);
+    HashMap<std::string, int> empty1, empty2(1000);
+    ASSERT_TRUE(empty1 == empty2);
+    ASSERT_TRUE(empty1 != lhs);
+}
+#endif
+
+/* Extension: StaticHashMap */
+
+/*
+* A StaticHashMap declared constexpr is built by the compiler: lookups work in static_assert,
+* and the same lookups work at run time.
+*/
+#if RUN_TEST_25A
+constexpr auto kOpcodes = make_static_hash_map<std::string_view, int>({
+    {"add", 0x01}, {"sub", 0x02}, {"mul", 0x03}, {"div", 0x04}, {"and", 0x05}, {"or", 0x06},
+    {"xor", 0x07}, {"not", 0x08}, {"jmp", 0x10}, {"jz", 0x11}, {"jnz", 0x12}, {"call", 0x13},
+    {"ret", 0x14}, {"push", 0x20}, {"pop", 0x21}, {"load", 0x30}, {"store", 0x31},
+});
+static_assert(kOpcodes.size() == 17);
+static_assert(kOpcodes.at("call") == 0x13);
+static_assert(kOpcodes.contains("store") && !kOpcodes.contains("nop") && !kOpcodes.contains(""));
+static_assert(kOpcodes.find("nop") == kOpcodes.end());
+static_assert(kOpcodes.slot_count() == 32);
+
+TEST(StaticHashMapTest, TEST_25A_STATIC_BASIC) {
+    std::unordered_map<std::string_view, int> answer(kOpcodes.begin(), kOpcodes.end());
+    CHECK_MAP_EQUAL(kOpcodes, answer);
+    ASSERT_EQ(answer.size(), kOpcodes.size());
+
+    // the elements are kept in declaration order
+    ASSERT_EQ(kOpcodes.begin()->first, "add");
+    ASSERT_EQ((kOpcodes.end() - 1)->first, "store");
+
+    // lookups with keys that are not string literals, and misses that land on empty slots
+    std::string key = "pu";
+    key += "sh";
+    ASSERT_EQ(kOpcodes.at(key), 0x20);
+    ASSERT_EQ(kOpcodes.count(key), 1);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_FALSE(kOpcodes.contains("op" + std::to_string(i)));
+    }
+    ASSERT_THROW(kOpcodes.at("halt"), std::out_of_range);
+}
+#endif
+
+/*
+* Integer and enum keys, a custom seeded hash, the empty map, and a map built at run time
+* (where a duplicate key is an exception instead of a compile error).
+*/
+#if RUN_TEST_25B
+enum class Color { Red, Green, Blue, Cyan, Magenta };
+
+template <size_t... I>
+constexpr std::array<std::pair<int, int>, sizeof...(I)> static_squares(std::index_sequence<I...>) {
+    return {{std::pair<int, int>(int(I) * 1000003, int(I * I))...}};
+}
+
+struct ConstantStaticHash {
+    constexpr uint64_t operator()(int key, uint64_t seed) const { return hash_avalanche(uint64_t(key % 4) ^ seed); }
+};
+
+TEST(StaticHashMapTest, TEST_25B_STATIC_KEYS) {
+    constexpr auto colors = make_static_hash_map<Color, const char*>({
+        {Color::Red, "red"}, {Color::Green, "green"}, {Color::Blue, "blue"},
+    });
+    static_assert(colors.contains(Color::Green) && !colors.contains(Color::Cyan));
+    ASSERT_STREQ(colors.at(Color::Blue), "blue");
+
+    constexpr StaticHashMap<int, int, 1000> squares(static_squares(std::make_index_sequence<1000>()));
+    static_assert(squares.at(999 * 1000003) == 999 * 999);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(squares.at(i * 1000003), i * i);
+        ASSERT_FALSE(squares.contains(i * 1000003 + 1));
+    }
+
+    constexpr StaticHashMap<int, int, 0> none(std::array<std::pair<int, int>, 0>{});
+    static_assert(none.empty() && !none.contains(0) && none.begin() == none.end());
+
+    // a hash with only 4 different values per seed still works through the displacements
+    constexpr auto weak = make_static_hash_map<int, int, ConstantStaticHash>({{0, 0}, {1, 1}, {2, 2}, {3, 3}});
+    static_assert(weak.at(2) == 2 && !weak.contains(4));
+    auto clash = [] { return make_static_hash_map<int, int, ConstantStaticHash>({{0, 0}, {4, 4}}); };
+    ASSERT_THROW(clash(), std::length_error);
+
+    std::array<std::pair<int, int>, 3> duplicates {{{1, 1}, {2, 2}, {1, 3}}};
+    ASSERT_THROW((StaticHashMap<int, int, 3>(duplicates)), std::out_of_range);
+    std::array<std::pair<int, int>, 3> runtime {{{1, 1}, {2, 2}, {3, 3}}};
+    StaticHashMap<int, int, 3> built(runtime);
+    ASSERT_EQ(built.at(3), 3);
+}
+#endif
+
+/* Extension: SmallHashMap */
+
+/*
+* Compares SmallHashMap with std::unordered_map while it fills its inline array, switches to
+* hashed storage, shrinks, and returns to inline storage after clear.
+*/
+#if RUN_TEST_26A
+TEST(SmallHashMapTest, TEST_26A_SMALL_BASIC) {
+    SmallHashMap<std::string, int, 4> map;
+    std::unordered_map<std::string, int> answer;
+    ASSERT_TRUE(map.empty() && map.is_inline());
+    ASSERT_TRUE(map.begin() == map.end());
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(map.insert({"key-" + std::to_string(i), i}).second);
+        answer.insert({"key-" + std::to_string(i), i});
+        ASSERT_FALSE(map.insert({"key-" + std::to_string(i), -1}).second);
+        CHECK_MAP_EQUAL(map, answer);
+    }
+    ASSERT_TRUE(map.is_inline());
+    // inline elements are visited in insertion order
+    int expected = 0;
+    for (const auto& [key, mapped] : map) ASSERT_EQ(mapped, expected++);
+
+    // erase moves the last element into the hole
+    ASSERT_TRUE(map.erase("key-1"));
+    ASSERT_FALSE(map.erase("key-1"));
+    answer.erase("key-1");
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_EQ(std::next(map.begin())->first, "key-3");
+
+    map["key-1"] = 1;
+    answer["key-1"] = 1;
+    map.at("key-0") = 100;
+    answer.at("key-0") = 100;
+    ASSERT_THROW(map.at("missing"), std::out_of_range);
+    ASSERT_TRUE(map.find("missing") == map.end());
+    ASSERT_EQ(map.find("key-2")->second, 2);
+    ASSERT_EQ(map.count("key-3"), 1);
+
+    // the fifth element switches to a HashMap
+    for (int i = 4; i < 100; ++i) {
+        map.try_emplace("key-" + std::to_string(i), i);
+        answer.try_emplace("key-" + std::to_string(i), i);
+        ASSERT_FALSE(map.is_inline());
+        CHECK_MAP_EQUAL(map, answer);
+    }
+    size_t visited = 0;
+    for (auto it = map.begin(); it != map.end(); ++it, ++visited) ASSERT_EQ(answer.at(it->first), it->second);
+    ASSERT_EQ(visited, answer.size());
+
+    // it stays hashed below the capacity, until clear
+    for (int i = 3; i < 100; ++i) {
+        map.erase("key-" + std::to_string(i));
+        answer.erase("key-" + std::to_string(i));
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_FALSE(map.is_inline());
+    map.clear();
+    ASSERT_TRUE(map.empty() && map.is_inline());
+    map["again"] = 1;
+    ASSERT_EQ(map.size(), 1);
+    ASSERT_TRUE(map.is_inline());
+
+    const SmallHashMap<int, int> numbers {{1, 10}, {2, 20}};
+    ASSERT_EQ(numbers.at(2), 20);
+    ASSERT_TRUE(numbers.find(3) == numbers.end());
+    ASSERT_EQ(numbers.find(1)->second, 10);
+
+    // the insert that switches to a HashMap may take its value from an inline element
+    SmallHashMap<int, std::string, 2> full{{1, std::string(100, 'a')}, {2, std::string(100, 'b')}};
+    full.try_emplace(3, full.at(1));
+    ASSERT_FALSE(full.is_inline());
+    ASSERT_EQ(full.at(3), std::string(100, 'a'));
+    ASSERT_EQ(full.at(1), std::string(100, 'a'));
+    ASSERT_EQ(full.at(2), std::string(100, 'b'));
+}
+#endif
+
+/*
+* Copies and moves in both modes, with elements that own memory.
+*/
+#if RUN_TEST_26B
+TEST(SmallHashMapTest, TEST_26B_SMALL_COPY_MOVE) {
+    using Map = SmallHashMap<std::string, std::string, 3>;
+    for (int size : {0, 2, 3, 10}) {
+        Map map;
+        std::unordered_map<std::string, std::string> answer;
+        for (int i = 0; i < size; ++i) {
+            map[std::to_string(i)] = std::string(10 * i, 'a' + i);
+            answer[std::to_string(i)] = std::string(10 * i, 'a' + i);
+        }
+
+        Map copy = map;
+        CHECK_MAP_EQUAL(copy, answer);
+        ASSERT_EQ(copy.is_inline(), map.is_inline());
+        copy["new"] = "value";
+        ASSERT_FALSE(map.contains("new"));
+
+        Map moved = std::move(copy);
+        ASSERT_TRUE(moved.contains("new"));
+        ASSERT_TRUE(copy.empty());
+        copy["reused"] = "value";
+        ASSERT_EQ(copy.size(), 1);
+
+        Map assigned {{"old", "value"}};
+        assigned = map;
+        CHECK_MAP_EQUAL(assigned, answer);
+        assigned = std::move(moved);
+        ASSERT_EQ(assigned.size(), answer.size() + 1);
+        assigned = assigned;
+        ASSERT_EQ(assigned.size(), answer.size() + 1);
+        CHECK_MAP_EQUAL(map, answer);
+    }
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: hash functions */
+
+/*
+* Checks hash_bytes, DefaultHash and fastrange: every length and every single-byte change gives a
+* new hash, equal strings hash alike whatever their type, and fastrange stays in range.
+*/
+#if RUN_TEST_27A
+TEST(HashFunctionsTest, TEST_27A_HASH_FUNCTIONS) {
+    // lengths 0..200 cover the short path, the 16-byte loop and the three-lane loop
+    std::string text;
+    for (int i = 0; i < 200; ++i) text.push_back(static_cast<char>('a' + i * 7 % 26));
+    std::unordered_set<uint64_t> hashes;
+    for (size_t length = 0; length <= text.size(); ++length) {
+        uint64_t hash = hash_bytes(text.data(), length);
+        ASSERT_EQ(hash, hash_bytes(text.data(), length));
+        ASSERT_NE(hash, hash_bytes(text.data(), length, 1));
+        hashes.insert(hash);
+        for (size_t i = 0; i < length; ++i) {
+            std::string changed = text.substr(0, length);
+            changed[i] ^= 1;
+            hashes.insert(hash_bytes(changed.data(), length));
+        }
+    }
+    ASSERT_EQ(hashes.size(), 201 + 200 * 201 / 2);
+
+    DefaultHash<std::string> string_hash;
+    ASSERT_EQ(string_hash(std::string("key")), DefaultHash<std::string_view>()(std::string_view("key")));
+    ASSERT_EQ(string_hash(std::string("key")), string_hash("key"));
+    ASSERT_NE(string_hash(std::string("key")), string_hash(std::string("kez")));
+    ASSERT_EQ(DefaultHash<double>()(0.0), DefaultHash<double>()(-0.0));
+    ASSERT_NE(DefaultHash<int>()(1), DefaultHash<int>()(2));
+    int values[2];
+    ASSERT_NE(DefaultHash<int*>()(&values[0]), DefaultHash<int*>()(&values[1]));
+
+    // hash_mix sends multiples of a power of two to different low bits
+    std::unordered_set<uint64_t> low_bits;
+    for (uint64_t i = 0; i < 64; ++i) low_bits.insert(hash_mix(i << 20) & 1023);
+    ASSERT_GT(low_bits.size(), 50);
+    ASSERT_EQ(hash_avalanche(0), 0);
+    ASSERT_NE(hash_avalanche(1), hash_avalanche(2));
+
+    for (size_t n : {1, 7, 1000, 1 << 20}) {
+        ASSERT_EQ(fastrange(0, n), 0);
+        ASSERT_EQ(fastrange(~uint64_t(0), n), n - 1);
+        ASSERT_EQ(fastrange(uint64_t(1) << 63, n), n / 2);
+    }
+
+    // the portable 128-bit multiply, for compilers without __uint128_t, agrees with the native one
+    static_assert(hash_mix(1) == 0x9E3779B97F4A7C15ull);
+    uint64_t max_low = ~uint64_t(0), max_high = ~uint64_t(0);
+    hash_multiply_portable(max_low, max_high);
+    ASSERT_EQ(max_low, 1);
+    ASSERT_EQ(max_high, ~uint64_t(0) - 1);
+    uint64_t x = 1;
+    for (int i = 0; i < 1000; ++i) {
+        x = hash_avalanche(x + i);
+        uint64_t y = hash_avalanche(x ^ 0x5555);
+        uint64_t native_low = x, native_high = y, portable_low = x, portable_high = y;
+        hash_multiply(native_low, native_high);
+        hash_multiply_portable(portable_low, portable_high);
+        ASSERT_EQ(portable_low, native_low);
+        ASSERT_EQ(portable_high, native_high);
+    }
+}
+#endif
+
+/*
+* With the default hash function, keys that are all multiples of the bucket count still spread
+* over the buckets; with the identity std::hash they share a single chain. The string keys can be
+* searched with a std::string_view since DefaultHash<std::string> is transparent.
+*/
+#if RUN_TEST_27B
+TEST(HashFunctionsTest, TEST_27B_DEFAULT_HASH_DISTRIBUTION) {
+    HashMap<uint64_t, int> mixed(1024);
+    HashMap<uint64_t, int, std::hash<uint64_t>> identity(1024);
+    mixed.max_load_factor(2);
+    identity.max_load_factor(2);
+    for (uint64_t i = 0; i < 512; ++i) {
+        mixed.insert({i * 1024, 0});
+        identity.insert({i * 1024, 0});
+    }
+    ASSERT_EQ(mixed.bucket_count(), 1024);
+    ASSERT_EQ(identity.bucket_count(), 1024);
+    ASSERT_EQ(identity.stats().max_chain_length, 512);
+    ASSERT_LE(mixed.stats().max_chain_length, 8);
+    ASSERT_GE(mixed.stats().empty_bucket_ratio, 0.5);
+    ASSERT_LT(mixed.stats().empty_bucket_ratio, 0.7);
+
+    HashMap<std::string, int, DefaultHash<std::string>, std::equal_to<>> strings;
+    strings.insert({"alpha", 1});
+    strings.insert({"beta", 2});
+    std::string_view buffer = "alphabet";
+    ASSERT_TRUE(strings.contains(buffer.substr(0, 5)));
+    ASSERT_FALSE(strings.contains(buffer.substr(0, 4)));
+    ASSERT_EQ(strings.find(std::string_view("beta"))->second, 2);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: Bloom filter */
+
+/*
+* Checks that the Bloom filter never hides a key of the map (no false negatives) while the map
+* grows, rehashes and erases, and that it can be turned off and on again. TEST_28C (in
+* hashmap_stats_test.cpp) checks that it answers most misses on its own.
+*/
+#if RUN_TEST_28A
+TEST(HashMapTest, TEST_28A_BLOOM_FILTER) {
+    HashMap<int, int> map;
+    ASSERT_FALSE(map.bloom_filter());
+    ASSERT_EQ(map.stats().bloom_filter_bytes, 0);
+    for (int i = 0; i < 100; ++i) map.insert({i, i});
+    map.bloom_filter(true);
+    ASSERT_TRUE(map.bloom_filter());
+
+    // every insert is visible right away, across several grows
+    for (int i = 100; i < 20000; ++i) {
+        map.insert({i, -i});
+        ASSERT_TRUE(map.contains(i));
+        ASSERT_TRUE(map.contains(i / 2));
+    }
+    for (int i = 0; i < 20000; i += 3) ASSERT_TRUE(map.erase(i));
+    map.rehash(map.bucket_count() * 2);
+    for (int i = 0; i < 20000; ++i) {
+        ASSERT_EQ(map.contains(i), i % 3 != 0);
+    }
+    ASSERT_EQ(map.at(20000 - 1), -(20000 - 1));
+    ASSERT_THROW(map.at(-1), std::out_of_range);
+    ASSERT_EQ(map.find(-1), map.end());
+
+    // misses: the estimated false positive rate stays well under 1%
+    auto stats = map.stats();
+    ASSERT_GE(stats.bloom_filter_bytes, map.size() * BlockedBloomFilter::kBitsPerElement / 8);
+    ASSERT_GT(stats.bloom_false_positive_rate, 0);
+    ASSERT_LT(stats.bloom_false_positive_rate, 0.01);
+    for (int i = 0; i < 100000; ++i) ASSERT_FALSE(map.contains(1000000 + i));
+
+    // the batched lookups skip the rejected keys, but still report them
+    std::vector<int> keys = {1, 3, 1000000, 4, 1000001};
+    std::vector<bool> found;
+    map.contains_many(keys.begin(), keys.end(), std::back_inserter(found));
+    ASSERT_EQ(found, (std::vector<bool>{true, false, false, true, false}));
+
+    map.bloom_filter(false);
+    ASSERT_EQ(map.stats().bloom_filter_bytes, 0);
+    ASSERT_TRUE(map.contains(1));
+    ASSERT_FALSE(map.contains(3));
+    map.bloom_filter(true);
+    for (int i = 0; i < 20000; ++i) {
+        ASSERT_EQ(map.contains(i), i % 3 != 0);
+    }
+}
+#endif
+
+/*
+* Covers the other paths that change the elements or the bucket array under an enabled filter:
+* an incremental rehash (two filters during the migration), copies, moves, clear,
+* max_load_factor, and intersect_with.
+*/
+#if RUN_TEST_28B
+TEST(HashMapTest, TEST_28B_BLOOM_FILTER_PATHS) {
+    HashMap<int, int> map;
+    map.bloom_filter(true);
+    map.incremental_rehash(true);
+    std::unordered_map<int, int> answer;
+    for (int i = 0; i < 5000; ++i) {
+        map.insert({i, i});
+        answer.insert({i, i});
+        if (i % 61 == 0) {
+            // wherever the migration stands, const and non-const lookups see every key
+            const auto& cmap = map;
+            for (int j = 0; j <= i; ++j) ASSERT_TRUE(cmap.contains(j));
+            for (int j = 0; j <= i; j += 17) ASSERT_NE(map.find(j), map.end());
+            ASSERT_FALSE(cmap.contains(i + 1));
+        }
+    }
+
+    // copies, whether or not the source is migrating
+    HashMap<int, int> copy(map);
+    ASSERT_TRUE(copy.bloom_filter());
+    CHECK_MAP_EQUAL(copy, answer);
+    for (const auto& [key, value] : answer) ASSERT_TRUE(copy.contains(key));
+    map.incremental_rehash(false);
+    HashMap<int, int> assigned;
+    assigned = map;
+    ASSERT_TRUE(assigned.bloom_filter());
+    for (const auto& [key, value] : answer) ASSERT_TRUE(assigned.contains(key));
+
+    // moves take the filter along, and the moved-from map keeps a working one
+    HashMap<int, int> moved(std::move(copy));
+    ASSERT_TRUE(moved.bloom_filter());
+    for (const auto& [key, value] : answer) ASSERT_TRUE(moved.contains(key));
+    ASSERT_TRUE(copy.bloom_filter());
+    ASSERT_FALSE(copy.contains(1));
+    copy.insert({1, 1});
+    ASSERT_TRUE(copy.contains(1));
+    copy = std::move(moved);
+    for (const auto& [key, value] : answer) ASSERT_TRUE(copy.contains(key));
+
+    // a bigger load factor grows nothing, so the filter is resized instead
+    map.max_load_factor(4);
+    for (int i = 5000; i < 20000; ++i) map.insert({i, i});
+    for (int i = 0; i < 20000; ++i) ASSERT_TRUE(map.contains(i));
+    ASSERT_LT(map.stats().bloom_false_positive_rate, 0.01);
+
+    std::vector<int> evens;
+    for (int i = 0; i < 20000; i += 2) evens.push_back(i);
+    HashMap<int, int> other;
+    for (int key : evens) other.insert({key, 0});
+    map.intersect_with(other);
+    ASSERT_EQ(map.size(), evens.size());
+    for (int i = 0; i < 20000; ++i) ASSERT_EQ(map.contains(i), i % 2 == 0);
+
+    map.clear();
+    ASSERT_TRUE(map.bloom_filter());
+    ASSERT_FLOAT_EQ(map.stats().bloom_false_positive_rate, 0);
+    ASSERT_FALSE(map.contains(0));
+    map.insert({0, 0});
+    ASSERT_TRUE(map.contains(0));
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension: LRUCache */
+
+/*
+* Returns the keys of cache from the most to the least recently used.
+*/
+template <typename Cache>
+std::vector<int> recency_order(const Cache& cache) {
+    std::vector<int> keys;
+    cache.for_each([&](const int& key, const auto&) { keys.push_back(key); });
+    return keys;
+}
+
+/*
+* Checks the basic contract of an LRUCache with an entry capacity: get refreshes an entry and
+* peek does not, put evicts the least recently used entry and calls the eviction callback,
+* overwrites keep the size, and the counters add up.
+*/
+#if RUN_TEST_29A
+TEST(LRUCacheTest, TEST_29A_LRU_BASIC) {
+    LRUCache<int, std::string> cache(3);
+    std::vector<std::pair<int, std::string>> evicted;
+    cache.on_evict([&](const int& key, std::string& value) { evicted.push_back({key, std::move(value)}); });
+    ASSERT_TRUE(cache.empty());
+    ASSERT_EQ(cache.get(1), nullptr);
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.put(3, "three");
+    ASSERT_EQ(recency_order(cache), (std::vector<int>{3, 2, 1}));
+    ASSERT_EQ(*cache.get(1), "one");
+    ASSERT_EQ(recency_order(cache), (std::vector<int>{1, 3, 2}));
+    ASSERT_EQ(*cache.peek(2), "two");
+    ASSERT_EQ(recency_order(cache), (std::vector<int>{1, 3, 2}));
+
+    // 2 is the least recently used entry, peek did not change that
+    cache.put(4, "four");
+    ASSERT_EQ(cache.size(), 3);
+    ASSERT_FALSE(cache.contains(2));
+    ASSERT_EQ(evicted, (std::vector<std::pair<int, std::string>>{{2, "two"}}));
+    ASSERT_EQ(recency_order(cache), (std::vector<int>{4, 1, 3}));
+
+    // an overwrite refreshes the entry and evicts nothing
+    cache.put(3, "THREE");
+    ASSERT_EQ(cache.size(), 3);
+    ASSERT_EQ(*cache.peek(3), "THREE");
+    ASSERT_EQ(recency_order(cache), (std::vector<int>{3, 4, 1}));
+    ASSERT_EQ(evicted.size(), 1);
+
+    // the value can be changed in place through get
+    *cache.get(1) += "!";
+    ASSERT_EQ(*cache.peek(1), "one!");
+
+    ASSERT_TRUE(cache.erase(4));
+    ASSERT_FALSE(cache.erase(4));
+    ASSERT_EQ(recency_order(cache), (std::vector<int>{1, 3}));
+    cache.put(5, "five");
+    cache.put(6, "six");
+    ASSERT_EQ(recency_order(cache), (std::vector<int>{6, 5, 1}));
+    ASSERT_EQ(evicted.back().first, 3);
+
+    // a smaller capacity evicts right away
+    cache.capacity(1);
+    ASSERT_EQ(recency_order(cache), (std::vector<int>{6}));
+    ASSERT_EQ(evicted.size(), 4);
+
+    auto stats = cache.stats();
+    ASSERT_EQ(stats.size, 1);
+    ASSERT_EQ(stats.weight, 1);
+    ASSERT_EQ(stats.capacity, 1);
+    ASSERT_EQ(stats.hits, 2);
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.evictions, 4);
+    ASSERT_FLOAT_EQ(stats.hit_rate, 2.0f / 3);
+    cache.reset_counters();
+    ASSERT_EQ(cache.stats().hits, 0);
+    ASSERT_FLOAT_EQ(cache.stats().hit_rate, 0);
+
+    // neither clear nor erase call the callback
+    cache.clear();
+    ASSERT_TRUE(cache.empty());
+    ASSERT_EQ(cache.weight(), 0);
+    ASSERT_EQ(evicted.size(), 4);
+    cache.on_evict(nullptr);
+    cache.put(7, "seven");
+    cache.put(8, "eight");
+    ASSERT_EQ(recency_order(cache), (std::vector<int>{8}));
+}
+#endif
+
+/*
+* Runs random traffic against a byte-capacity cache and a reference model built from a std::list
+* and a std::unordered_map, and checks copies and moves, which must keep the recency order.
+*/
+#if RUN_TEST_29B
+struct StringBytes {
+    size_t operator()(const int&, const std::string& value) const { return value.size(); }
+};
+
+TEST(LRUCacheTest, TEST_29B_LRU_WEIGHTED) {
+    using Cache = LRUCache<int, std::string, DefaultHash<int>, std::equal_to<int>, StringBytes>;
+    Cache cache(100);
+
+    // entries heavier than the whole capacity are never cached, and drop an older value
+    cache.put(1, "small");
+    cache.put(1, std::string(101, 'x'));
+    ASSERT_FALSE(cache.contains(1));
+    ASSERT_EQ(cache.weight(), 0);
+
+    std::list<std::pair<int, std::string>> order;
+    std::unordered_map<int, std::list<std::pair<int, std::string>>::iterator> index;
+    size_t model_weight = 0;
+    auto model_evict = [&]() {
+        model_weight -= order.back().second.size();
+        index.erase(order.back().first);
+        order.pop_back();
+    };
+    // a fixed linear congruential sequence, so that every run sees the same traffic
+    uint32_t state = 7;
+    auto rng = [&]() { state = state * 1103515245u + 12345u; return state >> 16; };
+    for (int i = 0; i < 20000; ++i) {
+        int key = static_cast<int>(rng() % 64);
+        if (rng() % 3 == 0) {
+            std::string* value = cache.get(key);
+            auto found = index.find(key);
+            ASSERT_EQ(value != nullptr, found != index.end());
+            if (value != nullptr) {
+                ASSERT_EQ(*value, found->second->second);
+                order.splice(order.begin(), order, found->second);
+            }
+        } else if (rng() % 10 == 0) {
+            ASSERT_EQ(cache.erase(key), index.count(key) == 1);
+            if (index.count(key)) {
+                model_weight -= index[key]->second.size();
+                order.erase(index[key]);
+                index.erase(key);
+            }
+        } else {
+            std::string value(rng() % 30, static_cast<char>('a' + i % 26));
+            cache.put(key, value);
+            if (index.count(key)) {
+                model_weight -= index[key]->second.size();
+                order.erase(index[key]);
+                index.erase(key);
+            }
+            order.push_front({key, value});
+            index[key] = order.begin();
+            model_weight += value.size();
+            while (model_weight > 100) model_evict();
+        }
+        ASSERT_EQ(cache.size(), order.size());
+        ASSERT_EQ(cache.weight(), model_weight);
+        ASSERT_LE(cache.weight(), cache.capacity());
+    }
+    std::vector<int> expected;
+    for (const auto& [key, value] : order) expected.push_back(key);
+    ASSERT_EQ(recency_order(cache), expected);
+
+    Cache copy(cache);
+    ASSERT_EQ(recency_order(copy), expected);
+    ASSERT_EQ(copy.weight(), cache.weight());
+    copy.put(1000, "new");
+    ASSERT_EQ(recency_order(cache), expected);
+    ASSERT_NE(recency_order(copy), expected);
+    copy = cache;
+    ASSERT_EQ(recency_order(copy), expected);
+
+    Cache moved(std::move(copy));
+    ASSERT_EQ(recency_order(moved), expected);
+    ASSERT_TRUE(copy.empty());
+    ASSERT_EQ(copy.weight(), 0);
+    copy.put(5, "five");
+    ASSERT_EQ(recency_order(copy), (std::vector<int>{5}));
+    copy = std::move(moved);
+    ASSERT_EQ(recency_order(copy), expected);
+    // the moved entries still evict in order
+    copy.put(2000, std::string(100, 'y'));
+    ASSERT_EQ(recency_order(copy), (std::vector<int>{2000}));
+}
+#endif
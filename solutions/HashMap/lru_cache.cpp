@@ -0,0 +1,273 @@
+#include "lru_cache.h"
+
+template<typename K, typename V, typename H, typename E, typename W>
+LRUCache<K, V, H, E, W>::LRUCache(size_t capacity, const W& weigher, const H& hash, const E& equal) :
+    _map(kInitialBuckets, hash, equal),
+    _weigher(weigher),
+    _head(nullptr),
+    _tail(nullptr),
+    _capacity(capacity),
+    _weight(0),
+    _hits(0),
+    _misses(0),
+    _evictions(0) {};
+
+template<typename K, typename V, typename H, typename E, typename W>
+inline size_t LRUCache<K, V, H, E, W>::size() const {
+    return _map.size();
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+inline bool LRUCache<K, V, H, E, W>::empty() const {
+    return _map.empty();
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+inline size_t LRUCache<K, V, H, E, W>::weight() const {
+    return _weight;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+inline size_t LRUCache<K, V, H, E, W>::capacity() const {
+    return _capacity;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::capacity(size_t capacity) {
+    _capacity = capacity;
+    evict_to_fit(0);
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::on_evict(eviction_callback callback) {
+    _on_evict = std::move(callback);
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+V* LRUCache<K, V, H, E, W>::get(const K& key) {
+    auto found = _map.find(key);
+    if (found == _map.end()) {
+        _misses++;
+        return nullptr;
+    }
+    _hits++;
+    move_to_front(&*found);
+    return &found->second.value;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+const V* LRUCache<K, V, H, E, W>::peek(const K& key) const {
+    auto found = _map.find(key);
+    return found != _map.end() ? &found->second.value : nullptr;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+bool LRUCache<K, V, H, E, W>::contains(const K& key) const {
+    return _map.contains(key);
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::put(const K& key, V value) {
+    size_t weight = _weigher(key, value);
+    if (weight > _capacity) {
+        erase(key);
+        return;
+    }
+    // a single lookup: try_emplace leaves value alone if key is already there
+    auto [element, inserted] = _map.try_emplace(key, std::move(value), weight);
+    Entry& entry = element->second;
+    if (inserted) {
+        push_front(&*element);
+        _weight += weight;
+    } else {
+        entry.value = std::move(value);
+        _weight = _weight - entry.weight + weight;
+        entry.weight = weight;
+        move_to_front(&*element);
+    }
+    // the entry is at the front, and fits on its own, so it is never evicted here
+    evict_to_fit(0);
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+bool LRUCache<K, V, H, E, W>::erase(const K& key) {
+    auto found = _map.find(key);
+    if (found == _map.end()) return false;
+    unlink(&*found);
+    _weight -= found->second.weight;
+    _map.erase(found);
+    return true;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::clear() {
+    _map.clear();
+    _head = _tail = nullptr;
+    _weight = 0;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+template<typename Fn>
+void LRUCache<K, V, H, E, W>::for_each(Fn fn) const {
+    for (const element_type* element = _head; element != nullptr; element = element->second.next) {
+        fn(element->first, static_cast<const V&>(element->second.value));
+    }
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+LRUCacheStats LRUCache<K, V, H, E, W>::stats() const {
+    LRUCacheStats stats;
+    stats.size = size();
+    stats.weight = _weight;
+    stats.capacity = _capacity;
+    stats.hits = _hits;
+    stats.misses = _misses;
+    stats.evictions = _evictions;
+    if (_hits + _misses > 0) stats.hit_rate = static_cast<float>(_hits) / (_hits + _misses);
+    return stats;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::reset_counters() {
+    _hits = 0;
+    _misses = 0;
+    _evictions = 0;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+LRUCache<K, V, H, E, W>::LRUCache(const LRUCache<K, V, H, E, W>& cache) :
+    _map(cache._map.bucket_count(), cache._map.hash_function(), cache._map.key_eq()),
+    _weigher(cache._weigher),
+    _on_evict(cache._on_evict),
+    _head(nullptr),
+    _tail(nullptr),
+    _capacity(cache._capacity),
+    _weight(0),
+    _hits(cache._hits),
+    _misses(cache._misses),
+    _evictions(cache._evictions) {
+
+    copy_entries(cache);
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+LRUCache<K, V, H, E, W>::LRUCache(LRUCache<K, V, H, E, W>&& cache) :
+    _map(std::move(cache._map)),
+    _weigher(std::move(cache._weigher)),
+    _on_evict(std::move(cache._on_evict)),
+    _head(cache._head),
+    _tail(cache._tail),
+    _capacity(cache._capacity),
+    _weight(cache._weight),
+    _hits(cache._hits),
+    _misses(cache._misses),
+    _evictions(cache._evictions) {
+
+    cache._head = cache._tail = nullptr;
+    cache._weight = 0;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+LRUCache<K, V, H, E, W>& LRUCache<K, V, H, E, W>::operator=(const LRUCache<K, V, H, E, W>& cache) {
+    if (this == &cache) return *this;
+    clear();
+    _map = HashMap<K, Entry, H, E>(cache._map.bucket_count(), cache._map.hash_function(), cache._map.key_eq());
+    _weigher = cache._weigher;
+    _on_evict = cache._on_evict;
+    _capacity = cache._capacity;
+    _hits = cache._hits;
+    _misses = cache._misses;
+    _evictions = cache._evictions;
+    copy_entries(cache);
+    return *this;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+LRUCache<K, V, H, E, W>& LRUCache<K, V, H, E, W>::operator=(LRUCache<K, V, H, E, W>&& cache) {
+    if (this == &cache) return *this;
+    // HashMap's move assignment steals the nodes (the allocator is always std::allocator),
+    // so the pointers of the list stay valid
+    _map = std::move(cache._map);
+    _weigher = std::move(cache._weigher);
+    _on_evict = std::move(cache._on_evict);
+    _head = cache._head;
+    _tail = cache._tail;
+    _capacity = cache._capacity;
+    _weight = cache._weight;
+    _hits = cache._hits;
+    _misses = cache._misses;
+    _evictions = cache._evictions;
+    cache._head = cache._tail = nullptr;
+    cache._weight = 0;
+    return *this;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::push_front(element_type* element) {
+    Entry& entry = element->second;
+    entry.prev = nullptr;
+    entry.next = _head;
+    if (_head != nullptr) {
+        _head->second.prev = element;
+    } else {
+        _tail = element;
+    }
+    _head = element;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::unlink(element_type* element) {
+    Entry& entry = element->second;
+    if (entry.prev != nullptr) {
+        entry.prev->second.next = entry.next;
+    } else {
+        _head = entry.next;
+    }
+    if (entry.next != nullptr) {
+        entry.next->second.prev = entry.prev;
+    } else {
+        _tail = entry.prev;
+    }
+    entry.prev = entry.next = nullptr;
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::move_to_front(element_type* element) {
+    if (element == _head) return;
+    unlink(element);
+    push_front(element);
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::evict_to_fit(size_t incoming) {
+    while (_tail != nullptr && _weight + incoming > _capacity) {
+        evict_back();
+    }
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::evict_back() {
+    element_type* victim = _tail;
+    unlink(victim);
+    _weight -= victim->second.weight;
+    _evictions++;
+    // HashMap::erase finds the node before it destroys it, so passing the key of the
+    // victim itself is safe; it is erased even if the callback throws
+    try {
+        if (_on_evict) _on_evict(victim->first, victim->second.value);
+    } catch (...) {
+        _map.erase(victim->first);
+        throw;
+    }
+    _map.erase(victim->first);
+}
+
+template<typename K, typename V, typename H, typename E, typename W>
+void LRUCache<K, V, H, E, W>::copy_entries(const LRUCache<K, V, H, E, W>& cache) {
+    for (const element_type* element = cache._tail; element != nullptr; element = element->second.prev) {
+        const Entry& entry = element->second;
+        auto inserted = _map.try_emplace(element->first, V(entry.value), entry.weight).first;
+        push_front(&*inserted);
+        _weight += entry.weight;
+    }
+}
@@ -0,0 +1,238 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <functional>   // for std::function, std::equal_to
+#include <utility>      // for std::pair, std::move
+
+#include "hashmap.h"
+
+/*
+* The default weigher of LRUCache: every entry weighs 1, so the capacity is a number of entries.
+*/
+struct LruUnitWeight {
+    template <typename K, typename V>
+    size_t operator()(const K&, const V&) const { return 1; }
+};
+
+/*
+* A snapshot of the counters of an LRUCache, returned by LRUCache::stats().
+* hits and misses count the calls to get, evictions the entries dropped to make room.
+*/
+struct LRUCacheStats {
+    size_t size = 0;
+    size_t weight = 0;
+    size_t capacity = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    float hit_rate = 0;
+};
+
+/*
+* Template class for an LRUCache
+*
+* K = key type
+* V = value type
+* H = hash function type used to hash a key; if not provided, defaults to DefaultHash<K> (see hash_functions.h)
+* E = key equality function type used to compare two keys; if not provided, defaults to std::equal_to<K>
+* W = weigher type, with prototype size_t weigh(const K& key, const V& value); if not provided,
+*     defaults to LruUnitWeight (every entry weighs 1)
+*
+* A cache of at most capacity() weight that evicts the least recently used entries first.
+* With the default weigher the capacity is a number of entries; with a weigher that returns
+* the size of an entry in bytes, it is a memory budget.
+*
+* The usual way to build one, a HashMap from keys to std::list iterators plus the std::list,
+* allocates two nodes per entry and follows a pointer from the map node to the list node on
+* every hit. LRUCache keeps the recency list inside the HashMap instead: the mapped type is an
+* Entry that holds the value and the prev / next pointers of the list, so each entry is one
+* node, and a hit touches that node and its two neighbours. This relies on HashMap never
+* moving its elements: rehashing relinks the nodes, so the pointers stay valid.
+*
+*      - get: one lookup, then the entry is unlinked and relinked at the front. O(1) average.
+*      - put: one lookup (try_emplace), then the entries at the back are evicted until the
+*        weight fits, so for a moment the HashMap holds the new entry on top of a full cache.
+*        O(1) average, plus one erase per evicted entry.
+*      - eviction removes the entry at the back of the list, calling the eviction callback
+*        first, if there is one.
+*
+* Not thread-safe: get changes the recency list, so even lookups need external locking.
+*
+* Usage:
+*      LRUCache<std::string, Page> pages(1000);
+*      pages.on_evict([](const std::string& url, Page& page) { page.flush(); });
+*      if (Page* page = pages.get(url)) return *page;
+*      pages.put(url, fetch(url));
+*
+*      struct Bytes {
+*          size_t operator()(const std::string& key, const std::string& blob) const { return key.size() + blob.size(); }
+*      };
+*      LRUCache<std::string, std::string, DefaultHash<std::string>, std::equal_to<std::string>, Bytes> blobs(64 << 20);
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - E is function type that with function prototype bool equal(const K& lhs, const K& rhs).
+*      - K must be copyable, V movable.
+*/
+template<typename K, typename V, typename H = DefaultHash<K>, typename E = std::equal_to<K>,
+         typename W = LruUnitWeight>
+class LRUCache {
+public:
+    using eviction_callback = std::function<void(const K& key, V& value)>;
+
+    static constexpr size_t kInitialBuckets = 16;
+
+    /*
+    * Creates an empty cache that holds at most capacity weight.
+    *
+    * Complexity: O(1)
+    */
+    explicit LRUCache(size_t capacity, const W& weigher = W(), const H& hash = H(), const E& equal = E());
+
+    inline size_t size() const;
+    inline bool empty() const;
+
+    /*
+    * Returns the total weight of the entries, at most capacity().
+    */
+    inline size_t weight() const;
+
+    /*
+    * Returns or sets the capacity. A smaller capacity evicts entries right away until the
+    * weight fits.
+    *
+    * Complexity: O(1) to read, O(1) average per evicted entry to set
+    */
+    inline size_t capacity() const;
+    void capacity(size_t capacity);
+
+    /*
+    * Sets the function called with every entry evicted to make room, just before it is
+    * destroyed. It may move the value out, but must not use the cache. erase, clear and
+    * overwrites by put do not call it. Pass nullptr to remove it.
+    */
+    void on_evict(eviction_callback callback);
+
+    /*
+    * Returns a pointer to the value of key and marks the entry most recently used,
+    * or returns nullptr. Counts a hit or a miss.
+    *
+    * The pointer stays valid until the entry is evicted, erased or overwritten.
+    *
+    * Complexity: O(1) average case
+    */
+    V* get(const K& key);
+
+    /*
+    * Returns a pointer to the value of key, or nullptr, without marking the entry used
+    * or counting anything.
+    *
+    * Complexity: O(1) average case
+    */
+    const V* peek(const K& key) const;
+    bool contains(const K& key) const;
+
+    /*
+    * Inserts or overwrites the value of key, marks it most recently used, then evicts least
+    * recently used entries until the weight fits the capacity. The weight of the entry is
+    * computed here, once: changing a value through the pointer returned by get does not
+    * update it.
+    *
+    * An entry heavier than the whole capacity is not cached, and an older value of key is
+    * erased, so that get never returns a stale value.
+    *
+    * Complexity: O(1) average case, plus O(1) average per evicted entry
+    */
+    void put(const K& key, V value);
+
+    /*
+    * Removes key from the cache. Returns whether it was there.
+    *
+    * Complexity: O(1) average case
+    */
+    bool erase(const K& key);
+
+    /*
+    * Removes every entry. The counters are kept.
+    *
+    * Complexity: O(N)
+    */
+    void clear();
+
+    /*
+    * Calls fn(key, value) for every entry, from the most to the least recently used.
+    *
+    * Complexity: O(N)
+    */
+    template <typename Fn>
+    void for_each(Fn fn) const;
+
+    /*
+    * Returns the size, weight and capacity of the cache, and its counters since construction
+    * or the last reset_counters(). reset_counters() zeroes hits, misses and evictions.
+    */
+    LRUCacheStats stats() const;
+    void reset_counters();
+
+    /*
+    * Copies keep the recency order. Moves take the entries over in O(1) (the HashMap hands
+    * its nodes over, so the list stays valid) and leave the source empty, with its capacity.
+    */
+    LRUCache(const LRUCache<K, V, H, E, W>& cache);
+    LRUCache(LRUCache<K, V, H, E, W>&& cache);
+
+    LRUCache<K, V, H, E, W>& operator=(const LRUCache<K, V, H, E, W>& cache);
+    LRUCache<K, V, H, E, W>& operator=(LRUCache<K, V, H, E, W>&& cache);
+
+private:
+    struct Entry;
+    using element_type = std::pair<const K, Entry>;
+
+    /*
+    * The mapped type of the HashMap: the value, its weight, and the links of the recency list.
+    * prev points to the more recently used entry, next to the less recently used one.
+    */
+    struct Entry {
+        V value;
+        size_t weight;
+        element_type* prev = nullptr;
+        element_type* next = nullptr;
+
+        Entry(V&& value, size_t weight) : value(std::move(value)), weight(weight) {}
+    };
+
+    /*
+    * Recency list operations. push_front links an unlinked element at the front (most
+    * recently used), unlink takes an element out of the list.
+    */
+    void push_front(element_type* element);
+    void unlink(element_type* element);
+    void move_to_front(element_type* element);
+
+    /*
+    * Evicts from the back until incoming more weight fits the capacity.
+    */
+    void evict_to_fit(size_t incoming);
+    void evict_back();
+
+    /*
+    * Inserts the entries of cache from the least to the most recently used, so that they end
+    * up in the same order. This cache must be empty.
+    */
+    void copy_entries(const LRUCache<K, V, H, E, W>& cache);
+
+    /* Private member variables */
+    HashMap<K, Entry, H, E> _map;
+    W _weigher;
+    eviction_callback _on_evict;
+    element_type* _head;                    // most recently used, nullptr if empty
+    element_type* _tail;                    // least recently used, nullptr if empty
+    size_t _capacity;
+    size_t _weight;
+    size_t _hits;
+    size_t _misses;
+    size_t _evictions;
+};
+
+#include "lru_cache.cpp"
+#endif
@@ -0,0 +1,326 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <cstddef>      // for size_t
+#include <memory>       // for std::shared_ptr
+#include <new>          // for ::operator new
+#include <vector>
+#include <algorithm>    // for std::max, std::min, std::sort, std::upper_bound
+#include <cstring>      // for std::memcpy
+#include <type_traits>  // for std::true_type, std::false_type
+
+/*
+* NodePool
+*
+* A slab (pool) allocator for objects of one fixed size, typically the nodes of a
+* node-based container such as HashMap.
+*
+* Instead of asking the general purpose heap for every node, the pool requests large slabs
+* and carves them into equally sized chunks. Freed chunks are pushed onto an intrusive free
+* list (the first bytes of a free chunk store the next pointer), so allocate and deallocate
+* are a handful of instructions each. Slabs start small and double in size up to kMaxSlabBytes,
+* so tiny maps do not waste memory and large maps do not call the heap very often.
+*
+* The pool never gives memory back to the heap while it is alive, except through release(),
+* which drops every slab at once in O(#slabs). This is only correct when none of the chunks
+* need to be destroyed individually, which is for the owner of the pool to decide.
+*
+* Not thread safe: one pool should be used by one container at a time.
+*/
+class NodePool {
+public:
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    ~NodePool() { release(); }
+
+    /*
+    * Returns uninitialized memory for one object of object_size bytes.
+    * The first call fixes the chunk size of the pool; later calls must use the same size.
+    */
+    void* allocate(size_t object_size) {
+        if (_chunk_size == 0) _chunk_size = round_up_chunk(object_size);
+        if (_free_list != nullptr) {
+            FreeChunk* chunk = _free_list;
+            _free_list = chunk->next;
+            return chunk;
+        }
+        if (_bump == _bump_end) add_slab();
+        void* result = _bump;
+        _bump += _chunk_size;
+        return result;
+    }
+
+    /*
+    * Returns a chunk obtained from allocate to the free list.
+    */
+    void deallocate(void* ptr) {
+        FreeChunk* chunk = static_cast<FreeChunk*>(ptr);
+        chunk->next = _free_list;
+        _free_list = chunk;
+    }
+
+    /*
+    * Releases every slab at once. All memory handed out by this pool becomes invalid.
+    */
+    void release() {
+        for (auto& [slab, bytes] : _slabs) {
+            ::operator delete(slab);
+        }
+        _slabs.clear();
+        _free_list = nullptr;
+        _bump = _bump_end = nullptr;
+        _next_slab_bytes = kMinSlabBytes;
+    }
+
+    /*
+    * Returns whether this pool can hand out objects of object_size bytes.
+    */
+    bool serves(size_t object_size) const {
+        return _chunk_size == 0 || _chunk_size == round_up_chunk(object_size);
+    }
+
+    /*
+    * Maps a chunk of one pool to the chunk at the same offset in a copy made by copy_from.
+    * Slabs are looked up by binary search, with a shortcut for runs of chunks from one slab.
+    */
+    class Relocation {
+    public:
+        void* operator()(const void* ptr) const {
+            const char* address = static_cast<const char*>(ptr);
+            const Slab& slab = slab_of(address);
+            return slab.copy + (address - slab.source);
+        }
+
+    private:
+        friend class NodePool;
+        struct Slab {
+            const char* source;
+            char* copy;
+            size_t bytes;
+            size_t index;   // in the slab list of the copy
+        };
+
+        const Slab& slab_of(const char* address) const {
+            const Slab* last = &_slabs[_last];
+            if (address < last->source || address >= last->source + last->bytes) {
+                _last = std::upper_bound(_slabs.begin(), _slabs.end(), address,
+                                         [](const char* lhs, const Slab& rhs) { return lhs < rhs.source; }) - _slabs.begin() - 1;
+            }
+            return _slabs[_last];
+        }
+
+        std::vector<Slab> _slabs;   // sorted by source address
+        mutable size_t _last = 0;     // the slab found last, most lookups hit it again
+    };
+
+    /*
+    * Turns this pool, which must not have any slab yet, into a byte for byte copy of other: every
+    * slab is copied with one memcpy, and the chunks handed out and the free list are the same, at the
+    * same offsets. Only valid if the objects in other are trivially copyable. Then fix(chunk, relocation)
+    * is called for every chunk of the copy that is handed out (in address order within a slab), so
+    * that the owner can redirect the pointers stored in its objects: relocation maps any chunk of
+    * other to its copy, and is returned for the pointers to chunks that the owner keeps elsewhere.
+    *
+    * Complexity: O(bytes_reserved()) plus one call of fix per chunk handed out
+    */
+    template <typename Fix>
+    Relocation copy_from(const NodePool& other, Fix fix) {
+        Relocation relocation;
+        _chunk_size = other._chunk_size;
+        _next_slab_bytes = other._next_slab_bytes;
+        _slabs.reserve(other._slabs.size());
+        relocation._slabs.reserve(other._slabs.size());
+        try {
+            for (const auto& [slab, bytes] : other._slabs) {
+                char* copy = static_cast<char*>(::operator new(bytes));
+                _slabs.push_back({copy, bytes});
+                std::memcpy(copy, slab, bytes);
+                relocation._slabs.push_back({slab, copy, bytes, _slabs.size() - 1});
+            }
+        } catch (...) {
+            release();
+            throw;
+        }
+        if (_slabs.empty()) return relocation;
+        std::sort(relocation._slabs.begin(), relocation._slabs.end(),
+                  [](const auto& lhs, const auto& rhs) { return lhs.source < rhs.source; });
+        _bump_end = _slabs.back().first + _slabs.back().second;
+        _bump = _bump_end - (other._bump_end - other._bump);
+
+        // the copied free chunks still point into other, so the list is rebuilt in the same order,
+        // and they are flagged so that fix skips them. Only the last slab has chunks never handed out
+        std::vector<std::vector<bool>> free(_slabs.size());
+        for (size_t i = 0; i < _slabs.size(); i++) free[i].resize(_slabs[i].second / _chunk_size);
+        FreeChunk** link = &_free_list;
+        for (FreeChunk* chunk = other._free_list; chunk != nullptr; chunk = chunk->next) {
+            const auto& slab = relocation.slab_of(reinterpret_cast<const char*>(chunk));
+            size_t offset = reinterpret_cast<const char*>(chunk) - slab.source;
+            free[slab.index][offset / _chunk_size] = true;
+            *link = reinterpret_cast<FreeChunk*>(slab.copy + offset);
+            link = &(*link)->next;
+        }
+        *link = nullptr;
+
+        for (size_t i = 0; i < _slabs.size(); i++) {
+            char* end = i + 1 == _slabs.size() ? _bump : _slabs[i].first + _slabs[i].second;
+            size_t index = 0;
+            for (char* chunk = _slabs[i].first; chunk < end; chunk += _chunk_size, index++) {
+                if (!free[i][index]) fix(static_cast<void*>(chunk), relocation);
+            }
+        }
+        return relocation;
+    }
+
+    size_t slab_count() const { return _slabs.size(); }
+
+    size_t bytes_reserved() const {
+        size_t total = 0;
+        for (const auto& [slab, bytes] : _slabs) total += bytes;
+        return total;
+    }
+
+private:
+    struct FreeChunk {
+        FreeChunk* next;
+    };
+
+    static constexpr size_t kMinSlabBytes = 4096;
+    static constexpr size_t kMaxSlabBytes = 1 << 20;
+
+    /*
+    * sizeof(T) is always a multiple of alignof(T), so rounding up to the alignment of a pointer keeps
+    * every chunk aligned for any T that is not over-aligned (slabs come from ::operator new).
+    */
+    static size_t round_up_chunk(size_t object_size) {
+        size_t align = alignof(FreeChunk);
+        size_t size = std::max(object_size, sizeof(FreeChunk));
+        return (size + align - 1) / align * align;
+    }
+
+    void add_slab() {
+        size_t bytes = std::max(_next_slab_bytes, _chunk_size);
+        bytes = bytes / _chunk_size * _chunk_size;
+        char* slab = static_cast<char*>(::operator new(bytes));
+        _slabs.push_back({slab, bytes});
+        _bump = slab;
+        _bump_end = slab + bytes;
+        _next_slab_bytes = std::min(2 * _next_slab_bytes, kMaxSlabBytes);
+    }
+
+    size_t _chunk_size = 0;
+    size_t _next_slab_bytes = kMinSlabBytes;
+    std::vector<std::pair<char*, size_t>> _slabs;
+    FreeChunk* _free_list = nullptr;
+    char* _bump = nullptr;
+    char* _bump_end = nullptr;
+};
+
+/*
+* Template class for a PoolAllocator
+*
+* T = type of object being allocated
+*
+* A standard-conforming allocator on top of NodePool, meant to be plugged into HashMap:
+*
+*      HashMap<int, int, std::hash<int>, std::equal_to<int>, PoolAllocator<std::pair<const int, int>>> map;
+*
+* Copies of an allocator share the same pool (as the allocator requirements demand), and
+* rebinding (e.g. from the value_type to HashMap's internal Node type) keeps sharing it.
+* Single-object allocations of the pool's object size are served from the pool, anything
+* else (arrays, other sizes, over-aligned types) falls back to ::operator new.
+*
+* A copy of a container does not share the pool of the original, because
+* select_on_container_copy_construction returns an allocator with a brand new pool.
+*/
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    template <typename U> friend class PoolAllocator;
+
+    PoolAllocator() : _pool(std::make_shared<NodePool>()) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : _pool(other._pool) {}
+
+    T* allocate(size_t n) {
+        if (n == 1 && served_by_pool()) {
+            return static_cast<T*>(_pool->allocate(sizeof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        if (n == 1 && served_by_pool()) {
+            _pool->deallocate(ptr);
+        } else {
+            ::operator delete(ptr);
+        }
+    }
+
+    PoolAllocator select_on_container_copy_construction() const {
+        return PoolAllocator();
+    }
+
+    /*
+    * Returns whether no other allocator shares this pool, in which case a container
+    * is allowed to drop all of its elements at once with release().
+    */
+    bool owns_pool_exclusively() const {
+        return _pool.use_count() == 1;
+    }
+
+    /*
+    * Frees every slab of the pool in O(#slabs). Only valid if the caller knows that no
+    * object allocated from the pool needs its destructor to run, and nobody else uses the pool.
+    */
+    void release() {
+        _pool->release();
+    }
+
+    /*
+    * Makes the pool of this allocator, which must be empty, a copy of the pool of other,
+    * see NodePool::copy_from.
+    */
+    template <typename U, typename Fix>
+    NodePool::Relocation copy_pool(const PoolAllocator<U>& other, Fix fix) {
+        return _pool->copy_from(*other._pool, fix);
+    }
+
+    const NodePool& pool() const { return *_pool; }
+
+    template <typename U>
+    friend bool operator==(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) {
+        return lhs._pool == rhs._pool;
+    }
+
+    template <typename U>
+    friend bool operator!=(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) {
+        return lhs._pool != rhs._pool;
+    }
+
+private:
+    bool served_by_pool() const {
+        return alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ && _pool->serves(sizeof(T));
+    }
+
+    std::shared_ptr<NodePool> _pool;
+};
+
+/*
+* Type trait telling containers whether an allocator supports dropping all
+* of its memory at once (through owns_pool_exclusively() and release()).
+*/
+template <typename Alloc>
+struct supports_bulk_release : std::false_type {};
+
+template <typename T>
+struct supports_bulk_release<PoolAllocator<T>> : std::true_type {};
+
+#endif
@@ -0,0 +1,408 @@
+
+#include "robin_hood_hashmap.h"
+
+template<typename K, typename M, typename H>
+RobinHoodHashMap<K, M, H>::RobinHoodHashMap() : RobinHoodHashMap(kMinCapacity) {};
+
+template<typename K, typename M, typename H>
+RobinHoodHashMap<K, M, H>::RobinHoodHashMap(size_t bucket_count, const H& hash):
+    _size(0),
+    _capacity(0),
+    _max_probe(0),
+    _hash_function(hash),
+    _slots(nullptr) {
+    size_t capacity = normalize_capacity(bucket_count);
+    initialize(capacity, max_probe_for(capacity));
+};
+
+template<typename K, typename M, typename H>
+RobinHoodHashMap<K, M, H>::~RobinHoodHashMap() {
+    destroy_slots();
+    std::allocator<value_type>().deallocate(_slots, slot_count());
+}
+
+template<typename K, typename M, typename H>
+inline size_t RobinHoodHashMap<K, M, H>::size() const {
+    return _size;
+}
+
+template<typename K, typename M, typename H>
+inline bool RobinHoodHashMap<K, M, H>::empty() const {
+    return _size == 0;
+}
+
+template<typename K, typename M, typename H>
+inline float RobinHoodHashMap<K, M, H>::load_factor() const {
+    return ((float) _size) / _capacity;
+}
+
+template<typename K, typename M, typename H>
+inline size_t RobinHoodHashMap<K, M, H>::bucket_count() const {
+    return _capacity;
+}
+
+template<typename K, typename M, typename H>
+bool RobinHoodHashMap<K, M, H>::contains(const K& key) const {
+    return find_index(key, hash_of(key)) != npos;
+}
+
+template<typename K, typename M, typename H>
+M& RobinHoodHashMap<K, M, H>::at(const K& key) {
+    size_t index = find_index(key, hash_of(key));
+    if (index == npos) throw std::out_of_range("RobinHoodHashMap<K, M, H>::at: key not found");
+    return _slots[index].second;
+}
+
+template<typename K, typename M, typename H>
+const M& RobinHoodHashMap<K, M, H>::at(const K& key) const {
+    return static_cast<const M&>(const_cast<RobinHoodHashMap<K, M, H> *>(this)->at(key));
+}
+
+template<typename K, typename M, typename H>
+void RobinHoodHashMap<K, M, H>::clear() {
+    destroy_slots();
+    std::fill(_dist.begin(), _dist.begin() + slot_count(), kEmpty);
+    _size = 0;
+}
+
+template<typename K, typename M, typename H>
+std::pair<typename RobinHoodHashMap<K, M, H>::iterator, bool> RobinHoodHashMap<K, M, H>::insert(const value_type& kv_pair) {
+    size_t hash = hash_of(kv_pair.first);
+    size_t index = find_index(kv_pair.first, hash);
+    if (index != npos) return {make_iterator(index), false};
+
+    index = insert_unique(hash, value_type(kv_pair));
+    return {make_iterator(index), true};
+}
+
+template<typename K, typename M, typename H>
+bool RobinHoodHashMap<K, M, H>::erase(const K& key) {
+    size_t index = find_index(key, hash_of(key));
+    if (index == npos) return false;
+    erase_at(index);
+    return true;
+}
+
+template<typename K, typename M, typename H>
+typename RobinHoodHashMap<K, M, H>::iterator RobinHoodHashMap<K, M, H>::erase(const_iterator pos) {
+    size_t index = pos._ctrl - _dist.data();
+    if (index >= slot_count()) return end();
+    erase_at(index);
+
+    // probes never wrap around, so the element shifted into index (if any) has not been visited yet
+    iterator temp = make_iterator(index);
+    if (!is_full(_dist[index])) ++temp;
+    return temp;
+}
+
+template<typename K, typename M, typename H>
+void RobinHoodHashMap<K, M, H>::rehash(size_t new_buckets) {
+    if (new_buckets == 0) throw std::out_of_range("RobinHoodHashMap<K,M,H>::rehash: Invalid Input Parameters");
+    size_t new_capacity = normalize_capacity(new_buckets);
+    while (max_load(new_capacity) < _size) new_capacity *= 2;
+    resize(new_capacity, std::max(max_probe_for(new_capacity), _max_probe));
+}
+
+template<typename K, typename M, typename H>
+std::vector<size_t> RobinHoodHashMap<K, M, H>::probe_length_histogram() const {
+    std::vector<size_t> histogram;
+    for (size_t i = 0; i < slot_count(); i++) {
+        if (!is_full(_dist[i])) continue;
+        size_t probe_length = _dist[i] - 1;
+        if (histogram.size() <= probe_length) histogram.resize(probe_length + 1, 0);
+        histogram[probe_length]++;
+    }
+    return histogram;
+}
+
+template<typename K, typename M, typename H>
+typename RobinHoodHashMap<K, M, H>::iterator RobinHoodHashMap<K, M, H>::begin() {
+    iterator iter(_dist.data(), _slots);
+    if (!is_full(_dist[0])) ++iter;
+    return iter;
+}
+
+template<typename K, typename M, typename H>
+typename RobinHoodHashMap<K, M, H>::const_iterator RobinHoodHashMap<K, M, H>::begin() const {
+    return const_cast<RobinHoodHashMap<K, M, H> *>(this)->begin();
+}
+
+template<typename K, typename M, typename H>
+typename RobinHoodHashMap<K, M, H>::iterator RobinHoodHashMap<K, M, H>::end() {
+    return make_iterator(slot_count());
+}
+
+template<typename K, typename M, typename H>
+typename RobinHoodHashMap<K, M, H>::const_iterator RobinHoodHashMap<K, M, H>::end() const {
+    return const_cast<RobinHoodHashMap<K, M, H> *>(this)->end();
+}
+
+template<typename K, typename M, typename H>
+typename RobinHoodHashMap<K, M, H>::iterator RobinHoodHashMap<K, M, H>::find(const K& key) {
+    size_t index = find_index(key, hash_of(key));
+    return make_iterator(index == npos ? slot_count() : index);
+}
+
+template<typename K, typename M, typename H>
+typename RobinHoodHashMap<K, M, H>::const_iterator RobinHoodHashMap<K, M, H>::find(const K& key) const {
+    return const_cast<RobinHoodHashMap<K, M, H> *>(this)->find(key);
+}
+
+template<typename K, typename M, typename H>
+void RobinHoodHashMap<K, M, H>::debug() {
+    std::cout << "RobinHoodHashMap Debug Info:" << std::endl;
+    std::cout << "Capacity=" << bucket_count() << " Size=" << size() << " Load Factor=" << load_factor()
+              << " Max Probe=" << _max_probe << std::endl;
+    for (size_t i = 0; i < slot_count(); i++) {
+        std::cout << "Slot-" << i << ": ";
+        if (is_full(_dist[i])) {
+            std::cout << "[psl " << _dist[i] - 1 << "] " << _slots[i].first << "-" << _slots[i].second;
+        }
+        std::cout << std::endl;
+    }
+}
+
+template<typename K, typename M, typename H>
+template<typename InputIter>
+RobinHoodHashMap<K, M, H>::RobinHoodHashMap(InputIter begin, InputIter end, size_t bucket_count, const H& hash):
+    RobinHoodHashMap(bucket_count, hash) {
+    for (InputIter iter = begin; iter != end; iter++) {
+        insert(*iter);
+    }
+}
+
+template<typename K, typename M, typename H>
+RobinHoodHashMap<K, M, H>::RobinHoodHashMap(std::initializer_list<value_type> init, size_t bucket_count, const H& hash):
+    RobinHoodHashMap(init.begin(), init.end(), bucket_count, hash) {}
+
+template<typename K, typename M, typename H>
+M& RobinHoodHashMap<K, M, H>::operator[](const K& key) {
+    size_t hash = hash_of(key);
+    size_t index = find_index(key, hash);
+    if (index != npos) return _slots[index].second;
+
+    index = insert_unique(hash, value_type(key, M()));
+    return _slots[index].second;
+}
+
+template<typename K, typename M, typename H>
+RobinHoodHashMap<K, M, H>::RobinHoodHashMap(const RobinHoodHashMap<K, M, H>& map):
+    RobinHoodHashMap(map._capacity, map._hash_function) {
+    for (const auto& kv_pair : map) {
+        insert(kv_pair);
+    }
+}
+
+template<typename K, typename M, typename H>
+RobinHoodHashMap<K, M, H>::RobinHoodHashMap(RobinHoodHashMap<K, M, H>&& map):
+    _size(map._size),
+    _capacity(map._capacity),
+    _max_probe(map._max_probe),
+    _hash_function(std::move(map._hash_function)),
+    _dist(std::move(map._dist)),
+    _slots(map._slots) {
+
+    map._slots = nullptr;
+    map.initialize(kMinCapacity, max_probe_for(kMinCapacity));
+}
+
+template<typename K, typename M, typename H>
+RobinHoodHashMap<K, M, H>& RobinHoodHashMap<K, M, H>::operator=(const RobinHoodHashMap<K, M, H>& map) {
+    if (this == &map) return *this;
+    clear();
+    _hash_function = map._hash_function;
+    for (const auto& kv_pair : map) {
+        insert(kv_pair);
+    }
+    return *this;
+}
+
+template<typename K, typename M, typename H>
+RobinHoodHashMap<K, M, H>& RobinHoodHashMap<K, M, H>::operator=(RobinHoodHashMap<K, M, H>&& map) {
+    if (this == &map) return *this;
+    destroy_slots();
+    std::allocator<value_type>().deallocate(_slots, slot_count());
+
+    _size = map._size;
+    _capacity = map._capacity;
+    _max_probe = map._max_probe;
+    _hash_function = std::move(map._hash_function);
+    _dist = std::move(map._dist);
+    _slots = map._slots;
+
+    map._slots = nullptr;
+    map.initialize(kMinCapacity, max_probe_for(kMinCapacity));
+    return *this;
+}
+
+template<typename K, typename M, typename H>
+size_t RobinHoodHashMap<K, M, H>::normalize_capacity(size_t bucket_count) {
+    size_t capacity = kMinCapacity;
+    while (capacity < bucket_count) capacity *= 2;
+    return capacity;
+}
+
+template<typename K, typename M, typename H>
+size_t RobinHoodHashMap<K, M, H>::max_probe_for(size_t capacity) {
+    // Robin Hood hashing keeps the longest PSL in O(log N), allow twice that much
+    size_t bits = 0;
+    while ((size_t(1) << bits) < capacity) bits++;
+    return std::max<size_t>(8, 2 * bits);
+}
+
+template<typename K, typename M, typename H>
+size_t RobinHoodHashMap<K, M, H>::find_index(const K& key, size_t hash) const {
+    size_t index = home(hash);
+    // dist is PSL + 1, the same encoding as the metadata bytes. An empty slot (0) or a
+    // slot whose element is closer to its home than we are to ours ends the search.
+    for (ctrl_t dist = 1; _dist[index] >= dist; index++, dist++) {
+        if (_dist[index] == dist && _slots[index].first == key) return index;
+    }
+    return npos;
+}
+
+template<typename K, typename M, typename H>
+size_t RobinHoodHashMap<K, M, H>::insert_unique(size_t hash, value_type&& kv_pair) {
+    while (true) {
+        if (_size + 1 > max_load(_capacity)) {
+            resize(_capacity * 2, std::max(max_probe_for(_capacity * 2), _max_probe));
+            continue;
+        }
+
+        size_t index = home(hash);
+        ctrl_t dist = 1;
+        while (_dist[index] >= dist) {
+            index++;
+            dist++;
+        }
+        if (try_place(index, dist, std::move(kv_pair))) {
+            ++_size;
+            return index;
+        }
+        grow_for_probe_length();
+    }
+}
+
+template<typename K, typename M, typename H>
+void RobinHoodHashMap<K, M, H>::grow_for_probe_length() {
+    // In a reasonably full table a long probe sequence just means we are due to grow.
+    // In a sparse table it means many keys share (nearly) the same hash, and doubling
+    // the capacity would not separate them, so allow longer probe sequences instead.
+    if (_size >= _capacity / 4) {
+        resize(_capacity * 2, std::max(max_probe_for(_capacity * 2), _max_probe));
+    } else if (_max_probe < kMaxProbeLimit) {
+        resize(_capacity, std::min(kMaxProbeLimit, 2 * _max_probe));
+    } else {
+        throw std::length_error("RobinHoodHashMap<K, M, H>::insert: too many keys share a probe sequence");
+    }
+}
+
+template<typename K, typename M, typename H>
+bool RobinHoodHashMap<K, M, H>::try_place(size_t index, ctrl_t dist, value_type&& kv_pair) {
+    if (dist > _max_probe) return false;
+
+    // Displacing the richer element at index and letting it continue its probe is the same
+    // as shifting the whole run [index, first empty slot) one slot to the right, because
+    // PSLs grow by at most one along a run. Check that no shifted element exceeds _max_probe.
+    size_t last = index;
+    while (_dist[last] != kEmpty) {
+        if (last + 1 == slot_count() || _dist[last] >= _max_probe) return false;
+        last++;
+    }
+
+    for (size_t i = last; i > index; i--) {
+        new (&_slots[i]) value_type(std::move(_slots[i - 1]));
+        _slots[i - 1].~value_type();
+        _dist[i] = _dist[i - 1] + 1;
+    }
+    new (&_slots[index]) value_type(std::move(kv_pair));
+    _dist[index] = dist;
+    return true;
+}
+
+template<typename K, typename M, typename H>
+void RobinHoodHashMap<K, M, H>::erase_at(size_t index) {
+    _slots[index].~value_type();
+
+    // backward-shift deletion: pull the following elements one slot closer to their home,
+    // until we reach an empty slot or an element that already lives in its home slot.
+    size_t i = index;
+    while (is_full(_dist[i + 1]) && _dist[i + 1] > 1) {
+        new (&_slots[i]) value_type(std::move(_slots[i + 1]));
+        _slots[i + 1].~value_type();
+        _dist[i] = _dist[i + 1] - 1;
+        i++;
+    }
+    _dist[i] = kEmpty;
+    --_size;
+}
+
+template<typename K, typename M, typename H>
+void RobinHoodHashMap<K, M, H>::resize(size_t new_capacity, size_t new_max_probe) {
+    std::vector<ctrl_t> old_dist = std::move(_dist);
+    value_type* old_slots = _slots;
+    size_t old_slot_count = slot_count();
+
+    // insert_unique may itself grow the new table if a probe gets too long,
+    // which is fine because the old arrays are only released at the end.
+    initialize(new_capacity, new_max_probe);
+    for (size_t i = 0; i < old_slot_count; i++) {
+        if (!is_full(old_dist[i])) continue;
+        insert_unique(hash_of(old_slots[i].first), std::move(old_slots[i]));
+        old_slots[i].~value_type();
+    }
+    std::allocator<value_type>().deallocate(old_slots, old_slot_count);
+}
+
+template<typename K, typename M, typename H>
+void RobinHoodHashMap<K, M, H>::initialize(size_t capacity, size_t max_probe) {
+    _size = 0;
+    _capacity = capacity;
+    _max_probe = max_probe;
+    _dist.assign(slot_count() + 1, kEmpty);
+    _dist[slot_count()] = kSentinel;
+    _slots = std::allocator<value_type>().allocate(slot_count());
+}
+
+template<typename K, typename M, typename H>
+void RobinHoodHashMap<K, M, H>::destroy_slots() {
+    if (_size == 0) return;
+    for (size_t i = 0; i < slot_count(); i++) {
+        if (is_full(_dist[i])) _slots[i].~value_type();
+    }
+}
+
+template<typename K, typename M, typename H>
+typename RobinHoodHashMap<K, M, H>::iterator RobinHoodHashMap<K, M, H>::make_iterator(size_t index) {
+    return iterator(&_dist[index], _slots + index);
+}
+
+template<typename K, typename M, typename H>
+std::ostream& operator<<(std::ostream& stream, const RobinHoodHashMap<K, M, H>& map) {
+    std::stringstream str_stream;
+    for (const auto& kv_pair : map) {
+        str_stream << kv_pair.first << ":" << kv_pair.second << ", ";
+    }
+    std::string str = str_stream.str();
+    if (str.size() != 0) {
+        str.erase(str.size() - 2, 2);
+    }
+
+    stream << "{" << str << "}";
+    return stream;
+}
+
+template<typename K, typename M, typename H>
+bool operator==(const RobinHoodHashMap<K, M, H>& lhs, const RobinHoodHashMap<K, M, H>& rhs) {
+    if (lhs.size() != rhs.size()) return false;
+    for (const auto& kv_pair : lhs) {
+        auto iter = rhs.find(kv_pair.first);
+        if (iter == rhs.end() || iter->second != kv_pair.second) return false;
+    }
+    return true;
+}
+
+template<typename K, typename M, typename H>
+bool operator!=(const RobinHoodHashMap<K, M, H>& lhs, const RobinHoodHashMap<K, M, H>& rhs) {
+    return !(lhs == rhs);
+}
@@ -0,0 +1,184 @@
+#ifndef ROBIN_HOOD_HASHMAP_H
+#define ROBIN_HOOD_HASHMAP_H
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <memory>       // for std::allocator
+#include <cstdint>      // for uint8_t
+#include <stdexcept>    // for std::out_of_range
+#include <algorithm>    // for std::fill
+
+#include "flat_hashmap_iterator.h"
+#include "hash_functions.h"
+
+/*
+* Template class for a RobinHoodHashMap
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* RobinHoodHashMap has the same public interface and the same iterator class template as
+* FlatHashMap, so code written against HashMap-like containers (e.g. a benchmark templated
+* on the map type) can switch to it by changing a single template argument.
+*
+* It is an open-addressing table with linear probing and Robin Hood displacement:
+*
+*      - every slot stores its probe-sequence length (PSL), i.e. the distance from the slot
+*        the element hashes to (its home) to where it actually lives.
+*      - on insert, an element that has travelled further than the occupant of a slot
+*        takes that slot ("steals from the rich"). This keeps all PSLs short and similar,
+*        and guarantees that along a probe sequence the PSLs never grow by more than one.
+*      - as a consequence, an unsuccessful lookup can stop as soon as it reaches a slot whose
+*        PSL is smaller than the distance it has probed so far: the key would have been placed
+*        there. Miss-heavy workloads therefore touch only a handful of consecutive slots.
+*      - erase does not leave tombstones. The elements following the erased one are shifted
+*        back by one slot (backward-shift deletion) until an empty slot or an element that
+*        is already in its home slot is found.
+*
+* Probes never wrap around: the slot array has _max_probe extra slots past the last home
+* slot, and the table grows whenever an insert would need a PSL larger than _max_probe.
+* Capacity is always a power of two. If a hash function maps so many keys to the same value
+* that no probe limit below 253 can hold them, insert throws std::length_error.
+*
+* Iterator invalidation: insert may move elements (both by growing and by displacement), so it
+* invalidates all iterators, pointers and references. erase(key) invalidates everything at or
+* after the erased slot; erase(pos) returns a valid iterator to the element following pos.
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - K and M must be regular (copyable, default constructible, and equality comparable).
+*/
+template<typename K, typename M, typename H = std::hash<K>>
+class RobinHoodHashMap {
+public:
+    using value_type = std::pair<const K, M>;
+    using iterator = FlatHashMapIterator<RobinHoodHashMap, false>;
+    using const_iterator = FlatHashMapIterator<RobinHoodHashMap, true>;
+
+    friend class FlatHashMapIterator<RobinHoodHashMap, false>;
+    friend class FlatHashMapIterator<RobinHoodHashMap, true>;
+
+    RobinHoodHashMap();
+
+    /*
+    * Constructor with bucket_count and hash function as parameters.
+    * bucket_count is the minimal number of home slots, rounded up to a power of two.
+    *
+    * Complexity: O(B), B = number of slots
+    */
+    explicit RobinHoodHashMap(size_t bucket_count, const H& hash = H());
+    ~RobinHoodHashMap();
+
+    inline size_t size() const;
+    inline bool empty() const;
+    inline float load_factor() const;
+    inline size_t bucket_count() const;
+
+    /*
+    * The following functions behave exactly like their HashMap counterparts,
+    * see hashmap.h for the documentation.
+    *
+    * Complexity: O(1) average case. Both hits and misses inspect O(average PSL) slots.
+    */
+    bool contains(const K& key) const;
+    M& at(const K& key);
+    const M& at(const K& key) const;
+    std::pair<iterator, bool> insert(const value_type& val);
+    bool erase(const K& key);
+    iterator erase(const_iterator pos);
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    M& operator[](const K& key);
+    void clear();
+
+    /*
+    * Rebuilds the table with at least new_buckets home slots, but never fewer than what
+    * is needed to hold size() elements under the maximum load factor.
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0.
+    *
+    * Complexity: O(N + B)
+    */
+    void rehash(size_t new_buckets);
+
+    /*
+    * Returns the probe-sequence length distribution of the elements in the map:
+    * result[d] is the number of elements that live d slots away from their home slot.
+    * result.size() - 1 is therefore the longest probe sequence in the table.
+    *
+    * Usage:
+    *      auto histogram = map.probe_length_histogram();
+    *      std::cout << "elements in their home slot: " << histogram[0];
+    *
+    * Complexity: O(B), B = number of slots
+    */
+    std::vector<size_t> probe_length_histogram() const;
+
+    iterator begin();
+    const_iterator begin() const;
+    iterator end();
+    const_iterator end() const;
+
+    /*
+    * Prints the size, capacity, and each occupied slot together with its PSL.
+    */
+    void debug();
+
+    template<typename InputIter>
+    RobinHoodHashMap(InputIter begin, InputIter end, size_t bucket_count = kMinCapacity, const H& hash = H());
+    RobinHoodHashMap(std::initializer_list<value_type> init, size_t bucket_count = kMinCapacity, const H& hash = H());
+
+    RobinHoodHashMap(const RobinHoodHashMap<K, M, H>& map);
+    RobinHoodHashMap(RobinHoodHashMap<K, M, H>&& map);
+
+    RobinHoodHashMap<K, M, H>& operator=(const RobinHoodHashMap<K, M, H>& map);
+    RobinHoodHashMap<K, M, H>& operator=(RobinHoodHashMap<K, M, H>&& map);
+
+private:
+    /*
+    * Metadata byte of a slot: 0 if the slot is empty, PSL + 1 otherwise.
+    * One extra byte holding kSentinel ends the array for the iterators.
+    */
+    using ctrl_t = uint8_t;
+    static constexpr ctrl_t kEmpty = 0;
+    static constexpr ctrl_t kSentinel = 255;
+
+    static bool is_full(ctrl_t ctrl) { return ctrl != kEmpty && ctrl != kSentinel; }
+    static bool is_sentinel(ctrl_t ctrl) { return ctrl == kSentinel; }
+
+    static constexpr size_t kMinCapacity = 16;
+    static constexpr size_t kMaxProbeLimit = 253;   // PSL + 1 must stay below kSentinel
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    size_t hash_of(const K& key) const { return hash_mix(_hash_function(key)); }
+    static size_t max_load(size_t capacity) { return capacity - capacity / 8; }
+    static size_t normalize_capacity(size_t bucket_count);
+    static size_t max_probe_for(size_t capacity);
+
+    size_t slot_count() const { return _capacity + _max_probe; }
+    size_t home(size_t hash) const { return hash & (_capacity - 1); }
+
+    size_t find_index(const K& key, size_t hash) const;
+    size_t insert_unique(size_t hash, value_type&& kv_pair);
+    bool try_place(size_t index, ctrl_t dist, value_type&& kv_pair);
+    void grow_for_probe_length();
+    void erase_at(size_t index);
+    void resize(size_t new_capacity, size_t new_max_probe);
+    void initialize(size_t capacity, size_t max_probe);
+    void destroy_slots();
+    iterator make_iterator(size_t index);
+
+    /* Private member variables */
+    size_t _size;
+    size_t _capacity;           // number of home slots, a power of two
+    size_t _max_probe;          // longest allowed PSL, also the number of overflow slots
+    H _hash_function;
+    std::vector<ctrl_t> _dist;  // slot_count() metadata bytes followed by one kSentinel
+    value_type* _slots;         // slot_count() slots, only the full ones hold constructed elements
+};
+
+#include "robin_hood_hashmap.cpp"
+#endif
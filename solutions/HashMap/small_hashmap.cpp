@@ -0,0 +1,274 @@
+#include "small_hashmap.h"
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+SmallHashMap<K, M, N, H, E, A>::SmallHashMap() :
+    _hash_function(H()),
+    _key_equal(E()),
+    _allocator(A()),
+    _size(0) {};
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+SmallHashMap<K, M, N, H, E, A>::SmallHashMap(const H& hash, const E& equal, const A& alloc) :
+    _hash_function(hash),
+    _key_equal(equal),
+    _allocator(alloc),
+    _size(0) {};
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+SmallHashMap<K, M, N, H, E, A>::SmallHashMap(std::initializer_list<value_type> init, const H& hash, const E& equal,
+                                             const A& alloc) :
+    SmallHashMap(hash, equal, alloc) {
+    for (const value_type& value : init) {
+        insert(value);
+    }
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+SmallHashMap<K, M, N, H, E, A>::~SmallHashMap() {
+    destroy_inline();
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+inline size_t SmallHashMap<K, M, N, H, E, A>::size() const {
+    return _hashed != nullptr ? _hashed->size() : _size;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+inline bool SmallHashMap<K, M, N, H, E, A>::empty() const {
+    return size() == 0;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+inline bool SmallHashMap<K, M, N, H, E, A>::is_inline() const {
+    return _hashed == nullptr;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+bool SmallHashMap<K, M, N, H, E, A>::contains(const K& key) const {
+    return _hashed != nullptr ? _hashed->contains(key) : find_inline(key) != nullptr;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+size_t SmallHashMap<K, M, N, H, E, A>::count(const K& key) const {
+    return contains(key) ? 1 : 0;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+M& SmallHashMap<K, M, N, H, E, A>::at(const K& key) {
+    if (_hashed != nullptr) return _hashed->at(key);
+    value_type* element = find_inline(key);
+    if (element == nullptr) throw std::out_of_range("SmallHashMap<K, M, N, H, E, A>::at: key not found");
+    return element->second;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+const M& SmallHashMap<K, M, N, H, E, A>::at(const K& key) const {
+    return static_cast<const M&>(const_cast<SmallHashMap<K, M, N, H, E, A> *>(this)->at(key));
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+typename SmallHashMap<K, M, N, H, E, A>::iterator SmallHashMap<K, M, N, H, E, A>::find(const K& key) {
+    if (_hashed != nullptr) return iterator(nullptr, _hashed->find(key));
+    value_type* element = find_inline(key);
+    return element != nullptr ? iterator(element, {}) : end();
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+typename SmallHashMap<K, M, N, H, E, A>::const_iterator SmallHashMap<K, M, N, H, E, A>::find(const K& key) const {
+    // HashMap's const find does not advance an incremental rehash, so this one stays read-only too
+    if (_hashed != nullptr) return const_iterator(nullptr, static_cast<const hashed_map&>(*_hashed).find(key));
+    value_type* element = find_inline(key);
+    return element != nullptr ? const_iterator(element, {}) : end();
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+std::pair<typename SmallHashMap<K, M, N, H, E, A>::iterator, bool>
+SmallHashMap<K, M, N, H, E, A>::insert(const value_type& value) {
+    return try_emplace(value.first, value.second);
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+std::pair<typename SmallHashMap<K, M, N, H, E, A>::iterator, bool>
+SmallHashMap<K, M, N, H, E, A>::insert(value_type&& value) {
+    return try_emplace(value.first, std::move(value.second));
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+template<typename... Args>
+std::pair<typename SmallHashMap<K, M, N, H, E, A>::iterator, bool>
+SmallHashMap<K, M, N, H, E, A>::try_emplace(const K& key, Args&&... args) {
+    if (_hashed == nullptr) {
+        value_type* element = find_inline(key);
+        if (element != nullptr) return {iterator(element, {}), false};
+        if (_size < N) {
+            element = slots() + _size;
+            new (element) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                                     std::forward_as_tuple(std::forward<Args>(args)...));
+            _size++;
+            return {iterator(element, {}), true};
+        }
+        // args may refer to an inline element, so the new element is built before they are moved
+        return {iterator(nullptr, switch_to_hashed(key, std::forward<Args>(args)...)), true};
+    }
+    auto [hashed, inserted] = _hashed->try_emplace(key, std::forward<Args>(args)...);
+    return {iterator(nullptr, hashed), inserted};
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+M& SmallHashMap<K, M, N, H, E, A>::operator[](const K& key) {
+    return try_emplace(key).first->second;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+bool SmallHashMap<K, M, N, H, E, A>::erase(const K& key) {
+    if (_hashed != nullptr) return _hashed->erase(key);
+    value_type* element = find_inline(key);
+    if (element == nullptr) return false;
+    // the last element fills the hole, so the inline elements stay contiguous
+    value_type* last = slots() + _size - 1;
+    element->~value_type();
+    if (element != last) {
+        new (element) value_type(std::move(*last));
+        last->~value_type();
+    }
+    _size--;
+    return true;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+void SmallHashMap<K, M, N, H, E, A>::clear() {
+    destroy_inline();
+    _hashed.reset();
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+typename SmallHashMap<K, M, N, H, E, A>::iterator SmallHashMap<K, M, N, H, E, A>::begin() {
+    if (_hashed != nullptr) return iterator(nullptr, _hashed->begin());
+    return iterator(slots(), {});
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+typename SmallHashMap<K, M, N, H, E, A>::const_iterator SmallHashMap<K, M, N, H, E, A>::begin() const {
+    return const_cast<SmallHashMap<K, M, N, H, E, A> *>(this)->begin();
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+typename SmallHashMap<K, M, N, H, E, A>::iterator SmallHashMap<K, M, N, H, E, A>::end() {
+    if (_hashed != nullptr) return iterator(nullptr, _hashed->end());
+    return iterator(slots() + _size, {});
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+typename SmallHashMap<K, M, N, H, E, A>::const_iterator SmallHashMap<K, M, N, H, E, A>::end() const {
+    return const_cast<SmallHashMap<K, M, N, H, E, A> *>(this)->end();
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+SmallHashMap<K, M, N, H, E, A>::SmallHashMap(const SmallHashMap<K, M, N, H, E, A>& map) :
+    _hash_function(map._hash_function),
+    _key_equal(map._key_equal),
+    _allocator(std::allocator_traits<A>::select_on_container_copy_construction(map._allocator)),
+    _size(0) {
+
+    if (map._hashed != nullptr) {
+        _hashed = std::make_unique<hashed_map>(*map._hashed);
+    } else {
+        copy_inline(map);
+    }
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+SmallHashMap<K, M, N, H, E, A>::SmallHashMap(SmallHashMap<K, M, N, H, E, A>&& map) :
+    _hash_function(std::move(map._hash_function)),
+    _key_equal(std::move(map._key_equal)),
+    _allocator(map._allocator),
+    _size(0),
+    _hashed(std::move(map._hashed)) {
+
+    // the HashMap changes hands in O(1), inline elements have to be moved one by one
+    move_inline(map);
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+SmallHashMap<K, M, N, H, E, A>& SmallHashMap<K, M, N, H, E, A>::operator=(const SmallHashMap<K, M, N, H, E, A>& map) {
+    if (this == &map) return *this;
+    clear();
+    _hash_function = map._hash_function;
+    _key_equal = map._key_equal;
+    if (map._hashed != nullptr) {
+        _hashed = std::make_unique<hashed_map>(*map._hashed);
+    } else {
+        copy_inline(map);
+    }
+    return *this;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+SmallHashMap<K, M, N, H, E, A>& SmallHashMap<K, M, N, H, E, A>::operator=(SmallHashMap<K, M, N, H, E, A>&& map) {
+    if (this == &map) return *this;
+    clear();
+    _hash_function = std::move(map._hash_function);
+    _key_equal = std::move(map._key_equal);
+    _allocator = map._allocator;
+    _hashed = std::move(map._hashed);
+    move_inline(map);
+    return *this;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+typename SmallHashMap<K, M, N, H, E, A>::value_type* SmallHashMap<K, M, N, H, E, A>::find_inline(const K& key) const {
+    value_type* elements = const_cast<SmallHashMap<K, M, N, H, E, A> *>(this)->slots();
+    for (size_t i = 0; i < _size; i++) {
+        if (_key_equal(elements[i].first, key)) return elements + i;
+    }
+    return nullptr;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+template<typename... Args>
+typename SmallHashMap<K, M, N, H, E, A>::hashed_map::iterator
+SmallHashMap<K, M, N, H, E, A>::switch_to_hashed(const K& key, Args&&... args) {
+    auto hashed = std::make_unique<hashed_map>(2 * N, _hash_function, _key_equal, _allocator);
+    auto inserted = hashed->try_emplace(key, std::forward<Args>(args)...).first;
+    // N more elements fit into 2 * N buckets without a rehash, so inserted stays valid
+    for (size_t i = 0; i < _size; i++) {
+        hashed->insert(std::move_if_noexcept(slots()[i]));
+    }
+    destroy_inline();
+    _hashed = std::move(hashed);
+    return inserted;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+void SmallHashMap<K, M, N, H, E, A>::copy_inline(const SmallHashMap<K, M, N, H, E, A>& map) {
+    try {
+        for (; _size < map._size; _size++) {
+            new (slots() + _size) value_type(map.slots()[_size]);
+        }
+    } catch (...) {
+        destroy_inline();
+        throw;
+    }
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+void SmallHashMap<K, M, N, H, E, A>::move_inline(SmallHashMap<K, M, N, H, E, A>& map) {
+    try {
+        for (; _size < map._size; _size++) {
+            new (slots() + _size) value_type(std::move(map.slots()[_size]));
+        }
+    } catch (...) {
+        destroy_inline();
+        map.destroy_inline();
+        throw;
+    }
+    map.destroy_inline();
+}
+
+template<typename K, typename M, size_t N, typename H, typename E, typename A>
+void SmallHashMap<K, M, N, H, E, A>::destroy_inline() {
+    for (size_t i = 0; i < _size; i++) {
+        slots()[i].~value_type();
+    }
+    _size = 0;
+}
@@ -0,0 +1,166 @@
+#ifndef SMALL_HASHMAP_H
+#define SMALL_HASHMAP_H
+
+#include <memory>       // for std::unique_ptr, std::allocator
+#include <new>          // for std::launder
+#include <stdexcept>    // for std::out_of_range
+#include <utility>      // for std::pair, std::move, std::move_if_noexcept
+#include <tuple>        // for std::forward_as_tuple
+#include <functional>   // for std::equal_to
+#include <initializer_list>
+
+#include "hashmap.h"
+#include "small_hashmap_iterator.h"
+
+/*
+* Template class for a SmallHashMap
+*
+* K = key type
+* M = mapped type
+* N = inline capacity: how many elements fit in the object itself (default 8)
+* H = hash function type used to hash a key; if not provided, defaults to DefaultHash<K> (see hash_functions.h)
+* E = key equality function type used to compare two keys; if not provided, defaults to std::equal_to<K>
+* A = allocator type of the HashMap used past the inline capacity
+*
+* SmallHashMap has the core interface of HashMap, and is built for programs that keep a great
+* many maps of a handful of elements each (e.g. the attributes of every user):
+*
+*      - up to N elements live inline, in an array inside the object. A default-constructed
+*        SmallHashMap allocates nothing (a HashMap allocates its bucket array and occupancy bitmap),
+*        and inserting up to N elements allocates nothing either (a HashMap allocates one node per
+*        element).
+*      - lookups in the inline array are a linear search with E. For a handful of elements, that
+*        is a few compares in one or two cache lines, with no hash to compute and no pointer to chase.
+*      - the (N + 1)-th insert moves every element into a HashMap, allocated on the heap, and the
+*        map stays hashed until clear(), which destroys the HashMap and returns to inline storage.
+*        Staying hashed when erase brings the size back under N avoids moving the elements back
+*        and forth when the size hovers around the capacity.
+*
+* Iterators: in inline mode, an iterator is a pointer into the array, and iteration visits the
+* elements in insertion order until the first erase, which moves the last element into the hole.
+* Any insert may invalidate iterators (the switch to hashed storage moves every element), and
+* erase invalidates iterators to the erased and to the last element. In hashed mode, the
+* guarantees of HashMap apply.
+*
+* Usage:
+*      std::vector<SmallHashMap<std::string, std::string>> attributes(users);
+*      attributes[user]["locale"] = "en_US";
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - E is function type that with function prototype bool equal(const K& lhs, const K& rhs).
+*      - K and M must be copyable or movable.
+*/
+template<typename K, typename M, size_t N = 8, typename H = DefaultHash<K>, typename E = std::equal_to<K>,
+         typename A = std::allocator<std::pair<const K, M>>>
+class SmallHashMap {
+public:
+    using value_type = std::pair<const K, M>;
+    using hashed_map = HashMap<K, M, H, E, A>;
+    using iterator = SmallHashMapIterator<SmallHashMap, false>;
+    using const_iterator = SmallHashMapIterator<SmallHashMap, true>;
+
+    friend class SmallHashMapIterator<SmallHashMap, false>;
+    friend class SmallHashMapIterator<SmallHashMap, true>;
+
+    static_assert(N > 0, "SmallHashMap needs room for at least one inline element");
+
+    /*
+    * Default constructor: creates an empty map in inline mode. Allocates nothing.
+    *
+    * Complexity: O(1)
+    */
+    SmallHashMap();
+    explicit SmallHashMap(const H& hash, const E& equal = E(), const A& alloc = A());
+    SmallHashMap(std::initializer_list<value_type> init, const H& hash = H(), const E& equal = E(),
+                 const A& alloc = A());
+
+    ~SmallHashMap();
+
+    inline size_t size() const;
+    inline bool empty() const;
+
+    /*
+    * Returns whether the elements are stored inline (true) or in a HashMap (false).
+    */
+    inline bool is_inline() const;
+
+    /*
+    * The following functions behave exactly like their HashMap counterparts,
+    * see hashmap.h for the documentation. at throws std::out_of_range if key is not in the map.
+    *
+    * Complexity: O(N) compares in inline mode, O(1) average case in hashed mode.
+    * An insert that switches to hashed mode costs O(N) more.
+    */
+    bool contains(const K& key) const;
+    size_t count(const K& key) const;
+    M& at(const K& key);
+    const M& at(const K& key) const;
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+
+    std::pair<iterator, bool> insert(const value_type& value);
+    std::pair<iterator, bool> insert(value_type&& value);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+    M& operator[](const K& key);
+    bool erase(const K& key);
+
+    /*
+    * Erases every element, destroys the HashMap if there is one, and returns to inline mode.
+    *
+    * Complexity: O(size())
+    */
+    void clear();
+
+    iterator begin();
+    const_iterator begin() const;
+    iterator end();
+    const_iterator end() const;
+
+    SmallHashMap(const SmallHashMap<K, M, N, H, E, A>& map);
+    SmallHashMap(SmallHashMap<K, M, N, H, E, A>&& map);
+
+    SmallHashMap<K, M, N, H, E, A>& operator=(const SmallHashMap<K, M, N, H, E, A>& map);
+    SmallHashMap<K, M, N, H, E, A>& operator=(SmallHashMap<K, M, N, H, E, A>&& map);
+
+private:
+    /*
+    * The inline array. Only the first _size slots hold constructed elements.
+    */
+    value_type* slots() { return std::launder(reinterpret_cast<value_type*>(_storage)); }
+    const value_type* slots() const { return std::launder(reinterpret_cast<const value_type*>(_storage)); }
+
+    /*
+    * Returns the inline element with the given key, or nullptr. Only valid in inline mode.
+    */
+    value_type* find_inline(const K& key) const;
+
+    /*
+    * Creates a HashMap with room for 2 * N elements, emplaces the new element {key, args...}
+    * into it first, while args may still refer to inline elements, then moves every inline
+    * element over and returns an iterator to the new element.
+    * If that throws, the map stays inline with all its elements, but the elements already
+    * moved over (all those whose move constructor cannot throw) are left in a moved-from state.
+    */
+    template <typename... Args>
+    typename hashed_map::iterator switch_to_hashed(const K& key, Args&&... args);
+
+    /*
+    * Copies (or moves) the elements of map, an inline map, into this map, which must be empty and inline.
+    */
+    void copy_inline(const SmallHashMap<K, M, N, H, E, A>& map);
+    void move_inline(SmallHashMap<K, M, N, H, E, A>& map);
+    void destroy_inline();
+
+    /* Private member variables */
+    H _hash_function;
+    E _key_equal;
+    A _allocator;
+    size_t _size;                           // number of inline elements, 0 in hashed mode
+    std::unique_ptr<hashed_map> _hashed;    // the elements once there are more than N, else nullptr
+    alignas(value_type) unsigned char _storage[N * sizeof(value_type)];
+};
+
+#include "small_hashmap.cpp"
+#endif
@@ -0,0 +1,125 @@
+#ifndef SMALL_HASHMAP_ITERATOR_H
+#define SMALL_HASHMAP_ITERATOR_H
+
+#include <iterator>     // for std::forward_iterator_tag
+#include <functional>   // for std::conditional_t
+
+/*
+* Template class for an iterator over a SmallHashMap.
+*
+* Map = the type of map this class is an iterator for.
+* IsConst = whether this is a const_iterator class.
+*
+* A SmallHashMap keeps its elements either inline, in a plain array, or in a HashMap once it has
+* outgrown the array. The iterator is a pointer into the array in the first case (nullptr otherwise)
+* and an iterator of the HashMap in the second, and moves whichever one is in use.
+*
+* Concept requirements:
+* - Map must define the types value_type and hashed_map (the HashMap used past the inline capacity).
+*/
+template <typename Map, bool IsConst = true>
+class SmallHashMapIterator {
+public:
+    /*
+    * Same aliases as HashMapIterator, so code written against one iterator
+    * type compiles against the other.
+    */
+    using value_type = std::conditional_t<IsConst, const typename Map::value_type, typename Map::value_type>;
+    using iterator_category =   std::forward_iterator_tag;
+    using difference_type   =   std::ptrdiff_t;
+    using pointer           =   value_type*;
+    using reference         =   value_type&;
+
+    friend Map;
+    friend SmallHashMapIterator<Map, true>;
+    friend SmallHashMapIterator<Map, false>;
+
+    /*
+    * Conversion operator: converts any iterator (iterator or const_iterator) to a const_iterator.
+    *
+    * Usage:
+    *      iterator iter = map.begin();
+    *      const_iterator c_iter = iter;    // implicit conversion
+    */
+    operator SmallHashMapIterator<Map, true>() const {
+        return SmallHashMapIterator<Map, true>(_inline, _hashed);
+    }
+
+    reference operator*() const;
+    pointer operator->() const;
+
+    SmallHashMapIterator<Map, IsConst>& operator++();
+    SmallHashMapIterator<Map, IsConst> operator++(int);
+
+    template <typename Map_, bool IsConst_>
+    friend bool operator==(const SmallHashMapIterator<Map_, IsConst_>& lhs, const SmallHashMapIterator<Map_, IsConst_>& rhs);
+
+    template <typename Map_, bool IsConst_>
+    friend bool operator!=(const SmallHashMapIterator<Map_, IsConst_>& lhs, const SmallHashMapIterator<Map_, IsConst_>& rhs);
+
+    SmallHashMapIterator(const SmallHashMapIterator<Map, IsConst>& rhs) = default;
+    SmallHashMapIterator<Map, IsConst>& operator=(const SmallHashMapIterator<Map, IsConst>& rhs) = default;
+
+    SmallHashMapIterator(SmallHashMapIterator<Map, IsConst>&& rhs) = default;
+    SmallHashMapIterator<Map, IsConst>& operator=(SmallHashMapIterator<Map, IsConst>&& rhs) = default;
+
+private:
+    using hashed_iterator = std::conditional_t<IsConst, typename Map::hashed_map::const_iterator,
+                                               typename Map::hashed_map::iterator>;
+
+    /*
+    * Instance variables: the element in the inline array (one past the last element for end()),
+    * or nullptr if the map is hashed, and the HashMap iterator used in that case.
+    */
+    value_type* _inline;
+    hashed_iterator _hashed;
+
+    /*
+    * Private constructor, only SmallHashMaps can hand out iterators.
+    */
+    SmallHashMapIterator(value_type* element, hashed_iterator hashed);
+};
+
+template<typename Map, bool IsConst>
+typename SmallHashMapIterator<Map, IsConst>::reference SmallHashMapIterator<Map, IsConst>::operator*() const {
+    return _inline != nullptr ? *_inline : *_hashed;
+}
+
+template<typename Map, bool IsConst>
+typename SmallHashMapIterator<Map, IsConst>::pointer SmallHashMapIterator<Map, IsConst>::operator->() const {
+    return &**this;
+}
+
+template<typename Map, bool IsConst>
+SmallHashMapIterator<Map, IsConst>::SmallHashMapIterator(value_type* element, hashed_iterator hashed):
+    _inline(element),
+    _hashed(hashed) {};
+
+template<typename Map, bool IsConst>
+SmallHashMapIterator<Map, IsConst>& SmallHashMapIterator<Map, IsConst>::operator++() {
+    if (_inline != nullptr) {
+        ++_inline;
+    } else {
+        ++_hashed;
+    }
+    return *this;
+}
+
+template<typename Map, bool IsConst>
+SmallHashMapIterator<Map, IsConst> SmallHashMapIterator<Map, IsConst>::operator++(int) {
+    SmallHashMapIterator<Map, IsConst> temp = *this;
+    ++(*this);
+    return temp;
+}
+
+template<typename Map, bool IsConst>
+bool operator==(const SmallHashMapIterator<Map, IsConst>& lhs, const SmallHashMapIterator<Map, IsConst>& rhs) {
+    return lhs._inline == rhs._inline && lhs._hashed == rhs._hashed;
+}
+
+template <typename Map, bool IsConst>
+bool operator!=(const SmallHashMapIterator<Map, IsConst>& lhs, const SmallHashMapIterator<Map, IsConst>& rhs) {
+    return !(lhs == rhs);
+}
+
+#endif
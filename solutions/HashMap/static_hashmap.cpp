@@ -0,0 +1,139 @@
+#include "static_hashmap.h"
+
+template<typename K, typename M, size_t N, typename H, typename E>
+constexpr StaticHashMap<K, M, N, H, E>::StaticHashMap(const std::array<std::pair<K, M>, N>& elements,
+                                                      const H& hash, const E& equal) :
+    StaticHashMap(elements, build(elements, hash, equal), hash, equal, std::make_index_sequence<N>()) {};
+
+template<typename K, typename M, size_t N, typename H, typename E>
+template<size_t... I>
+constexpr StaticHashMap<K, M, N, H, E>::StaticHashMap(const std::array<std::pair<K, M>, N>& elements,
+                                                      const Layout& layout, const H& hash, const E& equal,
+                                                      std::index_sequence<I...>) :
+    _hash_function(hash),
+    _key_equal(equal),
+    _seed(layout.seed),
+    _displacements(layout.displacements),
+    _slots(layout.slots),
+    _elements{{value_type(elements[I])...}} {};
+
+template<typename K, typename M, size_t N, typename H, typename E>
+constexpr bool StaticHashMap<K, M, N, H, E>::contains(const K& key) const {
+    return find(key) != end();
+}
+
+template<typename K, typename M, size_t N, typename H, typename E>
+constexpr size_t StaticHashMap<K, M, N, H, E>::count(const K& key) const {
+    return contains(key) ? 1 : 0;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E>
+constexpr const M& StaticHashMap<K, M, N, H, E>::at(const K& key) const {
+    const_iterator found = find(key);
+    if (found == end()) throw std::out_of_range("StaticHashMap<K, M, N, H, E>::at: key not found");
+    return found->second;
+}
+
+template<typename K, typename M, size_t N, typename H, typename E>
+constexpr typename StaticHashMap<K, M, N, H, E>::const_iterator StaticHashMap<K, M, N, H, E>::find(const K& key) const {
+    if constexpr (N == 0) {
+        return end();
+    } else {
+        uint64_t hash = _hash_function(key, _seed);
+        const value_type* element = &_elements[_slots[slot_of(hash, _displacements[bucket_of(hash)])]];
+        return _key_equal(element->first, key) ? element : end();
+    }
+}
+
+template<typename K, typename M, size_t N, typename H, typename E>
+constexpr typename StaticHashMap<K, M, N, H, E>::Layout
+StaticHashMap<K, M, N, H, E>::build(const std::array<std::pair<K, M>, N>& elements, const H& hash, const E& equal) {
+    Layout layout;
+    for (uint32_t attempt = 0; attempt < kMaxSeeds; attempt++) {
+        layout = Layout();
+        layout.seed = hash_avalanche(attempt);
+        if (try_build(elements, hash, equal, layout)) return layout;
+    }
+    throw std::length_error("StaticHashMap<K, M, N, H, E>: no seed gives every key its own slot");
+}
+
+template<typename K, typename M, size_t N, typename H, typename E>
+constexpr bool StaticHashMap<K, M, N, H, E>::try_build(const std::array<std::pair<K, M>, N>& elements,
+                                                       const H& hash, const E& equal, Layout& layout) {
+    // group the elements by bucket (a counting sort)
+    std::array<uint64_t, N> hashes{};
+    std::array<size_t, kBuckets + 1> bucket_start{};
+    for (size_t i = 0; i < N; i++) {
+        hashes[i] = hash(elements[i].first, layout.seed);
+        bucket_start[bucket_of(hashes[i]) + 1]++;
+    }
+    size_t largest = 0;
+    for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+        largest = bucket_start[bucket + 1] > largest ? bucket_start[bucket + 1] : largest;
+        bucket_start[bucket + 1] += bucket_start[bucket];
+    }
+    std::array<size_t, N> members{};
+    std::array<size_t, kBuckets> next{};
+    for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+        next[bucket] = bucket_start[bucket];
+    }
+    for (size_t i = 0; i < N; i++) {
+        members[next[bucket_of(hashes[i])]++] = i;
+    }
+
+    // place the largest buckets first, while most slots are free
+    std::array<bool, kSlots> taken{};
+    std::array<size_t, N> found{};
+    for (size_t bucket_size = largest; bucket_size > 0; bucket_size--) {
+        for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+            size_t first = bucket_start[bucket], last = bucket_start[bucket + 1];
+            if (last - first != bucket_size) continue;
+
+            // equal keys have equal hashes, and so do a few different keys under an unlucky seed
+            for (size_t i = first; i < last; i++) {
+                for (size_t j = first; j < i; j++) {
+                    if (hashes[members[i]] != hashes[members[j]]) continue;
+                    if (equal(elements[members[i]].first, elements[members[j]].first)) {
+                        throw std::out_of_range("StaticHashMap<K, M, N, H, E>: duplicate key");
+                    }
+                    return false;
+                }
+            }
+
+            bool placed = false;
+            for (uint32_t attempt = 0; attempt < kMaxDisplacements && !placed; attempt++) {
+                uint64_t displacement = hash_avalanche(uint64_t(attempt) + 1);
+                placed = true;
+                for (size_t i = first; i < last && placed; i++) {
+                    found[i - first] = slot_of(hashes[members[i]], displacement);
+                    if (taken[found[i - first]]) placed = false;
+                    for (size_t j = 0; j < i - first && placed; j++) {
+                        if (found[j] == found[i - first]) placed = false;
+                    }
+                }
+                if (!placed) continue;
+                layout.displacements[bucket] = displacement;
+                for (size_t i = first; i < last; i++) {
+                    taken[found[i - first]] = true;
+                    layout.slots[found[i - first]] = static_cast<uint32_t>(members[i]);
+                }
+            }
+            if (!placed) return false;
+        }
+    }
+    return true;
+}
+
+/*
+* Copies a built-in array into a std::array (std::pair is not assignable in constant expressions).
+*/
+template<typename T, size_t N, size_t... I>
+constexpr std::array<T, N> static_hash_map_elements(const T (&elements)[N], std::index_sequence<I...>) {
+    return {{elements[I]...}};
+}
+
+template<typename K, typename M, typename H, typename E, size_t N>
+constexpr StaticHashMap<K, M, N, H, E> make_static_hash_map(const std::pair<K, M> (&elements)[N],
+                                                            const H& hash, const E& equal) {
+    return StaticHashMap<K, M, N, H, E>(static_hash_map_elements(elements, std::make_index_sequence<N>()), hash, equal);
+}
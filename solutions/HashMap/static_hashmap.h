@@ -0,0 +1,189 @@
+#ifndef STATIC_HASHMAP_H
+#define STATIC_HASHMAP_H
+
+#include <array>
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint32_t, uint64_t
+#include <functional>   // for std::equal_to
+#include <stdexcept>    // for std::out_of_range, std::length_error
+#include <string_view>
+#include <type_traits>  // for std::enable_if_t, std::is_integral, std::is_enum
+#include <utility>      // for std::pair, std::index_sequence
+
+#include "hash_functions.h"
+
+/*
+* Default hash function of StaticHashMap: a seeded hash that can run at compile time, which
+* std::hash cannot. Provided for integer and enum keys and for std::string_view (FNV-1a over
+* the characters, then mixed). Other key types need their own H, with the prototype
+*
+*      constexpr uint64_t hash(const K& key, uint64_t seed) const;
+*/
+template<typename K, typename = void>
+struct StaticHash;
+
+template<typename K>
+struct StaticHash<K, std::enable_if_t<std::is_integral<K>::value || std::is_enum<K>::value>> {
+    constexpr uint64_t operator()(K key, uint64_t seed) const {
+        return hash_avalanche(static_cast<uint64_t>(key) ^ seed);
+    }
+};
+
+template<>
+struct StaticHash<std::string_view> {
+    constexpr uint64_t operator()(std::string_view key, uint64_t seed) const {
+        uint64_t hash = 0xcbf29ce484222325ull ^ seed;
+        for (char c : key) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3ull;
+        }
+        return hash_avalanche(hash);
+    }
+};
+
+/*
+* Template class for a StaticHashMap
+*
+* K = key type
+* M = mapped type
+* N = number of elements, fixed at compile time
+* H = seeded hash function type, see StaticHash; if not provided, defaults to StaticHash<K>
+* E = key equality function type used to compare two keys; if not provided, defaults to std::equal_to<K>
+*
+* StaticHashMap is a lookup table whose contents are known when the program is compiled, such as
+* protocol opcodes or keyword lists. Declared constexpr, the whole table is computed by the compiler
+* and lives in read-only data: building it costs nothing at startup and allocates nothing.
+*
+*      - the table has kSlots = a power of two of at least 1.25 N slots. Each slot holds the index
+*        of an element (a uint32_t); the elements themselves are stored in declaration order.
+*      - the slot of a key is a perfect hash, in the style of FrozenHashMap: the keys are split
+*        into kBuckets buckets of about 4 keys, and every bucket stores a displacement, chosen at
+*        compile time so that no two keys share a slot. The seed of H is chosen at compile time
+*        too: if a seed makes two different keys hash alike, or a bucket does not fit, the next
+*        one is tried.
+*      - a lookup hashes the key, reads the displacement of its bucket (a shift and a mask), mixes
+*        it into the hash, masks that down to the slot, and compares the key of the element in
+*        the slot. There is no probing and no loop. Empty slots point at the first element, which
+*        lives in another slot, so they can never match.
+*
+* Usage:
+*      constexpr auto opcodes = make_static_hash_map<std::string_view, int>({
+*          {"add", 0x01}, {"sub", 0x02}, {"mul", 0x03}, {"jmp", 0x10},
+*      });
+*      static_assert(opcodes.at("mul") == 0x03);
+*      int code = opcodes.at(token);               // at run time: a hash, masks and one compare
+*
+* Exceptions: a duplicate key throws std::out_of_range, and a set of keys that no seed can separate
+* throws std::length_error. In a constexpr declaration both become compile errors.
+*
+* Concept requirements:
+*      - K and M are literal types (e.g. integers, enums, std::string_view), for the map to be
+*        built at compile time. String keys should be std::string_view: std::equal_to<const char*>
+*        would compare the pointers.
+*      - H and E are constexpr function objects.
+*      - N fits in a uint32_t. The compiler evaluates O(N) loops at compile time, so the table is
+*        meant for up to a few thousand elements.
+*/
+template<typename K, typename M, size_t N, typename H = StaticHash<K>, typename E = std::equal_to<K>>
+class StaticHashMap {
+public:
+    using value_type = std::pair<const K, M>;
+    using iterator = const value_type*;
+    using const_iterator = const value_type*;
+
+    /*
+    * Builds the map from N elements. make_static_hash_map below deduces N from a braced list.
+    *
+    * Complexity: O(N) expected, at compile time if the map is declared constexpr.
+    */
+    constexpr StaticHashMap(const std::array<std::pair<K, M>, N>& elements, const H& hash = H(), const E& equal = E());
+
+    constexpr size_t size() const { return N; }
+    constexpr bool empty() const { return N == 0; }
+
+    /*
+    * The following functions behave exactly like their HashMap counterparts,
+    * see hashmap.h for the documentation. at throws std::out_of_range if key is not in the map.
+    *
+    * Complexity: O(1) worst case: one hash, one displacement, one key compare.
+    */
+    constexpr bool contains(const K& key) const;
+    constexpr size_t count(const K& key) const;
+    constexpr const M& at(const K& key) const;
+    constexpr const_iterator find(const K& key) const;
+
+    /*
+    * Iteration visits the elements in the order they were given to the constructor.
+    */
+    constexpr const_iterator begin() const { return _elements.data(); }
+    constexpr const_iterator end() const { return _elements.data() + N; }
+
+    /*
+    * The number of slots of the table and the seed chosen for H.
+    */
+    static constexpr size_t slot_count() { return kSlots; }
+    constexpr uint64_t seed() const { return _seed; }
+
+private:
+    static constexpr size_t round_up_pow2(size_t n) {
+        size_t result = 1;
+        while (result < n) result *= 2;
+        return result;
+    }
+
+    static constexpr size_t kSlots = round_up_pow2(N + N / 4 + 1);
+    static constexpr size_t kBuckets = round_up_pow2((N + 3) / 4);
+    static constexpr uint32_t kMaxDisplacements = 1 << 16;     // tried per bucket before a new seed
+    static constexpr uint32_t kMaxSeeds = 64;
+
+    /*
+    * Everything the constructor computes before it copies the elements.
+    */
+    struct Layout {
+        uint64_t seed = 0;
+        std::array<uint64_t, kBuckets> displacements{};
+        std::array<uint32_t, kSlots> slots{};     // the index of the element in each slot, 0 if empty
+    };
+
+    /*
+    * bucket_of takes the bucket from the high half of the hash, slot_of the slot from the low
+    * bits of the hash after mixing in the displacement, so the two are independent.
+    */
+    static constexpr size_t bucket_of(uint64_t hash) { return (hash >> 32) & (kBuckets - 1); }
+    static constexpr size_t slot_of(uint64_t hash, uint64_t displacement) {
+        return hash_avalanche(hash ^ displacement) & (kSlots - 1);
+    }
+
+    /*
+    * build tries seeds until try_build places every element with one of them.
+    * try_build returns false if this seed does not work.
+    */
+    static constexpr Layout build(const std::array<std::pair<K, M>, N>& elements, const H& hash, const E& equal);
+    static constexpr bool try_build(const std::array<std::pair<K, M>, N>& elements, const H& hash, const E& equal,
+                                    Layout& layout);
+
+    template<size_t... I>
+    constexpr StaticHashMap(const std::array<std::pair<K, M>, N>& elements, const Layout& layout, const H& hash,
+                            const E& equal, std::index_sequence<I...>);
+
+    /* Private member variables */
+    H _hash_function;
+    E _key_equal;
+    uint64_t _seed;
+    std::array<uint64_t, kBuckets> _displacements;
+    std::array<uint32_t, kSlots> _slots;
+    std::array<value_type, N> _elements;
+};
+
+/*
+* Builds a StaticHashMap from a braced list of elements, deducing N.
+*
+* Usage:
+*      constexpr auto keywords = make_static_hash_map<std::string_view, Token>({{"if", Token::If}, ...});
+*/
+template<typename K, typename M, typename H = StaticHash<K>, typename E = std::equal_to<K>, size_t N>
+constexpr StaticHashMap<K, M, N, H, E> make_static_hash_map(const std::pair<K, M> (&elements)[N],
+                                                            const H& hash = H(), const E& equal = E());
+
+#include "static_hashmap.cpp"
+#endif
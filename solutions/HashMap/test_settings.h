@@ -65,5 +65,94 @@
 #define RUN_TEST_4G 1
 #define RUN_TEST_4H 1
 
+// Extension: open-addressing FlatHashMap
+#define RUN_TEST_6A 1
+#define RUN_TEST_6B 1
+
+// Extension: RobinHoodHashMap
+#define RUN_TEST_7A 1
+#define RUN_TEST_7B 1
+
+// Extension: automatic growth and shrinking of HashMap
+#define RUN_TEST_8A 1
+
+// Extension: pooled node allocator
+#define RUN_TEST_9A 1
+#define RUN_TEST_9B 1
+
+// Extension: cached hash values in HashMap nodes
+#define RUN_TEST_10A 1
+
+// Extension: heterogeneous lookup
+#define RUN_TEST_11A 1
+
+// Extension: emplace, try_emplace, insert_or_assign, update
+#define RUN_TEST_12A 1
+
+// Extension: batched lookups
+#define RUN_TEST_13A 1
+
+// Extension: ConcurrentHashMap
+#define RUN_TEST_14A 1
+#define RUN_TEST_14B 1
+#define RUN_TEST_14C 1
+
+// Extension: incremental rehash
+#define RUN_TEST_15A 1
+
+// Extension: parallel rehash
+#define RUN_TEST_16A 1
+
+// Extension: bulk construction from random-access ranges
+#define RUN_TEST_17A 1
+
+// Extension: occupancy bitmap
+#define RUN_TEST_18A 1
+
+// Extension: DenseHashMap
+#define RUN_TEST_19A 1
+#define RUN_TEST_19B 1
+
+// Extension: HashMap::stats() (in hashmap_stats_test.cpp)
+#define RUN_TEST_20A 1
+
+// Extension: binary snapshots (save / load)
+#define RUN_TEST_21A 1
+#define RUN_TEST_21B 1
+
+// Extension: FrozenHashMap
+#define RUN_TEST_22A 1
+#define RUN_TEST_22B 1
+
+// Extension: structure-preserving copies
+#define RUN_TEST_23A 1
+#define RUN_TEST_23B 1
+
+// Extension: set algebra (merge, intersect_with, difference_with, symmetric_difference)
+#define RUN_TEST_24A 1
+#define RUN_TEST_24B 1
+#define RUN_TEST_24C 1
+
+// Extension: StaticHashMap
+#define RUN_TEST_25A 1
+#define RUN_TEST_25B 1
+
+// Extension: SmallHashMap
+#define RUN_TEST_26A 1
+#define RUN_TEST_26B 1
+
+// Extension: hash functions
+#define RUN_TEST_27A 1
+#define RUN_TEST_27B 1
+
+// Extension: Bloom filter in front of HashMap
+#define RUN_TEST_28A 1
+#define RUN_TEST_28B 1
+#define RUN_TEST_28C 1
+
+// Extension: LRUCache
+#define RUN_TEST_29A 1
+#define RUN_TEST_29B 1
+
 // Milestone 5: benchmark (optional)
 #define RUN_TEST_PERF 1